@@ -0,0 +1,1068 @@
+#include "Graphics/MeshBounds.h"
+#include "Graphics/Meshlets.h"
+#include "Graphics/ObjParser.h"
+#include "Graphics/VertexHashTable.h"
+#include "ParallelFor.h"
+#include "ProcGen/DiamondSquare.h"
+#include "ProcGen/DistanceField.h"
+#include "ProcGen/HeightfieldCodec.h"
+#include "ProcGen/HydraulicErosionReference.h"
+#include "ProcGen/MapFilters.h"
+#include "ProcGen/NavMesh.h"
+#include "ProcGen/StrataColumns.h"
+#include "ProcGen/TerrainMaterialBaker.h"
+#include "ProcGen/ThermalErosionReference.h"
+#include "ProcGen/WaterBodies.h"
+#include "ProcGen/WaterChunks.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+Throughput of the CPU terrain pipeline: every hydraulic and thermal erosion pass, diamond-square, the map filters
+against plain clamped loops, the material bakers, the heightfield codec, the nav mesh build, water body labelling, shore
+distances, the water chunk culling and the OBJ parsing, vertex deduplication, mesh bounds, meshlet build and meshlet
+culling of the model loader and renderer run on the map as a mesh, over a range of map sizes and thread counts. Needs no
+GPU.
+
+	radBenchmark [--sizes 256,1024,4096,8192] [--threads 1,2,4] [--stages A,B] [--repeats 3] [--min-sample-ms 50]
+				 [--out file.json]
+
+Results go to stdout (or --out) as JSON, progress to stderr. Every sample runs the stage until MinSampleMs has passed
+and keeps the time per run, the best of the repeats is reported. Bytes per cell are the compulsory traffic of the stage,
+every plane it touches read or written once per pass, so bytesPerSecond is a lower bound of the bandwidth it needs.
+scalingEfficiency is the 1 thread time over the N thread time, divided by N. Stages left out by --stages still run once
+untimed, later stages may use their output. Some stages add metrics about their output, such as the share of work saved.
+*/
+
+namespace
+{
+
+using namespace rad;
+using namespace rad::proc;
+
+// Strata take up to 128 B per column, larger maps skip their stages
+constexpr uint32_t MaxStrataSize = 4096;
+// A vertex and six corners per cell, 68 B before the deduplicated copy
+constexpr uint32_t MaxMeshSize = 2048;
+// The nav mesh voxelizes a cell per height sample, several spans and a hash map of vertices per tile
+constexpr uint32_t MaxNavMeshSize = 2048;
+// The map written as an OBJ takes about 200 B per cell on disk
+constexpr uint32_t MaxObjSize = 1024;
+
+struct Options
+{
+	std::vector<uint32_t> Sizes = {256, 1024, 4096, 8192};
+	std::vector<uint32_t> Threads;
+	// Empty times every stage
+	std::vector<std::string> Stages;
+	uint32_t Repeats = 3;
+	double MinSampleMs = 50.0;
+	std::string OutPath;
+};
+
+struct Result
+{
+	std::string Stage;
+	uint32_t Size = 0;
+	uint32_t Threads = 0;
+	double BestSeconds = 0.0;
+	double MeanSeconds = 0.0;
+	uint64_t Runs = 0;
+	double Cells = 0.0;
+	double BytesPerCell = 0.0;
+	double ScalingEfficiency = 0.0;
+	std::vector<std::pair<std::string, double>> Metrics = {};
+};
+
+struct Stage
+{
+	std::string Name;
+	double BytesPerCell = 0.0;
+	// Stages that can't use more than one thread only run once per size
+	bool Serial = false;
+	std::function<void(uint32_t threadCount)> Run;
+	// Optional figures about the stage's output rather than its speed, taken after it ran
+	std::function<std::vector<std::pair<std::string, double>>()> Metrics = {};
+};
+
+std::vector<std::string> ParseNames(char const* text)
+{
+	std::vector<std::string> names;
+	std::stringstream stream(text);
+	std::string item;
+	while (std::getline(stream, item, ','))
+		if (!item.empty())
+			names.push_back(item);
+	return names;
+}
+
+std::vector<uint32_t> ParseList(char const* text)
+{
+	std::vector<uint32_t> values;
+	for (std::string const& item : ParseNames(text))
+		values.push_back(uint32_t(std::strtoul(item.c_str(), nullptr, 10)));
+	return values;
+}
+
+std::optional<Options> ParseOptions(int argc, char** argv)
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		char const* arg = argv[i];
+		char const* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (std::strcmp(arg, "--sizes") == 0 && value)
+			options.Sizes = ParseList(value);
+		else if (std::strcmp(arg, "--threads") == 0 && value)
+			options.Threads = ParseList(value);
+		else if (std::strcmp(arg, "--stages") == 0 && value)
+			options.Stages = ParseNames(value);
+		else if (std::strcmp(arg, "--repeats") == 0 && value)
+			options.Repeats = std::max(1u, uint32_t(std::strtoul(value, nullptr, 10)));
+		else if (std::strcmp(arg, "--min-sample-ms") == 0 && value)
+			options.MinSampleMs = std::strtod(value, nullptr);
+		else if (std::strcmp(arg, "--out") == 0 && value)
+			options.OutPath = value;
+		else
+		{
+			std::cerr << "Usage: radBenchmark [--sizes 256,1024,4096,8192] [--threads 1,2,4] [--stages A,B] "
+						 "[--repeats 3] [--min-sample-ms 50] [--out file.json]\n";
+			return std::nullopt;
+		}
+		i++;
+	}
+	// Powers of two up to the core count, and the core count itself
+	if (options.Threads.empty())
+	{
+		uint32_t cores = DefaultThreadCount();
+		for (uint32_t threads = 1; threads < cores; threads *= 2)
+			options.Threads.push_back(threads);
+		options.Threads.push_back(cores);
+	}
+	return options;
+}
+
+// Best and mean time of one run over the repeats
+std::pair<double, double> TimeStage(Stage const& stage, uint32_t threadCount, Options const& options, uint64_t& runs)
+{
+	using Clock = std::chrono::steady_clock;
+	double best = 0.0, total = 0.0;
+	runs = 0;
+	for (uint32_t repeat = 0; repeat < options.Repeats; repeat++)
+	{
+		uint64_t sampleRuns = 0;
+		auto start = Clock::now();
+		double elapsedMs = 0.0;
+		do
+		{
+			stage.Run(threadCount);
+			sampleRuns++;
+			elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		} while (elapsedMs < options.MinSampleMs);
+		double seconds = elapsedMs / 1000.0 / double(sampleRuns);
+		best = repeat == 0 ? seconds : std::min(best, seconds);
+		total += seconds;
+		runs += sampleRuns;
+	}
+	return {best, total / options.Repeats};
+}
+
+void RunStages(std::vector<Stage> const& stages, uint32_t size, double cells, Options const& options,
+			   std::vector<Result>& results)
+{
+	for (Stage const& stage : stages)
+	{
+		if (!options.Stages.empty() && std::ranges::find(options.Stages, stage.Name) == options.Stages.end())
+		{
+			stage.Run(DefaultThreadCount());
+			continue;
+		}
+		double singleThreadSeconds = 0.0;
+		for (uint32_t threads : options.Threads)
+		{
+			if (stage.Serial && threads != 1)
+				continue;
+			Result result{.Stage = stage.Name, .Size = size, .Threads = threads, .Cells = cells,
+						  .BytesPerCell = stage.BytesPerCell};
+			auto [best, mean] = TimeStage(stage, threads, options, result.Runs);
+			result.BestSeconds = best;
+			result.MeanSeconds = mean;
+			if (threads == 1)
+				singleThreadSeconds = best;
+			result.ScalingEfficiency = singleThreadSeconds > 0.0 ? singleThreadSeconds / best / threads : 0.0;
+			if (stage.Metrics)
+				result.Metrics = stage.Metrics();
+			std::cerr << "  " << stage.Name << " " << size << "^2 x" << threads << ": " << best * 1000.0 << " ms, "
+					  << cells / best / 1e6 << " Mcells/s\n";
+			results.push_back(std::move(result));
+		}
+	}
+}
+
+// Both textures: mip 0 written, then every mip read to write the next one
+// The map filters written as plain loops over every cell with clamped neighbour reads, what RunStencil replaces
+void NaiveNormalMap(std::span<const float> heights, uint32_t size, float cellLength, std::span<float> normalX,
+					std::span<float> normalY, std::span<float> normalZ)
+{
+	float scale = 1.0f / (2.0f * cellLength);
+	int last = int(size) - 1;
+	auto at = [&](int x, int y) { return heights[std::clamp(x, 0, last) + size_t(std::clamp(y, 0, last)) * size]; };
+	for (int y = 0; y < int(size); y++)
+		for (int x = 0; x < int(size); x++)
+		{
+			float dx = (at(x + 1, y) - at(x - 1, y)) * scale;
+			float dz = (at(x, y + 1) - at(x, y - 1)) * scale;
+			float inverseLength = 1.0f / std::sqrt(dx * dx + dz * dz + 1.0f);
+			size_t cell = x + size_t(y) * size;
+			normalX[cell] = -dx * inverseLength;
+			normalY[cell] = inverseLength;
+			normalZ[cell] = -dz * inverseLength;
+		}
+}
+
+void NaiveSlopeMap(std::span<const float> heights, uint32_t size, float cellLength, std::span<float> slope)
+{
+	float scale = 1.0f / (2.0f * cellLength);
+	int last = int(size) - 1;
+	auto at = [&](int x, int y) { return heights[std::clamp(x, 0, last) + size_t(std::clamp(y, 0, last)) * size]; };
+	for (int y = 0; y < int(size); y++)
+		for (int x = 0; x < int(size); x++)
+		{
+			float dx = (at(x + 1, y) - at(x - 1, y)) * scale;
+			float dz = (at(x, y + 1) - at(x, y - 1)) * scale;
+			slope[x + size_t(y) * size] = std::atan(std::sqrt(dx * dx + dz * dz));
+		}
+}
+
+// The full 2D kernel, weights as GaussianBlur builds them
+void NaiveGaussianBlur(std::span<const float> values, uint32_t size, int radius, std::span<float> out)
+{
+	std::vector<float> weights(2 * size_t(radius) + 1);
+	float sigma = std::max(0.5f, radius * 0.5f), total = 0.0f;
+	for (int k = -radius; k <= radius; k++)
+		total += weights[k + radius] = std::exp(-0.5f * k * k / (sigma * sigma));
+	for (float& weight : weights)
+		weight /= total;
+	int last = int(size) - 1;
+	for (int y = 0; y < int(size); y++)
+		for (int x = 0; x < int(size); x++)
+		{
+			float sum = 0.0f;
+			for (int ky = -radius; ky <= radius; ky++)
+				for (int kx = -radius; kx <= radius; kx++)
+					sum += weights[ky + radius] * weights[kx + radius] *
+						   values[std::clamp(x + kx, 0, last) + size_t(std::clamp(y + ky, 0, last)) * size];
+			out[x + size_t(y) * size] = sum;
+		}
+}
+
+void NaiveRemapRange(std::span<float> values, float newMin, float newMax)
+{
+	auto [low, high] = std::minmax_element(values.begin(), values.end());
+	float lowValue = *low, inverseRange = *high > *low ? 1.0f / (*high - *low) : 0.0f;
+	for (float& value : values)
+		value = (value - lowValue) * inverseRange * (newMax - newMin) + newMin;
+}
+
+double MaxDifference(std::span<const float> a, std::span<const float> b)
+{
+	double difference = 0.0;
+	for (size_t i = 0; i < a.size(); i++)
+		difference = std::max(difference, double(std::abs(a[i] - b[i])));
+	return difference;
+}
+
+double MaterialBytesPerCell(uint32_t size)
+{
+	double texels = 0.0;
+	for (uint32_t mipSize = size;; mipSize /= 2)
+	{
+		texels += double(mipSize) * mipSize;
+		if (mipSize <= 1)
+			break;
+	}
+	return 2.0 * 16.0 * (texels + texels - 1.0) / (double(size) * size);
+}
+
+// The map as an OBJ would hold it: a vertex per cell, and six corners per quad indexing them
+void BuildTerrainMesh(std::span<const float> heights, uint32_t size, std::vector<Vertex>& vertices,
+					  std::vector<uint32_t>& corners)
+{
+	vertices.resize(heights.size());
+	for (uint32_t y = 0; y < size; y++)
+		for (uint32_t x = 0; x < size; x++)
+		{
+			auto height = [&](uint32_t sx, uint32_t sy)
+			{ return heights[std::min(sx, size - 1) + std::min(sy, size - 1) * size]; };
+			glm::vec3 normal = {height(x ? x - 1 : 0, y) - height(x + 1, y), 2.0f,
+								height(x, y ? y - 1 : 0) - height(x, y + 1)};
+			vertices[x + y * size] = {.Position = {float(x), height(x, y), float(y)},
+									  .Normal = glm::normalize(normal),
+									  .TexCoord = {float(x) / size, float(y) / size},
+									  .Tangent = {1.0f, 0.0f, 0.0f}};
+		}
+	corners.clear();
+	corners.reserve(size_t(size - 1) * (size - 1) * 6);
+	for (uint32_t y = 0; y + 1 < size; y++)
+		for (uint32_t x = 0; x + 1 < size; x++)
+		{
+			uint32_t cell = x + y * size;
+			for (uint32_t corner : {cell, cell + size, cell + 1, cell + 1, cell + size, cell + size + 1})
+				corners.push_back(corner);
+		}
+}
+
+// The mesh as OBJ text with every corner's position, texcoord and normal, returns the size of the file
+size_t WriteTerrainObj(std::filesystem::path const& path, std::span<const Vertex> vertices,
+					   std::span<const uint32_t> corners)
+{
+	std::string text = "o terrain\n";
+	auto append = [&](std::initializer_list<float> values)
+	{
+		char buffer[32];
+		for (float value : values)
+		{
+			text += ' ';
+			text.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+		}
+		text += '\n';
+	};
+	for (Vertex const& vertex : vertices)
+	{
+		text += 'v';
+		append({vertex.Position.x, vertex.Position.y, vertex.Position.z});
+		text += "vt";
+		append({vertex.TexCoord.x, vertex.TexCoord.y});
+		text += "vn";
+		append({vertex.Normal.x, vertex.Normal.y, vertex.Normal.z});
+	}
+	for (size_t corner = 0; corner < corners.size(); corner++)
+	{
+		std::string index = std::to_string(corners[corner] + 1);
+		text += corner % 3 ? " " : "f ";
+		text += index;
+		text += '/';
+		text += index;
+		text += '/';
+		text += index;
+		if (corner % 3 == 2)
+			text += '\n';
+	}
+	std::ofstream(path, std::ios::binary) << text;
+	return text.size();
+}
+
+// What the model loader keyed its std::unordered_map on before VertexHashTable, HashCombine over std::hash<float>
+struct MapVertexHash
+{
+	size_t operator()(Vertex const& vertex) const
+	{
+		auto combine = [](size_t& seed, size_t value) { seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
+		auto hashFloats = [&](std::initializer_list<float> values)
+		{
+			size_t seed = 0;
+			for (float value : values)
+				combine(seed, std::hash<float>{}(value));
+			return seed;
+		};
+		size_t seed = 0;
+		combine(seed, hashFloats({vertex.Position.x, vertex.Position.y, vertex.Position.z}));
+		combine(seed, hashFloats({vertex.Normal.x, vertex.Normal.y, vertex.Normal.z}));
+		combine(seed, hashFloats({vertex.TexCoord.x, vertex.TexCoord.y}));
+		return seed;
+	}
+};
+
+void DeduplicateWithMap(std::span<const Vertex> source, std::span<const uint32_t> corners, std::vector<Vertex>& unique,
+						std::vector<uint32_t>& indices)
+{
+	std::unordered_map<Vertex, size_t, MapVertexHash> uniqueVertices;
+	unique.clear();
+	indices.clear();
+	for (uint32_t corner : corners)
+	{
+		Vertex const& vertex = source[corner];
+		size_t index;
+		if (auto it = uniqueVertices.find(vertex); it != uniqueVertices.end())
+			index = it->second;
+		else
+		{
+			index = unique.size();
+			unique.push_back(vertex);
+			uniqueVertices.emplace(vertex, index);
+		}
+		indices.push_back(uint32_t(index));
+	}
+}
+
+// The box and the sphere around its center straight over the indices, what ComputeMeshBounds is measured against
+MeshBounds NaiveMeshBounds(std::span<const glm::vec3> positions, std::span<const uint32_t> indices)
+{
+	MeshBounds bounds;
+	bounds.Min = bounds.Max = positions[indices[0]];
+	for (uint32_t index : indices)
+	{
+		bounds.Min = glm::min(bounds.Min, positions[index]);
+		bounds.Max = glm::max(bounds.Max, positions[index]);
+	}
+	bounds.Center = (bounds.Min + bounds.Max) * 0.5f;
+	float farthest = 0.0f;
+	for (uint32_t index : indices)
+	{
+		glm::vec3 delta = positions[index] - bounds.Center;
+		farthest = std::max(farthest, glm::dot(delta, delta));
+	}
+	bounds.Radius = std::sqrt(farthest);
+	return bounds;
+}
+
+// The loop of LoadShapeVertices
+void DeduplicateWithHashTable(std::span<const Vertex> source, std::span<const uint32_t> corners,
+							  std::vector<Vertex>& unique, std::vector<uint32_t>& indices)
+{
+	VertexHashTable uniqueVertices(corners.size() / 2);
+	std::vector<uint64_t> hashes;
+	unique.clear();
+	indices.clear();
+	for (uint32_t corner : corners)
+	{
+		Vertex const& vertex = source[corner];
+		uint64_t hash = HashVertex(vertex);
+		uint32_t index = uniqueVertices.FindOrInsert(unique, vertex, hash, uint32_t(unique.size()));
+		if (index == unique.size())
+		{
+			unique.push_back(vertex);
+			hashes.push_back(hash);
+		}
+		indices.push_back(index);
+	}
+}
+
+void BenchmarkSize(uint32_t size, Options const& options, std::vector<Result>& results)
+{
+	double cells = double(size) * size;
+	std::cerr << size << "^2\n";
+
+	std::mt19937 generator(1234);
+	std::vector<float> heights;
+	std::vector<Stage> baseStages = {
+		// Recursive and consumes the RNG in a fixed order, one thread only
+		{.Name = "DiamondSquare",
+		 .BytesPerCell = 12.0,
+		 .Serial = true,
+		 .Run =
+			 [&](uint32_t)
+		 {
+			 generator.seed(1234);
+			 heights = CreateDiamondSquareHeightMap(size, 1.0f, generator);
+		 }},
+	};
+	RunStages(baseStages, size, cells, options, results);
+	for (float& height : heights)
+		height *= 100.0f;
+
+	HydraulicErosionState state(size, size);
+	state.Heights = heights;
+	std::fill(state.Water.begin(), state.Water.end(), 0.1f);
+	HydraulicErosionSettings settings;
+	settings.PipeLength = 1.0f;
+	HydraulicErosionStep(state, settings);
+
+	// Planes: heights, water, sediment, softness 4 B, outflux 16 B, velocity 8 B
+	std::vector<Stage> hydraulicStages = {
+		{.Name = "HydraulicAddWater", .BytesPerCell = 8.0, .Run = [&](uint32_t threads)
+		 {
+			 settings.ThreadCount = threads;
+			 HydraulicAddWater(state, settings);
+		 }},
+		{.Name = "HydraulicCalculateOutflux", .BytesPerCell = 40.0, .Run = [&](uint32_t threads)
+		 {
+			 settings.ThreadCount = threads;
+			 HydraulicCalculateOutflux(state, settings);
+		 }},
+		{.Name = "HydraulicUpdateWaterVelocity", .BytesPerCell = 32.0, .Run = [&](uint32_t threads)
+		 {
+			 settings.ThreadCount = threads;
+			 HydraulicUpdateWaterVelocity(state, settings);
+		 }},
+		{.Name = "HydraulicErosionAndDeposition", .BytesPerCell = 40.0, .Run = [&](uint32_t threads)
+		 {
+			 settings.ThreadCount = threads;
+			 HydraulicErosionAndDeposition(state, settings);
+		 }},
+		{.Name = "HydraulicSedimentTransportationAndEvaporation", .BytesPerCell = 24.0, .Run = [&](uint32_t threads)
+		 {
+			 settings.ThreadCount = threads;
+			 HydraulicSedimentTransportationAndEvaporation(state, settings);
+		 }},
+	};
+	RunStages(hydraulicStages, size, cells, options, results);
+
+	if (size <= MaxStrataSize)
+	{
+		// Alternating hard and soft bands, most columns end up with the full 16 layers
+		StrataLayer bands[] = {{4.0f, 0.1f}, {2.5f, 0.8f}, {3.0f, 0.3f}, {1.5f, 0.9f}};
+		StrataColumns strata(size, size);
+		strata.BuildFromBands(state.Heights, bands);
+		// Erosion reads the exposed softness of every cell once per step
+		volatile float lookupSink = 0.0f;
+		std::vector<Stage> strataStages = {
+			{.Name = "SoftnessMapLookup", .BytesPerCell = 4.0, .Serial = true, .Run = [&](uint32_t)
+			 {
+				 float sum = 0.0f;
+				 for (size_t i = 0; i < state.Softness.size(); i++)
+					 sum += state.Softness[i];
+				 lookupSink = sum;
+			 }},
+			{.Name = "StrataTopSoftnessLookup", .BytesPerCell = 4.0, .Serial = true, .Run = [&](uint32_t)
+			 {
+				 float sum = 0.0f;
+				 for (size_t i = 0; i < state.Softness.size(); i++)
+					 sum += strata.GetTopSoftness(i);
+				 lookupSink = sum;
+			 }},
+			// Walks the column from the top, the column and at least one layer are read
+			{.Name = "StrataDepthLookup", .BytesPerCell = 16.0, .Serial = true, .Run = [&](uint32_t)
+			 {
+				 float sum = 0.0f;
+				 for (size_t i = 0; i < state.Softness.size(); i++)
+					 sum += strata.GetSoftnessAtDepth(i, 12.0f);
+				 lookupSink = sum;
+			 }},
+			// Columns share the layer arena, so strata erosion runs on one thread
+			{.Name = "HydraulicErosionAndDepositionStrata",
+			 .BytesPerCell = 40.0,
+			 .Serial = true,
+			 .Run = [&](uint32_t) { HydraulicErosionAndDeposition(state, settings, &strata); },
+			 .Metrics =
+				 [&]()
+			 {
+				 return std::vector<std::pair<std::string, double>>{
+					 {"layersPerColumn", double(strata.GetLayerCount()) / cells},
+					 {"arenaBytes", double(strata.GetArenaBytes())},
+				 };
+			 }},
+		};
+		RunStages(strataStages, size, cells, options, results);
+	}
+
+	std::vector<float> water = std::move(state.Water), sediment = std::move(state.Sediment);
+	std::vector<float> softness = std::move(state.Softness);
+	heights = std::move(state.Heights);
+	state = {};
+
+	std::vector<float> thermalOut(heights.size());
+	rad::hlsl::ThermalErosionResources thermalSettings{};
+	std::vector<Stage> thermalStages = {
+		// Outflux pass reads heights and softness and writes 8 pipes, the deposit pass reads them back
+		{.Name = "ThermalErosionScatter", .BytesPerCell = 8.0 + 32.0 + 32.0 + 4.0 + 4.0, .Run = [&](uint32_t threads)
+		 { ThermalErosionScatter(heights, softness, size, size, thermalSettings, thermalOut, threads); }},
+		{.Name = "ThermalErosionGather", .BytesPerCell = 12.0, .Run = [&](uint32_t threads)
+		 { ThermalErosionGather(heights, softness, size, size, thermalSettings, thermalOut, threads); }},
+	};
+	RunStages(thermalStages, size, cells, options, results);
+	thermalOut = {};
+	softness = {};
+
+	{
+		// Each naive stage reports how far it is from the stencil version that ran just before it
+		std::vector<float> stencilPlanes[3], naivePlanes[3];
+		for (uint32_t plane = 0; plane < 3; plane++)
+		{
+			stencilPlanes[plane].resize(heights.size());
+			naivePlanes[plane].resize(heights.size());
+		}
+		auto differenceMetrics = [&](uint32_t planeCount)
+		{
+			double difference = 0.0;
+			for (uint32_t plane = 0; plane < planeCount; plane++)
+				difference = std::max(difference, MaxDifference(stencilPlanes[plane], naivePlanes[plane]));
+			return std::vector<std::pair<std::string, double>>{{"maxDifference", difference}};
+		};
+		float cellLength = 1.0f;
+		int blurRadius = 2;
+		std::vector<Stage> filterStages = {
+			{.Name = "NormalMap", .BytesPerCell = 16.0, .Run = [&](uint32_t threads)
+			 {
+				 ComputeNormalMap(heights, size, size, cellLength, stencilPlanes[0], stencilPlanes[1], stencilPlanes[2],
+								  threads);
+			 }},
+			{.Name = "NormalMapNaive",
+			 .BytesPerCell = 16.0,
+			 .Serial = true,
+			 .Run = [&](uint32_t)
+			 { NaiveNormalMap(heights, size, cellLength, naivePlanes[0], naivePlanes[1], naivePlanes[2]); },
+			 .Metrics = [&]() { return differenceMetrics(3); }},
+			{.Name = "SlopeMap", .BytesPerCell = 8.0, .Run = [&](uint32_t threads)
+			 { ComputeSlopeMap(heights, size, size, cellLength, stencilPlanes[0], threads); }},
+			{.Name = "SlopeMapNaive",
+			 .BytesPerCell = 8.0,
+			 .Serial = true,
+			 .Run = [&](uint32_t) { NaiveSlopeMap(heights, size, cellLength, naivePlanes[0]); },
+			 .Metrics = [&]() { return differenceMetrics(1); }},
+			// Both passes read and write a plane
+			{.Name = "GaussianBlur", .BytesPerCell = 16.0, .Run = [&](uint32_t threads)
+			 {
+				 GaussianBlur(heights, size, size, uint32_t(blurRadius), stencilPlanes[0], StencilBorder::Clamp,
+							  threads);
+			 }},
+			{.Name = "GaussianBlurNaive",
+			 .BytesPerCell = 8.0,
+			 .Serial = true,
+			 .Run = [&](uint32_t) { NaiveGaussianBlur(heights, size, blurRadius, naivePlanes[0]); },
+			 .Metrics = [&]() { return differenceMetrics(1); }},
+			// Both remap a fresh copy of the heights, so every run sees the same input. The copy, the min and max
+			// pass, then the remap reading and writing.
+			{.Name = "RemapRange", .BytesPerCell = 20.0, .Run = [&](uint32_t threads)
+			 {
+				 stencilPlanes[0] = heights;
+				 RemapRange(stencilPlanes[0], size, size, 0.0f, 100.0f, 1.0f, threads);
+			 }},
+			{.Name = "RemapRangeNaive",
+			 .BytesPerCell = 20.0,
+			 .Serial = true,
+			 .Run =
+				 [&](uint32_t)
+			 {
+				 naivePlanes[0] = heights;
+				 NaiveRemapRange(naivePlanes[0], 0.0f, 100.0f);
+			 },
+			 .Metrics = [&]() { return differenceMetrics(1); }},
+		};
+		RunStages(filterStages, size, cells, options, results);
+	}
+
+	// One texel per cell, the engine bakes a fixed 1024^2 whatever the map size
+	TerrainMaterialMaps maps{.Width = size, .Height = size, .Heights = heights, .Water = water, .Sediment = sediment,
+							 .TotalLength = float(size)};
+	MaterialTexture albedo(size, size), normal(size, size);
+	double materialBytes = MaterialBytesPerCell(size);
+	std::vector<Stage> materialStages = {
+		{.Name = "BakeTerrainMaterial", .BytesPerCell = 4.0 + materialBytes, .Run = [&](uint32_t threads)
+		 { BakeTerrainMaterial(maps, albedo, normal, threads); }},
+		{.Name = "BakeWaterMaterial", .BytesPerCell = 12.0 + materialBytes, .Run = [&](uint32_t threads)
+		 { BakeWaterMaterial(maps, albedo, normal, threads); }},
+	};
+	RunStages(materialStages, size, cells, options, results);
+
+	// The undo history's tiles and saved maps: the heights exact and to a centimetre, the size they take and how fast
+	// they come back
+	EncodedHeightfield exactHeights, lossyHeights;
+	float lossyMaxError = 0.01f;
+	std::vector<float> decodedHeights(heights.size());
+	auto compression = [&](EncodedHeightfield const& encoded)
+	{
+		return std::vector<std::pair<std::string, double>>{
+			{"compressionRatio", cells * sizeof(float) / double(encoded.Bytes.size())},
+			{"bitsPerCell", 8.0 * double(encoded.Bytes.size()) / cells},
+		};
+	};
+	std::vector<Stage> encodeStages = {
+		{.Name = "EncodeHeightfield",
+		 .BytesPerCell = 4.0,
+		 .Run = [&](uint32_t threads)
+		 { exactHeights = EncodeHeightfield(heights, size, size, {.ThreadCount = threads}); },
+		 .Metrics = [&]() { return compression(exactHeights); }},
+		{.Name = "EncodeHeightfieldLossy",
+		 .BytesPerCell = 4.0,
+		 .Run =
+			 [&](uint32_t threads)
+		 {
+			 lossyHeights =
+				 EncodeHeightfield(heights, size, size, {.MaxError = lossyMaxError, .ThreadCount = threads});
+		 },
+		 .Metrics = [&]() { return compression(lossyHeights); }},
+	};
+	RunStages(encodeStages, size, cells, options, results);
+
+	// The compressed stream read, every cell written once
+	auto exactDecoder = HeightfieldDecoder::Open(exactHeights.Bytes);
+	auto lossyDecoder = HeightfieldDecoder::Open(lossyHeights.Bytes);
+	std::vector<Stage> decodeStages = {
+		{.Name = "DecodeHeightfield",
+		 .BytesPerCell = 4.0 + double(exactHeights.Bytes.size()) / cells,
+		 .Run = [&](uint32_t threads) { exactDecoder->DecodeAll(decodedHeights, threads); },
+		 .Metrics =
+			 [&]()
+		 {
+			 bool exact = std::memcmp(decodedHeights.data(), heights.data(), heights.size() * sizeof(float)) == 0;
+			 return std::vector<std::pair<std::string, double>>{{"bitExact", exact ? 1.0 : 0.0}};
+		 }},
+		{.Name = "DecodeHeightfieldLossy",
+		 .BytesPerCell = 4.0 + double(lossyHeights.Bytes.size()) / cells,
+		 .Run = [&](uint32_t threads) { lossyDecoder->DecodeAll(decodedHeights, threads); },
+		 .Metrics =
+			 [&]()
+		 {
+			 double largest = 0.0;
+			 for (size_t i = 0; i < heights.size(); i++)
+				 largest = std::max(largest, double(std::abs(decodedHeights[i] - heights[i])));
+			 return std::vector<std::pair<std::string, double>>{{"maxError", largest},
+																 {"maxErrorBound", lossyMaxError}};
+		 }},
+	};
+	RunStages(decodeStages, size, cells, options, results);
+	decodedHeights = {};
+
+	if (size <= MaxNavMeshSize)
+	{
+		// A cell per height sample, every tile rebuilt each run as after regenerating the terrain
+		NavMeshBuilder::Settings navSettings{.CellSize = 1.0f, .AgentRadius = 1.0f};
+		NavMeshBuilder navMesh(navSettings, 0.0f, 0.0f, float(size - 1), float(size - 1));
+		std::vector<Stage> navMeshStages = {
+			{.Name = "BuildNavMesh",
+			 .BytesPerCell = 4.0,
+			 .Run =
+				 [&](uint32_t threads)
+			 {
+				 navSettings.ThreadCount = threads;
+				 navMesh = NavMeshBuilder(navSettings, 0.0f, 0.0f, float(size - 1), float(size - 1));
+				 navMesh.SetHeightfield(heights, size, size, 0.0f, 0.0f, 1.0f);
+				 navMesh.Build();
+			 },
+			 .Metrics =
+				 [&]()
+			 {
+				 uint32_t walkableCells = 0;
+				 for (NavMeshTile const& tile : navMesh.GetTiles())
+					 walkableCells += tile.WalkableCells;
+				 auto const& stats = navMesh.GetLastBuildStats();
+				 return std::vector<std::pair<std::string, double>>{
+					 {"tiles", double(stats.BuiltTiles)},
+					 {"meanTileMs", stats.MeanTileMs},
+					 {"maxTileMs", stats.MaxTileMs},
+					 {"polygons", double(navMesh.GetPolygonCount())},
+					 {"walkableFraction", walkableCells / cells},
+				 };
+			 }},
+		};
+		RunStages(navMeshStages, size, cells, options, results);
+	}
+
+	// A lake over the lowest 15% of the map, one plane vertex per cell like the water plane at 512^2
+	std::vector<float> lakeWater(heights.size());
+	{
+		std::vector<float> sortedHeights = heights;
+		auto level = sortedHeights.begin() + sortedHeights.size() * 15 / 100;
+		std::nth_element(sortedHeights.begin(), level, sortedHeights.end());
+		for (size_t i = 0; i < heights.size(); i++)
+			lakeWater[i] = std::max(0.0f, *level - heights[i]);
+	}
+	WaterChunkGrid grid{.ResX = size, .ResY = size, .ChunkQuads = 16};
+	std::vector<uint32_t> chunkIndexOffsets;
+	BuildChunkedPlaneIndices(grid, chunkIndexOffsets);
+	std::vector<float> chunkMax = ComputeChunkMaxWater(lakeWater, size, size, grid);
+	std::vector<IndexRange> drawRanges;
+	WaterBodyLabels bodies;
+	WaterLabelSettings labelSettings;
+	std::vector<uint8_t> lakeMask = MaskAboveThreshold(lakeWater, labelSettings.Threshold);
+	std::vector<float> shoreDistance;
+	// Classification runs on the main thread once per readback, weighed against the share of the plane it skips
+	std::vector<Stage> waterStages = {
+		// Reads the water of every cell, writes its link and label, heights only under water
+		{.Name = "LabelWaterBodies",
+		 .BytesPerCell = 16.0,
+		 .Run =
+			 [&](uint32_t threads)
+		 {
+			 labelSettings.ThreadCount = threads;
+			 bodies = LabelWaterBodies(lakeWater, heights, size, size, labelSettings);
+		 },
+		 .Metrics =
+			 [&]()
+		 {
+			 double wetCells = 0.0;
+			 for (WaterBody const& body : bodies.Bodies)
+				 wetCells += body.Area;
+			 return std::vector<std::pair<std::string, double>>{
+				 {"bodies", double(bodies.Bodies.size())},
+				 {"wetFraction", wetCells / cells},
+			 };
+		 }},
+		// Once per side: the mask, both column sweeps read and write the column distances, the row pass reads them.
+		// The output is written once.
+		{.Name = "ShoreSignedDistance", .BytesPerCell = 2.0 * (1.0 + 16.0 + 4.0) + 4.0, .Run = [&](uint32_t threads)
+		 { shoreDistance = ComputeSignedDistance(lakeMask, size, size, 1.0f, threads); }},
+		{.Name = "WaterChunkMax", .BytesPerCell = 4.0, .Serial = true, .Run = [&](uint32_t)
+		 { chunkMax = ComputeChunkMaxWater(lakeWater, size, size, grid); }},
+		{.Name = "ClassifyWaterChunks",
+		 .BytesPerCell = 0.0,
+		 .Serial = true,
+		 .Run = [&](uint32_t)
+		 { drawRanges = BuildWetDrawRanges(ClassifyWetChunks(chunkMax, grid, 0.2f), chunkIndexOffsets); },
+		 .Metrics =
+			 [&]()
+		 {
+			 double drawnIndices = 0.0;
+			 for (IndexRange const& range : drawRanges)
+				 drawnIndices += range.IndexCount;
+			 return std::vector<std::pair<std::string, double>>{
+				 {"chunks", double(grid.ChunkCount())},
+				 {"drawCalls", double(drawRanges.size())},
+				 {"drawnIndexFraction", drawnIndices / double(chunkIndexOffsets.back())},
+			 };
+		 }},
+	};
+	RunStages(waterStages, size, cells, options, results);
+
+	if (size <= MaxMeshSize)
+	{
+		lakeWater = {};
+		lakeMask = {};
+		shoreDistance = {};
+		std::vector<Vertex> meshVertices, uniqueVertices;
+		std::vector<uint32_t> meshCorners, mapIndices, tableIndices;
+		BuildTerrainMesh(heights, size, meshVertices, meshCorners);
+		auto dedupMetrics = [&]()
+		{
+			return std::vector<std::pair<std::string, double>>{
+				{"corners", double(meshCorners.size())},
+				{"uniqueVertices", double(uniqueVertices.size())},
+			};
+		};
+		// One shape's loop, a thread each. Six corners read per cell, their indices written and each vertex copied
+		// once.
+		std::vector<Stage> meshStages = {
+			{.Name = "DeduplicateVerticesMap",
+			 .BytesPerCell = 6.0 * (4.0 + 44.0 + 4.0) + 44.0,
+			 .Serial = true,
+			 .Run = [&](uint32_t) { DeduplicateWithMap(meshVertices, meshCorners, uniqueVertices, mapIndices); },
+			 .Metrics = dedupMetrics},
+			{.Name = "DeduplicateVertices",
+			 .BytesPerCell = 6.0 * (4.0 + 44.0 + 4.0) + 44.0,
+			 .Serial = true,
+			 .Run = [&](uint32_t)
+			 { DeduplicateWithHashTable(meshVertices, meshCorners, uniqueVertices, tableIndices); },
+			 .Metrics =
+				 [&]()
+			 {
+				 auto metrics = dedupMetrics();
+				 metrics.push_back({"matchesMap", tableIndices == mapIndices ? 1.0 : 0.0});
+				 return metrics;
+			 }},
+		};
+		RunStages(meshStages, size, cells, options, results);
+
+		if (size <= MaxObjSize)
+		{
+			std::filesystem::path objPath = std::filesystem::temp_directory_path() / "radBenchmarkTerrain.obj";
+			double objBytes = double(WriteTerrainObj(objPath, meshVertices, meshCorners));
+			ObjData obj;
+			bool parsed = false;
+			// The whole file is read once, bytesPerSecond is the parse rate
+			std::vector<Stage> objStages = {
+				{.Name = "ParseObj",
+				 .BytesPerCell = objBytes / cells,
+				 .Run = [&](uint32_t threads) { parsed = ParseObj(objPath, obj, threads); },
+				 .Metrics =
+					 [&]()
+				 {
+					 size_t triangles = obj.Shapes.empty() ? 0 : obj.Shapes[0].mesh.material_ids.size();
+					 bool complete = parsed && obj.Attrib.vertices.size() == meshVertices.size() * 3 &&
+									 triangles * 3 == meshCorners.size();
+					 return std::vector<std::pair<std::string, double>>{
+						 {"megabytes", objBytes / 1e6},
+						 {"triangles", double(triangles)},
+						 {"complete", complete ? 1.0 : 0.0},
+					 };
+				 }},
+			};
+			RunStages(objStages, size, cells, options, results);
+			obj = {};
+			std::error_code error;
+			std::filesystem::remove(objPath, error);
+		}
+
+		std::vector<glm::vec3> positions(uniqueVertices.size());
+		std::ranges::transform(uniqueVertices, positions.begin(), &Vertex::Position);
+		MeshBounds bounds, naiveBounds;
+		// Six indices and their positions per cell read twice by the naive loops. ComputeMeshBounds reads the indices
+		// twice, the positions once and its three axis arrays four times.
+		std::vector<Stage> boundsStages = {
+			{.Name = "MeshBoundsNaive",
+			 .BytesPerCell = 2.0 * 6.0 * (4.0 + 12.0),
+			 .Serial = true,
+			 .Run = [&](uint32_t) { naiveBounds = NaiveMeshBounds(positions, tableIndices); }},
+			{.Name = "MeshBounds",
+			 .BytesPerCell = 2.0 * 6.0 * 4.0 + 12.0 + 4.0 * 12.0,
+			 .Serial = true,
+			 .Run = [&](uint32_t) { bounds = ComputeMeshBounds(positions, tableIndices); },
+			 .Metrics =
+				 [&]()
+			 {
+				 return std::vector<std::pair<std::string, double>>{
+					 {"boxMatchesNaive", bounds.Min == naiveBounds.Min && bounds.Max == naiveBounds.Max ? 1.0 : 0.0},
+					 {"radiusOverNaive", bounds.Radius / naiveBounds.Radius},
+				 };
+			 }},
+		};
+		RunStages(boundsStages, size, cells, options, results);
+
+		// Six indices and their positions per cell read, about a byte per corner and a vertex index written
+		MeshletData meshlets;
+		std::vector<Stage> meshletStages = {
+			{.Name = "BuildMeshlets",
+			 .BytesPerCell = 6.0 * (4.0 + 12.0) + 6.0 + 4.0,
+			 .Serial = true,
+			 .Run = [&](uint32_t) { meshlets = BuildMeshlets(positions, tableIndices); },
+			 .Metrics =
+				 [&]()
+			 {
+				 return std::vector<std::pair<std::string, double>>{
+					 {"meshlets", double(meshlets.Meshlets.size())},
+					 {"trianglesPerMeshlet", tableIndices.size() / 3.0 / meshlets.Meshlets.size()},
+				 };
+			 }},
+		};
+		RunStages(meshletStages, size, cells, options, results);
+		positions = {};
+
+		// A camera standing in the middle of the map a little above the highest peak, looking around at a slight
+		// downward tilt, then one from above a corner looking across the map and one below it looking up
+		glm::vec3 center = (bounds.Min + bounds.Max) * 0.5f;
+		float extent = bounds.Max.x - bounds.Min.x;
+		glm::mat4 projection = glm::perspectiveLH(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 2.0f * extent);
+		std::vector<MeshletCullView> views;
+		auto addView = [&](glm::vec3 position, glm::vec3 target)
+		{ views.emplace_back(projection * glm::lookAtLH(position, target, glm::vec3(0, 1, 0)), position); };
+		glm::vec3 eye = {center.x, bounds.Max.y + 2.0f, center.z};
+		for (int i = 0; i < 8; i++)
+		{
+			float angle = glm::radians(45.0f * i);
+			addView(eye, eye + glm::vec3(std::cos(angle), -0.25f, std::sin(angle)));
+		}
+		addView({bounds.Min.x, bounds.Max.y + 0.25f * extent, bounds.Min.z}, center);
+		addView({center.x + 0.01f, bounds.Min.y - 0.5f * extent, center.z}, center);
+
+		std::vector<uint32_t> visible;
+		MeshletCullStats cullStats;
+		// Every meshlet's 64 B read once per view
+		std::vector<Stage> cullStages = {
+			{.Name = "CullMeshlets",
+			 .BytesPerCell = views.size() * sizeof(Meshlet) * meshlets.Meshlets.size() / cells,
+			 .Serial = true,
+			 .Run =
+				 [&](uint32_t)
+			 {
+				 cullStats = {};
+				 for (MeshletCullView const& view : views)
+				 {
+					 visible.clear();
+					 CullMeshlets(meshlets, glm::mat4(1.0f), view, visible, cullStats);
+				 }
+			 },
+			 .Metrics =
+				 [&]()
+			 {
+				 double triangles = double(cullStats.Triangles);
+				 return std::vector<std::pair<std::string, double>>{
+					 {"views", double(views.size())},
+					 {"visibleMeshletFraction", cullStats.VisibleMeshlets / double(cullStats.Meshlets)},
+					 {"frustumCulledTriangleFraction", cullStats.FrustumCulledTriangles / triangles},
+					 {"backfaceCulledTriangleFraction", cullStats.BackfaceCulledTriangles / triangles},
+				 };
+			 }},
+		};
+		RunStages(cullStages, size, cells, options, results);
+	}
+}
+
+void WriteJson(std::ostream& out, Options const& options, std::vector<Result> const& results,
+			   std::vector<uint32_t> const& skippedSizes)
+{
+	auto writeList = [&](std::vector<uint32_t> const& values)
+	{
+		out << "[";
+		for (size_t i = 0; i < values.size(); i++)
+			out << (i ? ", " : "") << values[i];
+		out << "]";
+	};
+
+	out << "{\n";
+	out << "  \"hardwareThreads\": " << DefaultThreadCount() << ",\n";
+	out << "  \"repeats\": " << options.Repeats << ",\n";
+	out << "  \"minSampleMs\": " << options.MinSampleMs << ",\n";
+	out << "  \"sizes\": ";
+	writeList(options.Sizes);
+	out << ",\n  \"threads\": ";
+	writeList(options.Threads);
+	out << ",\n  \"skippedSizes\": ";
+	writeList(skippedSizes);
+	out << ",\n  \"results\": [\n";
+	char line[512];
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		Result const& result = results[i];
+		std::snprintf(line, sizeof(line),
+					  "    {\"stage\": \"%s\", \"size\": %u, \"threads\": %u, \"runs\": %llu, \"bestSeconds\": %.9g, "
+					  "\"meanSeconds\": %.9g, \"cellsPerSecond\": %.6g, \"bytesPerCell\": %.4g, "
+					  "\"bytesPerSecond\": %.6g, \"scalingEfficiency\": %.4f",
+					  result.Stage.c_str(), result.Size, result.Threads, (unsigned long long)result.Runs,
+					  result.BestSeconds, result.MeanSeconds, result.Cells / result.BestSeconds, result.BytesPerCell,
+					  result.Cells * result.BytesPerCell / result.BestSeconds, result.ScalingEfficiency);
+		out << line;
+		if (!result.Metrics.empty())
+		{
+			out << ", \"metrics\": {";
+			for (size_t j = 0; j < result.Metrics.size(); j++)
+			{
+				std::snprintf(line, sizeof(line), "%s\"%s\": %.6g", j ? ", " : "", result.Metrics[j].first.c_str(),
+							  result.Metrics[j].second);
+				out << line;
+			}
+			out << "}";
+		}
+		out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	auto options = ParseOptions(argc, argv);
+	if (!options)
+		return 1;
+
+	std::vector<Result> results;
+	std::vector<uint32_t> skippedSizes;
+	for (uint32_t size : options->Sizes)
+	{
+		try
+		{
+			BenchmarkSize(size, *options, results);
+		}
+		catch (std::bad_alloc const&)
+		{
+			std::cerr << "  not enough memory for " << size << "^2, skipped\n";
+			skippedSizes.push_back(size);
+		}
+	}
+
+	if (options->OutPath.empty())
+		WriteJson(std::cout, *options, results, skippedSizes);
+	else
+	{
+		std::ofstream file(options->OutPath);
+		WriteJson(file, *options, results, skippedSizes);
+	}
+	return 0;
+}
@@ -17,11 +17,14 @@
 
 
 #define DEFAULT_VALUE(x) = x
+// Functions defined in headers shared with HLSL
+#define SHARED_FUNCTION inline
 #else
 // if HLSL
 #define PI 3.14159265359
 
 #define DEFAULT_VALUE(x) 
+#define SHARED_FUNCTION
 #endif
 
 #if RAD_BINDLESS
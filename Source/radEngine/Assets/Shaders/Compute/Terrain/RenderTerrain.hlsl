@@ -40,16 +40,46 @@ struct PSOut
 };
 
 
+// Position in the atlases of the finest resident page covering texCoord
+float2 VirtualToAtlasUV(float2 texCoord, float2 atlasSize)
+{
+    Texture2D<uint> indirection = GetBindlessResource(Resources.IndirectionTextureIndex);
+    uint2 pages = uint2(Resources.VirtualPagesX, Resources.VirtualPagesY);
+    uint2 page = min(uint2(texCoord * pages), pages - 1);
+    uint entry = indirection[page];
+    uint slot = entry & 0xFFFF;
+    uint mip = entry >> 16;
+    float2 local = saturate(texCoord * float2(pages >> mip) - float2(page >> mip));
+    float slotSize = Resources.PageSize + 2 * Resources.PageBorder;
+    float2 slotOrigin = float2(slot % Resources.AtlasSlotsX, slot / Resources.AtlasSlotsX) * slotSize + Resources.PageBorder;
+    return (slotOrigin + local * Resources.PageSize) / atlasSize;
+}
+
 [RootSignature(BindlessRootSignature)]
 PSOut PSMain(VSOut IN)
 {
-    Texture2D<float4> albedoMap = GetBindlessResource(Resources.TerrainAlbedoTextureIndex);
-    Texture2D<float4> normalMap = GetBindlessResource(Resources.TerrainNormalMapTextureIndex);
-	float4 diffuseCol = albedoMap.Sample(MipMapSampler, IN.TexCoord);
+	float4 diffuseCol;
+	float3 normalMapVal;
+	if (Resources.UseVirtualTexture)
+	{
+		Texture2D<float4> albedoAtlas = GetBindlessResource(Resources.AlbedoAtlasTextureIndex);
+		Texture2D<float4> normalAtlas = GetBindlessResource(Resources.NormalAtlasTextureIndex);
+		float2 atlasSize;
+		albedoAtlas.GetDimensions(atlasSize.x, atlasSize.y);
+		float2 atlasUV = VirtualToAtlasUV(IN.TexCoord, atlasSize);
+		diffuseCol = albedoAtlas.SampleLevel(linearSampler, atlasUV, 0);
+		normalMapVal = normalAtlas.SampleLevel(linearSampler, atlasUV, 0).xyz * 2 - 1;
+	}
+	else
+	{
+		Texture2D<float4> albedoMap = GetBindlessResource(Resources.TerrainAlbedoTextureIndex);
+		Texture2D<float4> normalMap = GetBindlessResource(Resources.TerrainNormalMapTextureIndex);
+		diffuseCol = albedoMap.Sample(MipMapSampler, IN.TexCoord);
+		normalMapVal = normalMap.Sample(MipMapSampler, IN.TexCoord).xyz * 2 - 1;
+	}
 
     PSOut output;
     output.Albedo = diffuseCol;
-	float3 normalMapVal = normalMap.Sample(MipMapSampler, IN.TexCoord).xyz * 2 - 1;
 	normalMapVal = normalize(normalMapVal);
 	
     float3 normal = normalize(mul((float3x3) Resources.Normal, float3(0, 1, 0)));
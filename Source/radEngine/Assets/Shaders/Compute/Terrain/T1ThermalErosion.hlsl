@@ -0,0 +1,55 @@
+#include "TerrainCommon.hlsli"
+
+ConstantBuffer<ThermalErosionResources> Resources : register(b0);
+
+float TalusAngle(float hardness)
+{
+    return hardness * (1.0 - Resources.SoftnessTalusCoefficient) + Resources.MinTalusCoefficient;
+}
+
+// Moved material per unit of height difference, the outflux towards a neighbour is this times the height difference
+float FluxPerHeightDiff(float hardness)
+{
+    float cellArea = Resources.PipeLength * Resources.PipeLength;
+    return cellArea * Resources.DeltaTime * hardness * Resources.ThermalErosionRate * 0.5;
+}
+
+// Gather formulation: instead of storing 8 outflux values per cell and reading them back in a second pass, every cell
+// recomputes the outflux of its neighbours towards itself. The outflux of a cell towards a neighbour only depends on
+// their height difference and the cell's own hardness, so 9 heights and 9 hardness values are all that is needed.
+[RootSignature(BindlessRootSignature)]
+[numthreads(8, 8, 1)]
+void CSMain(uint3 dispatchID : SV_DispatchThreadID)
+{
+    Texture2D<float> heightMap = GetBindlessResource(Resources.InHeightMapIndex);
+    Texture2D<float> hardnessMap = GetBindlessResource(Resources.InHardnessMapIndex);
+    RWTexture2D<float> outHeightMap = GetBindlessResource(Resources.OutHeightMapIndex);
+    uint2 textureSize;
+    heightMap.GetDimensions(textureSize.x, textureSize.y);
+
+    float heightCur = heightMap[dispatchID.xy];
+    float hardnessCur = hardnessMap[dispatchID.xy];
+    float talusCur = TalusAngle(hardnessCur);
+
+    float outHeightDiffs = 0;
+    float inFlux = 0;
+    for (uint i = 0; i < 8; i++)
+    {
+        int2 offset = IndexToOffset8(i);
+        int2 neighborCoord = int2(dispatchID.xy) + offset;
+        if (!IsInBounds(neighborCoord, textureSize))
+            continue;
+        float d = length(float2(offset)) * Resources.PipeLength;
+        float heightDiff = heightCur - heightMap[neighborCoord];
+        if (heightDiff > 0 && heightDiff / d > talusCur)
+            outHeightDiffs += heightDiff;
+        else if (-heightDiff > 0)
+        {
+            float hardnessNeighbor = hardnessMap[neighborCoord];
+            if (-heightDiff / d > TalusAngle(hardnessNeighbor))
+                inFlux += FluxPerHeightDiff(hardnessNeighbor) * -heightDiff;
+        }
+    }
+
+    outHeightMap[dispatchID.xy] = heightCur + inFlux - FluxPerHeightDiff(hardnessCur) * outHeightDiffs;
+}
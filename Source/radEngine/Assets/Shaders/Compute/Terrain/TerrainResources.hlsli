@@ -36,6 +36,15 @@ struct TerrainRenderResources
     uint TerrainAlbedoTextureIndex;
     uint TerrainNormalMapTextureIndex;
     float TotalLength DEFAULT_VALUE(1024.0f);
+    // Albedo and normal read through the virtual texture atlases instead, see VirtualTexturePageTable.h
+    uint UseVirtualTexture DEFAULT_VALUE(0);
+    uint IndirectionTextureIndex;
+    uint AlbedoAtlasTextureIndex;
+    uint NormalAtlasTextureIndex;
+    uint VirtualPagesX, VirtualPagesY;
+    uint AtlasSlotsX;
+    uint PageSize;
+    uint PageBorder;
 };
 
 struct WaterRenderResources
@@ -56,27 +65,27 @@ struct WaterRenderResources
     float TotalLength DEFAULT_VALUE(1024.0f);
 };
 
+struct WaterChunkMaxResources
+{
+    uint WaterHeightMapIndex;
+    uint OutChunkMaxIndex;
+    uint MeshResX, MeshResY;
+    uint ChunkQuads DEFAULT_VALUE(16);
+};
+
 #define EROSION_DELTA_TIME 0.02f
 
-struct ThermalOutfluxResources
+struct ThermalErosionResources
 {
     uint InHeightMapIndex;
     uint InHardnessMapIndex;
-    uint OutFluxTextureIndex1;
-    uint OutFluxTextureIndex2;
+    uint OutHeightMapIndex;
     float ThermalErosionRate DEFAULT_VALUE(0.15);
     float PipeLength DEFAULT_VALUE(1.0f);
     float SoftnessTalusCoefficient DEFAULT_VALUE(0.8f);
     float MinTalusCoefficient DEFAULT_VALUE(0.1f);
     float DeltaTime DEFAULT_VALUE(EROSION_DELTA_TIME);
 };
-
-struct ThermalDepositResources
-{
-    uint InFluxTextureIndex1;
-    uint InFluxTextureIndex2;
-    uint OutHeightMapIndex;
-};
  
 struct HydrolicAddWaterResources
 {
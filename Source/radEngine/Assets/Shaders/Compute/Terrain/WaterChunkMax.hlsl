@@ -0,0 +1,41 @@
+#include "TerrainCommon.hlsli"
+
+ConstantBuffer<WaterChunkMaxResources> Resources : register(b0);
+
+groupshared float GroupMax[64];
+
+// One group per chunk of the water plane, writes the highest water level of the texels the chunk's vertices can sample.
+// Must match ComputeChunkMaxWater in WaterChunks.cpp.
+[RootSignature(BindlessRootSignature)]
+[numthreads(8, 8, 1)]
+void CSMain(uint3 groupID : SV_GroupID, uint3 groupThreadID : SV_GroupThreadID, uint groupIndex : SV_GroupIndex)
+{
+    Texture2D<float> waterHeightMap = GetBindlessResource(Resources.WaterHeightMapIndex);
+    RWTexture2D<float> chunkMaxMap = GetBindlessResource(Resources.OutChunkMaxIndex);
+    uint2 textureSize;
+    waterHeightMap.GetDimensions(textureSize.x, textureSize.y);
+
+    uint2 meshRes = uint2(Resources.MeshResX, Resources.MeshResY);
+    uint2 firstVertex = groupID.xy * Resources.ChunkQuads;
+    uint2 lastVertex = min(firstVertex + Resources.ChunkQuads, meshRes - 1);
+    // One texel of margin for the bilinear sampling between vertices
+    int2 texelMin = max(int2(firstVertex * textureSize / meshRes) - 1, 0);
+    int2 texelMax = min(int2(lastVertex * textureSize / meshRes) + 1, int2(textureSize) - 1);
+
+    float maxWater = 0;
+    for (int y = texelMin.y + groupThreadID.y; y <= texelMax.y; y += 8)
+        for (int x = texelMin.x + groupThreadID.x; x <= texelMax.x; x += 8)
+            maxWater = max(maxWater, waterHeightMap[int2(x, y)]);
+
+    GroupMax[groupIndex] = maxWater;
+    GroupMemoryBarrierWithGroupSync();
+    for (uint stride = 32; stride > 0; stride >>= 1)
+    {
+        if (groupIndex < stride)
+            GroupMax[groupIndex] = max(GroupMax[groupIndex], GroupMax[groupIndex + stride]);
+        GroupMemoryBarrierWithGroupSync();
+    }
+
+    if (groupIndex == 0)
+        chunkMaxMap[groupID.xy] = GroupMax[0];
+}
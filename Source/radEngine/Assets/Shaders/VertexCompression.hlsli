@@ -0,0 +1,98 @@
+// clang-format off
+#pragma once
+#include "Common.hlsli"
+
+// Compact vertex layouts and their decoders, shared so the C++ encoders are checked against the exact decode the
+// shaders run. Only the intrinsics shimmed below may be used in the functions.
+#ifdef __cplusplus
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+namespace rad
+{
+namespace hlsl
+{
+
+using std::abs;
+using std::max;
+using glm::normalize;
+
+inline int asint(uint value)
+{
+	return std::bit_cast<int>(value);
+}
+
+inline float f16tof32(uint value)
+{
+	return glm::unpackHalf1x16(uint16_t(value));
+}
+#endif
+
+// 20 bytes. Position is unorm16 within the bounds of the vertex buffer, x and y in PositionXY and z in the low half of
+// PositionZ. Normal and Tangent are octahedral, TexCoord is two halves.
+struct CompactVertex
+{
+    uint PositionXY;
+    uint PositionZ;
+    uint Normal;
+    uint Tangent;
+    uint TexCoord;
+};
+
+// 24 bytes, for meshes whose extent would make 16 bit positions too coarse
+struct CompactVertexFloat
+{
+    float3 Position;
+    uint Normal;
+    uint Tangent;
+    uint TexCoord;
+};
+
+// Signed normalized value in the low bitCount bits of bits
+SHARED_FUNCTION float DecodeSnorm(uint bits, uint bitCount)
+{
+    uint shift = 32 - bitCount;
+    return max(float(asint(bits << shift) >> shift) / float((1u << (bitCount - 1)) - 1), -1.0f);
+}
+
+// Unit vector from a point of the octahedron unfolded onto [-1, 1]^2
+SHARED_FUNCTION float3 DecodeOctahedral(float2 encoded)
+{
+    float3 n = float3(encoded.x, encoded.y, 1.0f - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -fold : fold;
+    n.y += n.y >= 0.0f ? -fold : fold;
+    return normalize(n);
+}
+
+SHARED_FUNCTION float3 DecodeCompactPosition(uint positionXY, uint positionZ, float3 boundsMin, float3 boundsExtent)
+{
+    float3 unorm = float3(float(positionXY & 0xFFFF), float(positionXY >> 16), float(positionZ & 0xFFFF)) / 65535.0f;
+    return boundsMin + unorm * boundsExtent;
+}
+
+// Two snorm16 octahedral coordinates
+SHARED_FUNCTION float3 DecodeCompactNormal(uint normal)
+{
+    return DecodeOctahedral(float2(DecodeSnorm(normal, 16), DecodeSnorm(normal >> 16, 16)));
+}
+
+// Octahedral like the normal but with 15 bits in y, the top bit is set when the bitangent is -cross(normal, tangent).
+// Returns the handedness in w.
+SHARED_FUNCTION float4 DecodeCompactTangent(uint tangent)
+{
+    float3 direction = DecodeOctahedral(float2(DecodeSnorm(tangent, 16), DecodeSnorm(tangent >> 16, 15)));
+    return float4(direction, (tangent >> 31) != 0 ? -1.0f : 1.0f);
+}
+
+SHARED_FUNCTION float2 DecodeCompactTexCoord(uint texCoord)
+{
+    return float2(f16tof32(texCoord), f16tof32(texCoord >> 16));
+}
+
+#ifdef __cplusplus
+}; // namespace hlsl
+}; // namespace rad
+#endif
@@ -1,5 +1,7 @@
 #include "DXResource.h"
 #include "RendererCommon.h"
+#include "StagingAllocator.h"
+#include "TextureFootprint.h"
 
 namespace rad
 {
@@ -28,18 +30,30 @@ DXTexture DXTexture::FromExisting(RadDevice& device, std::wstring name, ComPtr<I
 
 void DXTexture::UploadData(CommandContext& commandCtx, std::span<const std::byte> data, uint8_t bytesPerPixel)
 {
-	TransitionVec(*this, D3D12_RESOURCE_STATE_COPY_DEST).Execute(commandCtx.CommandList);
-	auto intermediateBuf =
-		DXBuffer::Create(commandCtx.Device, Name + L"_IntermediateBuffer", data.size(), D3D12_HEAP_TYPE_UPLOAD);
-	commandCtx.IntermediateResources.push_back(intermediateBuf.Resource);
-	D3D12_SUBRESOURCE_DATA subresourceData = {};
-	subresourceData.pData = data.data();
-	subresourceData.RowPitch = Info.Width * bytesPerPixel;
-	subresourceData.SlicePitch = Info.Height * subresourceData.RowPitch;
+	UploadRegion(commandCtx, Region{.Width = Info.Width, .Height = Info.Height}, data, bytesPerPixel);
+}
+
+void DXTexture::UploadRegion(CommandContext& commandCtx, Region const& region, std::span<const std::byte> data,
+							 uint8_t bytesPerPixel, uint64_t srcRowPitch)
+{
+	assert(region.X + region.Width <= std::max(1u, Info.Width >> region.MipLevel));
+	assert(region.Y + region.Height <= std::max(1u, Info.Height >> region.MipLevel));
+	if (!region.Width || !region.Height)
+		return;
 
-	uint64_t res = UpdateSubresources(&commandCtx.CommandList, Resource.Get(), intermediateBuf.Resource.Get(), 0, 0, 1,
-									  &subresourceData);
-	assert(res != 0);
+	auto footprint = ComputeRegionFootprint(region.Width, region.Height, bytesPerPixel);
+	auto staging =
+		commandCtx.Staging.Allocate(commandCtx.Device, footprint.TotalBytes, TextureDataPlacementAlignment);
+	CopyRegionRows(footprint, data, srcRowPitch ? srcRowPitch : footprint.RowBytes, staging.CPUAddress);
+
+	TransitionVec(*this, D3D12_RESOURCE_STATE_COPY_DEST).Execute(commandCtx.CommandList);
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT placedFootprint = {
+		.Offset = staging.Offset,
+		.Footprint = {Info.Format, region.Width, region.Height, 1, UINT(footprint.RowPitch)},
+	};
+	CD3DX12_TEXTURE_COPY_LOCATION src(staging.Resource, placedFootprint);
+	CD3DX12_TEXTURE_COPY_LOCATION dst(Resource.Get(), region.MipLevel);
+	commandCtx->CopyTextureRegion(&dst, region.X, region.Y, 0, &src, nullptr);
 }
 
 ShaderResourceView DXTexture::CreateSRV(D3D12_SHADER_RESOURCE_VIEW_DESC const* srvDesc)
@@ -69,9 +83,14 @@ DXBuffer DXBuffer::Create(RadDevice& device, std::wstring name, size_t size, D3D
 	ComPtr<ID3D12Resource> resource;
 	auto desc = CD3DX12_RESOURCE_DESC::Buffer(size, flags);
 	auto heapProp = CD3DX12_HEAP_PROPERTIES(heapType);
-	device.CreateCommittedResource(&heapProp, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_COMMON, nullptr,
+	// Readback heap resources can only live in the copy dest state
+	auto startState =
+		heapType == D3D12_HEAP_TYPE_READBACK ? D3D12_RESOURCE_STATE_COPY_DEST : D3D12_RESOURCE_STATE_COMMON;
+	device.CreateCommittedResource(&heapProp, D3D12_HEAP_FLAG_NONE, &desc, startState, nullptr,
 								   IID_PPV_ARGS(&resource));
-	return DXBuffer(name, resource, size);
+	DXBuffer buffer(name, resource, size);
+	buffer.State = startState;
+	return buffer;
 }
 
 DXBuffer DXBuffer::CreateAndUpload(RadDevice& device, std::wstring name, CommandContext& commandCtx,
@@ -61,12 +61,33 @@ struct DXTexture : DXResource
 								  TextureCreateInfo const& info,
 								  D3D12_RESOURCE_STATES startState = D3D12_RESOURCE_STATE_COMMON);
 
+	struct Region
+	{
+		uint32_t X = 0;
+		uint32_t Y = 0;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t MipLevel = 0;
+	};
+
 	void UploadData(CommandContext& commandCtx, std::span<const std::byte> data, uint8_t bytesPerPixel);
 	template <typename T> void UploadDataTyped(CommandContext& commandCtx, std::span<const T> data)
 	{
 		UploadData(commandCtx, std::span<const std::byte>((std::byte const*)data.data(), data.size_bytes()), sizeof(T));
 	}
 
+	// Uploads a rect of a mip through the command context's staging memory. srcRowPitch is the distance in bytes
+	// between two rows in data, 0 means the rows are tightly packed.
+	void UploadRegion(CommandContext& commandCtx, Region const& region, std::span<const std::byte> data,
+					  uint8_t bytesPerPixel, uint64_t srcRowPitch = 0);
+	template <typename T>
+	void UploadRegionTyped(CommandContext& commandCtx, Region const& region, std::span<const T> data,
+						   uint64_t srcRowPitchInElements = 0)
+	{
+		UploadRegion(commandCtx, region, std::span<const std::byte>((std::byte const*)data.data(), data.size_bytes()),
+					 sizeof(T), srcRowPitchInElements * sizeof(T));
+	}
+
 	ShaderResourceView CreateSRV(D3D12_SHADER_RESOURCE_VIEW_DESC const* srvDesc);
 	UnorderedAccessView CreateUAV(D3D12_UNORDERED_ACCESS_VIEW_DESC const* uavDesc);
 	RenderTargetView CreateRTV(D3D12_RENDER_TARGET_VIEW_DESC const* rtvDesc);
@@ -0,0 +1,128 @@
+#include "GPUReadback.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace rad
+{
+
+std::unique_ptr<GPUReadback> GPUReadback::Create(RadDevice& device, uint64_t capacity)
+{
+	auto readback = std::make_unique<GPUReadback>();
+	readback->CreateBuffer(device, capacity);
+	return readback;
+}
+
+GPUReadback::~GPUReadback()
+{
+	ReleaseBuffer();
+}
+
+bool GPUReadback::Reserve(RadDevice& device, uint64_t capacity)
+{
+	if (capacity <= Ring.GetCapacity())
+		return true;
+	if (Ring.GetLiveAllocationCount())
+		return false;
+	ReleaseBuffer();
+	CreateBuffer(device, capacity);
+	ReportedOversize = false;
+	return true;
+}
+
+void GPUReadback::CreateBuffer(RadDevice& device, uint64_t capacity)
+{
+	Buffer = DXBuffer::Create(device, L"ReadbackRing", capacity, D3D12_HEAP_TYPE_READBACK);
+	// Readback buffers may stay mapped, every read goes through the range of a retired copy
+	MappedData = Buffer.Map<std::byte>();
+	Ring = ReadbackRing(Buffer.Size);
+}
+
+void GPUReadback::ReleaseBuffer()
+{
+	if (MappedData)
+	{
+		D3D12_RANGE writtenRange = {0, 0};
+		Buffer.Resource->Unmap(0, &writtenRange);
+		MappedData = nullptr;
+	}
+	Buffer = {};
+}
+
+std::optional<ReadbackRing::Allocation> GPUReadback::Allocate(uint64_t size, uint64_t alignment)
+{
+	if (size > Ring.GetCapacity() && !ReportedOversize)
+	{
+		std::cerr << "Readback of " << size << " bytes can't fit the " << Ring.GetCapacity()
+				  << " byte readback ring, Reserve more" << std::endl;
+		ReportedOversize = true;
+	}
+	return Ring.Allocate(size, alignment);
+}
+
+bool GPUReadback::ReadBuffer(CommandContext& commandCtx, DXBuffer& buffer, uint64_t offset, uint64_t size,
+							 BufferCallback callback)
+{
+	auto allocation = Allocate(size, 16);
+	if (!allocation)
+		return false;
+
+	TransitionVec(buffer, D3D12_RESOURCE_STATE_COPY_SOURCE).Execute(commandCtx);
+	commandCtx->CopyBufferRegion(Buffer.Resource.Get(), allocation->Offset, buffer.Resource.Get(), offset, size);
+
+	commandCtx.RetireCallbacks.push_back(
+		[this, allocation = *allocation, size, callback = std::move(callback)]() mutable
+		{
+			callback(std::span<const std::byte>(MappedData + allocation.Offset, size));
+			Ring.Complete(allocation.Id);
+		});
+	return true;
+}
+
+bool GPUReadback::ReadTexture(CommandContext& commandCtx, DXTexture& texture, uint32_t mipLevel,
+							  uint32_t bytesPerPixel, TextureCallback callback)
+{
+	auto footprint = ComputeRegionFootprint(std::max(1u, texture.Info.Width >> mipLevel),
+											std::max(1u, texture.Info.Height >> mipLevel), bytesPerPixel);
+	auto allocation = Allocate(footprint.TotalBytes, TextureDataPlacementAlignment);
+	if (!allocation)
+		return false;
+
+	TransitionVec(texture, D3D12_RESOURCE_STATE_COPY_SOURCE).Execute(commandCtx);
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT placedFootprint = {
+		.Offset = allocation->Offset,
+		.Footprint = {texture.Info.Format, footprint.Width, footprint.Height, 1, UINT(footprint.RowPitch)},
+	};
+	CD3DX12_TEXTURE_COPY_LOCATION dst(Buffer.Resource.Get(), placedFootprint);
+	CD3DX12_TEXTURE_COPY_LOCATION src(texture.Resource.Get(), mipLevel);
+	commandCtx->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+
+	commandCtx.RetireCallbacks.push_back(
+		[this, allocation = *allocation, footprint, callback = std::move(callback)]() mutable
+		{
+			callback(std::span<const std::byte>(MappedData + allocation.Offset, footprint.TotalBytes), footprint);
+			Ring.Complete(allocation.Id);
+		});
+	return true;
+}
+
+bool GPUReadback::ReadQueries(CommandContext& commandCtx, ID3D12QueryHeap& queryHeap, D3D12_QUERY_TYPE type,
+							  uint32_t startIndex, uint32_t count, BufferCallback callback)
+{
+	uint64_t size = count * sizeof(uint64_t);
+	auto allocation = Allocate(size, sizeof(uint64_t));
+	if (!allocation)
+		return false;
+
+	commandCtx->ResolveQueryData(&queryHeap, type, startIndex, count, Buffer.Resource.Get(), allocation->Offset);
+
+	commandCtx.RetireCallbacks.push_back(
+		[this, allocation = *allocation, size, callback = std::move(callback)]() mutable
+		{
+			callback(std::span<const std::byte>(MappedData + allocation.Offset, size));
+			Ring.Complete(allocation.Id);
+		});
+	return true;
+}
+
+} // namespace rad
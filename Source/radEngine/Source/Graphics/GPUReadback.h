@@ -0,0 +1,53 @@
+#pragma once
+
+#include "DXResource.h"
+#include "ReadbackRing.h"
+#include "TextureFootprint.h"
+
+namespace rad
+{
+
+/*
+Copies buffers and textures into a persistently mapped READBACK buffer and calls back once the command context the copy
+was recorded on has retired. Nothing waits on the GPU, the data just shows up a few frames later. Data spans are only
+valid during the callback.
+*/
+struct GPUReadback
+{
+	using BufferCallback = std::move_only_function<void(std::span<const std::byte> data)>;
+	using TextureCallback =
+		std::move_only_function<void(std::span<const std::byte> data, TextureRegionFootprint const& footprint)>;
+
+	static std::unique_ptr<GPUReadback> Create(RadDevice& device, uint64_t capacity);
+	~GPUReadback();
+
+	// Grows the ring to at least capacity bytes. Only possible while nothing is in flight, returns false otherwise.
+	bool Reserve(RadDevice& device, uint64_t capacity);
+
+	// Both return false without recording anything when the ring is full. A request larger than the whole ring can
+	// never succeed, it is reported once.
+	bool ReadBuffer(CommandContext& commandCtx, DXBuffer& buffer, uint64_t offset, uint64_t size,
+					BufferCallback callback);
+	bool ReadTexture(CommandContext& commandCtx, DXTexture& texture, uint32_t mipLevel, uint32_t bytesPerPixel,
+					 TextureCallback callback);
+	// Resolves count 64 bit queries straight into the ring
+	bool ReadQueries(CommandContext& commandCtx, ID3D12QueryHeap& queryHeap, D3D12_QUERY_TYPE type, uint32_t startIndex,
+					 uint32_t count, BufferCallback callback);
+
+	ReadbackRing const& GetRing() const
+	{
+		return Ring;
+	}
+
+  private:
+	void CreateBuffer(RadDevice& device, uint64_t capacity);
+	void ReleaseBuffer();
+	std::optional<ReadbackRing::Allocation> Allocate(uint64_t size, uint64_t alignment);
+
+	DXBuffer Buffer;
+	std::byte* MappedData = nullptr;
+	ReadbackRing Ring;
+	bool ReportedOversize = false;
+};
+
+} // namespace rad
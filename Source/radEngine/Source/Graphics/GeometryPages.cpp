@@ -0,0 +1,36 @@
+#include "GeometryPages.h"
+
+#include <algorithm>
+
+namespace rad
+{
+
+GeometryPages::Allocation GeometryPages::Allocate(uint32_t count)
+{
+	Allocation allocation;
+	allocation.Range.Count = count;
+	if (count == 0)
+		return allocation;
+
+	for (uint32_t page = 0; page < Pages.size(); page++)
+		if (auto offset = Pages[page].Allocate(count))
+		{
+			allocation.Range.Page = page;
+			allocation.Range.Offset = uint32_t(*offset);
+			return allocation;
+		}
+
+	allocation.NewPageSize = std::max<uint64_t>(PageSize, count);
+	allocation.Range.Page = uint32_t(Pages.size());
+	allocation.Range.Offset = uint32_t(*Pages.emplace_back(allocation.NewPageSize).Allocate(count));
+	return allocation;
+}
+
+void GeometryPages::Free(GeometryRange range, std::vector<std::move_only_function<void()>>& retireCallbacks)
+{
+	if (range.Count == 0)
+		return;
+	retireCallbacks.push_back([this, range]() { Pages[range.Page].Free(range.Offset, range.Count); });
+}
+
+} // namespace rad
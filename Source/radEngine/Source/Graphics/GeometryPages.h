@@ -0,0 +1,56 @@
+#pragma once
+
+#include "RangeAllocator.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace rad
+{
+
+// Elements of one page of a GeometryPool buffer, Offset and Count are in vertices or indices
+struct GeometryRange
+{
+	uint32_t Page = 0;
+	uint32_t Offset = 0;
+	uint32_t Count = 0;
+};
+
+/*
+The ranges taken from the pages of one GeometryPool buffer. A range goes into the first page with room for it, a page
+is added when none has, and a range larger than a page gets a page of its own. A freed range is only given back when
+the retire callback it queued runs, so draws still in flight keep their data. Knows nothing about D3D12 so it can be
+exercised on its own.
+*/
+struct GeometryPages
+{
+	struct Allocation
+	{
+		GeometryRange Range;
+		// Elements of the page the caller has to create for the range, 0 when it went into an existing page
+		uint64_t NewPageSize = 0;
+	};
+
+	explicit GeometryPages(uint64_t pageSize) : PageSize(pageSize) {}
+
+	// An empty range for a count of 0
+	Allocation Allocate(uint32_t count);
+	void Free(GeometryRange range, std::vector<std::move_only_function<void()>>& retireCallbacks);
+
+	size_t GetPageCount() const
+	{
+		return Pages.size();
+	}
+	RangeAllocator const& GetPage(uint32_t page) const
+	{
+		return Pages[page];
+	}
+
+  private:
+	// In elements
+	uint64_t PageSize = 0;
+	std::vector<RangeAllocator> Pages;
+};
+
+} // namespace rad
@@ -0,0 +1,64 @@
+#include "GeometryPool.h"
+
+#include "StagingAllocator.h"
+
+#include <cstring>
+
+namespace rad
+{
+
+GeometryRange GeometryPool::UploadVertices(CommandContext& commandCtx, std::span<const Vertex> vertices)
+{
+	return Vertices.Upload(commandCtx, std::as_bytes(vertices));
+}
+
+GeometryRange GeometryPool::UploadIndices(CommandContext& commandCtx, std::span<const uint32_t> indices)
+{
+	return Indices.Upload(commandCtx, std::as_bytes(indices));
+}
+
+void GeometryPool::FreeVertices(CommandContext& commandCtx, GeometryRange range)
+{
+	Vertices.Free(commandCtx, range);
+}
+
+void GeometryPool::FreeIndices(CommandContext& commandCtx, GeometryRange range)
+{
+	Indices.Free(commandCtx, range);
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryPool::VertexBufferView(uint32_t page)
+{
+	return Vertices.Pages[page].VertexBufferView(Vertices.Stride);
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryPool::IndexBufferView(uint32_t page)
+{
+	return Indices.Pages[page].IndexBufferView(DXGI_FORMAT_R32_UINT);
+}
+
+GeometryRange GeometryPool::PooledBuffer::Upload(CommandContext& commandCtx, std::span<const std::byte> data)
+{
+	auto [range, newPageSize] = Ranges.Allocate(uint32_t(data.size() / Stride));
+	if (range.Count == 0)
+		return range;
+	if (newPageSize)
+		Pages.push_back(DXBuffer::Create(commandCtx.Device, Name + std::to_wstring(range.Page), newPageSize * Stride,
+										 D3D12_HEAP_TYPE_DEFAULT));
+
+	auto staging = commandCtx.Staging.Allocate(commandCtx.Device, data.size(), 16);
+	std::memcpy(staging.CPUAddress, data.data(), data.size());
+	auto& buffer = Pages[range.Page];
+	TransitionVec(buffer, D3D12_RESOURCE_STATE_COPY_DEST).Execute(commandCtx);
+	commandCtx->CopyBufferRegion(buffer.Resource.Get(), uint64_t(range.Offset) * Stride, staging.Resource,
+								 staging.Offset, data.size());
+	TransitionVec(buffer, State).Execute(commandCtx);
+	return range;
+}
+
+void GeometryPool::PooledBuffer::Free(CommandContext& commandCtx, GeometryRange range)
+{
+	Ranges.Free(range, commandCtx.RetireCallbacks);
+}
+
+} // namespace rad
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "DXResource.h"
+#include "GeometryPages.h"
+#include "Model.h"
+#include "RendererCommon.h"
+
+#include <span>
+#include <vector>
+
+namespace rad
+{
+
+/*
+Vertex and index buffers shared by every mesh. Each is a few large pages that meshes take ranges of, so consecutive
+draws bind the same buffers and only differ in StartIndexLocation and BaseVertexLocation. A page is added when none has
+a free range large enough, and a range larger than a page gets a page of its own. Freed ranges are given back once the
+command context that freed them has retired, so draws still in flight keep their data.
+*/
+struct GeometryPool
+{
+	GeometryRange UploadVertices(CommandContext& commandCtx, std::span<const Vertex> vertices);
+	GeometryRange UploadIndices(CommandContext& commandCtx, std::span<const uint32_t> indices);
+	void FreeVertices(CommandContext& commandCtx, GeometryRange range);
+	void FreeIndices(CommandContext& commandCtx, GeometryRange range);
+
+	D3D12_VERTEX_BUFFER_VIEW VertexBufferView(uint32_t page);
+	D3D12_INDEX_BUFFER_VIEW IndexBufferView(uint32_t page);
+
+  private:
+	struct PooledBuffer
+	{
+		std::wstring Name;
+		uint32_t Stride = 0;
+		// The state the pages are in between uploads
+		D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+		GeometryPages Ranges;
+		std::vector<DXBuffer> Pages;
+
+		GeometryRange Upload(CommandContext& commandCtx, std::span<const std::byte> data);
+		void Free(CommandContext& commandCtx, GeometryRange range);
+	};
+
+	PooledBuffer Vertices{L"GeometryPoolVertices", sizeof(Vertex), D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
+						  GeometryPages(1 << 20)};
+	PooledBuffer Indices{L"GeometryPoolIndices", sizeof(uint32_t), D3D12_RESOURCE_STATE_INDEX_BUFFER,
+						 GeometryPages(1 << 22)};
+};
+
+} // namespace rad
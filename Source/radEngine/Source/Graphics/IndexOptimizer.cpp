@@ -0,0 +1,281 @@
+#include "IndexOptimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+namespace rad
+{
+
+namespace
+{
+
+// FIFO cache kept as the time each vertex was last loaded, a vertex is cached while fewer than cacheSize loads
+// happened since
+struct VertexCacheSimulation
+{
+	VertexCacheSimulation(uint32_t vertexCount, uint32_t cacheSize)
+		: LoadTimes(vertexCount, 0), Time(cacheSize + 1), CacheSize(cacheSize)
+	{
+	}
+
+	bool IsCached(uint32_t vertex) const
+	{
+		return Time - LoadTimes[vertex] <= CacheSize;
+	}
+
+	// Returns the number of the triangle's vertices that had to be loaded
+	uint32_t Draw(uint32_t const* triangle)
+	{
+		uint32_t misses = 0;
+		for (int corner = 0; corner < 3; corner++)
+			if (!IsCached(triangle[corner]))
+			{
+				LoadTimes[triangle[corner]] = Time++;
+				misses++;
+			}
+		return misses;
+	}
+
+	void Flush()
+	{
+		Time += CacheSize + 1;
+	}
+
+	std::vector<uint32_t> LoadTimes;
+	uint32_t Time;
+	uint32_t CacheSize;
+};
+
+} // namespace
+
+VertexTriangles::VertexTriangles(std::span<const uint32_t> indices, uint32_t vertexCount) : Offsets(vertexCount + 1, 0)
+{
+	for (uint32_t index : indices)
+		Offsets[index + 1]++;
+	std::partial_sum(Offsets.begin(), Offsets.end(), Offsets.begin());
+	Triangles.resize(indices.size());
+	std::vector<uint32_t> fill(Offsets.begin(), Offsets.end() - 1);
+	for (size_t corner = 0; corner < indices.size(); corner++)
+		Triangles[fill[indices[corner]]++] = uint32_t(corner / 3);
+}
+
+VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	assert(indices.size() % 3 == 0);
+	VertexCacheStats stats;
+	if (indices.empty())
+		return stats;
+
+	VertexCacheSimulation cache(vertexCount, cacheSize);
+	std::vector<uint8_t> used(vertexCount, 0);
+	uint32_t misses = 0;
+	uint32_t usedCount = 0;
+	for (size_t triangle = 0; triangle < indices.size(); triangle += 3)
+	{
+		misses += cache.Draw(&indices[triangle]);
+		for (int corner = 0; corner < 3; corner++)
+		{
+			usedCount += !used[indices[triangle + corner]];
+			used[indices[triangle + corner]] = 1;
+		}
+	}
+	stats.ACMR = float(misses) / float(indices.size() / 3);
+	stats.ATVR = float(misses) / float(usedCount);
+	return stats;
+}
+
+void OptimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize)
+{
+	assert(indices.size() % 3 == 0);
+	uint32_t triangleCount = uint32_t(indices.size() / 3);
+	if (triangleCount == 0)
+		return;
+
+	VertexTriangles adjacency(indices, vertexCount);
+	std::vector<uint32_t> liveTriangles(vertexCount);
+	for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+		liveTriangles[vertex] = adjacency.Offsets[vertex + 1] - adjacency.Offsets[vertex];
+
+	VertexCacheSimulation cache(vertexCount, cacheSize);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	constexpr uint32_t NoVertex = ~0u;
+	uint32_t fanVertex = indices[0];
+	// Vertices below it have no live triangles left, the fallback scan only moves forwards
+	uint32_t scanVertex = 0;
+	while (fanVertex != NoVertex)
+	{
+		candidates.clear();
+		for (uint32_t triangle : adjacency.Of(fanVertex))
+		{
+			if (emitted[triangle])
+				continue;
+			uint32_t const* corners = &indices[triangle * 3];
+			for (int corner = 0; corner < 3; corner++)
+			{
+				deadEnds.push_back(corners[corner]);
+				candidates.push_back(corners[corner]);
+				liveTriangles[corners[corner]]--;
+			}
+			cache.Draw(corners);
+			result.insert(result.end(), corners, corners + 3);
+			emitted[triangle] = 1;
+		}
+
+		// The oldest candidate that stays cached through its own fan, or failing that the youngest candidate left
+		uint32_t next = NoVertex;
+		int64_t bestPriority = -1;
+		for (uint32_t vertex : candidates)
+		{
+			if (liveTriangles[vertex] == 0)
+				continue;
+			int64_t priority = 0;
+			uint32_t age = cache.Time - cache.LoadTimes[vertex];
+			if (age + 2 * liveTriangles[vertex] <= cacheSize)
+				priority = age;
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				next = vertex;
+			}
+		}
+
+		while (next == NoVertex && !deadEnds.empty())
+		{
+			uint32_t vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (liveTriangles[vertex] > 0)
+				next = vertex;
+		}
+		for (; next == NoVertex && scanVertex < vertexCount; scanVertex++)
+			if (liveTriangles[scanVertex] > 0)
+				next = scanVertex;
+		fanVertex = next;
+	}
+
+	assert(result.size() == indices.size());
+	std::ranges::copy(result, indices.begin());
+}
+
+void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const glm::vec3> positions, float threshold,
+					  uint32_t cacheSize)
+{
+	assert(indices.size() % 3 == 0);
+	uint32_t triangleCount = uint32_t(indices.size() / 3);
+	if (triangleCount == 0)
+		return;
+	uint32_t vertexCount = uint32_t(positions.size());
+
+	// Hard boundaries where the cache starts over, a triangle that loads all of its vertices reuses nothing before it
+	std::vector<uint32_t> hardBoundaries = {0};
+	{
+		VertexCacheSimulation cache(vertexCount, cacheSize);
+		cache.Draw(&indices[0]);
+		for (uint32_t triangle = 1; triangle < triangleCount; triangle++)
+			if (cache.Draw(&indices[triangle * 3]) == 3)
+				hardBoundaries.push_back(triangle);
+	}
+	hardBoundaries.push_back(triangleCount);
+
+	// Soft boundaries within each run wherever a prefix is already as cache friendly as the run as a whole
+	std::vector<uint32_t> clusterStarts;
+	VertexCacheSimulation cache(vertexCount, cacheSize);
+	for (size_t run = 0; run + 1 < hardBoundaries.size(); run++)
+	{
+		uint32_t start = hardBoundaries[run];
+		uint32_t end = hardBoundaries[run + 1];
+		cache.Flush();
+		uint32_t runMisses = 0;
+		for (uint32_t triangle = start; triangle < end; triangle++)
+			runMisses += cache.Draw(&indices[triangle * 3]);
+		float thresholdACMR = float(runMisses) / float(end - start) * threshold;
+
+		cache.Flush();
+		clusterStarts.push_back(start);
+		uint32_t clusterStart = start;
+		uint32_t clusterMisses = 0;
+		for (uint32_t triangle = start; triangle + 1 < end; triangle++)
+		{
+			clusterMisses += cache.Draw(&indices[triangle * 3]);
+			if (float(clusterMisses) / float(triangle + 1 - clusterStart) <= thresholdACMR)
+			{
+				clusterStarts.push_back(triangle + 1);
+				clusterStart = triangle + 1;
+				clusterMisses = 0;
+				cache.Flush();
+			}
+		}
+	}
+	size_t clusterCount = clusterStarts.size();
+	clusterStarts.push_back(triangleCount);
+
+	// Area weighted centroids and normals of the clusters and the mesh
+	std::vector<glm::vec3> centroids(clusterCount);
+	std::vector<glm::vec3> normals(clusterCount);
+	glm::vec3 meshCentroid = {};
+	float meshArea = 0.0f;
+	for (size_t cluster = 0; cluster < clusterCount; cluster++)
+	{
+		glm::vec3 centroid = {};
+		glm::vec3 normal = {};
+		float area = 0.0f;
+		for (uint32_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++)
+		{
+			glm::vec3 p0 = positions[indices[triangle * 3]];
+			glm::vec3 p1 = positions[indices[triangle * 3 + 1]];
+			glm::vec3 p2 = positions[indices[triangle * 3 + 2]];
+			glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+			float triangleArea = std::sqrt(glm::dot(cross, cross));
+			centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+		meshCentroid += centroid;
+		meshArea += area;
+		centroids[cluster] = area > 0.0f ? centroid / area : positions[indices[clusterStarts[cluster] * 3]];
+		float normalLength = std::sqrt(glm::dot(normal, normal));
+		normals[cluster] = normalLength > 0.0f ? normal / normalLength : glm::vec3();
+	}
+	if (meshArea > 0.0f)
+		meshCentroid /= meshArea;
+
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; cluster++)
+		sortKeys[cluster] = glm::dot(centroids[cluster] - meshCentroid, normals[cluster]);
+	std::vector<uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::ranges::stable_sort(order, [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+	for (uint32_t cluster : order)
+		result.insert(result.end(), indices.begin() + clusterStarts[cluster] * 3,
+					  indices.begin() + clusterStarts[cluster + 1] * 3);
+	std::ranges::copy(result, indices.begin());
+}
+
+std::vector<uint32_t> RemapVerticesToFirstUse(std::span<std::vector<uint32_t>> indexLists, uint32_t vertexCount)
+{
+	constexpr uint32_t Unused = ~0u;
+	std::vector<uint32_t> remap(vertexCount, Unused);
+	uint32_t nextVertex = 0;
+	for (auto& indices : indexLists)
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == Unused)
+				remap[index] = nextVertex++;
+			index = remap[index];
+		}
+	for (uint32_t& vertex : remap)
+		if (vertex == Unused)
+			vertex = nextVertex++;
+	return remap;
+}
+
+} // namespace rad
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "RadishCommon.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rad
+{
+
+// Size of the post-transform vertex cache the orders are tuned for and measured with
+constexpr uint32_t VertexCacheSize = 16;
+
+/*
+How a triangle list fares in a FIFO post-transform cache. ACMR is the number of vertices transformed per triangle, 0.5
+at best on a regular grid and 3 without reuse. ATVR is the number transformed per distinct vertex, 1 at best.
+*/
+struct VertexCacheStats
+{
+	float ACMR = 0.0f;
+	float ATVR = 0.0f;
+};
+
+// Triangles around each vertex as a compressed list: the ones of vertex v are Triangles[Offsets[v], Offsets[v + 1])
+struct VertexTriangles
+{
+	VertexTriangles(std::span<const uint32_t> indices, uint32_t vertexCount);
+
+	std::span<const uint32_t> Of(uint32_t vertex) const
+	{
+		return std::span(Triangles).subspan(Offsets[vertex], Offsets[vertex + 1] - Offsets[vertex]);
+	}
+
+	std::vector<uint32_t> Offsets;
+	std::vector<uint32_t> Triangles;
+};
+
+VertexCacheStats AnalyzeVertexCache(std::span<const uint32_t> indices, uint32_t vertexCount,
+									uint32_t cacheSize = VertexCacheSize);
+
+/*
+Reorders the triangles of indices for vertex reuse with Tipsify (Sander, Nehab and Barczak 2007): triangles are emitted
+in fans around a vertex, and the next fan is the most recently used neighbor that will still be cached once its own
+remaining triangles are emitted. Runs in linear time. Indices must be below vertexCount.
+*/
+void OptimizeVertexCache(std::span<uint32_t> indices, uint32_t vertexCount, uint32_t cacheSize = VertexCacheSize);
+
+/*
+Reorders clusters of triangles of a cache optimized list so that the ones facing away from the mesh's center, which
+tend to occlude the rest, come first. The list is cut wherever the cache starts over and again wherever a cluster's
+ACMR is within threshold of the whole run's, then the clusters are sorted by how far along their normal they sit from
+the center. A threshold of 1.05 trades at most 5% of ACMR for less overdraw.
+*/
+void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const glm::vec3> positions, float threshold = 1.05f,
+					  uint32_t cacheSize = VertexCacheSize);
+
+/*
+Renumbers the vertices referenced by indexLists in order of first use so vertex fetches walk memory forwards, and
+returns the new index of every old vertex. Vertices no list references keep their relative order after the rest.
+*/
+std::vector<uint32_t> RemapVerticesToFirstUse(std::span<std::vector<uint32_t>> indexLists, uint32_t vertexCount);
+
+} // namespace rad
@@ -0,0 +1,212 @@
+#include "MeshBounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace rad
+{
+
+namespace
+{
+
+// Independent accumulators per reduction, wide enough for 8 floats per instruction
+constexpr uint32_t BoundsLanes = 8;
+
+/*
+The positions of the vertices indices reference, each once, split into one array per axis and padded to whole lanes
+with copies of the first. Indices repeat each vertex several times, so the passes after this touch a fraction of the
+data and none of it through an index.
+*/
+struct UniquePositions
+{
+	UniquePositions(std::span<const glm::vec3> positions, std::span<const uint32_t> indices)
+	{
+		// Bytes rather than bits, so marking a vertex does not wait on marking its neighbors
+		uint32_t first = indices[0], last = indices[0];
+		for (uint32_t index : indices)
+		{
+			first = std::min(first, index);
+			last = std::max(last, index);
+		}
+		std::vector<uint8_t> used(last - first + 1);
+		for (uint32_t index : indices)
+			used[index - first] = 1;
+		uint32_t count = 0;
+		for (uint8_t vertexUsed : used)
+			count += vertexUsed;
+
+		Count = (count + BoundsLanes - 1) / BoundsLanes * BoundsLanes;
+		// Every vertex of the range is written, unused ones are overwritten by the next, into one element of slack
+		for (auto& axis : Axis)
+			axis.resize(Count + 1);
+		uint32_t written = 0;
+		for (uint32_t vertex = 0; vertex < used.size(); vertex++)
+		{
+			glm::vec3 const& position = positions[first + vertex];
+			Axis[0][written] = position.x;
+			Axis[1][written] = position.y;
+			Axis[2][written] = position.z;
+			written += used[vertex];
+		}
+		for (; written < Count; written++)
+			for (auto& axis : Axis)
+				axis[written] = axis[0];
+	}
+
+	glm::vec3 operator[](uint32_t i) const
+	{
+		return {Axis[0][i], Axis[1][i], Axis[2][i]};
+	}
+
+	uint32_t Count = 0;
+	std::vector<float> Axis[3];
+};
+
+// Largest squared distance of the positions to center
+float FarthestDistance(UniquePositions const& positions, glm::vec3 center)
+{
+	float const* x = positions.Axis[0].data();
+	float const* y = positions.Axis[1].data();
+	float const* z = positions.Axis[2].data();
+	float farthest[BoundsLanes] = {};
+	for (uint32_t i = 0; i < positions.Count; i += BoundsLanes)
+		for (uint32_t lane = 0; lane < BoundsLanes; lane++)
+		{
+			float dx = x[i + lane] - center.x;
+			float dy = y[i + lane] - center.y;
+			float dz = z[i + lane] - center.z;
+			farthest[lane] = std::max(farthest[lane], dx * dx + dy * dy + dz * dz);
+		}
+	return *std::ranges::max_element(farthest);
+}
+
+// Center of Ritter's sphere, started from the most distant pair among the positions on the faces of the box
+glm::vec3 RitterCenter(UniquePositions const& positions, MeshBounds const& box)
+{
+	glm::vec3 extremes[2][3];
+	for (int axis = 0; axis < 3; axis++)
+	{
+		auto const& values = positions.Axis[axis];
+		extremes[0][axis] = positions[uint32_t(std::ranges::find(values, box.Min[axis]) - values.begin())];
+		extremes[1][axis] = positions[uint32_t(std::ranges::find(values, box.Max[axis]) - values.begin())];
+	}
+	int widest = 0;
+	float widestDistance = -1.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		glm::vec3 delta = extremes[1][axis] - extremes[0][axis];
+		float distance = glm::dot(delta, delta);
+		if (distance > widestDistance)
+		{
+			widest = axis;
+			widestDistance = distance;
+		}
+	}
+
+	glm::vec3 center = (extremes[0][widest] + extremes[1][widest]) * 0.5f;
+	float radius = std::sqrt(widestDistance) * 0.5f;
+	for (uint32_t i = 0; i < positions.Count; i++)
+	{
+		glm::vec3 delta = positions[i] - center;
+		float squaredDistance = glm::dot(delta, delta);
+		if (squaredDistance > radius * radius)
+		{
+			float distance = std::sqrt(squaredDistance);
+			float grownRadius = (radius + distance) * 0.5f;
+			center += delta * ((grownRadius - radius) / distance);
+			radius = grownRadius;
+		}
+	}
+	return center;
+}
+
+} // namespace
+
+MeshBounds ComputeMeshBounds(std::span<const glm::vec3> positions, std::span<const uint32_t> indices)
+{
+	if (indices.empty())
+		return {};
+
+	UniquePositions unique(positions, indices);
+	MeshBounds bounds;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float const* values = unique.Axis[axis].data();
+		float minimum[BoundsLanes], maximum[BoundsLanes];
+		std::ranges::fill(minimum, values[0]);
+		std::ranges::fill(maximum, values[0]);
+		for (uint32_t i = 0; i < unique.Count; i += BoundsLanes)
+			for (uint32_t lane = 0; lane < BoundsLanes; lane++)
+			{
+				float value = values[i + lane];
+				minimum[lane] = std::min(minimum[lane], value);
+				maximum[lane] = std::max(maximum[lane], value);
+			}
+		bounds.Min[axis] = *std::ranges::min_element(minimum);
+		bounds.Max[axis] = *std::ranges::max_element(maximum);
+	}
+
+	glm::vec3 boxCenter = (bounds.Min + bounds.Max) * 0.5f;
+	glm::vec3 ritterCenter = RitterCenter(unique, bounds);
+	float boxDistance = FarthestDistance(unique, boxCenter);
+	float ritterDistance = FarthestDistance(unique, ritterCenter);
+	bounds.Center = ritterDistance < boxDistance ? ritterCenter : boxCenter;
+	bounds.Radius = std::sqrt(std::min(ritterDistance, boxDistance));
+	return bounds;
+}
+
+MeshBounds MergeMeshBounds(MeshBounds const& a, MeshBounds const& b)
+{
+	if (a.IsEmpty())
+		return b;
+	if (b.IsEmpty())
+		return a;
+
+	MeshBounds merged;
+	merged.Min = glm::min(a.Min, b.Min);
+	merged.Max = glm::max(a.Max, b.Max);
+	glm::vec3 delta = b.Center - a.Center;
+	float distance = glm::length(delta);
+	if (distance + b.Radius <= a.Radius)
+	{
+		merged.Center = a.Center;
+		merged.Radius = a.Radius;
+	}
+	else if (distance + a.Radius <= b.Radius)
+	{
+		merged.Center = b.Center;
+		merged.Radius = b.Radius;
+	}
+	else
+	{
+		merged.Radius = (distance + a.Radius + b.Radius) * 0.5f;
+		merged.Center = a.Center + delta * ((merged.Radius - a.Radius) / distance);
+	}
+	return merged;
+}
+
+MeshBounds TransformMeshBounds(MeshBounds const& bounds, glm::mat4 const& worldMatrix)
+{
+	if (bounds.IsEmpty())
+		return bounds;
+
+	glm::mat3 linear(worldMatrix);
+	glm::vec3 translation(worldMatrix[3]);
+	glm::vec3 boxCenter = linear * ((bounds.Min + bounds.Max) * 0.5f) + translation;
+	glm::vec3 halfExtent = (bounds.Max - bounds.Min) * 0.5f;
+	glm::vec3 boxHalfExtent = {};
+	for (int column = 0; column < 3; column++)
+		boxHalfExtent += glm::abs(linear[column]) * halfExtent[column];
+
+	float maxScale = std::max({glm::length(linear[0]), glm::length(linear[1]), glm::length(linear[2])});
+
+	MeshBounds transformed;
+	transformed.Min = boxCenter - boxHalfExtent;
+	transformed.Max = boxCenter + boxHalfExtent;
+	transformed.Center = linear * bounds.Center + translation;
+	transformed.Radius = bounds.Radius * maxScale;
+	return transformed;
+}
+
+} // namespace rad
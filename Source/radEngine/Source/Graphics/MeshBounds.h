@@ -0,0 +1,40 @@
+#pragma once
+
+#include "RadishCommon.h"
+
+#include <cstdint>
+#include <span>
+
+namespace rad
+{
+
+// Box and sphere around a mesh, in the space of its vertex positions
+struct MeshBounds
+{
+	glm::vec3 Min = {};
+	glm::vec3 Max = {};
+	glm::vec3 Center = {};
+	// Negative for bounds around nothing
+	float Radius = -1.0f;
+
+	bool IsEmpty() const
+	{
+		return Radius < 0.0f;
+	}
+};
+
+/*
+Bounds of the vertices indices reference, empty when indices is. The box is exact. The sphere is the smaller
+of the one around the box's center and Ritter's (1990), which is grown from the most distant pair of extreme vertices
+and whose radius is then shrunk back to the farthest vertex. Positions are gathered in blocks that are split into one
+array per axis, so the min, max and distance loops are branch free and vectorize.
+*/
+MeshBounds ComputeMeshBounds(std::span<const glm::vec3> positions, std::span<const uint32_t> indices);
+
+// Bounds holding both
+MeshBounds MergeMeshBounds(MeshBounds const& a, MeshBounds const& b);
+
+// The box around the transformed box (Arvo 1990) and the sphere scaled by the largest axis scale of worldMatrix
+MeshBounds TransformMeshBounds(MeshBounds const& bounds, glm::mat4 const& worldMatrix);
+
+} // namespace rad
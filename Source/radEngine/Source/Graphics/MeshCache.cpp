@@ -0,0 +1,363 @@
+#include "MeshCache.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace rad
+{
+
+namespace
+{
+
+constexpr uint32_t MeshCacheMagic = 'R' | 'M' << 8 | 'S' << 16 | 'H' << 24;
+// Bump when the layout, Vertex or the way LoadModel builds vertices changes, so stale caches are rebuilt
+constexpr uint32_t MeshCacheVersion = 8;
+constexpr size_t MeshCacheAlignment = 16;
+
+// Sections follow the header in this order: vertices, shapes, materials, indices, levels of detail, meshlets, meshlet
+// vertices, meshlet triangles and strings, each aligned to 16 bytes
+struct MeshCacheHeader
+{
+	uint32_t Magic = MeshCacheMagic;
+	uint32_t Version = MeshCacheVersion;
+	uint64_t SourceHash = 0;
+	uint32_t VertexSize = sizeof(Vertex);
+	uint32_t ShapeCount = 0;
+	uint32_t MaterialCount = 0;
+	uint32_t MeshletSize = sizeof(Meshlet);
+	uint32_t LodSize = sizeof(MeshLod);
+	uint32_t Padding = 0;
+	uint64_t VertexCount = 0;
+	uint64_t IndexCount = 0;
+	uint64_t LodCount = 0;
+	uint64_t MeshletCount = 0;
+	uint64_t MeshletVertexCount = 0;
+	uint64_t MeshletTriangleSize = 0;
+	uint64_t StringSize = 0;
+};
+
+struct StoredString
+{
+	uint32_t Offset = 0;
+	uint32_t Length = 0;
+};
+
+// Elements of one of the shared sections that belong to a shape
+struct StoredRange
+{
+	uint64_t First = 0;
+	uint64_t Count = 0;
+};
+
+struct StoredShape
+{
+	StoredString Name;
+	StoredRange Indices;
+	StoredRange Lods;
+	StoredRange Meshlets;
+	StoredRange MeshletVertices;
+	StoredRange MeshletTriangles;
+	uint32_t MaterialIndex = ~0u;
+	float BoundsMin[3] = {};
+	float BoundsMax[3] = {};
+	float BoundsCenter[3] = {};
+	float BoundsRadius = -1.0f;
+	uint32_t Padding = 0;
+};
+
+struct StoredMaterial
+{
+	StoredString Name;
+	StoredString DiffuseTexture;
+	StoredString NormalMapTexture;
+	float Diffuse[3] = {};
+};
+
+size_t AlignSection(size_t offset)
+{
+	return (offset + MeshCacheAlignment - 1) & ~(MeshCacheAlignment - 1);
+}
+
+struct MeshCacheLayout
+{
+	size_t Vertices = 0;
+	size_t Shapes = 0;
+	size_t Materials = 0;
+	size_t Indices = 0;
+	size_t Lods = 0;
+	size_t Meshlets = 0;
+	size_t MeshletVertices = 0;
+	size_t MeshletTriangles = 0;
+	size_t Strings = 0;
+	size_t End = 0;
+};
+
+MeshCacheLayout GetMeshCacheLayout(MeshCacheHeader const& header)
+{
+	MeshCacheLayout layout;
+	layout.Vertices = AlignSection(sizeof(MeshCacheHeader));
+	layout.Shapes = AlignSection(layout.Vertices + header.VertexCount * sizeof(Vertex));
+	layout.Materials = AlignSection(layout.Shapes + header.ShapeCount * sizeof(StoredShape));
+	layout.Indices = AlignSection(layout.Materials + header.MaterialCount * sizeof(StoredMaterial));
+	layout.Lods = AlignSection(layout.Indices + header.IndexCount * sizeof(uint32_t));
+	layout.Meshlets = AlignSection(layout.Lods + header.LodCount * sizeof(MeshLod));
+	layout.MeshletVertices = AlignSection(layout.Meshlets + header.MeshletCount * sizeof(Meshlet));
+	layout.MeshletTriangles = AlignSection(layout.MeshletVertices + header.MeshletVertexCount * sizeof(uint32_t));
+	layout.Strings = AlignSection(layout.MeshletTriangles + header.MeshletTriangleSize);
+	layout.End = layout.Strings + header.StringSize;
+	return layout;
+}
+
+uint64_t MixHash(uint64_t hash)
+{
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+// Four independent lanes over 32 byte stripes keep several multiplies in flight, so hashing a large OBJ costs a small
+// fraction of parsing it
+uint64_t HashBytes(std::span<const std::byte> bytes, uint64_t seed)
+{
+	constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ull, Prime2 = 0xC2B2AE3D27D4EB4Full;
+	uint64_t lanes[4] = {seed + Prime1, seed ^ Prime2, seed - Prime1, ~seed};
+	size_t offset = 0;
+	for (; offset + 32 <= bytes.size(); offset += 32)
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes.data() + offset + lane * 8, sizeof(word));
+			lanes[lane] = std::rotl(lanes[lane] + word * Prime2, 31) * Prime1;
+		}
+	uint64_t hash = std::rotl(lanes[0], 1) + std::rotl(lanes[1], 7) + std::rotl(lanes[2], 12) + std::rotl(lanes[3], 18);
+	for (; offset < bytes.size(); offset++)
+		hash = std::rotl(hash ^ uint64_t(bytes[offset]) * Prime1, 11) * Prime2;
+	return MixHash(hash ^ bytes.size());
+}
+
+uint64_t HashString(std::string_view text, uint64_t seed)
+{
+	return HashBytes(std::as_bytes(std::span(text.data(), text.size())), seed);
+}
+
+bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+} // namespace
+
+std::filesystem::path GetMeshCachePath(std::filesystem::path const& objPath)
+{
+	return std::filesystem::path(objPath).replace_extension(".radmesh");
+}
+
+uint64_t HashMeshSource(std::filesystem::path const& objPath)
+{
+	MappedFile obj(objPath);
+	if (!obj.IsValid())
+		return 0;
+	uint64_t hash = HashBytes(obj.GetBytes(), MeshCacheVersion);
+
+	// tinyobj looks the MTL files up next to the OBJ, a missing one only contributes its name
+	std::string_view text(reinterpret_cast<char const*>(obj.GetBytes().data()), obj.GetBytes().size());
+	for (size_t line = text.find("mtllib"); line != std::string_view::npos; line = text.find("mtllib", line + 6))
+	{
+		if (line != 0 && text[line - 1] != '\n')
+			continue;
+		size_t end = std::min(text.find('\n', line), text.size());
+		for (size_t name = line + 6; name < end;)
+		{
+			while (name < end && IsSpace(text[name]))
+				name++;
+			size_t nameEnd = name;
+			while (nameEnd < end && !IsSpace(text[nameEnd]))
+				nameEnd++;
+			if (nameEnd == name)
+				break;
+			std::string_view mtlName = text.substr(name, nameEnd - name);
+			hash = HashString(mtlName, hash);
+			MappedFile mtl(objPath.parent_path() / mtlName);
+			if (mtl.IsValid())
+				hash = HashBytes(mtl.GetBytes(), hash);
+			name = nameEnd;
+		}
+	}
+	return hash == 0 ? 1 : hash;
+}
+
+std::vector<std::byte> SerializeMeshCache(uint64_t sourceHash, MeshCacheView const& view)
+{
+	MeshCacheHeader header;
+	header.SourceHash = sourceHash;
+	header.VertexCount = view.Vertices.size();
+	header.ShapeCount = uint32_t(view.Shapes.size());
+	header.MaterialCount = uint32_t(view.Materials.size());
+
+	std::string strings;
+	auto storeString = [&](std::string_view text)
+	{
+		StoredString stored{uint32_t(strings.size()), uint32_t(text.size())};
+		strings += text;
+		return stored;
+	};
+	auto storeRange = [](uint64_t& total, size_t count)
+	{
+		StoredRange range{total, count};
+		total += count;
+		return range;
+	};
+
+	std::vector<StoredShape> shapes(view.Shapes.size());
+	for (size_t i = 0; i < view.Shapes.size(); i++)
+	{
+		auto const& shape = view.Shapes[i];
+		shapes[i].Name = storeString(shape.Name);
+		shapes[i].Indices = storeRange(header.IndexCount, shape.Indices.size());
+		shapes[i].Lods = storeRange(header.LodCount, shape.Lods.size());
+		shapes[i].Meshlets = storeRange(header.MeshletCount, shape.Meshlets.size());
+		shapes[i].MeshletVertices = storeRange(header.MeshletVertexCount, shape.MeshletVertices.size());
+		shapes[i].MeshletTriangles = storeRange(header.MeshletTriangleSize, shape.MeshletTriangles.size());
+		shapes[i].MaterialIndex = shape.MaterialIndex;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			shapes[i].BoundsMin[axis] = shape.Bounds.Min[axis];
+			shapes[i].BoundsMax[axis] = shape.Bounds.Max[axis];
+			shapes[i].BoundsCenter[axis] = shape.Bounds.Center[axis];
+		}
+		shapes[i].BoundsRadius = shape.Bounds.Radius;
+	}
+	std::vector<StoredMaterial> materials(view.Materials.size());
+	for (size_t i = 0; i < view.Materials.size(); i++)
+	{
+		auto const& material = view.Materials[i];
+		materials[i].Name = storeString(material.Name);
+		materials[i].DiffuseTexture = storeString(material.DiffuseTexture);
+		materials[i].NormalMapTexture = storeString(material.NormalMapTexture);
+		materials[i].Diffuse[0] = material.Diffuse.x;
+		materials[i].Diffuse[1] = material.Diffuse.y;
+		materials[i].Diffuse[2] = material.Diffuse.z;
+	}
+	header.StringSize = strings.size();
+
+	MeshCacheLayout layout = GetMeshCacheLayout(header);
+	std::vector<std::byte> bytes(layout.End);
+	auto write = [&](size_t offset, void const* data, size_t size)
+	{
+		if (size)
+			std::memcpy(bytes.data() + offset, data, size);
+	};
+	auto writeRange = [&](size_t section, StoredRange range, auto span)
+	{ write(section + range.First * sizeof(span[0]), span.data(), span.size_bytes()); };
+	write(0, &header, sizeof(header));
+	write(layout.Vertices, view.Vertices.data(), view.Vertices.size_bytes());
+	write(layout.Shapes, shapes.data(), shapes.size() * sizeof(StoredShape));
+	write(layout.Materials, materials.data(), materials.size() * sizeof(StoredMaterial));
+	for (size_t i = 0; i < view.Shapes.size(); i++)
+	{
+		auto const& shape = view.Shapes[i];
+		writeRange(layout.Indices, shapes[i].Indices, shape.Indices);
+		writeRange(layout.Lods, shapes[i].Lods, shape.Lods);
+		writeRange(layout.Meshlets, shapes[i].Meshlets, shape.Meshlets);
+		writeRange(layout.MeshletVertices, shapes[i].MeshletVertices, shape.MeshletVertices);
+		writeRange(layout.MeshletTriangles, shapes[i].MeshletTriangles, shape.MeshletTriangles);
+	}
+	write(layout.Strings, strings.data(), strings.size());
+	return bytes;
+}
+
+bool ParseMeshCache(std::span<const std::byte> bytes, uint64_t sourceHash, MeshCacheView& view)
+{
+	MeshCacheHeader header;
+	if (bytes.size() < sizeof(header))
+		return false;
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (header.Magic != MeshCacheMagic || header.Version != MeshCacheVersion || header.SourceHash != sourceHash ||
+		header.VertexSize != sizeof(Vertex) || header.MeshletSize != sizeof(Meshlet) ||
+		header.LodSize != sizeof(MeshLod))
+		return false;
+	// Counts large enough to overflow the layout can only come from a corrupt file
+	for (uint64_t count : {header.VertexCount, header.IndexCount, header.LodCount, header.MeshletCount,
+						   header.MeshletVertexCount, header.MeshletTriangleSize, header.StringSize})
+		if (count > bytes.size())
+			return false;
+	MeshCacheLayout layout = GetMeshCacheLayout(header);
+	if (layout.End != bytes.size())
+		return false;
+
+	auto const* base = bytes.data();
+	auto const* shapes = reinterpret_cast<StoredShape const*>(base + layout.Shapes);
+	auto const* materials = reinterpret_cast<StoredMaterial const*>(base + layout.Materials);
+	std::string_view strings(reinterpret_cast<char const*>(base + layout.Strings), header.StringSize);
+	bool valid = true;
+	auto loadString = [&](StoredString stored)
+	{
+		if (uint64_t(stored.Offset) + stored.Length > strings.size())
+		{
+			valid = false;
+			return std::string_view();
+		}
+		return strings.substr(stored.Offset, stored.Length);
+	};
+	auto loadRange = [&]<typename T>(size_t section, uint64_t total, StoredRange range, std::span<const T>& span)
+	{
+		if (range.First > total || range.Count > total - range.First)
+			valid = false;
+		else
+			span = {reinterpret_cast<T const*>(base + section) + range.First, size_t(range.Count)};
+	};
+
+	view.Vertices = {reinterpret_cast<Vertex const*>(base + layout.Vertices), size_t(header.VertexCount)};
+	view.Shapes.resize(header.ShapeCount);
+	for (size_t i = 0; i < view.Shapes.size(); i++)
+	{
+		StoredShape const& stored = shapes[i];
+		auto& shape = view.Shapes[i];
+		shape.Name = loadString(stored.Name);
+		loadRange(layout.Indices, header.IndexCount, stored.Indices, shape.Indices);
+		loadRange(layout.Lods, header.LodCount, stored.Lods, shape.Lods);
+		loadRange(layout.Meshlets, header.MeshletCount, stored.Meshlets, shape.Meshlets);
+		loadRange(layout.MeshletVertices, header.MeshletVertexCount, stored.MeshletVertices, shape.MeshletVertices);
+		loadRange(layout.MeshletTriangles, header.MeshletTriangleSize, stored.MeshletTriangles, shape.MeshletTriangles);
+		shape.MaterialIndex = stored.MaterialIndex;
+		shape.Bounds.Min = {stored.BoundsMin[0], stored.BoundsMin[1], stored.BoundsMin[2]};
+		shape.Bounds.Max = {stored.BoundsMax[0], stored.BoundsMax[1], stored.BoundsMax[2]};
+		shape.Bounds.Center = {stored.BoundsCenter[0], stored.BoundsCenter[1], stored.BoundsCenter[2]};
+		shape.Bounds.Radius = stored.BoundsRadius;
+	}
+	view.Materials.resize(header.MaterialCount);
+	for (size_t i = 0; i < view.Materials.size(); i++)
+	{
+		StoredMaterial const& stored = materials[i];
+		view.Materials[i].Name = loadString(stored.Name);
+		view.Materials[i].DiffuseTexture = loadString(stored.DiffuseTexture);
+		view.Materials[i].NormalMapTexture = loadString(stored.NormalMapTexture);
+		view.Materials[i].Diffuse = {stored.Diffuse[0], stored.Diffuse[1], stored.Diffuse[2]};
+	}
+	return valid;
+}
+
+bool WriteMeshCache(std::filesystem::path const& path, std::span<const std::byte> bytes)
+{
+	std::filesystem::path temporaryPath = path;
+	temporaryPath += ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.write(reinterpret_cast<char const*>(bytes.data()), std::streamsize(bytes.size())))
+			return false;
+	}
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (!error)
+		return true;
+	std::filesystem::remove(temporaryPath, error);
+	return false;
+}
+
+} // namespace rad
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "MeshBounds.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "Vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace rad
+{
+
+struct MeshCacheShape
+{
+	std::string_view Name;
+	// Every level of detail of the shape, one after the other
+	std::span<const uint32_t> Indices;
+	// Ranges of Indices, the first is the full resolution shape
+	std::span<const MeshLod> Lods;
+	// The parts of the shape's MeshletData, meshlet vertices index the model's vertices
+	std::span<const Meshlet> Meshlets;
+	std::span<const uint32_t> MeshletVertices;
+	std::span<const uint8_t> MeshletTriangles;
+	// ~0u when the shape has no material
+	uint32_t MaterialIndex = ~0u;
+	// Around the full resolution level, which holds every vertex the other levels use
+	MeshBounds Bounds;
+};
+
+struct MeshCacheMaterial
+{
+	std::string_view Name;
+	// As written in the MTL, relative to the model's directory, empty when unset
+	std::string_view DiffuseTexture;
+	std::string_view NormalMapTexture;
+	glm::vec3 Diffuse = {1, 1, 1};
+};
+
+/*
+Everything LoadModel needs from an OBJ once it is parsed, tangents are generated and vertices deduplicated. The spans
+and strings point either into a mapped .radmesh file or into the storage of the OBJ load that produced them.
+*/
+struct MeshCacheView
+{
+	std::span<const Vertex> Vertices;
+	std::vector<MeshCacheShape> Shapes;
+	std::vector<MeshCacheMaterial> Materials;
+};
+
+// Where the cache of an OBJ lives, next to it with the .radmesh extension
+std::filesystem::path GetMeshCachePath(std::filesystem::path const& objPath);
+
+// Hash of the OBJ, the MTL files it references and the cache format version, 0 when the OBJ cannot be read
+uint64_t HashMeshSource(std::filesystem::path const& objPath);
+
+std::vector<std::byte> SerializeMeshCache(uint64_t sourceHash, MeshCacheView const& view);
+
+// Points view into bytes, false when they are not a complete cache of this version built from sourceHash
+bool ParseMeshCache(std::span<const std::byte> bytes, uint64_t sourceHash, MeshCacheView& view);
+
+// Writes through a temporary file and a rename so a crash never leaves a truncated cache behind
+bool WriteMeshCache(std::filesystem::path const& path, std::span<const std::byte> bytes);
+
+} // namespace rad
@@ -0,0 +1,516 @@
+#include "MeshSimplifier.h"
+
+#include "IndexOptimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace rad
+{
+
+namespace
+{
+
+constexpr uint32_t NoVertex = ~0u;
+// Planes along borders and seams weigh this much more than the faces, so outlines hold when the faces around them are
+// flat enough to collapse freely
+constexpr double EdgeWeight = 10.0;
+// Collapses that turn a triangle by more than about 75 degrees are skipped, not only those that flip it, since slivers
+// standing on edge shade like holes
+constexpr float MinFlipCosine = 0.25f;
+
+enum class VertexKind : uint8_t
+{
+	// Inside the surface, collapses into any neighbor
+	Manifold,
+	// On an open border, collapses along it
+	Border,
+	// One of two vertices at a position split by a seam, collapses along the seam together with the other one
+	Seam,
+	// Never collapses
+	Locked,
+};
+
+// Sum of squared distances to weighted planes, as the upper triangle of the symmetric 4x4 matrix
+struct Quadric
+{
+	double A00 = 0, A11 = 0, A22 = 0, A01 = 0, A02 = 0, A12 = 0;
+	double B0 = 0, B1 = 0, B2 = 0;
+	double C = 0;
+	// Of the face planes only, so the planes along borders and seams add to the error instead of diluting it
+	double Weight = 0;
+
+	void AddPlane(glm::vec3 normal, double distance, double weight, bool face = true)
+	{
+		double a = normal.x, b = normal.y, c = normal.z;
+		A00 += weight * a * a;
+		A11 += weight * b * b;
+		A22 += weight * c * c;
+		A01 += weight * a * b;
+		A02 += weight * a * c;
+		A12 += weight * b * c;
+		B0 += weight * a * distance;
+		B1 += weight * b * distance;
+		B2 += weight * c * distance;
+		C += weight * distance * distance;
+		if (face)
+			Weight += weight;
+	}
+
+	// Squared distances of point to the planes, weighted and divided by the weight of the faces
+	double Evaluate(glm::vec3 point) const
+	{
+		double x = point.x, y = point.y, z = point.z;
+		double sum = A00 * x * x + A11 * y * y + A22 * z * z + 2 * (A01 * x * y + A02 * x * z + A12 * y * z) +
+					 2 * (B0 * x + B1 * y + B2 * z) + C;
+		return Weight > 0 ? std::max(sum, 0.0) / Weight : 0.0;
+	}
+
+	Quadric& operator+=(Quadric const& other)
+	{
+		A00 += other.A00;
+		A11 += other.A11;
+		A22 += other.A22;
+		A01 += other.A01;
+		A02 += other.A02;
+		A12 += other.A12;
+		B0 += other.B0;
+		B1 += other.B1;
+		B2 += other.B2;
+		C += other.C;
+		Weight += other.Weight;
+		return *this;
+	}
+};
+
+uint64_t EdgeKey(uint32_t from, uint32_t to)
+{
+	return uint64_t(from) << 32 | to;
+}
+
+bool HasEdge(std::vector<uint64_t> const& sortedEdges, uint32_t from, uint32_t to)
+{
+	return std::ranges::binary_search(sortedEdges, EdgeKey(from, to));
+}
+
+struct Simplifier
+{
+	// Local vertices are the ones the indices reference, numbered densely
+	std::vector<uint32_t> GlobalVertices;
+	std::vector<glm::vec3> Positions;
+	// Vertices at equal positions share a PositionId, Siblings links them in a ring
+	std::vector<uint32_t> PositionIds;
+	std::vector<uint32_t> Siblings;
+	std::vector<VertexKind> Kinds;
+	// The one open half edge leaving and entering each border or seam vertex
+	std::vector<uint32_t> OpenOut;
+	std::vector<uint32_t> OpenIn;
+	std::vector<Quadric> Quadrics;
+	std::vector<uint32_t> Indices;
+
+	Simplifier(std::span<const glm::vec3> positions, std::span<const uint32_t> indices)
+	{
+		GlobalVertices.assign(indices.begin(), indices.end());
+		std::ranges::sort(GlobalVertices);
+		GlobalVertices.erase(std::unique(GlobalVertices.begin(), GlobalVertices.end()), GlobalVertices.end());
+		Indices.resize(indices.size());
+		for (size_t i = 0; i < indices.size(); i++)
+			Indices[i] = uint32_t(std::ranges::lower_bound(GlobalVertices, indices[i]) - GlobalVertices.begin());
+		// Quadrics are built around the first vertex to keep large coordinates from cancelling out
+		Positions.resize(GlobalVertices.size());
+		glm::vec3 origin = positions[GlobalVertices[0]];
+		for (size_t v = 0; v < GlobalVertices.size(); v++)
+			Positions[v] = positions[GlobalVertices[v]] - origin;
+
+		WeldPositions();
+		ClassifyVertices();
+		ComputeQuadrics();
+	}
+
+	uint32_t VertexCount() const
+	{
+		return uint32_t(Positions.size());
+	}
+
+	void WeldPositions()
+	{
+		std::vector<uint32_t> order(VertexCount());
+		std::iota(order.begin(), order.end(), 0);
+		auto less = [&](uint32_t a, uint32_t b)
+		{
+			glm::vec3 pa = Positions[a], pb = Positions[b];
+			return pa.x != pb.x ? pa.x < pb.x : pa.y != pb.y ? pa.y < pb.y : pa.z < pb.z;
+		};
+		std::ranges::sort(order, less);
+
+		PositionIds.resize(VertexCount());
+		Siblings.resize(VertexCount());
+		uint32_t positionCount = 0;
+		for (size_t first = 0; first < order.size();)
+		{
+			size_t last = first + 1;
+			while (last < order.size() && !less(order[first], order[last]))
+				last++;
+			for (size_t i = first; i < last; i++)
+			{
+				PositionIds[order[i]] = positionCount;
+				Siblings[order[i]] = order[i + 1 < last ? i + 1 : first];
+			}
+			positionCount++;
+			first = last;
+		}
+		Quadrics.resize(positionCount);
+	}
+
+	uint32_t SiblingCount(uint32_t vertex) const
+	{
+		uint32_t count = 1;
+		for (uint32_t sibling = Siblings[vertex]; sibling != vertex; sibling = Siblings[sibling])
+			count++;
+		return count;
+	}
+
+	void ClassifyVertices()
+	{
+		std::vector<uint64_t> edges, positionEdges;
+		edges.reserve(Indices.size());
+		positionEdges.reserve(Indices.size());
+		ForEachHalfEdge(
+			[&](uint32_t from, uint32_t to)
+			{
+				edges.push_back(EdgeKey(from, to));
+				positionEdges.push_back(EdgeKey(PositionIds[from], PositionIds[to]));
+			});
+		std::ranges::sort(edges);
+		std::ranges::sort(positionEdges);
+
+		// Half edges used twice, or open ones more than once per vertex, make a vertex non manifold
+		std::vector<uint8_t> complex(VertexCount(), 0);
+		for (size_t i = 1; i < edges.size(); i++)
+			if (edges[i] == edges[i - 1])
+				complex[edges[i] >> 32] = complex[uint32_t(edges[i])] = 1;
+		std::vector<uint32_t> openOutCount(VertexCount(), 0), openInCount(VertexCount(), 0);
+		OpenOut.assign(VertexCount(), NoVertex);
+		OpenIn.assign(VertexCount(), NoVertex);
+		ForEachHalfEdge(
+			[&](uint32_t from, uint32_t to)
+			{
+				if (HasEdge(edges, to, from))
+					return;
+				openOutCount[from]++;
+				OpenOut[from] = to;
+				openInCount[to]++;
+				OpenIn[to] = from;
+			});
+
+		// An open half edge is a border when no triangle at the same positions closes it, otherwise a seam
+		auto isBorder = [&](uint32_t from, uint32_t to)
+		{ return !HasEdge(positionEdges, PositionIds[to], PositionIds[from]); };
+		auto hasOneOpenEdgeEachWay = [&](uint32_t v) { return openOutCount[v] == 1 && openInCount[v] == 1; };
+
+		Kinds.assign(VertexCount(), VertexKind::Locked);
+		for (uint32_t v = 0; v < VertexCount(); v++)
+		{
+			uint32_t siblingCount = SiblingCount(v);
+			if (complex[v] || openOutCount[v] > 1 || openInCount[v] > 1)
+				continue;
+			if (siblingCount == 1)
+			{
+				if (openOutCount[v] == 0 && openInCount[v] == 0)
+					Kinds[v] = VertexKind::Manifold;
+				else if (hasOneOpenEdgeEachWay(v) && isBorder(v, OpenOut[v]) && isBorder(OpenIn[v], v))
+					Kinds[v] = VertexKind::Border;
+			}
+			else if (siblingCount == 2)
+			{
+				uint32_t s = Siblings[v];
+				bool seam = !complex[s] && hasOneOpenEdgeEachWay(v) && hasOneOpenEdgeEachWay(s);
+				seam = seam && !isBorder(v, OpenOut[v]) && !isBorder(OpenIn[v], v);
+				seam = seam && !isBorder(s, OpenOut[s]) && !isBorder(OpenIn[s], s);
+				if (seam)
+					Kinds[v] = VertexKind::Seam;
+			}
+		}
+	}
+
+	template <typename Fn>
+	void ForEachHalfEdge(Fn&& fn) const
+	{
+		for (size_t t = 0; t < Indices.size(); t += 3)
+			for (int corner = 0; corner < 3; corner++)
+				fn(Indices[t + corner], Indices[t + (corner + 1) % 3]);
+	}
+
+	glm::vec3 TriangleNormal(size_t triangle) const
+	{
+		glm::vec3 p0 = Positions[Indices[triangle]];
+		return glm::cross(Positions[Indices[triangle + 1]] - p0, Positions[Indices[triangle + 2]] - p0);
+	}
+
+	void ComputeQuadrics()
+	{
+		for (size_t t = 0; t < Indices.size(); t += 3)
+		{
+			glm::vec3 normal = TriangleNormal(t);
+			float length = std::sqrt(glm::dot(normal, normal));
+			if (!(length > 0.0f))
+				continue;
+			normal /= length;
+			double distance = -glm::dot(normal, Positions[Indices[t]]);
+			for (int corner = 0; corner < 3; corner++)
+				Quadrics[PositionIds[Indices[t + corner]]].AddPlane(normal, distance, length * 0.5);
+
+			// Planes through open edges, perpendicular to the face, hold borders and seams in place
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uint32_t from = Indices[t + corner], to = Indices[t + (corner + 1) % 3];
+				if (OpenOut[from] != to)
+					continue;
+				glm::vec3 edge = Positions[to] - Positions[from];
+				glm::vec3 edgeNormal = glm::cross(edge, normal);
+				float edgeNormalLength = std::sqrt(glm::dot(edgeNormal, edgeNormal));
+				if (!(edgeNormalLength > 0.0f))
+					continue;
+				edgeNormal /= edgeNormalLength;
+				double edgeDistance = -glm::dot(edgeNormal, Positions[from]);
+				double weight = glm::dot(edge, edge) * EdgeWeight;
+				Quadrics[PositionIds[from]].AddPlane(edgeNormal, edgeDistance, weight, false);
+				Quadrics[PositionIds[to]].AddPlane(edgeNormal, edgeDistance, weight, false);
+			}
+		}
+	}
+
+	// The vertex v0's sibling collapses into with v0 into v1, NoVertex when the collapse is not allowed. v0 itself
+	// when it has no sibling.
+	uint32_t CollapsePartner(uint32_t v0, uint32_t v1) const
+	{
+		if (PositionIds[v0] == PositionIds[v1])
+			return NoVertex;
+		switch (Kinds[v0])
+		{
+		case VertexKind::Manifold:
+			return v0;
+		case VertexKind::Border:
+			return OpenOut[v0] == v1 || OpenIn[v0] == v1 ? v0 : NoVertex;
+		case VertexKind::Seam:
+		{
+			if (OpenOut[v0] != v1 && OpenIn[v0] != v1)
+				return NoVertex;
+			uint32_t s0 = Siblings[v0];
+			if (OpenOut[s0] != NoVertex && PositionIds[OpenOut[s0]] == PositionIds[v1])
+				return OpenOut[s0];
+			if (OpenIn[s0] != NoVertex && PositionIds[OpenIn[s0]] == PositionIds[v1])
+				return OpenIn[s0];
+			return NoVertex;
+		}
+		default:
+			return NoVertex;
+		}
+	}
+
+	// Whether moving v0 to target turns any of its triangles too far
+	bool FlipsTriangles(uint32_t v0, glm::vec3 target, uint32_t targetPositionId,
+						VertexTriangles const& adjacency) const
+	{
+		for (uint32_t triangle : adjacency.Of(v0))
+		{
+			uint32_t const* corners = &Indices[triangle * 3];
+			int moved = corners[0] == v0 ? 0 : corners[1] == v0 ? 1 : 2;
+			uint32_t b = corners[(moved + 1) % 3], c = corners[(moved + 2) % 3];
+			// Triangles on the collapsing edge disappear
+			if (PositionIds[b] == targetPositionId || PositionIds[c] == targetPositionId)
+				continue;
+			glm::vec3 pa = Positions[v0], pb = Positions[b], pc = Positions[c];
+			glm::vec3 before = glm::cross(pb - pa, pc - pa);
+			glm::vec3 after = glm::cross(pb - target, pc - target);
+			if (glm::dot(before, after) <= MinFlipCosine * std::sqrt(glm::dot(before, before) * glm::dot(after, after)))
+				return true;
+		}
+		return false;
+	}
+
+	struct Collapse
+	{
+		uint32_t From;
+		uint32_t To;
+		float Cost;
+	};
+
+	// One pass of collapses, cheapest first. Each collapse locks the positions around it for the rest of the pass, so
+	// the triangles it checked for flips stay as they were. Returns false when nothing collapsed.
+	bool CollapseEdges(size_t targetIndexCount, double maxCost, double& cost)
+	{
+		std::vector<Collapse> candidates;
+		candidates.reserve(Indices.size());
+		for (size_t t = 0; t < Indices.size(); t += 3)
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uint32_t a = Indices[t + corner], b = Indices[t + (corner + 1) % 3];
+				double costAB = CollapsePartner(a, b) != NoVertex ? Quadrics[PositionIds[a]].Evaluate(Positions[b])
+																  : std::numeric_limits<double>::infinity();
+				double costBA = CollapsePartner(b, a) != NoVertex ? Quadrics[PositionIds[b]].Evaluate(Positions[a])
+																  : std::numeric_limits<double>::infinity();
+				if (costAB <= costBA && costAB <= maxCost)
+					candidates.push_back({a, b, float(costAB)});
+				else if (costBA < costAB && costBA <= maxCost)
+					candidates.push_back({b, a, float(costBA)});
+			}
+		if (candidates.empty())
+			return false;
+		std::ranges::sort(candidates, {}, &Collapse::Cost);
+
+		VertexTriangles adjacency(Indices, VertexCount());
+		std::vector<uint32_t> collapses(VertexCount());
+		std::iota(collapses.begin(), collapses.end(), 0);
+		std::vector<uint8_t> touched(Quadrics.size(), 0);
+		auto touchOneRing = [&](uint32_t vertex)
+		{
+			for (uint32_t triangle : adjacency.Of(vertex))
+				for (int corner = 0; corner < 3; corner++)
+					touched[PositionIds[Indices[triangle * 3 + corner]]] = 1;
+		};
+		size_t trianglesToRemove = (Indices.size() - targetIndexCount) / 3;
+		size_t removed = 0;
+		for (Collapse const& collapse : candidates)
+		{
+			if (removed >= trianglesToRemove)
+				break;
+			uint32_t v0 = collapse.From, v1 = collapse.To;
+			uint32_t p0 = PositionIds[v0], p1 = PositionIds[v1];
+			if (touched[p0] || touched[p1])
+				continue;
+			uint32_t s0 = Siblings[v0];
+			uint32_t s1 = CollapsePartner(v0, v1);
+			bool seam = Kinds[v0] == VertexKind::Seam;
+			if (FlipsTriangles(v0, Positions[v1], p1, adjacency) ||
+				(seam && FlipsTriangles(s0, Positions[s1], p1, adjacency)))
+				continue;
+
+			collapses[v0] = v1;
+			if (seam)
+				collapses[s0] = s1;
+			Quadrics[p1] += Quadrics[p0];
+			touchOneRing(v0);
+			if (seam)
+				touchOneRing(s0);
+			removed += Kinds[v0] == VertexKind::Border ? 1 : 2;
+			cost = std::max(cost, double(collapse.Cost));
+		}
+		if (removed == 0)
+			return false;
+
+		size_t kept = 0;
+		for (size_t t = 0; t < Indices.size(); t += 3)
+		{
+			uint32_t a = collapses[Indices[t]], b = collapses[Indices[t + 1]], c = collapses[Indices[t + 2]];
+			uint32_t pa = PositionIds[a], pb = PositionIds[b], pc = PositionIds[c];
+			if (pa == pb || pb == pc || pa == pc)
+				continue;
+			Indices[kept++] = a;
+			Indices[kept++] = b;
+			Indices[kept++] = c;
+		}
+		Indices.resize(kept);
+		return true;
+	}
+};
+
+} // namespace
+
+std::vector<uint32_t> SimplifyMesh(std::span<const glm::vec3> positions, std::span<const uint32_t> indices,
+								   size_t targetIndexCount, float maxError, float& error)
+{
+	assert(indices.size() % 3 == 0);
+	error = 0.0f;
+	if (indices.size() <= targetIndexCount)
+		return std::vector<uint32_t>(indices.begin(), indices.end());
+
+	Simplifier simplifier(positions, indices);
+	double maxCost = double(maxError) * maxError;
+	double cost = 0.0;
+	while (simplifier.Indices.size() > targetIndexCount && simplifier.CollapseEdges(targetIndexCount, maxCost, cost))
+	{
+	}
+	error = float(std::sqrt(cost));
+
+	std::vector<uint32_t> result(simplifier.Indices.size());
+	for (size_t i = 0; i < result.size(); i++)
+		result[i] = simplifier.GlobalVertices[simplifier.Indices[i]];
+	return result;
+}
+
+std::vector<MeshLod> BuildMeshLods(std::span<const glm::vec3> positions, std::vector<uint32_t>& indices,
+								   MeshLodSettings const& settings)
+{
+	std::vector<MeshLod> lods = {{0, uint32_t(indices.size()), 0.0f}};
+	if (indices.empty())
+		return lods;
+
+	glm::vec3 minimum = positions[indices[0]], maximum = minimum;
+	for (uint32_t index : indices)
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minimum[axis] = std::min(minimum[axis], positions[index][axis]);
+			maximum[axis] = std::max(maximum[axis], positions[index][axis]);
+		}
+	float maxError = settings.MaxRelativeError * glm::length(maximum - minimum) * 0.5f;
+
+	std::vector<uint32_t> previous;
+	while (lods.size() < settings.MaxLods)
+	{
+		MeshLod const& last = lods.back();
+		previous.assign(indices.begin() + last.IndexOffset, indices.begin() + last.IndexOffset + last.IndexCount);
+		size_t target = size_t(float(previous.size() / 3) * settings.Reduction) * 3;
+		float error = 0.0f;
+		std::vector<uint32_t> simplified = SimplifyMesh(positions, previous, target, maxError, error);
+		if (simplified.empty() || float(simplified.size()) > float(previous.size()) * settings.MinReduction)
+			break;
+
+		// Over the range of vertices the level uses, like the full resolution level was
+		auto [first, lastVertex] = std::ranges::minmax(simplified);
+		for (uint32_t& index : simplified)
+			index -= first;
+		OptimizeVertexCache(simplified, lastVertex - first + 1);
+		for (uint32_t& index : simplified)
+			index += first;
+
+		lods.push_back({uint32_t(indices.size()), uint32_t(simplified.size()), last.Error + error});
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+	}
+	return lods;
+}
+
+LodSelectionView::LodSelectionView(glm::mat4 const& projection, glm::vec3 position, float viewportHeight,
+								   float thresholdPixels)
+	: Position(position), PixelsPerUnit(projection[1][1] * viewportHeight * 0.5f),
+	  Perspective(projection[3][3] == 0.0f), ThresholdPixels(thresholdPixels)
+{
+}
+
+uint32_t SelectMeshLod(std::span<const MeshLod> lods, glm::mat4 const& worldMatrix, glm::vec3 center, float radius,
+					   LodSelectionView const& view)
+{
+	float scale = 0.0f;
+	for (int axis = 0; axis < 3; axis++)
+		scale = std::max(scale, glm::length(glm::vec3(worldMatrix[axis])));
+	float pixelsPerUnit = view.PixelsPerUnit * scale;
+	if (view.Perspective)
+	{
+		glm::vec3 worldCenter = glm::vec3(worldMatrix * glm::vec4(center, 1.0f));
+		float distance = glm::length(worldCenter - view.Position) - radius * scale;
+		if (distance <= 0.0f)
+			return 0;
+		pixelsPerUnit /= distance;
+	}
+
+	uint32_t selected = 0;
+	for (uint32_t lod = 1; lod < lods.size(); lod++)
+		if (lods[lod].Error * pixelsPerUnit <= view.ThresholdPixels)
+			selected = lod;
+	return selected;
+}
+
+} // namespace rad
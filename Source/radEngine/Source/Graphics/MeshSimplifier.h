@@ -0,0 +1,71 @@
+#pragma once
+
+#include "RadishCommon.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rad
+{
+
+// A level of detail of a mesh, a range of its index buffer
+struct MeshLod
+{
+	uint32_t IndexOffset = 0;
+	uint32_t IndexCount = 0;
+	// How far the simplified surface strays from the full resolution one, in the units of the vertex positions
+	float Error = 0.0f;
+};
+
+/*
+Quadric error edge collapse (Garland and Heckbert 1997) that keeps the vertices and only rewrites the indices, so every
+level of detail shares the vertex buffer of the full mesh. Vertices at the same position, as split by UV seams, are
+welded for the quadrics and collapse together along the seam so the seam keeps its shape in both halves. Open borders,
+where the mesh meets the shapes of other materials, only collapse along themselves. Vertices whose neighborhood is
+neither, like seam corners, stay put. Collapses that would flip a triangle are skipped.
+Stops at targetIndexCount or before a collapse costs more than maxError, and returns the error reached in error.
+*/
+std::vector<uint32_t> SimplifyMesh(std::span<const glm::vec3> positions, std::span<const uint32_t> indices,
+								   size_t targetIndexCount, float maxError, float& error);
+
+struct MeshLodSettings
+{
+	// Levels including the full resolution one
+	uint32_t MaxLods = 5;
+	// Triangles each level aims to keep of the one before
+	float Reduction = 0.5f;
+	// A level keeping more than this of the one before is dropped and ends the chain
+	float MinReduction = 0.85f;
+	// Largest error of a single level, relative to the radius of the mesh's bounds
+	float MaxRelativeError = 0.05f;
+};
+
+/*
+Appends the levels of detail of the triangle list in indices to it, each simplified from the one before and ordered
+for the vertex cache. The first level is indices as given with no error, the errors of later levels add up those of
+the levels they were made from.
+*/
+std::vector<MeshLod> BuildMeshLods(std::span<const glm::vec3> positions, std::vector<uint32_t>& indices,
+								   MeshLodSettings const& settings = {});
+
+// What level of detail selection needs from a view
+struct LodSelectionView
+{
+	LodSelectionView(glm::mat4 const& projection, glm::vec3 position, float viewportHeight, float thresholdPixels);
+
+	glm::vec3 Position;
+	// Pixels per unit of error one unit in front of a perspective view, or anywhere in front of an orthographic one
+	float PixelsPerUnit;
+	bool Perspective;
+	float ThresholdPixels;
+};
+
+/*
+Index of the coarsest level whose error, projected at the point of the bounding sphere closest to the view, stays
+within the view's threshold. The error is scaled by the largest axis scale of worldMatrix.
+*/
+uint32_t SelectMeshLod(std::span<const MeshLod> lods, glm::mat4 const& worldMatrix, glm::vec3 center, float radius,
+					   LodSelectionView const& view);
+
+} // namespace rad
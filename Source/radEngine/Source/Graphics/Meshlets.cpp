@@ -0,0 +1,342 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace rad
+{
+
+namespace
+{
+
+constexpr uint8_t UnusedVertex = 0xFF;
+constexpr uint32_t NoTriangle = ~0u;
+
+// Ritter's sphere, started from the most distant pair among the extreme points along each axis
+void ComputeMeshletSphere(std::span<const glm::vec3> positions, std::span<const uint32_t> vertices, Meshlet& meshlet)
+{
+	uint32_t minimum[3], maximum[3];
+	std::ranges::fill(minimum, vertices[0]);
+	std::ranges::fill(maximum, vertices[0]);
+	for (uint32_t vertex : vertices)
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if (positions[vertex][axis] < positions[minimum[axis]][axis])
+				minimum[axis] = vertex;
+			if (positions[vertex][axis] > positions[maximum[axis]][axis])
+				maximum[axis] = vertex;
+		}
+	int widest = 0;
+	float widestDistance = -1.0f;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		glm::vec3 delta = positions[maximum[axis]] - positions[minimum[axis]];
+		float distance = glm::dot(delta, delta);
+		if (distance > widestDistance)
+		{
+			widest = axis;
+			widestDistance = distance;
+		}
+	}
+
+	glm::vec3 center = (positions[minimum[widest]] + positions[maximum[widest]]) * 0.5f;
+	float radius = std::sqrt(widestDistance) * 0.5f;
+	for (uint32_t vertex : vertices)
+	{
+		glm::vec3 delta = positions[vertex] - center;
+		float distance = std::sqrt(glm::dot(delta, delta));
+		if (distance > radius)
+		{
+			float grownRadius = (radius + distance) * 0.5f;
+			center += delta * ((grownRadius - radius) / distance);
+			radius = grownRadius;
+		}
+	}
+	meshlet.Center = center;
+	meshlet.Radius = radius;
+}
+
+// The cone around the average normal that holds every triangle normal, with its apex pushed back along the axis until
+// it is behind every triangle's plane. Needs the sphere for its center.
+void ComputeMeshletCone(std::span<const glm::vec3> positions, std::span<const uint32_t> vertices,
+						std::span<const uint8_t> triangles, std::vector<glm::vec3>& normals, Meshlet& meshlet)
+{
+	normals.clear();
+	glm::vec3 normalSum = {};
+	for (size_t triangle = 0; triangle < triangles.size(); triangle += 3)
+	{
+		glm::vec3 p0 = positions[vertices[triangles[triangle]]];
+		glm::vec3 normal = glm::cross(positions[vertices[triangles[triangle + 1]]] - p0,
+									  positions[vertices[triangles[triangle + 2]]] - p0);
+		float length = std::sqrt(glm::dot(normal, normal));
+		// Degenerate triangles face nowhere, they never show up and never hold a cone back
+		normals.push_back(length > 0.0f ? normal / length : glm::vec3());
+		normalSum += normals.back();
+	}
+
+	meshlet.ConeApex = meshlet.Center;
+	meshlet.ConeCutoff = 1.0f;
+	float sumLength = std::sqrt(glm::dot(normalSum, normalSum));
+	if (sumLength == 0.0f)
+		return;
+	glm::vec3 axis = normalSum / sumLength;
+	meshlet.ConeAxis = axis;
+
+	float minimumDot = 1.0f;
+	for (glm::vec3 const& normal : normals)
+		if (normal != glm::vec3())
+			minimumDot = std::min(minimumDot, glm::dot(normal, axis));
+	// Past 84 degrees the cone hardly ever culls and its apex runs off to infinity
+	if (minimumDot <= 0.1f)
+		return;
+
+	float apexDistance = 0.0f;
+	for (size_t triangle = 0; triangle < normals.size(); triangle++)
+	{
+		if (normals[triangle] == glm::vec3())
+			continue;
+		glm::vec3 p0 = positions[vertices[triangles[triangle * 3]]];
+		float centerDistance = glm::dot(meshlet.Center - p0, normals[triangle]);
+		apexDistance = std::max(apexDistance, centerDistance / glm::dot(axis, normals[triangle]));
+	}
+	meshlet.ConeApex = meshlet.Center - axis * apexDistance;
+	meshlet.ConeCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+}
+
+} // namespace
+
+MeshletData BuildMeshlets(std::span<const glm::vec3> positions, std::span<const uint32_t> indices,
+						  MeshletSettings const& settings)
+{
+	assert(settings.MaxVertices >= 3 && settings.MaxVertices < UnusedVertex && settings.MaxTriangles > 0);
+	MeshletData data;
+	uint32_t triangleCount = uint32_t(indices.size() / 3);
+	if (triangleCount == 0)
+		return data;
+
+	// Triangles around every vertex that are not in a meshlet yet, emitted triangles are swapped out
+	std::vector<uint32_t> adjacencyOffsets(positions.size() + 1, 0);
+	std::vector<uint32_t> liveTriangles(positions.size(), 0);
+	for (uint32_t triangle = 0; triangle < triangleCount * 3; triangle++)
+		liveTriangles[indices[triangle]]++;
+	for (size_t vertex = 0; vertex < positions.size(); vertex++)
+		adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+	std::vector<uint32_t> adjacency(adjacencyOffsets.back());
+	std::ranges::fill(liveTriangles, 0);
+	for (uint32_t triangle = 0; triangle < triangleCount; triangle++)
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[triangle * 3 + corner];
+			adjacency[adjacencyOffsets[vertex] + liveTriangles[vertex]++] = triangle;
+		}
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint8_t> localIndices(positions.size(), UnusedVertex);
+	std::vector<glm::vec3> normals;
+	Meshlet meshlet;
+	glm::vec3 positionSum = {};
+	glm::vec3 boxMin = {}, boxMax = {};
+	uint32_t seed = NoTriangle;
+
+	auto countNewVertices = [&](uint32_t triangle)
+	{
+		uint32_t const* corners = &indices[size_t(triangle) * 3];
+		return uint32_t(localIndices[corners[0]] == UnusedVertex) + (localIndices[corners[1]] == UnusedVertex) +
+			   (localIndices[corners[2]] == UnusedVertex);
+	};
+	auto addTriangle = [&](uint32_t triangle)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[size_t(triangle) * 3 + corner];
+			if (localIndices[vertex] == UnusedVertex)
+			{
+				boxMin = meshlet.VertexCount ? glm::min(boxMin, positions[vertex]) : positions[vertex];
+				boxMax = meshlet.VertexCount ? glm::max(boxMax, positions[vertex]) : positions[vertex];
+				localIndices[vertex] = uint8_t(meshlet.VertexCount++);
+				data.Vertices.push_back(vertex);
+				positionSum += positions[vertex];
+			}
+			data.Triangles.push_back(localIndices[vertex]);
+			uint32_t* around = &adjacency[adjacencyOffsets[vertex]];
+			uint32_t& count = liveTriangles[vertex];
+			*std::find(around, around + count, triangle) = around[count - 1];
+			count--;
+		}
+		emitted[triangle] = 1;
+		meshlet.TriangleCount++;
+	};
+	// Within the meshlet's box grown by its largest half extent or the triangle's longest edge, whichever is larger
+	auto isNearby = [&](uint32_t triangle)
+	{
+		if (meshlet.TriangleCount == 0)
+			return true;
+		glm::vec3 corners[3];
+		for (int corner = 0; corner < 3; corner++)
+			corners[corner] = positions[indices[size_t(triangle) * 3 + corner]];
+		glm::vec3 halfExtent = (boxMax - boxMin) * 0.5f;
+		float reach = std::max({halfExtent.x, halfExtent.y, halfExtent.z});
+		for (int corner = 0; corner < 3; corner++)
+		{
+			glm::vec3 edge = corners[(corner + 1) % 3] - corners[corner];
+			reach = std::max(reach, std::sqrt(glm::dot(edge, edge)));
+		}
+		for (glm::vec3 const& corner : corners)
+			for (int axis = 0; axis < 3; axis++)
+				if (corner[axis] < boxMin[axis] - reach || corner[axis] > boxMax[axis] + reach)
+					return false;
+		return true;
+	};
+	auto finishMeshlet = [&]()
+	{
+		std::span<const uint32_t> vertices(data.Vertices.data() + meshlet.VertexOffset, meshlet.VertexCount);
+		std::span<const uint8_t> triangles(data.Triangles.data() + size_t(meshlet.TriangleOffset) * 3,
+										   size_t(meshlet.TriangleCount) * 3);
+		ComputeMeshletSphere(positions, vertices, meshlet);
+		ComputeMeshletCone(positions, vertices, triangles, normals, meshlet);
+		// The next meshlet starts next to this one when anything is left around it
+		seed = NoTriangle;
+		for (uint32_t vertex : vertices)
+		{
+			localIndices[vertex] = UnusedVertex;
+			if (seed == NoTriangle && liveTriangles[vertex] > 0)
+				seed = adjacency[adjacencyOffsets[vertex]];
+		}
+		data.Meshlets.push_back(meshlet);
+		meshlet = {};
+		meshlet.VertexOffset = uint32_t(data.Vertices.size());
+		meshlet.TriangleOffset = uint32_t(data.Triangles.size() / 3);
+		positionSum = {};
+	};
+
+	uint32_t scan = 0;
+	for (uint32_t remaining = triangleCount; remaining > 0;)
+	{
+		uint32_t best = NoTriangle, bestExtra = ~0u;
+		float bestDistance = std::numeric_limits<float>::max();
+		glm::vec3 centroid = positionSum / float(std::max(meshlet.VertexCount, 1u));
+		for (uint32_t i = 0; i < meshlet.VertexCount; i++)
+		{
+			uint32_t vertex = data.Vertices[meshlet.VertexOffset + i];
+			for (uint32_t j = 0; j < liveTriangles[vertex]; j++)
+			{
+				uint32_t triangle = adjacency[adjacencyOffsets[vertex] + j];
+				uint32_t const* corners = &indices[size_t(triangle) * 3];
+				uint32_t extra = countNewVertices(triangle);
+				if (meshlet.VertexCount + extra > settings.MaxVertices)
+					continue;
+				// Triangles adding no vertex come first, then ones that are the last live triangle of a vertex, left
+				// for later they would cost that vertex again in another meshlet
+				if (extra != 0)
+				{
+					if (liveTriangles[corners[0]] == 1 || liveTriangles[corners[1]] == 1 ||
+						liveTriangles[corners[2]] == 1)
+						extra = 0;
+					extra++;
+				}
+				if (extra > bestExtra)
+					continue;
+				glm::vec3 delta =
+					(positions[corners[0]] + positions[corners[1]] + positions[corners[2]]) / 3.0f - centroid;
+				float distance = glm::dot(delta, delta);
+				if (extra < bestExtra || distance < bestDistance)
+				{
+					best = triangle;
+					bestExtra = extra;
+					bestDistance = distance;
+				}
+			}
+		}
+
+		if (best == NoTriangle && meshlet.TriangleCount == 0 && seed != NoTriangle)
+			best = seed;
+		// Nothing connected fits, the index order of the file is the next best hint of locality. A triangle far from
+		// the meshlet would loosen its sphere and cone for every view, the meshlet is closed instead.
+		if (best == NoTriangle)
+		{
+			while (emitted[scan])
+				scan++;
+			if (meshlet.VertexCount + countNewVertices(scan) <= settings.MaxVertices && isNearby(scan))
+				best = scan;
+		}
+		if (best == NoTriangle)
+		{
+			finishMeshlet();
+			continue;
+		}
+		addTriangle(best);
+		remaining--;
+		if (meshlet.TriangleCount == settings.MaxTriangles)
+			finishMeshlet();
+	}
+	if (meshlet.TriangleCount > 0)
+		finishMeshlet();
+	return data;
+}
+
+MeshletCullView::MeshletCullView(glm::mat4 const& viewProjection, glm::vec3 position) : Position(position)
+{
+	auto row = [&](int i)
+	{ return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]); };
+	// Clip space depth runs from 0 to w, so the near plane is the third row on its own
+	Planes[0] = row(3) + row(0);
+	Planes[1] = row(3) - row(0);
+	Planes[2] = row(3) + row(1);
+	Planes[3] = row(3) - row(1);
+	Planes[4] = row(2);
+	Planes[5] = row(3) - row(2);
+	for (glm::vec4& plane : Planes)
+		plane /= std::sqrt(glm::dot(glm::vec3(plane), glm::vec3(plane)));
+}
+
+void CullMeshlets(MeshletData const& meshlets, glm::mat4 const& worldMatrix, MeshletCullView const& view,
+				  std::vector<uint32_t>& visible, MeshletCullStats& stats)
+{
+	glm::mat3 linear(worldMatrix);
+	float scales[3] = {std::sqrt(glm::dot(linear[0], linear[0])), std::sqrt(glm::dot(linear[1], linear[1])),
+					   std::sqrt(glm::dot(linear[2], linear[2]))};
+	float maxScale = std::max({scales[0], scales[1], scales[2]});
+	float minScale = std::min({scales[0], scales[1], scales[2]});
+	// Cones hold under rotation, translation and uniform scale. A mirror flips the triangles' planes and leaves the
+	// apex in front of them.
+	float tolerance = maxScale * maxScale * 1e-3f;
+	bool testCones = maxScale - minScale <= maxScale * 1e-3f && std::abs(glm::dot(linear[0], linear[1])) <= tolerance &&
+					 std::abs(glm::dot(linear[0], linear[2])) <= tolerance &&
+					 std::abs(glm::dot(linear[1], linear[2])) <= tolerance && glm::determinant(linear) > 0.0f;
+
+	for (uint32_t i = 0; i < meshlets.Meshlets.size(); i++)
+	{
+		Meshlet const& meshlet = meshlets.Meshlets[i];
+		stats.Meshlets++;
+		stats.Triangles += meshlet.TriangleCount;
+
+		glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(meshlet.Center, 1.0f));
+		float radius = meshlet.Radius * maxScale;
+		bool outside = std::ranges::any_of(view.Planes, [&](glm::vec4 const& plane)
+										   { return glm::dot(glm::vec3(plane), center) + plane.w < -radius; });
+		if (outside)
+		{
+			stats.FrustumCulledTriangles += meshlet.TriangleCount;
+			continue;
+		}
+
+		if (testCones && meshlet.ConeCutoff < 1.0f)
+		{
+			glm::vec3 apex = glm::vec3(worldMatrix * glm::vec4(meshlet.ConeApex, 1.0f));
+			glm::vec3 axis = linear * meshlet.ConeAxis / maxScale;
+			glm::vec3 toApex = apex - view.Position;
+			float distance = std::sqrt(glm::dot(toApex, toApex));
+			if (glm::dot(toApex, axis) >= meshlet.ConeCutoff * distance)
+			{
+				stats.BackfaceCulledTriangles += meshlet.TriangleCount;
+				continue;
+			}
+		}
+		visible.push_back(i);
+		stats.VisibleMeshlets++;
+	}
+}
+
+} // namespace rad
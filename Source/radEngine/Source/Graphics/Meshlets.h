@@ -0,0 +1,82 @@
+#pragma once
+
+#include "RadishCommon.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rad
+{
+
+/*
+A cluster of nearby triangles of a mesh, small enough for one mesh shader group. The sphere bounds its vertices. The
+normal cone bounds the facing of its triangles: seen from a point where dot(normalize(ConeApex - point), ConeAxis) is
+at least ConeCutoff every triangle is a back face. A ConeCutoff of 1 marks clusters whose normals are too spread out.
+*/
+struct Meshlet
+{
+	// Into MeshletData::Vertices and, in triangles, MeshletData::Triangles
+	uint32_t VertexOffset = 0;
+	uint32_t TriangleOffset = 0;
+	uint32_t VertexCount = 0;
+	uint32_t TriangleCount = 0;
+	glm::vec3 Center = {};
+	float Radius = 0.0f;
+	glm::vec3 ConeApex = {};
+	float ConeCutoff = 1.0f;
+	glm::vec3 ConeAxis = {};
+	uint32_t Padding = 0;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> Meshlets;
+	// Indices into the vertex buffer of the mesh
+	std::vector<uint32_t> Vertices;
+	// Three indices into the meshlet's vertices per triangle, winding kept
+	std::vector<uint8_t> Triangles;
+};
+
+struct MeshletSettings
+{
+	// 64 vertices and 124 triangles fit the outputs of a 128 thread mesh shader group
+	uint32_t MaxVertices = 64;
+	uint32_t MaxTriangles = 124;
+};
+
+/*
+Splits a triangle list into meshlets. Each meshlet grows greedily from a seed triangle, preferring triangles that add no
+new vertices, then ones that would be left dangling, then the closest to the meshlet's centroid. When nothing connected
+fits any more, the next triangle in index order is tried if it lies near the meshlet, else the meshlet is closed and the
+next one is seeded next to it.
+*/
+MeshletData BuildMeshlets(std::span<const glm::vec3> positions, std::span<const uint32_t> indices,
+						  MeshletSettings const& settings = {});
+
+// Frustum planes and position of a view for culling meshlets, the planes point inwards
+struct MeshletCullView
+{
+	MeshletCullView(glm::mat4 const& viewProjection, glm::vec3 position);
+
+	glm::vec4 Planes[6];
+	glm::vec3 Position;
+};
+
+struct MeshletCullStats
+{
+	uint64_t Meshlets = 0;
+	uint64_t VisibleMeshlets = 0;
+	uint64_t Triangles = 0;
+	uint64_t FrustumCulledTriangles = 0;
+	uint64_t BackfaceCulledTriangles = 0;
+};
+
+/*
+Appends the meshlets of a mesh drawn with worldMatrix that survive frustum and normal cone culling to visible and adds
+them up in stats. Cones are skipped when worldMatrix scales unevenly, shears or mirrors.
+*/
+void CullMeshlets(MeshletData const& meshlets, glm::mat4 const& worldMatrix, MeshletCullView const& view,
+				  std::vector<uint32_t>& visible, MeshletCullStats& stats);
+
+} // namespace rad
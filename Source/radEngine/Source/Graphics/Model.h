@@ -2,6 +2,10 @@
 
 #include "DXResource.h"
 #include "RendererCommon.h"
+#include "MeshBounds.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "Vertex.h"
 
 #include "ConstantBuffers.hlsli"
 
@@ -22,19 +26,17 @@ struct Material
 	std::optional<DescriptorAllocation> NormalMapTextureSRV = std::nullopt;
 };
 
-struct Vertex
+// CPU copy of a mesh's triangles for the passes that need the geometry, the meshes of a model share its positions
+struct MeshGeometry
 {
-	glm::vec3 Position;
-	glm::vec3 Normal;
-	glm::vec2 TexCoord;
-	glm::vec3 Tangent;
-
-	bool operator==(const Vertex& other) const
-	{
-		return Position.x == other.Position.x && Position.y == other.Position.y && Position.z == other.Position.z &&
-			   Normal.x == other.Normal.x && Normal.y == other.Normal.y && Normal.z == other.Normal.z &&
-			   TexCoord.x == other.TexCoord.x && TexCoord.y == other.TexCoord.y;
-	}
+	std::shared_ptr<const std::vector<glm::vec3>> Positions;
+	// The full resolution triangles
+	std::vector<uint32_t> Indices;
+	MeshletData Meshlets;
+	// Ranges of the mesh's GPU index buffer, which holds every level after the full resolution one
+	std::vector<MeshLod> Lods;
+	// Around the full resolution triangles
+	MeshBounds Bounds;
 };
 
 } // namespace rad
\ No newline at end of file
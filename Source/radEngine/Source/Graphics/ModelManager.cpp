@@ -1,251 +1,570 @@
 #include "ModelManager.h"
 
 #include "Renderer.h"
+#include <algorithm>
+#include <iostream>
+#include <optional>
 #include <filesystem>
+#include <unordered_set>
 #include <tiny_obj_loader.h>
 #include "TextureManager.h"
+#include "MeshCache.h"
+#include "ObjParser.h"
+#include "VertexHashTable.h"
+#include "IndexOptimizer.h"
+#include "MeshSimplifier.h"
+#include "ParallelFor.h"
 
-// Hash function for Vertex
-namespace std
+namespace rad
+{
+
+// One shape's triangles deduplicated on their own. The corners keep their tangents so the merge can add them up in the
+// order a single pass over all shapes would.
+struct ShapeVertices
 {
-template <> struct hash<glm::vec2>
+	std::vector<Vertex> Unique;
+	std::vector<uint64_t> Hashes;
+	std::vector<uint32_t> CornerVertices;
+	std::vector<glm::vec3> CornerTangents;
+};
+
+static void LoadShapeVertices(tinyobj::attrib_t const& attrib, tinyobj::shape_t const& shape, ShapeVertices& out)
 {
-	size_t operator()(glm::vec2 const& v) const
+	VertexHashTable uniqueVertices(shape.mesh.indices.size() / 2);
+	out.CornerVertices.reserve(shape.mesh.indices.size());
+	out.CornerTangents.reserve(shape.mesh.indices.size());
+
+	// Loop over faces(polygon)
+	size_t index_offset = 0;
+	for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++)
 	{
-		size_t seed = 0;
-		rad::HashCombine(seed, v.x, v.y);
-		return seed;
+		// hardcode loading to triangles
+		int fv = 3;
+		Vertex newVertices[3];
+		glm::vec3 bitangent;
+		// Loop over vertices in the face.
+		for (size_t v = 0; v < fv; v++)
+		{
+			// access to vertex
+			tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
+
+			// vertex position
+			tinyobj::real_t vx = attrib.vertices[3 * idx.vertex_index + 0];
+			tinyobj::real_t vy = attrib.vertices[3 * idx.vertex_index + 1];
+			tinyobj::real_t vz = attrib.vertices[3 * idx.vertex_index + 2];
+			// vertex normal
+			tinyobj::real_t nx = attrib.normals[3 * idx.normal_index + 0];
+			tinyobj::real_t ny = attrib.normals[3 * idx.normal_index + 1];
+			tinyobj::real_t nz = attrib.normals[3 * idx.normal_index + 2];
+			// vertex texcoords
+			tinyobj::real_t tx = attrib.texcoords[2 * idx.texcoord_index + 0];
+			tinyobj::real_t ty = attrib.texcoords[2 * idx.texcoord_index + 1];
+
+			// copy it into our vertex
+			Vertex new_vert;
+			new_vert.Position = {vx, vy, vz};
+
+			new_vert.Normal = {nx, ny, nz};
+
+			new_vert.TexCoord = {tx, ty};
+
+			newVertices[v] = new_vert;
+		}
+
+		glm::vec3 deltaPos1 = newVertices[1].Position - newVertices[0].Position;
+		glm::vec3 deltaPos2 = newVertices[2].Position - newVertices[0].Position;
+
+		glm::vec2 deltaUV1 = newVertices[1].TexCoord - newVertices[0].TexCoord;
+		glm::vec2 deltaUV2 = newVertices[2].TexCoord - newVertices[0].TexCoord;
+
+		float r = 1.0F / (deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x);
+		glm::vec3 tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * r;
+		bitangent = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x) * r;
+		newVertices[0].Tangent = tangent;
+		newVertices[1].Tangent = tangent;
+		newVertices[2].Tangent = tangent;
+
+		for (size_t v = 0; v < fv; v++)
+		{
+			Vertex& vtx = newVertices[v];
+
+			glm::vec3 n = vtx.Normal;
+			glm::vec3 t = vtx.Tangent;
+
+			// Gram-Schmidt orthogonalize
+			t = glm::normalize(t - n * glm::dot(n, t));
+
+			// Calculate handedness
+			if (glm::dot(glm::cross(n, t), bitangent) < 0.0f)
+				t *= -1;
+
+			vtx.Tangent = -t;
+		}
+
+		for (size_t v = 0; v < fv; v++)
+		{
+			Vertex& vtx = newVertices[v];
+			uint64_t hash = HashVertex(vtx);
+			uint32_t index = uniqueVertices.FindOrInsert(out.Unique, vtx, hash, uint32_t(out.Unique.size()));
+			if (index == out.Unique.size())
+			{
+				out.Unique.push_back(vtx);
+				out.Hashes.push_back(hash);
+			}
+			out.CornerVertices.push_back(index);
+			out.CornerTangents.push_back(vtx.Tangent);
+		}
+
+		index_offset += fv;
 	}
-};
-template <> struct hash<glm::vec3>
+}
+
+// Shapes are deduplicated in parallel, then merged in order into vertices so that equal vertices of different shapes
+// share an index and the result matches a single pass over all shapes, tangent sums included
+void LoadVerticesAndIndexBuffer(tinyobj::attrib_t const& attrib, std::vector<tinyobj::shape_t> const& shapes,
+								std::vector<Vertex>& vertices, std::vector<std::vector<uint32_t>>& indexPerShape)
 {
-	size_t operator()(glm::vec3 const& v) const
+
+	std::vector<ShapeVertices> shapeVertices(shapes.size());
+	ParallelFor(uint32_t(shapes.size()), 0,
+				[&](uint32_t s) { LoadShapeVertices(attrib, shapes[s], shapeVertices[s]); });
+
+	size_t uniqueCount = 0;
+	for (auto const& shape : shapeVertices)
+		uniqueCount += shape.Unique.size();
+	vertices.reserve(uniqueCount);
+	VertexHashTable uniqueVertices(uniqueCount);
+
+	std::vector<uint32_t> globalIndices;
+	// Set while the first corner of a vertex this shape added still has to be skipped, its tangent is already in
+	std::vector<uint8_t> firstCornerPending;
+	for (auto& shape : shapeVertices)
 	{
-		size_t seed = 0;
-		rad::HashCombine(seed, v.x, v.y, v.z);
-		return seed;
+		globalIndices.resize(shape.Unique.size());
+		firstCornerPending.assign(shape.Unique.size(), 0);
+		for (size_t i = 0; i < shape.Unique.size(); i++)
+		{
+			uint32_t index = uniqueVertices.FindOrInsert(vertices, shape.Unique[i], shape.Hashes[i],
+														 uint32_t(vertices.size()));
+			if (index == vertices.size())
+			{
+				vertices.push_back(shape.Unique[i]);
+				firstCornerPending[i] = 1;
+			}
+			globalIndices[i] = index;
+		}
+
+		auto& indices = indexPerShape.emplace_back();
+		indices.reserve(shape.CornerVertices.size());
+		for (size_t corner = 0; corner < shape.CornerVertices.size(); corner++)
+		{
+			uint32_t local = shape.CornerVertices[corner];
+			uint32_t index = globalIndices[local];
+			if (firstCornerPending[local])
+				firstCornerPending[local] = 0;
+			else
+			{
+				Vertex& existing = vertices[index];
+				existing.Tangent = existing.Tangent + shape.CornerTangents[corner];
+			}
+			indices.push_back(index);
+		}
+		shape = {};
 	}
-};
-template <> struct hash<rad::Vertex>
+}
+
+// Each shape is reordered for the vertex cache and then for overdraw, over the range of the shared vertices it uses.
+// Vertices are then renumbered in order of first use.
+static void OptimizeIndices(std::vector<Vertex>& vertices, std::vector<std::vector<uint32_t>>& indexPerShape)
+{
+	std::vector<glm::vec3> positions(vertices.size());
+	std::ranges::transform(vertices, positions.begin(), &Vertex::Position);
+
+	auto optimizeShape = [&](uint32_t s)
+	{
+		auto& indices = indexPerShape[s];
+		if (indices.empty())
+			return;
+		auto [first, last] = std::ranges::minmax(indices);
+		uint32_t vertexCount = last - first + 1;
+		for (uint32_t& index : indices)
+			index -= first;
+		OptimizeVertexCache(indices, vertexCount);
+		OptimizeOverdraw(indices, std::span(positions).subspan(first, vertexCount));
+		for (uint32_t& index : indices)
+			index += first;
+	};
+	ParallelFor(uint32_t(indexPerShape.size()), 0, optimizeShape);
+
+	std::vector<uint32_t> remap = RemapVerticesToFirstUse(indexPerShape, uint32_t(vertices.size()));
+	std::vector<Vertex> remapped(vertices.size());
+	for (size_t v = 0; v < vertices.size(); v++)
+		remapped[remap[v]] = vertices[v];
+	vertices = std::move(remapped);
+}
+
+static MeshCacheView CreateMeshCacheView(ObjData const& obj, std::vector<Vertex> const& vertices,
+										 std::vector<std::vector<uint32_t>> const& indexPerShape)
 {
-	size_t operator()(rad::Vertex const& vertex) const
+	MeshCacheView view;
+	view.Vertices = vertices;
+	auto& shapes = obj.Shapes;
+	view.Shapes.resize(shapes.size());
+	for (size_t i = 0; i < shapes.size(); i++)
 	{
-		size_t seed = 0;
-		rad::HashCombine(seed, vertex.Position, vertex.Normal, vertex.TexCoord);
-		return seed;
+		view.Shapes[i].Name = shapes[i].name;
+		view.Shapes[i].Indices = indexPerShape[i];
+		if (!shapes[i].mesh.material_ids.empty() && shapes[i].mesh.material_ids[0] >= 0)
+			view.Shapes[i].MaterialIndex = uint32_t(shapes[i].mesh.material_ids[0]);
 	}
+	for (auto& mat : obj.Materials)
+		view.Materials.push_back({mat.name, mat.diffuse_texname, mat.displacement_texname,
+								  glm::vec3(mat.diffuse[0], mat.diffuse[1], mat.diffuse[2])});
+	return view;
+}
+
+/*
+What a model load reads and computes before it touches the GPU, filled in on the load's worker thread. The spans of
+Model point into the cache file or into the storage of the OBJ load.
+*/
+struct ModelSourceData
+{
+	bool Valid = false;
+	MappedFile CacheFile;
+	ObjData Obj;
+	std::vector<Vertex> Vertices;
+	std::vector<std::vector<uint32_t>> IndicesPerShape;
+	std::vector<std::vector<MeshLod>> LodsPerShape;
+	std::vector<MeshletData> MeshletsPerShape;
+	MeshCacheView Model;
+	std::shared_ptr<std::vector<glm::vec3>> Positions;
+	// Textures of the materials by path, the ones that failed to decode are missing
+	std::unordered_map<std::string, TextureManager::DecodedTexture> Textures;
 };
-} // namespace std
 
-namespace rad
+static std::string GetModelTexturePath(std::string const& modelPath, std::string_view textureName)
 {
+	return std::filesystem::path(modelPath).parent_path().string() + "/" + std::string(textureName);
+}
 
-void LoadVerticesAndIndexBuffer(const tinyobj::ObjReader& reader, std::vector<Vertex>& vertices,
-								std::vector<std::vector<uint32_t>>& indexPerShape)
+static void LoadModelSource(std::string const& modelPath, ModelSourceData& source)
 {
-	auto& attrib = reader.GetAttrib();
-	auto shapes = reader.GetShapes();
+	std::filesystem::path cachePath = GetMeshCachePath(modelPath);
+	uint64_t sourceHash = HashMeshSource(modelPath);
+	auto& model = source.Model;
+	source.CacheFile = MappedFile(cachePath);
+	bool cached = source.CacheFile.IsValid() && ParseMeshCache(source.CacheFile.GetBytes(), sourceHash, model);
 
-	std::unordered_map<Vertex, size_t> uniqueVertices;
+	if (!cached)
+	{
+		// Unmapped first so the stale cache can be replaced
+		source.CacheFile = {};
+		if (!ParseObj(modelPath, source.Obj))
+		{
+			std::cout << source.Obj.Error << "\n";
+			return;
+		}
+		LoadVerticesAndIndexBuffer(source.Obj.Attrib, source.Obj.Shapes, source.Vertices, source.IndicesPerShape);
+		OptimizeIndices(source.Vertices, source.IndicesPerShape);
+		model = CreateMeshCacheView(source.Obj, source.Vertices, source.IndicesPerShape);
+	}
+
+	source.Positions = std::make_shared<std::vector<glm::vec3>>(model.Vertices.size());
+	std::ranges::transform(model.Vertices, source.Positions->begin(), &Vertex::Position);
 
-	for (size_t s = 0; s < shapes.size(); s++)
+	if (!cached)
 	{
-		auto& indices = indexPerShape.emplace_back();
-		// Loop over faces(polygon)
-		size_t index_offset = 0;
-		for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
+		auto& positions = *source.Positions;
+		auto& indicesPerShape = source.IndicesPerShape;
+		auto& lodsPerShape = source.LodsPerShape;
+		auto& meshletsPerShape = source.MeshletsPerShape;
+		// The levels of detail are appended to each shape's indices, bounds and meshlets are built for the full
+		// resolution only
+		lodsPerShape.resize(model.Shapes.size());
+		meshletsPerShape.resize(model.Shapes.size());
+		auto buildShape = [&](uint32_t i)
 		{
-			// hardcode loading to triangles
-			int fv = 3;
-			Vertex newVertices[3];
-			glm::vec3 bitangent;
-			// Loop over vertices in the face.
-			for (size_t v = 0; v < fv; v++)
-			{
-				// access to vertex
-				tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-				// vertex position
-				tinyobj::real_t vx = attrib.vertices[3 * idx.vertex_index + 0];
-				tinyobj::real_t vy = attrib.vertices[3 * idx.vertex_index + 1];
-				tinyobj::real_t vz = attrib.vertices[3 * idx.vertex_index + 2];
-				// vertex normal
-				tinyobj::real_t nx = attrib.normals[3 * idx.normal_index + 0];
-				tinyobj::real_t ny = attrib.normals[3 * idx.normal_index + 1];
-				tinyobj::real_t nz = attrib.normals[3 * idx.normal_index + 2];
-				// vertex texcoords
-				tinyobj::real_t tx = attrib.texcoords[2 * idx.texcoord_index + 0];
-				tinyobj::real_t ty = attrib.texcoords[2 * idx.texcoord_index + 1];
-
-				// copy it into our vertex
-				Vertex new_vert;
-				new_vert.Position = {vx, vy, vz};
-
-				new_vert.Normal = {nx, ny, nz};
-
-				new_vert.TexCoord = {tx, ty};
-
-				newVertices[v] = new_vert;
-			}
+			lodsPerShape[i] = BuildMeshLods(positions, indicesPerShape[i]);
+			auto fullResolution = std::span(indicesPerShape[i]).first(lodsPerShape[i][0].IndexCount);
+			model.Shapes[i].Bounds = ComputeMeshBounds(positions, fullResolution);
+			meshletsPerShape[i] = BuildMeshlets(positions, fullResolution);
+		};
+		ParallelFor(uint32_t(model.Shapes.size()), 0, buildShape);
+
+		for (size_t i = 0; i < model.Shapes.size(); i++)
+		{
+			model.Shapes[i].Indices = indicesPerShape[i];
+			model.Shapes[i].Lods = lodsPerShape[i];
+			model.Shapes[i].Meshlets = meshletsPerShape[i].Meshlets;
+			model.Shapes[i].MeshletVertices = meshletsPerShape[i].Vertices;
+			model.Shapes[i].MeshletTriangles = meshletsPerShape[i].Triangles;
+		}
+		if (!WriteMeshCache(cachePath, SerializeMeshCache(sourceHash, model)))
+			std::cout << "Failed to write mesh cache " << cachePath << "\n";
+	}
 
-			glm::vec3 deltaPos1 = newVertices[1].Position - newVertices[0].Position;
-			glm::vec3 deltaPos2 = newVertices[2].Position - newVertices[0].Position;
+	std::vector<std::string> texturePaths;
+	for (auto& mat : model.Materials)
+		for (std::string_view texture : {mat.DiffuseTexture, mat.NormalMapTexture})
+			if (!texture.empty())
+				texturePaths.push_back(GetModelTexturePath(modelPath, texture));
+	std::ranges::sort(texturePaths);
+	texturePaths.erase(std::unique(texturePaths.begin(), texturePaths.end()), texturePaths.end());
+	std::vector<std::optional<TextureManager::DecodedTexture>> textures(texturePaths.size());
+	ParallelFor(uint32_t(texturePaths.size()), 0,
+				[&](uint32_t i) { textures[i] = TextureManager::DecodeTexture(texturePaths[i], {}); });
+	for (size_t i = 0; i < texturePaths.size(); i++)
+		if (textures[i])
+			source.Textures.emplace(texturePaths[i], std::move(*textures[i]));
+
+	source.Valid = true;
+}
 
-			glm::vec2 deltaUV1 = newVertices[1].TexCoord - newVertices[0].TexCoord;
-			glm::vec2 deltaUV2 = newVertices[2].TexCoord - newVertices[0].TexCoord;
+// The texture loaded from path, nullptr when it failed to decode
+static DXTexture* CreateModelTexture(Renderer& renderer, ModelSourceData const& source, std::string const& path,
+									 CommandContext& commandCtx)
+{
+	auto it = source.Textures.find(path);
+	if (it == source.Textures.end())
+		return nullptr;
+	return renderer.TextureManager->CreateTexture(path, it->second, {}, commandCtx, true);
+}
 
-			float r = 1.0F / (deltaUV1.x * deltaUV2.y - deltaUV1.y * deltaUV2.x);
-			glm::vec3 tangent = (deltaPos1 * deltaUV2.y - deltaPos2 * deltaUV1.y) * r;
-			bitangent = (deltaPos2 * deltaUV1.x - deltaPos1 * deltaUV2.x) * r;
-			newVertices[0].Tangent = tangent;
-			newVertices[1].Tangent = tangent;
-			newVertices[2].Tangent = tangent;
+static void CreateMaterial(Renderer& renderer, std::string const& modelPath, ModelSourceData const& source,
+						   MeshCacheMaterial const& mat, Material& material, CommandContext& commandCtx)
+{
+	material.Name = mat.Name;
 
-			for (size_t v = 0; v < fv; v++)
-			{
-				Vertex& vtx = newVertices[v];
+	material.MaterialInfo = g_GPUDescriptorAllocator->AllocateFromStatic(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
 
-				glm::vec3 n = vtx.Normal;
-				glm::vec3 t = vtx.Tangent;
+	rad::hlsl::MaterialBuffer matInfo = {};
+	bool difTexLoaded = false;
+	// Load the textures
+	if (!mat.DiffuseTexture.empty())
+	{
+		material.DiffuseTextureName = GetModelTexturePath(modelPath, mat.DiffuseTexture);
+		auto* tex = CreateModelTexture(renderer, source, *material.DiffuseTextureName, commandCtx);
+		if (tex)
+		{
+			material.DiffuseTextureSRV =
+				g_GPUDescriptorAllocator->AllocateFromStatic(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
+			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+			srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+			srvDesc.Texture2D.MipLevels = -1;
+			tex->CreatePlacedSRV(material.DiffuseTextureSRV->GetView(0), &srvDesc);
+			difTexLoaded = true;
+			matInfo.DiffuseTextureIndex = material.DiffuseTextureSRV->Index;
+		}
+	}
+	if (!difTexLoaded)
+	{
+		matInfo.Diffuse = glm::vec4{mat.Diffuse, 1.0f};
+		material.DiffuseColor = mat.Diffuse;
+	}
+	if (!mat.NormalMapTexture.empty())
+	{
+		material.NormalMapTextureName = GetModelTexturePath(modelPath, mat.NormalMapTexture);
+		auto* tex = CreateModelTexture(renderer, source, *material.NormalMapTextureName, commandCtx);
+		if (tex)
+		{
+			material.NormalMapTextureSRV =
+				g_GPUDescriptorAllocator->AllocateFromStatic(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
+			D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+			srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+			srvDesc.Texture2D.MipLevels = -1;
+			tex->CreatePlacedSRV(material.NormalMapTextureSRV->GetView(0), &srvDesc);
+			matInfo.NormalMapTextureIndex = material.NormalMapTextureSRV->Index;
+		}
+	}
 
-				// Gram-Schmidt orthogonalize
-				t = glm::normalize(t - n * glm::dot(n, t));
+	material.MaterialInfoBuffer = DXTypedSingularBuffer<rad::hlsl::MaterialBuffer>::CreateAndUpload(
+		renderer.GetDevice(), s2ws(mat.Name) + L"_MaterialInfo", commandCtx, matInfo,
+		D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+	material.MaterialInfoBuffer.CreatePlacedCBV(material.MaterialInfo.GetView(0));
+}
 
-				// Calculate handedness
-				if (glm::dot(glm::cross(n, t), bitangent) < 0.0f)
-					t *= -1;
+static void CreateMesh(GeometryPool& geometryPool, ModelSourceData const& source, MeshCacheShape const& shape,
+					   ObjModel& objModel, CommandContext& commandCtx)
+{
+	auto const& model = source.Model;
+	std::string name(shape.Name);
+	auto& mesh = objModel.Meshes[name];
+	mesh.Vertices = objModel.Vertices;
+	mesh.Name = name;
+	mesh.Indices = geometryPool.UploadIndices(commandCtx, shape.Indices);
+	if (shape.MaterialIndex < model.Materials.size())
+		mesh.Material = objModel.Materials[std::string(model.Materials[shape.MaterialIndex].Name)];
+	auto geometry = std::make_shared<MeshGeometry>();
+	auto fullResolution = shape.Lods.empty() ? shape.Indices : shape.Indices.first(shape.Lods[0].IndexCount);
+	geometry->Positions = source.Positions;
+	geometry->Indices.assign(fullResolution.begin(), fullResolution.end());
+	geometry->Meshlets = {std::vector<Meshlet>(shape.Meshlets.begin(), shape.Meshlets.end()),
+						  std::vector<uint32_t>(shape.MeshletVertices.begin(), shape.MeshletVertices.end()),
+						  std::vector<uint8_t>(shape.MeshletTriangles.begin(), shape.MeshletTriangles.end())};
+	geometry->Lods.assign(shape.Lods.begin(), shape.Lods.end());
+	geometry->Bounds = shape.Bounds;
+	mesh.Bounds = shape.Bounds;
+	objModel.Bounds = MergeMeshBounds(objModel.Bounds, shape.Bounds);
+	mesh.Geometry = std::move(geometry);
+}
 
-				vtx.Tangent = -t;
-			}
+ModelManager::ModelManager(rad::Renderer& renderer) : Renderer(renderer) {}
 
-			for (size_t v = 0; v < fv; v++)
-			{
-				Vertex& vtx = newVertices[v];
-				size_t index;
-				if (auto it = uniqueVertices.find(vtx); it != uniqueVertices.end())
-				{
-					index = it->second;
-					Vertex& existing = vertices[index];
-					existing.Tangent = existing.Tangent + vtx.Tangent;
-				}
-				else
-				{
-					index = vertices.size();
-					vertices.emplace_back(vtx);
-					uniqueVertices.emplace(vtx, index);
-				}
-				indices.push_back(index);
-			}
+ModelManager::~ModelManager() = default;
 
-			index_offset += fv;
-		}
+OptionalRef<ObjModel> ModelManager::LoadModel(const std::string& modelPath, CommandContext& commandCtx)
+{
+	ModelId id = LoadModelAsync(modelPath);
+	auto& load = *Loads[id];
+	if (load.Worker.joinable())
+		load.Worker.join();
+	if (!load.UploadsQueued)
+		QueueUploads(load);
+	while (!load.Uploads.empty())
+	{
+		ModelUpload upload = std::move(load.Uploads.front());
+		load.Uploads.pop_front();
+		upload.Record(commandCtx);
 	}
+	return GetModel(id);
 }
 
-OptionalRef<ObjModel> ModelManager::LoadModel(const std::string& modelPath, CommandContext& commandCtx)
+ModelId ModelManager::LoadModelAsync(const std::string& modelPath)
 {
-	auto it = Models.find(modelPath);
-	if (it != Models.end())
+	auto it = ModelIds.find(modelPath);
+	if (it != ModelIds.end())
 	{
 		return it->second;
 	}
 
-	auto& objModel = Models[modelPath] = ObjModel{};
+	ModelId id = NextId;
+	NextId.Id++;
+	ModelIds[modelPath] = id;
+	auto& load = *(Loads[id] = std::make_unique<ModelLoad>());
+	load.Path = modelPath;
+	load.Source = std::make_unique<ModelSourceData>();
+	load.Worker = std::jthread(
+		[&load]
+		{
+			LoadModelSource(load.Path, *load.Source);
+			load.SourceReady.store(true, std::memory_order_release);
+		});
+	return id;
+}
 
-	tinyobj::ObjReaderConfig readerConfig;
-	tinyobj::ObjReader reader;
-	reader.ParseFromFile(modelPath, readerConfig);
-	assert(reader.Valid());
-	auto& attrib = reader.GetAttrib();
-	auto shapes = reader.GetShapes();
+ModelLoadState ModelManager::GetLoadState(ModelId id) const
+{
+	auto it = Loads.find(id);
+	return it != Loads.end() ? it->second->State : ModelLoadState::Failed;
+}
 
-	objModel.Meshes.reserve(shapes.size());
-	objModel.Materials.reserve(reader.GetMaterials().size());
+OptionalRef<ObjModel> ModelManager::GetModel(ModelId id)
+{
+	if (GetLoadState(id) != ModelLoadState::Ready)
+		return std::nullopt;
+	return Models[Loads[id]->Path];
+}
 
-	std::vector<Vertex> vertices;
-	std::vector<std::vector<uint32_t>> indicesPerShape;
-	LoadVerticesAndIndexBuffer(reader, vertices, indicesPerShape);
-	objModel.Vertices =
-		DXTypedBuffer<Vertex>::CreateAndUpload(Renderer.GetDevice(), s2ws(modelPath) + L"_Vertices", commandCtx,
-											   vertices, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
+void ModelManager::Update(RenderFrameRecord& frameRecord)
+{
+	bool loading = std::ranges::any_of(Loads, [](auto const& entry)
+									   { return entry.second->State == ModelLoadState::Loading; });
+	if (loading)
+		frameRecord.CommandRecord.Push("ModelUploads", [this](CommandContext& commandCtx)
+									   { RecordUploads(commandCtx, UploadBudgetBytes); });
+}
 
-	for (auto& mat : reader.GetMaterials())
+// The vertices go first, then the materials with their textures and then the meshes that use them. The model becomes
+// Ready with the last upload, and the CPU copies go with it. The uploads run over later frames and only keep the load,
+// which its unique_ptr keeps in place, and objModel, a node of Models. They reach the materials and shapes by index
+// through the load's source.
+void ModelManager::QueueUploads(ModelLoad& load)
+{
+	load.UploadsQueued = true;
+	auto& source = *load.Source;
+	if (!source.Valid)
 	{
-		auto& material = objModel.Materials[mat.name];
-		material.Name = mat.name;
-
-		material.MaterialInfo = g_GPUDescriptorAllocator->AllocateFromStatic(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
+		std::cout << "Failed to load " << load.Path << "\n";
+		load.State = ModelLoadState::Failed;
+		load.Source.reset();
+		return;
+	}
 
-		rad::hlsl::MaterialBuffer matInfo = {};
-		bool difTexLoaded = false;
-		// Load the textures
-		if (!mat.diffuse_texname.empty())
+	auto const& model = source.Model;
+	auto& objModel = Models[load.Path] = ObjModel{};
+	objModel.Meshes.reserve(model.Shapes.size());
+	objModel.Materials.reserve(model.Materials.size());
+
+	load.Uploads.push_back({model.Vertices.size_bytes(),
+							[this, &load, &objModel](CommandContext& commandCtx)
+							{
+								auto const& vertices = load.Source->Model.Vertices;
+								objModel.Vertices = GeometryPool.UploadVertices(commandCtx, vertices);
+							}});
+
+	// Textures shared by materials count against the budget of the first one only
+	std::unordered_set<std::string> countedTextures;
+	for (size_t m = 0; m < model.Materials.size(); m++)
+	{
+		auto const& mat = model.Materials[m];
+		uint64_t bytes = 0;
+		for (std::string_view texture : {mat.DiffuseTexture, mat.NormalMapTexture})
 		{
-			material.DiffuseTextureName =
-				std::filesystem::path(modelPath).parent_path().string() + "/" + mat.diffuse_texname;
-			// Load texture into memory
-			auto* tex = Renderer.TextureManager->LoadTexture(std::filesystem::path(*material.DiffuseTextureName), {},
-															 commandCtx, true);
-			if (tex)
-			{
-				material.DiffuseTextureSRV =
-					g_GPUDescriptorAllocator->AllocateFromStatic(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
-				D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-				srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
-				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-				srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-				srvDesc.Texture2D.MipLevels = -1;
-				tex->CreatePlacedSRV(material.DiffuseTextureSRV->GetView(0), &srvDesc);
-				difTexLoaded = true;
-				matInfo.DiffuseTextureIndex = material.DiffuseTextureSRV->Index;
-			}
+			std::string path = GetModelTexturePath(load.Path, texture);
+			auto it = source.Textures.find(path);
+			if (!texture.empty() && it != source.Textures.end() && countedTextures.insert(path).second)
+				bytes += it->second.Texels.size();
 		}
-		if (!difTexLoaded)
+		load.Uploads.push_back({bytes, [this, &load, &objModel, m](CommandContext& commandCtx)
+								{
+									auto const& mat = load.Source->Model.Materials[m];
+									auto& material = objModel.Materials[std::string(mat.Name)];
+									CreateMaterial(Renderer, load.Path, *load.Source, mat, material, commandCtx);
+								}});
+	}
+
+	for (size_t s = 0; s < model.Shapes.size(); s++)
+		load.Uploads.push_back({model.Shapes[s].Indices.size_bytes(),
+								[this, &load, &objModel, s](CommandContext& commandCtx)
+								{
+									auto const& source = *load.Source;
+									CreateMesh(GeometryPool, source, source.Model.Shapes[s], objModel, commandCtx);
+								}});
+
+	load.Uploads.push_back({0, [&load](CommandContext&)
+							{
+								load.State = ModelLoadState::Ready;
+								load.Source.reset();
+							}});
+}
+
+void ModelManager::RecordUploads(CommandContext& commandCtx, uint64_t budget)
+{
+	uint64_t recorded = 0;
+	for (uint32_t id = 1; id < NextId.Id; id++)
+	{
+		auto& load = *Loads[ModelId{id}];
+		if (load.State != ModelLoadState::Loading || !load.SourceReady.load(std::memory_order_acquire))
+			continue;
+		if (!load.UploadsQueued)
 		{
-			matInfo.Diffuse = glm::vec4{mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], 1.0f};
-			material.DiffuseColor = glm::vec3(mat.diffuse[0], mat.diffuse[1], mat.diffuse[2]);
+			load.Worker.join();
+			QueueUploads(load);
 		}
-		if (!mat.displacement_texname.empty())
+		while (!load.Uploads.empty() && (recorded == 0 || recorded + load.Uploads.front().Bytes <= budget))
 		{
-			material.NormalMapTextureName =
-				std::filesystem::path(modelPath).parent_path().string() + "/" + mat.displacement_texname;
-			// Load texture into memory
-			auto* tex = Renderer.TextureManager->LoadTexture(std::filesystem::path(*material.NormalMapTextureName), {},
-															 commandCtx, true);
-			if (tex)
-			{
-				material.NormalMapTextureSRV =
-					g_GPUDescriptorAllocator->AllocateFromStatic(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
-				D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-				srvDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-				srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-				srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-				srvDesc.Texture2D.MipLevels = -1;
-				tex->CreatePlacedSRV(material.NormalMapTextureSRV->GetView(0), &srvDesc);
-				matInfo.NormalMapTextureIndex = material.NormalMapTextureSRV->Index;
-			}
+			ModelUpload upload = std::move(load.Uploads.front());
+			load.Uploads.pop_front();
+			upload.Record(commandCtx);
+			recorded += upload.Bytes;
 		}
-
-		material.MaterialInfoBuffer = DXTypedSingularBuffer<rad::hlsl::MaterialBuffer>::CreateAndUpload(
-			Renderer.GetDevice(), s2ws(mat.name) + L"_MaterialInfo", commandCtx, matInfo,
-			D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
-		material.MaterialInfoBuffer.CreatePlacedCBV(material.MaterialInfo.GetView(0));
+		if (!load.Uploads.empty())
+			return;
 	}
-
-	// Loop over shapes
-	for (size_t i = 0; i < shapes.size(); i++)
-	{
-		auto& shape = shapes[i];
-		auto& indices = indicesPerShape[i];
-		auto& mesh = objModel.Meshes[shape.name];
-		mesh.Model = objModel.Vertices;
-		mesh.Name = shape.name;
-		mesh.Indices = DXTypedBuffer<uint32_t>::CreateAndUpload(Renderer.GetDevice(), s2ws(shape.name), commandCtx,
-																indices, D3D12_RESOURCE_STATE_INDEX_BUFFER);
-		mesh.Material = objModel.Materials[reader.GetMaterials()[shape.mesh.material_ids[0]].name];
-	}
-
-	return objModel;
 }
 
-} // namespace rad
\ No newline at end of file
+} // namespace rad
@@ -3,36 +3,108 @@
 #include "RadishCommon.h"
 #include "DXHelpers.h"
 
+#include "GeometryPool.h"
 #include "Model.h"
 
 #include "RendererCommon.h"
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
+
+RAD_ID_STRUCT_U32(rad, ModelId)
+
 namespace rad
 {
 
 struct ObjModel;
+struct RenderFrameRecord;
 
 struct Mesh
 {
 	std::string Name;
-	OptionalRef<DXTypedBuffer<Vertex>> Model = std::nullopt;
-	DXTypedBuffer<uint32_t> Indices;
+	// The model's vertices, which the indices count from
+	GeometryRange Vertices;
+	// Every level of detail, MeshLod offsets are relative to the start of the range
+	GeometryRange Indices;
 	OptionalRef<Material> Material;
+	MeshBounds Bounds;
+	std::shared_ptr<const MeshGeometry> Geometry;
 };
 
 struct ObjModel
 {
-	DXTypedBuffer<Vertex> Vertices;
+	GeometryRange Vertices;
+	// Around every mesh
+	MeshBounds Bounds;
 	std::unordered_map<std::string, Mesh> Meshes;
 	std::unordered_map<std::string, Material> Materials;
 };
 
+enum class ModelLoadState
+{
+	Loading,
+	Ready,
+	Failed,
+};
+
+struct ModelSourceData;
+
 struct ModelManager
 {
-	ModelManager(Renderer& renderer) : Renderer(renderer) {}
+	ModelManager(Renderer& renderer);
+	~ModelManager();
+	// Loads the model and records all of its uploads on commandContext before returning
 	OptionalRef<ObjModel> LoadModel(const std::string& modelPath, CommandContext& commandContext);
 
+	/*
+	Starts loading a model and returns right away. The OBJ or its cache is read and processed and the textures are
+	decoded on a worker thread, then Update records the uploads a few at a time. Loading a path again returns the same
+	id.
+	*/
+	ModelId LoadModelAsync(const std::string& modelPath);
+	ModelLoadState GetLoadState(ModelId id) const;
+	// The model once its state is Ready
+	OptionalRef<ObjModel> GetModel(ModelId id);
+
+	// Records the uploads of the models whose worker is done on the frame's command context, within UploadBudgetBytes
+	void Update(RenderFrameRecord& frameRecord);
+
+	// Vertex, index and texel bytes uploaded per frame, an upload larger than the budget goes through on its own
+	uint64_t UploadBudgetBytes = 32 * 1024 * 1024;
+
 	Renderer& Renderer;
+	// Holds the vertices and indices of every model
+	GeometryPool GeometryPool;
 	std::unordered_map<std::string, ObjModel> Models;
+
+  private:
+	struct ModelUpload
+	{
+		uint64_t Bytes = 0;
+		std::move_only_function<void(CommandContext&)> Record;
+	};
+	struct ModelLoad
+	{
+		std::string Path;
+		ModelLoadState State = ModelLoadState::Loading;
+		// Written by Worker, which sets SourceReady once it is done with it
+		std::unique_ptr<ModelSourceData> Source;
+		std::atomic<bool> SourceReady = false;
+		bool UploadsQueued = false;
+		std::deque<ModelUpload> Uploads;
+		// Last, so it is joined before the rest is destroyed
+		std::jthread Worker;
+	};
+
+	void QueueUploads(ModelLoad& load);
+	// Records the uploads of loads in the order they started until budget bytes are spent
+	void RecordUploads(CommandContext& commandContext, uint64_t budget);
+
+	std::unordered_map<std::string, ModelId> ModelIds;
+	std::unordered_map<ModelId, std::unique_ptr<ModelLoad>> Loads;
+	ModelId NextId = {1};
 };
-} // namespace rad
\ No newline at end of file
+} // namespace rad
@@ -0,0 +1,451 @@
+#include "ObjParser.h"
+
+#include "MappedFile.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <map>
+#include <string_view>
+
+namespace rad
+{
+
+namespace
+{
+
+struct ObjShapeStart
+{
+	// Polygons and triangles of the chunk before this o or g belong to the shape before it
+	uint32_t FirstPolygon = 0;
+	size_t FirstTriangle = 0;
+	std::string Name;
+};
+
+struct ObjChunk
+{
+	std::string_view Text;
+	size_t TextOffset = 0;
+
+	std::vector<float> Vertices;
+	std::vector<float> Normals;
+	std::vector<float> TexCoords;
+	// Corners of every polygon, negative OBJ indices count back from the end of this chunk's attributes until stitched
+	std::vector<tinyobj::index_t> Corners;
+	// Component c of corner i is relative when RelativeCorners holds i * 3 + c
+	std::vector<size_t> RelativeCorners;
+	std::vector<uint32_t> PolygonSizes;
+	// Index into MaterialNames, -1 for the material that was current when the chunk started
+	std::vector<int> PolygonMaterials;
+	std::vector<std::string> MaterialNames;
+	std::vector<std::string> MaterialLibraries;
+	std::vector<ObjShapeStart> ShapeStarts;
+	size_t TriangleCount = 0;
+	std::string Error;
+
+	// Set while stitching
+	int StartMaterial = -1;
+	size_t VertexBase = 0;
+	size_t NormalBase = 0;
+	size_t TexCoordBase = 0;
+	// Shape and first triangle in it of the part before each shape start, then of the part after every start
+	std::vector<std::pair<size_t, size_t>> Segments;
+};
+
+constexpr size_t NoShape = ~size_t(0);
+
+bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+void SkipSpaces(char const*& p, char const* end)
+{
+	while (p < end && IsSpace(*p))
+		p++;
+}
+
+std::string_view ReadToken(char const*& p, char const* end)
+{
+	SkipSpaces(p, end);
+	char const* start = p;
+	while (p < end && !IsSpace(*p))
+		p++;
+	return {start, size_t(p - start)};
+}
+
+// Missing or malformed values read as 0 like tinyobj's parseReal
+float ParseFloat(char const*& p, char const* end)
+{
+	SkipSpaces(p, end);
+	if (p < end && *p == '+')
+		p++;
+	float value = 0.0f;
+	auto result = std::from_chars(p, end, value);
+	if (result.ec != std::errc::invalid_argument)
+		p = result.ptr;
+	if (result.ec != std::errc())
+		value = 0.0f;
+	return value;
+}
+
+bool StartsWith(char const* p, char const* end, std::string_view keyword)
+{
+	return size_t(end - p) > keyword.size() && std::string_view(p, keyword.size()) == keyword &&
+		   IsSpace(p[keyword.size()]);
+}
+
+// Parses one f line into the chunk, false when an index is malformed
+bool ParseFace(ObjChunk& chunk, char const* p, char const* end)
+{
+	size_t firstCorner = chunk.Corners.size();
+	auto resolve = [&](int index, size_t count, int component) -> int
+	{
+		if (index > 0)
+			return index - 1;
+		chunk.RelativeCorners.push_back(chunk.Corners.size() * 3 + component);
+		return int(count) + index;
+	};
+	while (true)
+	{
+		SkipSpaces(p, end);
+		if (p == end)
+			break;
+		int indices[3] = {0, 0, 0};
+		for (int component = 0; component < 3; component++)
+		{
+			if (component > 0)
+			{
+				if (p == end || *p != '/')
+					break;
+				p++;
+				// v//vn leaves the texcoord out
+				if (p < end && *p == '/')
+					continue;
+			}
+			if (p < end && *p == '+')
+				p++;
+			auto result = std::from_chars(p, end, indices[component]);
+			if (result.ec != std::errc() || indices[component] == 0)
+				return false;
+			p = result.ptr;
+		}
+		if (p < end && !IsSpace(*p))
+			return false;
+		tinyobj::index_t corner;
+		corner.vertex_index = resolve(indices[0], chunk.Vertices.size() / 3, 0);
+		corner.texcoord_index = indices[1] ? resolve(indices[1], chunk.TexCoords.size() / 2, 1) : -1;
+		corner.normal_index = indices[2] ? resolve(indices[2], chunk.Normals.size() / 3, 2) : -1;
+		chunk.Corners.push_back(corner);
+	}
+
+	size_t cornerCount = chunk.Corners.size() - firstCorner;
+	// tinyobj drops faces with fewer than 3 corners
+	if (cornerCount < 3)
+	{
+		while (!chunk.RelativeCorners.empty() && chunk.RelativeCorners.back() >= firstCorner * 3)
+			chunk.RelativeCorners.pop_back();
+		chunk.Corners.resize(firstCorner);
+		return true;
+	}
+	chunk.PolygonSizes.push_back(uint32_t(cornerCount));
+	chunk.PolygonMaterials.push_back(chunk.MaterialNames.empty() ? -1 : int(chunk.MaterialNames.size()) - 1);
+	chunk.TriangleCount += cornerCount - 2;
+	return true;
+}
+
+void ParseChunk(ObjChunk& chunk)
+{
+	char const* p = chunk.Text.data();
+	char const* textEnd = p + chunk.Text.size();
+	while (p < textEnd)
+	{
+		char const* lineStart = p;
+		char const* end = std::find(p, textEnd, '\n');
+		p = end + (end < textEnd);
+		char const* line = lineStart;
+		SkipSpaces(line, end);
+		if (line == end)
+			continue;
+
+		if (StartsWith(line, end, "v"))
+		{
+			line += 1;
+			for (int i = 0; i < 3; i++)
+				chunk.Vertices.push_back(ParseFloat(line, end));
+		}
+		else if (StartsWith(line, end, "vn"))
+		{
+			line += 2;
+			for (int i = 0; i < 3; i++)
+				chunk.Normals.push_back(ParseFloat(line, end));
+		}
+		else if (StartsWith(line, end, "vt"))
+		{
+			line += 2;
+			for (int i = 0; i < 2; i++)
+				chunk.TexCoords.push_back(ParseFloat(line, end));
+		}
+		else if (StartsWith(line, end, "f"))
+		{
+			if (!ParseFace(chunk, line + 1, end))
+			{
+				size_t offset = chunk.TextOffset + size_t(lineStart - chunk.Text.data());
+				chunk.Error = "Malformed face at byte " + std::to_string(offset);
+				return;
+			}
+		}
+		else if (StartsWith(line, end, "o") || StartsWith(line, end, "g"))
+		{
+			bool isObject = *line == 'o';
+			line += 1;
+			SkipSpaces(line, end);
+			std::string name;
+			if (isObject)
+			{
+				char const* nameEnd = end;
+				while (nameEnd > line && IsSpace(nameEnd[-1]))
+					nameEnd--;
+				name.assign(line, nameEnd);
+			}
+			else
+			{
+				// tinyobj joins the names of a primitive in several groups with spaces
+				for (std::string_view group = ReadToken(line, end); !group.empty(); group = ReadToken(line, end))
+					name += (name.empty() ? "" : " ") + std::string(group);
+			}
+			chunk.ShapeStarts.push_back({uint32_t(chunk.PolygonSizes.size()), chunk.TriangleCount, std::move(name)});
+		}
+		else if (StartsWith(line, end, "usemtl"))
+		{
+			line += 6;
+			chunk.MaterialNames.emplace_back(ReadToken(line, end));
+		}
+		else if (StartsWith(line, end, "mtllib"))
+		{
+			line += 6;
+			chunk.MaterialLibraries.emplace_back(line, end);
+		}
+	}
+}
+
+// Loads the first of the MTL files a mtllib line names that can be opened, like tinyobj's MaterialFileReader
+void LoadMaterialLibrary(std::filesystem::path const& directory, std::string_view libraries,
+						 std::map<std::string, int>& materialMap, ObjData& data)
+{
+	char const* p = libraries.data();
+	char const* end = p + libraries.size();
+	for (std::string_view name = ReadToken(p, end); !name.empty(); name = ReadToken(p, end))
+	{
+		std::ifstream stream(directory / name);
+		if (!stream)
+			continue;
+		std::string warning, error;
+		tinyobj::LoadMtl(&materialMap, &data.Materials, &stream, &warning, &error);
+		return;
+	}
+}
+
+} // namespace
+
+bool ParseObj(std::filesystem::path const& path, ObjData& data, uint32_t threadCount)
+{
+	data = {};
+	MappedFile file(path);
+	if (!file.IsValid())
+	{
+		data.Error = "Cannot open " + path.string();
+		return false;
+	}
+	std::string_view text(reinterpret_cast<char const*>(file.GetBytes().data()), file.GetBytes().size());
+
+	// A few chunks per thread balance uneven line mixes, each cut moves forward to the start of the next line
+	if (threadCount == 0)
+		threadCount = DefaultThreadCount();
+	size_t chunkSize = std::clamp<size_t>(text.size() / (size_t(threadCount) * 4), 1 << 20, 64 << 20);
+	std::vector<ObjChunk> chunks;
+	for (size_t start = 0; start < text.size();)
+	{
+		size_t end = std::min(start + chunkSize, text.size());
+		end = std::min(text.find('\n', end - 1), text.size() - 1) + 1;
+		auto& chunk = chunks.emplace_back();
+		chunk.Text = text.substr(start, end - start);
+		chunk.TextOffset = start;
+		start = end;
+	}
+	ParallelFor(uint32_t(chunks.size()), threadCount, [&](uint32_t c) { ParseChunk(chunks[c]); });
+	for (auto& chunk : chunks)
+		if (!chunk.Error.empty())
+		{
+			data.Error = chunk.Error;
+			return false;
+		}
+
+	std::map<std::string, int> materialMap;
+	for (auto& chunk : chunks)
+		for (auto& libraries : chunk.MaterialLibraries)
+			LoadMaterialLibrary(path.parent_path(), libraries, materialMap, data);
+	auto findMaterial = [&](std::string const& name)
+	{
+		auto it = materialMap.find(name);
+		return it == materialMap.end() ? -1 : it->second;
+	};
+
+	// Walk the chunks in file order to place every attribute, shape and triangle
+	struct ShapeInfo
+	{
+		std::string Name;
+		size_t TriangleCount = 0;
+	};
+	std::vector<ShapeInfo> shapes(1);
+	size_t vertexCount = 0, normalCount = 0, texCoordCount = 0;
+	int material = -1;
+	for (auto& chunk : chunks)
+	{
+		chunk.VertexBase = vertexCount;
+		chunk.NormalBase = normalCount;
+		chunk.TexCoordBase = texCoordCount;
+		vertexCount += chunk.Vertices.size() / 3;
+		normalCount += chunk.Normals.size() / 3;
+		texCoordCount += chunk.TexCoords.size() / 2;
+
+		chunk.StartMaterial = material;
+		if (!chunk.MaterialNames.empty())
+			material = findMaterial(chunk.MaterialNames.back());
+
+		size_t firstTriangle = 0;
+		for (auto& start : chunk.ShapeStarts)
+		{
+			chunk.Segments.emplace_back(shapes.size() - 1, shapes.back().TriangleCount);
+			shapes.back().TriangleCount += start.FirstTriangle - firstTriangle;
+			firstTriangle = start.FirstTriangle;
+			shapes.push_back({start.Name});
+		}
+		chunk.Segments.emplace_back(shapes.size() - 1, shapes.back().TriangleCount);
+		shapes.back().TriangleCount += chunk.TriangleCount - firstTriangle;
+	}
+
+	// Shapes without faces are dropped like tinyobj does
+	std::vector<size_t> shapeRemap(shapes.size(), NoShape);
+	for (size_t s = 0; s < shapes.size(); s++)
+	{
+		if (shapes[s].TriangleCount == 0)
+			continue;
+		shapeRemap[s] = data.Shapes.size();
+		auto& shape = data.Shapes.emplace_back();
+		shape.name = shapes[s].Name;
+		shape.mesh.indices.resize(shapes[s].TriangleCount * 3);
+		shape.mesh.num_face_vertices.assign(shapes[s].TriangleCount, 3);
+		shape.mesh.material_ids.resize(shapes[s].TriangleCount);
+	}
+
+	data.Attrib.vertices.resize(vertexCount * 3);
+	data.Attrib.normals.resize(normalCount * 3);
+	data.Attrib.texcoords.resize(texCoordCount * 2);
+	ParallelFor(uint32_t(chunks.size()), threadCount,
+				[&](uint32_t c)
+				{
+					auto& chunk = chunks[c];
+					std::ranges::copy(chunk.Vertices, data.Attrib.vertices.begin() + chunk.VertexBase * 3);
+					std::ranges::copy(chunk.Normals, data.Attrib.normals.begin() + chunk.NormalBase * 3);
+					std::ranges::copy(chunk.TexCoords, data.Attrib.texcoords.begin() + chunk.TexCoordBase * 2);
+					chunk.Vertices = {};
+					chunk.Normals = {};
+					chunk.TexCoords = {};
+				});
+
+	// Quads need every position in place to pick their diagonal, so triangles are written after the copy above
+	std::vector<float> const& positions = data.Attrib.vertices;
+	ParallelFor(uint32_t(chunks.size()), threadCount,
+				[&](uint32_t c)
+				{
+					auto& chunk = chunks[c];
+					for (size_t relative : chunk.RelativeCorners)
+					{
+						auto& corner = chunk.Corners[relative / 3];
+						switch (relative % 3)
+						{
+						case 0: corner.vertex_index += int(chunk.VertexBase); break;
+						case 1: corner.texcoord_index += int(chunk.TexCoordBase); break;
+						default: corner.normal_index += int(chunk.NormalBase); break;
+						}
+					}
+					auto outside = [](int index, size_t count) { return index < -1 || index >= int64_t(count); };
+					for (auto const& corner : chunk.Corners)
+						if (corner.vertex_index < 0 || outside(corner.vertex_index, vertexCount) ||
+							outside(corner.texcoord_index, texCoordCount) || outside(corner.normal_index, normalCount))
+						{
+							chunk.Error = "Face index out of range after byte " + std::to_string(chunk.TextOffset);
+							return;
+						}
+					std::vector<int> materials(chunk.MaterialNames.size());
+					std::ranges::transform(chunk.MaterialNames, materials.begin(), findMaterial);
+
+					size_t corner = 0, segment = 0;
+					tinyobj::shape_t* shape = nullptr;
+					size_t triangle = 0;
+					auto startSegment = [&]()
+					{
+						auto [index, first] = chunk.Segments[segment++];
+						shape = shapeRemap[index] == NoShape ? nullptr : &data.Shapes[shapeRemap[index]];
+						triangle = first;
+					};
+					startSegment();
+					auto emit = [&](tinyobj::index_t a, tinyobj::index_t b, tinyobj::index_t d, int material)
+					{
+						auto* indices = shape->mesh.indices.data() + triangle * 3;
+						indices[0] = a;
+						indices[1] = b;
+						indices[2] = d;
+						shape->mesh.material_ids[triangle++] = material;
+					};
+					for (size_t polygon = 0; polygon < chunk.PolygonSizes.size(); polygon++)
+					{
+						while (segment <= chunk.ShapeStarts.size() &&
+							   chunk.ShapeStarts[segment - 1].FirstPolygon <= polygon)
+							startSegment();
+						uint32_t size = chunk.PolygonSizes[polygon];
+						auto const* corners = chunk.Corners.data() + corner;
+						corner += size;
+						int material = chunk.PolygonMaterials[polygon] < 0 ? chunk.StartMaterial
+																		   : materials[chunk.PolygonMaterials[polygon]];
+						if (size == 4)
+						{
+							auto distance = [&](tinyobj::index_t i, tinyobj::index_t j)
+							{
+								float sum = 0.0f;
+								for (int k = 0; k < 3; k++)
+								{
+									float delta = positions[size_t(j.vertex_index) * 3 + k] -
+												  positions[size_t(i.vertex_index) * 3 + k];
+									sum += delta * delta;
+								}
+								return sum;
+							};
+							if (distance(corners[0], corners[2]) < distance(corners[1], corners[3]))
+							{
+								emit(corners[0], corners[1], corners[2], material);
+								emit(corners[0], corners[2], corners[3], material);
+							}
+							else
+							{
+								emit(corners[0], corners[1], corners[3], material);
+								emit(corners[1], corners[2], corners[3], material);
+							}
+						}
+						else
+							for (uint32_t i = 1; i + 1 < size; i++)
+								emit(corners[0], corners[i], corners[i + 1], material);
+					}
+				});
+	for (auto& chunk : chunks)
+		if (!chunk.Error.empty())
+		{
+			data.Error = chunk.Error;
+			return false;
+		}
+	return true;
+}
+
+} // namespace rad
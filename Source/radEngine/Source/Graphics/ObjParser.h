@@ -0,0 +1,32 @@
+#pragma once
+
+#include <tiny_obj_loader.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace rad
+{
+
+// What tinyobj::ObjReader hands out after parsing an OBJ
+struct ObjData
+{
+	tinyobj::attrib_t Attrib;
+	std::vector<tinyobj::shape_t> Shapes;
+	std::vector<tinyobj::material_t> Materials;
+	std::string Error;
+};
+
+/*
+Parallel replacement for tinyobj::ObjReader::ParseFromFile over the part of OBJ the engine loads: v, vn, vt, f, o, g,
+usemtl and mtllib. The file is mapped and cut at line boundaries into chunks that are parsed on ParallelFor with
+std::from_chars, then stitched by offsetting each chunk's attributes, relative indices, shapes and materials by what
+the chunks before it hold. Shapes and faces come out like tinyobj's: a shape per o or g with faces, triangles, quads
+split along their shorter diagonal and larger polygons as fans. Smoothing groups, lines and points are skipped.
+Returns false with Error set when the file cannot be read or a face index is malformed.
+*/
+bool ParseObj(std::filesystem::path const& path, ObjData& data, uint32_t threadCount = 0);
+
+} // namespace rad
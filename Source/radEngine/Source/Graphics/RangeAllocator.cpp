@@ -0,0 +1,68 @@
+#include "RangeAllocator.h"
+
+#include <cassert>
+
+namespace rad
+{
+
+RangeAllocator::RangeAllocator(uint64_t capacity) : Capacity(capacity)
+{
+	if (capacity)
+		AddFreeRange(0, capacity);
+}
+
+std::optional<uint64_t> RangeAllocator::Allocate(uint64_t size)
+{
+	if (size == 0)
+		return std::nullopt;
+	auto best = FreeBySize.lower_bound({size, 0});
+	if (best == FreeBySize.end())
+		return std::nullopt;
+
+	auto [rangeSize, offset] = *best;
+	RemoveFreeRange(FreeByOffset.find(offset));
+	if (rangeSize > size)
+		AddFreeRange(offset + size, rangeSize - size);
+	return offset;
+}
+
+void RangeAllocator::Free(uint64_t offset, uint64_t size)
+{
+	assert(size && offset + size <= Capacity);
+	auto next = FreeByOffset.lower_bound(offset);
+	assert(next == FreeByOffset.end() || offset + size <= next->first);
+	if (next != FreeByOffset.end() && next->first == offset + size)
+	{
+		size += next->second;
+		next = std::next(next);
+		RemoveFreeRange(std::prev(next));
+	}
+	if (next != FreeByOffset.begin())
+	{
+		auto previous = std::prev(next);
+		assert(previous->first + previous->second <= offset);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFreeRange(previous);
+		}
+	}
+	AddFreeRange(offset, size);
+}
+
+void RangeAllocator::AddFreeRange(uint64_t offset, uint64_t size)
+{
+	FreeByOffset.emplace(offset, size);
+	FreeBySize.emplace(size, offset);
+	FreeSize += size;
+}
+
+void RangeAllocator::RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator range)
+{
+	FreeBySize.erase({range->second, range->first});
+	FreeSize -= range->second;
+	FreeByOffset.erase(range);
+}
+
+} // namespace rad
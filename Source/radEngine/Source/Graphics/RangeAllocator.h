@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <set>
+#include <utility>
+
+namespace rad
+{
+
+/*
+Hands out ranges of a fixed size space, counted in whatever units the caller uses. Free ranges are kept by offset, so
+a freed range merges with the free ranges it touches, and by size, so an allocation takes the smallest free range that
+fits and the large ones stay whole for large requests. Knows nothing about D3D12 so it can be exercised on its own.
+*/
+struct RangeAllocator
+{
+	explicit RangeAllocator(uint64_t capacity = 0);
+
+	// Returns the offset of size free units, nullopt when no free range is large enough
+	std::optional<uint64_t> Allocate(uint64_t size);
+	// Gives back a range Allocate returned
+	void Free(uint64_t offset, uint64_t size);
+
+	uint64_t GetCapacity() const
+	{
+		return Capacity;
+	}
+	uint64_t GetFreeSize() const
+	{
+		return FreeSize;
+	}
+	uint64_t GetLargestFreeRange() const
+	{
+		return FreeBySize.empty() ? 0 : FreeBySize.rbegin()->first;
+	}
+	size_t GetFreeRangeCount() const
+	{
+		return FreeByOffset.size();
+	}
+
+  private:
+	void AddFreeRange(uint64_t offset, uint64_t size);
+	void RemoveFreeRange(std::map<uint64_t, uint64_t>::iterator range);
+
+	// Offset to size, and size and offset of the same ranges
+	std::map<uint64_t, uint64_t> FreeByOffset;
+	std::set<std::pair<uint64_t, uint64_t>> FreeBySize;
+	uint64_t Capacity = 0;
+	uint64_t FreeSize = 0;
+};
+
+} // namespace rad
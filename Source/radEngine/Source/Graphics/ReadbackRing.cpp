@@ -0,0 +1,45 @@
+#include "ReadbackRing.h"
+
+#include <cassert>
+
+namespace rad
+{
+
+std::optional<ReadbackRing::Allocation> ReadbackRing::Allocate(uint64_t size, uint64_t alignment)
+{
+	if (size == 0 || size > Capacity)
+		return std::nullopt;
+	if (Allocations.empty())
+		Head = 0;
+
+	// The free space is the single arc going from Head to the oldest live allocation
+	uint64_t offset = (Head + alignment - 1) / alignment * alignment;
+	uint64_t consumed = offset + size - Head;
+	if (offset + size > Capacity)
+	{
+		offset = 0;
+		consumed = Capacity - Head + size;
+	}
+	if (UsedBytes + consumed > Capacity)
+		return std::nullopt;
+
+	Allocation allocation{.Id = NextId++, .Offset = offset};
+	Allocations.push_back({.Id = allocation.Id, .Consumed = consumed});
+	Head = (offset + size) % Capacity;
+	UsedBytes += consumed;
+	return allocation;
+}
+
+void ReadbackRing::Complete(uint64_t id)
+{
+	assert(!Allocations.empty() && id >= Allocations.front().Id && id <= Allocations.back().Id);
+	// Ids are handed out in order, so the entry is found by its distance from the front
+	Allocations[id - Allocations.front().Id].Completed = true;
+	while (!Allocations.empty() && Allocations.front().Completed)
+	{
+		UsedBytes -= Allocations.front().Consumed;
+		Allocations.pop_front();
+	}
+}
+
+} // namespace rad
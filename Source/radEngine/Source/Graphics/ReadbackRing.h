@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+namespace rad
+{
+
+/*
+Sub-allocates a fixed size ring of GPU->CPU copy destinations. Allocations are completed when the command context that
+recorded their copy has finished on the GPU, which isn't necessarily in allocation order, but their space is only given
+back once every older allocation has completed too. Knows nothing about D3D12 so it can be exercised on its own.
+*/
+struct ReadbackRing
+{
+	struct Allocation
+	{
+		uint64_t Id = 0;
+		uint64_t Offset = 0;
+	};
+
+	explicit ReadbackRing(uint64_t capacity = 0) : Capacity(capacity) {}
+
+	// Returns nullopt when the ring doesn't have size contiguous bytes left, the caller can retry a frame later
+	std::optional<Allocation> Allocate(uint64_t size, uint64_t alignment);
+	void Complete(uint64_t id);
+
+	uint64_t GetCapacity() const
+	{
+		return Capacity;
+	}
+	uint64_t GetUsedBytes() const
+	{
+		return UsedBytes;
+	}
+	size_t GetLiveAllocationCount() const
+	{
+		return Allocations.size();
+	}
+
+  private:
+	struct Entry
+	{
+		uint64_t Id;
+		// Bytes the head moved for this allocation, including alignment and wrap around padding
+		uint64_t Consumed;
+		bool Completed = false;
+	};
+	std::deque<Entry> Allocations;
+	uint64_t Capacity = 0;
+	uint64_t Head = 0;
+	uint64_t UsedBytes = 0;
+	uint64_t NextId = 1;
+};
+
+} // namespace rad
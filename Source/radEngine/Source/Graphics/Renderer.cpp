@@ -62,6 +62,8 @@ bool Renderer::InitializeDevice()
 	ModelManager = std::make_unique<rad::ModelManager>(*this);
 	// ModelManager->Init();
 
+	Readback = GPUReadback::Create(GetDevice(), 64 * 1024 * 1024);
+
 	{
 		D3D12_COMMAND_QUEUE_DESC desc = {};
 		desc.Type = D3D12_COMMAND_LIST_TYPE_DIRECT;
@@ -179,6 +181,7 @@ bool Renderer::OnWindowResized(uint32_t width, uint32_t height, bool initial)
 bool Renderer::Deinitialize()
 {
 	WaitAllCommandContexts();
+	Readback.reset();
 	DeferredPipeline.reset();
 	BlitPipeline.reset();
 	ModelManager.reset();
@@ -231,6 +234,7 @@ void Renderer::EnqueueFrame(RenderFrameRecord record)
 
 void Renderer::Render(RenderFrameRecord& record)
 {
+	RetireCompletedCommandContexts();
 	auto activeCmdContext = GetNewCommandContext();
 	if (!activeCmdContext)
 	{
@@ -356,6 +360,10 @@ Renderer::CommandContextData& Renderer::WaitAndClearCommandContext(PendingComman
 	cmdContext->GPUHeapPages.clear();
 	cmdContext->CommandAllocator->Reset();
 	cmdContext->IntermediateResources.clear();
+	cmdContext->Staging.Reset();
+	for (auto& callback : cmdContext->RetireCallbacks)
+		callback();
+	cmdContext->RetireCallbacks.clear();
 
 	// Delete from PendingCommandContexts
 	AvailableCommandContexts.push_back(cmdContext);
@@ -369,6 +377,17 @@ void Renderer::WaitAllCommandContexts()
 		PendingCommandContexts.pop_front();
 	}
 }
+void Renderer::RetireCompletedCommandContexts()
+{
+	while (!PendingCommandContexts.empty())
+	{
+		auto& pendingContext = PendingCommandContexts.front();
+		if (pendingContext.Fence->Fence->GetCompletedValue() < pendingContext.FenceValue)
+			break;
+		WaitAndClearCommandContext(std::move(pendingContext));
+		PendingCommandContexts.pop_front();
+	}
+}
 std::pair<Ref<DXTexture>, DescriptorAllocationView> Renderer::GetViewingTexture()
 {
 	if (ViewingTexture)
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "DXResource.h"
+#include "StagingAllocator.h"
+#include "GPUReadback.h"
 #include "RadishCommon.h"
 #include "RendererCommon.h"
 
@@ -185,6 +187,8 @@ struct Renderer
 		ComPtr<ID3D12CommandAllocator> CommandAllocator;
 		std::unordered_map<D3D12_DESCRIPTOR_HEAP_TYPE, DescriptorHeapPage*> GPUHeapPages = {};
 		std::vector<ComPtr<ID3D12Resource>> IntermediateResources;
+		StagingAllocator Staging;
+		std::vector<std::move_only_function<void()>> RetireCallbacks;
 	};
 	struct ActiveCommandContext
 	{
@@ -194,7 +198,8 @@ struct Renderer
 		CommandContext AsCommandContext()
 		{
 			return CommandContext{CmdContext->Device, CommandList, CmdContext->GPUHeapPages,
-								  CmdContext->IntermediateResources};
+								  CmdContext->IntermediateResources, CmdContext->Staging,
+								  CmdContext->RetireCallbacks};
 		}
 	};
 	struct PendingCommandContext
@@ -230,6 +235,8 @@ struct Renderer
 															  uint64_t signalValue, bool wait = false);
 	CommandContextData& WaitAndClearCommandContext(PendingCommandContext&& context);
 	void WaitAllCommandContexts();
+	// Clears the pending command contexts the GPU is already done with, without waiting on the others
+	void RetireCompletedCommandContexts();
 
 	std::queue<RenderFrameRecord> PendingFrameRecords;
 
@@ -251,6 +258,7 @@ struct Renderer
 	std::unique_ptr<ShaderManager> ShaderManager;
 	std::unique_ptr<TextureManager> TextureManager;
 	std::unique_ptr<ModelManager> ModelManager;
+	std::unique_ptr<GPUReadback> Readback;
 
 	DXFence Fence;
 	UINT64 FenceLastSignaledValue = 0;
@@ -6,12 +6,17 @@
 
 namespace rad
 {
+struct StagingAllocator;
+
 struct CommandContext
 {
 	RadDevice& Device;
 	RadGraphicsCommandList& CommandList;
 	std::unordered_map<D3D12_DESCRIPTOR_HEAP_TYPE, DescriptorHeapPage*>& GPUHeapPages;
 	std::vector<ComPtr<ID3D12Resource>>& IntermediateResources;
+	StagingAllocator& Staging;
+	// Run once the GPU has finished executing the command list
+	std::vector<std::move_only_function<void()>>& RetireCallbacks;
 	operator RadGraphicsCommandList&()
 	{
 		return CommandList;
@@ -0,0 +1,48 @@
+#include "StagingAllocator.h"
+#include "TextureFootprint.h"
+
+#include <algorithm>
+
+namespace rad
+{
+
+StagingAllocation StagingAllocator::Allocate(RadDevice& device, uint64_t size, uint64_t alignment)
+{
+	for (auto& page : Pages)
+	{
+		uint64_t offset = AlignUp(page.Offset, alignment);
+		if (offset + size <= page.Buffer.Size)
+		{
+			page.Offset = offset + size;
+			return {page.Buffer.Resource.Get(), offset, page.CPUAddress + offset};
+		}
+	}
+
+	// Oversized requests get a page of their own, which is kept around for the next upload of the same size
+	uint64_t pageSize = std::max(PageSize, AlignUp(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+	auto& page = Pages.emplace_back(
+		Page{.Buffer = DXBuffer::Create(device, L"StagingPage", pageSize, D3D12_HEAP_TYPE_UPLOAD)});
+	page.CPUAddress = page.Buffer.Map<std::byte>();
+	page.Offset = size;
+	return {page.Buffer.Resource.Get(), 0, page.CPUAddress};
+}
+
+void StagingAllocator::Reset()
+{
+	for (auto& page : Pages)
+	{
+		page.IdleResets = page.Offset ? 0 : page.IdleResets + 1;
+		page.Offset = 0;
+	}
+	std::erase_if(Pages, [this](Page const& page) { return page.IdleResets > MaxIdleResets; });
+}
+
+uint64_t StagingAllocator::GetReservedBytes() const
+{
+	uint64_t total = 0;
+	for (auto const& page : Pages)
+		total += page.Buffer.Size;
+	return total;
+}
+
+} // namespace rad
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "DXResource.h"
+
+namespace rad
+{
+
+struct StagingAllocation
+{
+	ID3D12Resource* Resource = nullptr;
+	uint64_t Offset = 0;
+	std::byte* CPUAddress = nullptr;
+};
+
+/*
+Hands out upload heap memory for copies recorded on a command context. Pages stay mapped and are rewound by Reset once
+the command context has finished executing, so repeated uploads reuse the same memory instead of creating a committed
+resource every time.
+*/
+struct StagingAllocator
+{
+	uint64_t PageSize = 4 * 1024 * 1024;
+	// Pages that stay unused for this many resets are released
+	uint32_t MaxIdleResets = 8;
+
+	StagingAllocation Allocate(RadDevice& device, uint64_t size, uint64_t alignment);
+	void Reset();
+
+	uint64_t GetReservedBytes() const;
+
+  private:
+	struct Page
+	{
+		DXBuffer Buffer;
+		std::byte* CPUAddress = nullptr;
+		uint64_t Offset = 0;
+		uint32_t IdleResets = 0;
+	};
+	std::vector<Page> Pages;
+};
+
+} // namespace rad
@@ -0,0 +1,35 @@
+#include "TextureFootprint.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace rad
+{
+
+TextureRegionFootprint ComputeRegionFootprint(uint32_t width, uint32_t height, uint32_t bytesPerPixel)
+{
+	TextureRegionFootprint footprint{.Width = width, .Height = height};
+	footprint.RowBytes = uint64_t(width) * bytesPerPixel;
+	footprint.RowPitch = AlignUp(footprint.RowBytes, TextureDataPitchAlignment);
+	if (width && height)
+		footprint.TotalBytes = footprint.RowPitch * (height - 1) + footprint.RowBytes;
+	return footprint;
+}
+
+void CopyRegionRows(TextureRegionFootprint const& footprint, std::span<const std::byte> src, uint64_t srcRowPitch,
+					std::byte* dst)
+{
+	if (!footprint.Height)
+		return;
+	assert(srcRowPitch >= footprint.RowBytes);
+	assert(src.size() >= srcRowPitch * (footprint.Height - 1) + footprint.RowBytes);
+	if (srcRowPitch == footprint.RowPitch)
+	{
+		std::memcpy(dst, src.data(), footprint.TotalBytes);
+		return;
+	}
+	for (uint32_t row = 0; row < footprint.Height; row++)
+		std::memcpy(dst + row * footprint.RowPitch, src.data() + row * srcRowPitch, footprint.RowBytes);
+}
+
+} // namespace rad
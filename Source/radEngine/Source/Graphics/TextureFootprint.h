@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace rad
+{
+
+// Mirrors D3D12_TEXTURE_DATA_PITCH_ALIGNMENT and D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, kept here so the layout math
+// doesn't depend on the D3D12 headers
+constexpr uint64_t TextureDataPitchAlignment = 256;
+constexpr uint64_t TextureDataPlacementAlignment = 512;
+
+constexpr uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+struct TextureRegionFootprint
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	// Tightly packed size of a row
+	uint64_t RowBytes = 0;
+	// Size of a row in the staging buffer, RowBytes aligned to TextureDataPitchAlignment
+	uint64_t RowPitch = 0;
+	// Staging memory needed for the region, the last row is not padded
+	uint64_t TotalBytes = 0;
+};
+
+TextureRegionFootprint ComputeRegionFootprint(uint32_t width, uint32_t height, uint32_t bytesPerPixel);
+
+// Copies height rows of footprint.RowBytes from a source with an arbitrary pitch into the pitched staging layout
+void CopyRegionRows(TextureRegionFootprint const& footprint, std::span<const std::byte> src, uint64_t srcRowPitch,
+					std::byte* dst);
+
+} // namespace rad
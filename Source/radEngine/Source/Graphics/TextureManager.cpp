@@ -27,17 +27,46 @@ DXTexture* rad::TextureManager::LoadTexture(std::filesystem::path const& path,
 		return Textures[it->second].get();
 	}
 
+	auto decoded = DecodeTexture(path, info);
+	if (!decoded)
+		return nullptr;
+	return CreateTexture(path, *decoded, info, commandCtx, generateMips);
+}
+
+std::optional<TextureManager::DecodedTexture> TextureManager::DecodeTexture(std::filesystem::path const& path,
+																			 TextureLoadInfo const& info)
+{
 	int width, height, comp;
+	int desiredComp = info.AlphaOnly ? STBI_grey : STBI_rgb_alpha;
+	// Per thread, so decodes on other threads keep their own setting
+	stbi_set_flip_vertically_on_load_thread(true);
+	stbi_uc* data = stbi_load(path.string().c_str(), &width, &height, &comp, desiredComp);
 
-	if (stbi_info(path.string().c_str(), &width, &height, &comp) == 0)
+	if (data == nullptr)
 	{
-		std::cout << "Failed to load texture info for " << path << ". Reason: " << stbi_failure_reason() << std::endl;
-		return {0};
+		std::cout << "Failed to load texture " << path << ". Reason: " << stbi_failure_reason() << std::endl;
+		return std::nullopt;
+	}
+
+	DecodedTexture decoded{.Width = uint32_t(width), .Height = uint32_t(height), .BytesPerPixel = uint8_t(desiredComp)};
+	auto const* texels = reinterpret_cast<const std::byte*>(data);
+	decoded.Texels.assign(texels, texels + size_t(width) * height * desiredComp);
+	stbi_image_free(data);
+	return decoded;
+}
+
+DXTexture* TextureManager::CreateTexture(std::filesystem::path const& path, DecodedTexture const& decoded,
+										 TextureLoadInfo const& info, CommandContext& commandCtx, bool generateMips)
+{
+	auto it = LoadedTextures.find(path);
+	if (it != LoadedTextures.end())
+	{
+		return Textures[it->second].get();
 	}
 
 	DXTexture::TextureCreateInfo createInfo = {
-		.Width = uint32_t(width),
-		.Height = uint32_t(height),
+		.Width = decoded.Width,
+		.Height = decoded.Height,
 		.MipLevels = generateMips ? 0u : 1u,
 		.Format = DXGI_FORMAT_R8G8B8A8_UNORM,
 		.Flags = info.Flags,
@@ -47,29 +76,11 @@ DXTexture* rad::TextureManager::LoadTexture(std::filesystem::path const& path,
 	if (generateMips)
 		createInfo.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
-	int desiredComp = info.AlphaOnly ? STBI_grey : STBI_rgb_alpha;
-	stbi_set_flip_vertically_on_load(true);
-	stbi_uc* data = stbi_load(path.string().c_str(), &width, &height, &comp, desiredComp);
-
-	if (data == nullptr)
-	{
-		std::cout << "Failed to load texture " << path << ". Reason: " << stbi_failure_reason() << std::endl;
-		return {0};
-	}
-
 	auto texture =
 		DXTexture::Create(Renderer.GetDevice(), path.filename().wstring(), createInfo, D3D12_RESOURCE_STATE_COPY_DEST);
 
 	// Copy the data to the texture
-	{
-		size_t size = width * height * desiredComp;
-		texture.UploadData(
-			commandCtx,
-			std::span<const std::byte>(reinterpret_cast<const std::byte*>(data), size_t(width * height * desiredComp)),
-			desiredComp);
-	}
-
-	stbi_image_free(data);
+	texture.UploadData(commandCtx, decoded.Texels, decoded.BytesPerPixel);
 
 	if (generateMips)
 	{
@@ -22,10 +22,25 @@ struct TextureManager
 		D3D12_RESOURCE_FLAGS Flags = D3D12_RESOURCE_FLAG_NONE;
 	};
 
+	// Texels of an image file as CreateTexture takes them
+	struct DecodedTexture
+	{
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint8_t BytesPerPixel = 0;
+		std::vector<std::byte> Texels;
+	};
+
 	void GenerateMips(CommandContext& commandCtx, DXTexture& texture);
 	DXTexture* LoadTexture(std::filesystem::path const& path, TextureLoadInfo const& info, CommandContext& commandCtx,
 						   bool generateMips = true);
 
+	// Reads and decodes an image without touching the GPU or the manager, so it can run on any thread
+	static std::optional<DecodedTexture> DecodeTexture(std::filesystem::path const& path, TextureLoadInfo const& info);
+	// Creates and uploads a texture decoded from path, or returns the one already loaded from it
+	DXTexture* CreateTexture(std::filesystem::path const& path, DecodedTexture const& decoded,
+							 TextureLoadInfo const& info, CommandContext& commandCtx, bool generateMips = true);
+
   private:
 	std::unordered_map<TextureId, std::unique_ptr<DXTexture>> Textures;
 	std::unordered_map<std::filesystem::path, TextureId> LoadedTextures;
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "RadishCommon.h"
+
+namespace rad
+{
+
+struct Vertex
+{
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::vec2 TexCoord;
+	glm::vec3 Tangent;
+
+	bool operator==(const Vertex& other) const
+	{
+		return Position.x == other.Position.x && Position.y == other.Position.y && Position.z == other.Position.z &&
+			   Normal.x == other.Normal.x && Normal.y == other.Normal.y && Normal.z == other.Normal.z &&
+			   TexCoord.x == other.TexCoord.x && TexCoord.y == other.TexCoord.y;
+	}
+};
+
+} // namespace rad
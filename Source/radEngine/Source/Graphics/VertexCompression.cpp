@@ -0,0 +1,177 @@
+#include "VertexCompression.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace rad
+{
+
+namespace
+{
+
+constexpr uint32_t EncodeBlockSize = 256;
+
+// Round to nearest even like the hardware conversion, written with selects so that it vectorizes. Halves too small
+// to be normal get their mantissa lined up by adding 0.5, whose exponent matches the smallest denormal's position.
+uint32_t FloatToHalf(float value)
+{
+	uint32_t bits = std::bit_cast<uint32_t>(value);
+	uint32_t sign = (bits >> 16) & 0x8000;
+	bits &= 0x7FFFFFFF;
+	uint32_t denormal = std::bit_cast<uint32_t>(std::bit_cast<float>(bits) + 0.5f) - 0x3F000000;
+	uint32_t normal = (bits + 0xC8000FFF + ((bits >> 13) & 1)) >> 13;
+	uint32_t overflow = bits > 0x7F800000 ? 0x7E00 : 0x7C00;
+	uint32_t half = bits >= 0x47800000 ? overflow : bits < 0x38800000 ? denormal : normal;
+	return half | sign;
+}
+
+// Two's complement of value rounded to a signed normalized integer of bitCount bits, in the low bits
+uint32_t EncodeSnorm(float value, uint32_t bitCount)
+{
+	float maxValue = float((1u << (bitCount - 1)) - 1);
+	float scaled = std::clamp(value, -1.0f, 1.0f) * maxValue;
+	int32_t rounded = int32_t(scaled + (scaled >= 0.0f ? 0.5f : -0.5f));
+	return uint32_t(rounded) & ((1u << bitCount) - 1);
+}
+
+// Octahedral coordinates of a direction of any length, zero and NaN directions map to the +z pole
+void EncodeOctahedral(float x, float y, float z, float& u, float& v)
+{
+	float length = std::abs(x) + std::abs(y) + std::abs(z);
+	bool valid = length > 0.0f;
+	float scale = valid ? 1.0f / length : 0.0f;
+	float px = x * scale;
+	float py = y * scale;
+	float foldedX = (1.0f - std::abs(py)) * (px >= 0.0f ? 1.0f : -1.0f);
+	float foldedY = (1.0f - std::abs(px)) * (py >= 0.0f ? 1.0f : -1.0f);
+	u = valid ? (z < 0.0f ? foldedX : px) : 0.0f;
+	v = valid ? (z < 0.0f ? foldedY : py) : 0.0f;
+}
+
+// One block of vertices split into arrays per component
+struct VertexBlock
+{
+	uint32_t Count = 0;
+	float Position[3][EncodeBlockSize];
+	float Normal[3][EncodeBlockSize];
+	float Tangent[3][EncodeBlockSize];
+	float TexCoord[2][EncodeBlockSize];
+
+	uint32_t PackedNormal[EncodeBlockSize];
+	uint32_t PackedTangent[EncodeBlockSize];
+	uint32_t PackedTexCoord[EncodeBlockSize];
+
+	void Load(std::span<const Vertex> vertices)
+	{
+		assert(vertices.size() <= EncodeBlockSize);
+		Count = uint32_t(vertices.size());
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			Vertex const& vertex = vertices[i];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				Position[axis][i] = vertex.Position[axis];
+				Normal[axis][i] = vertex.Normal[axis];
+				Tangent[axis][i] = vertex.Tangent[axis];
+			}
+			TexCoord[0][i] = vertex.TexCoord.x;
+			TexCoord[1][i] = vertex.TexCoord.y;
+		}
+	}
+
+	// Everything but the position, which the layouts store differently
+	void PackAttributes()
+	{
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			float u, v;
+			EncodeOctahedral(Normal[0][i], Normal[1][i], Normal[2][i], u, v);
+			PackedNormal[i] = EncodeSnorm(u, 16) | EncodeSnorm(v, 16) << 16;
+		}
+		for (uint32_t i = 0; i < Count; i++)
+		{
+			float u, v;
+			EncodeOctahedral(Tangent[0][i], Tangent[1][i], Tangent[2][i], u, v);
+			PackedTangent[i] = EncodeSnorm(u, 16) | EncodeSnorm(v, 15) << 16;
+		}
+		for (uint32_t i = 0; i < Count; i++)
+			PackedTexCoord[i] = FloatToHalf(TexCoord[0][i]) | FloatToHalf(TexCoord[1][i]) << 16;
+	}
+};
+
+template <typename Encoded, typename EncodeBlock>
+void EncodeBlocks(std::span<const Vertex> vertices, std::span<Encoded> encoded, uint32_t threadCount,
+				  EncodeBlock&& encodeBlock)
+{
+	assert(encoded.size() >= vertices.size());
+	uint32_t blockCount = uint32_t((vertices.size() + EncodeBlockSize - 1) / EncodeBlockSize);
+	ParallelFor(blockCount, threadCount,
+				[&](uint32_t blockIndex)
+				{
+					VertexBlock block;
+					size_t first = size_t(blockIndex) * EncodeBlockSize;
+					size_t count = std::min<size_t>(EncodeBlockSize, vertices.size() - first);
+					block.Load(vertices.subspan(first, count));
+					block.PackAttributes();
+					encodeBlock(block, encoded.subspan(first, count));
+				});
+}
+
+} // namespace
+
+CompactVertexBounds ComputeCompactVertexBounds(std::span<const Vertex> vertices)
+{
+	if (vertices.empty())
+		return {};
+	glm::vec3 minimum(std::numeric_limits<float>::max());
+	glm::vec3 maximum(std::numeric_limits<float>::lowest());
+	for (Vertex const& vertex : vertices)
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minimum[axis] = std::min(minimum[axis], vertex.Position[axis]);
+			maximum[axis] = std::max(maximum[axis], vertex.Position[axis]);
+		}
+	return {minimum, maximum - minimum};
+}
+
+void EncodeCompactVertices(std::span<const Vertex> vertices, CompactVertexBounds const& bounds,
+						   std::span<hlsl::CompactVertex> encoded, uint32_t threadCount)
+{
+	float scale[3];
+	for (int axis = 0; axis < 3; axis++)
+		scale[axis] = bounds.Extent[axis] > 0.0f ? 65535.0f / bounds.Extent[axis] : 0.0f;
+
+	auto encodeBlock = [&](VertexBlock& block, std::span<hlsl::CompactVertex> out)
+	{
+		uint32_t quantized[3][EncodeBlockSize];
+		for (int axis = 0; axis < 3; axis++)
+			for (uint32_t i = 0; i < block.Count; i++)
+			{
+				float unorm = (block.Position[axis][i] - bounds.Min[axis]) * scale[axis];
+				quantized[axis][i] = uint32_t(std::clamp(unorm, 0.0f, 65535.0f) + 0.5f);
+			}
+		for (uint32_t i = 0; i < block.Count; i++)
+			out[i] = {quantized[0][i] | quantized[1][i] << 16, quantized[2][i], block.PackedNormal[i],
+					  block.PackedTangent[i], block.PackedTexCoord[i]};
+	};
+	EncodeBlocks(vertices, encoded, threadCount, encodeBlock);
+}
+
+void EncodeCompactVertices(std::span<const Vertex> vertices, std::span<hlsl::CompactVertexFloat> encoded,
+						   uint32_t threadCount)
+{
+	auto encodeBlock = [&](VertexBlock& block, std::span<hlsl::CompactVertexFloat> out)
+	{
+		for (uint32_t i = 0; i < block.Count; i++)
+			out[i] = {glm::vec3(block.Position[0][i], block.Position[1][i], block.Position[2][i]),
+					  block.PackedNormal[i], block.PackedTangent[i], block.PackedTexCoord[i]};
+	};
+	EncodeBlocks(vertices, encoded, threadCount, encodeBlock);
+}
+
+} // namespace rad
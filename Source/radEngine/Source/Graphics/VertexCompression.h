@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include "VertexCompression.hlsli"
+
+#include <cstdint>
+#include <span>
+
+namespace rad
+{
+
+// Box the quantized positions of a vertex buffer are stored in, DecodeCompactPosition takes it apart
+struct CompactVertexBounds
+{
+	glm::vec3 Min = {};
+	glm::vec3 Extent = {};
+};
+
+CompactVertexBounds ComputeCompactVertexBounds(std::span<const Vertex> vertices);
+
+/*
+Encoders for the layouts in VertexCompression.hlsli. Vertices are encoded in blocks that are first split into one array
+per component, so the quantization loops are branch free and vectorize, and blocks are spread over ParallelFor.
+Rounding is to nearest, so decoding is off by at most:
+- positions: half a step of Extent / 65535 per axis, plus float rounding in the decode
+- normals: 0.006 degrees, tangents 0.01 degrees, zero or NaN directions come back as +z
+- texture coordinates: half a unit in the last place of a half, 2^-11 relative, as the hardware rounds
+The loader folds the bitangent's handedness into the tangent, so every Vertex encodes a handedness of +1.
+*/
+void EncodeCompactVertices(std::span<const Vertex> vertices, CompactVertexBounds const& bounds,
+						   std::span<hlsl::CompactVertex> encoded, uint32_t threadCount = 0);
+void EncodeCompactVertices(std::span<const Vertex> vertices, std::span<hlsl::CompactVertexFloat> encoded,
+						   uint32_t threadCount = 0);
+
+} // namespace rad
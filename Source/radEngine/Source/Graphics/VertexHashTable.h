@@ -0,0 +1,101 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rad
+{
+
+// 64 bit hash of the bits of what Vertex::operator== compares, with -0 hashed as +0 so equal vertices hash alike
+inline uint64_t HashVertex(Vertex const& vertex)
+{
+	auto bits = [](float value) -> uint64_t { return value == 0.0f ? 0u : std::bit_cast<uint32_t>(value); };
+	uint64_t words[4] = {
+		bits(vertex.Position.x) | bits(vertex.Position.y) << 32,
+		bits(vertex.Position.z) | bits(vertex.Normal.x) << 32,
+		bits(vertex.Normal.y) | bits(vertex.Normal.z) << 32,
+		bits(vertex.TexCoord.x) | bits(vertex.TexCoord.y) << 32,
+	};
+	uint64_t hash = 0x27D4EB2F165667C5ull;
+	for (uint64_t word : words)
+		hash = std::rotl((hash ^ word) * 0x9E3779B97F4A7C15ull, 29);
+	// murmur3 finalizer, every input bit reaches the low bits used for the slot
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+/*
+Open addressing map from a vertex to its index in a vertex array the caller owns, with linear probing over a power of
+two array of slots kept at most half full. Slots hold the full hash and the index, so probing only compares vertices
+whose hashes match, and growing never touches the vertices.
+*/
+struct VertexHashTable
+{
+	explicit VertexHashTable(size_t expectedCount = 0)
+	{
+		Slots.resize(std::bit_ceil(std::max<size_t>(16, expectedCount * 2)));
+	}
+
+	// Index of a vertex of vertices equal to vertex, or newIndex after storing it when there is none
+	uint32_t FindOrInsert(std::span<const Vertex> vertices, Vertex const& vertex, uint64_t hash, uint32_t newIndex)
+	{
+		size_t mask = Slots.size() - 1;
+		for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+		{
+			Slot& entry = Slots[slot];
+			if (entry.Index == EmptySlot)
+			{
+				entry = {hash, newIndex};
+				if (++Count * 2 > Slots.size())
+					Grow();
+				return newIndex;
+			}
+			if (entry.Hash == hash && vertices[entry.Index] == vertex)
+				return entry.Index;
+		}
+	}
+
+	size_t GetCount() const
+	{
+		return Count;
+	}
+
+  private:
+	static constexpr uint32_t EmptySlot = ~0u;
+
+	struct Slot
+	{
+		uint64_t Hash = 0;
+		uint32_t Index = EmptySlot;
+	};
+
+	void Grow()
+	{
+		std::vector<Slot> old(Slots.size() * 2);
+		old.swap(Slots);
+		size_t mask = Slots.size() - 1;
+		for (Slot const& entry : old)
+		{
+			if (entry.Index == EmptySlot)
+				continue;
+			size_t slot = entry.Hash & mask;
+			while (Slots[slot].Index != EmptySlot)
+				slot = (slot + 1) & mask;
+			Slots[slot] = entry;
+		}
+	}
+
+	std::vector<Slot> Slots;
+	size_t Count = 0;
+};
+
+} // namespace rad
@@ -0,0 +1,254 @@
+#include "VirtualTexturePageTable.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+namespace rad
+{
+
+VirtualTexturePageTable::VirtualTexturePageTable(Settings const& settings) : Config(settings)
+{
+	assert(Config.PageSize > 0 && Config.Width % Config.PageSize == 0 && Config.Height % Config.PageSize == 0);
+	PagesX = Config.Width / Config.PageSize;
+	PagesY = Config.Height / Config.PageSize;
+	assert(std::has_single_bit(PagesX) && std::has_single_bit(PagesY));
+	MipCount = std::countr_zero(std::min(PagesX, PagesY)) + 1;
+	assert(Config.PhysicalPageCount <= 0x10000);
+
+	Slots.resize(Config.PhysicalPageCount);
+	for (uint32_t slot = Config.PhysicalPageCount; slot-- > 0;)
+		FreeSlots.push_back(slot);
+	Indirection.assign(size_t(PagesX) * PagesY, InvalidEntry);
+
+	// The coarsest mip backs every other page, it is loaded by the first Update and never evicted
+	uint32_t topMip = MipCount - 1;
+	assert(GetPagesX(topMip) * GetPagesY(topMip) < Config.PhysicalPageCount);
+	for (uint32_t y = 0; y < GetPagesY(topMip); y++)
+		for (uint32_t x = 0; x < GetPagesX(topMip); x++)
+		{
+			uint32_t slot = AcquireSlot();
+			MakeResident({x, y, topMip}, slot, true);
+			Slots[slot].Stale = true;
+			PinnedSlots.push_back(slot);
+		}
+}
+
+void VirtualTexturePageTable::BeginFrame()
+{
+	Frame++;
+	Pending.clear();
+	PendingKeys.clear();
+	Reloads.clear();
+	FrameStats.Requested = FrameStats.Missing = FrameStats.Loaded = FrameStats.Evicted = 0;
+}
+
+void VirtualTexturePageTable::Request(PageId page)
+{
+	assert(page.Mip < MipCount && page.X < GetPagesX(page.Mip) && page.Y < GetPagesY(page.Mip));
+	uint64_t key = Key(page);
+	if (auto it = Resident.find(key); it != Resident.end())
+	{
+		Slot& slot = Slots[it->second];
+		if (slot.LastRequested == Frame)
+			return;
+		FrameStats.Requested++;
+		Touch(it->second);
+		if (slot.Stale && !slot.Pinned)
+			Reloads.push_back(it->second);
+		return;
+	}
+	if (PendingKeys.insert(key).second)
+	{
+		Pending.push_back(page);
+		FrameStats.Requested++;
+	}
+}
+
+void VirtualTexturePageTable::RequestByDistance(float viewerX, float viewerY, float viewerHeight, float mip0Distance)
+{
+	uint32_t topMip = MipCount - 1;
+	for (uint32_t y = 0; y < GetPagesY(topMip); y++)
+		for (uint32_t x = 0; x < GetPagesX(topMip); x++)
+			RequestSubtree({x, y, topMip}, viewerX, viewerY, viewerHeight, mip0Distance);
+}
+
+void VirtualTexturePageTable::RequestSubtree(PageId page, float viewerX, float viewerY, float viewerHeight,
+											 float mip0Distance)
+{
+	Request(page);
+	if (page.Mip == 0)
+		return;
+
+	// Distance to the closest point of the page
+	float size = float(Config.PageSize << page.Mip);
+	float minX = page.X * size, minY = page.Y * size;
+	float dx = std::max({minX - viewerX, 0.0f, viewerX - (minX + size)});
+	float dy = std::max({minY - viewerY, 0.0f, viewerY - (minY + size)});
+	float distance = std::sqrt(dx * dx + dy * dy + viewerHeight * viewerHeight);
+	float wantedMip = distance < mip0Distance ? 0.0f : std::floor(std::log2(distance / mip0Distance)) + 1.0f;
+	if (wantedMip >= float(page.Mip))
+		return;
+
+	for (uint32_t child = 0; child < 4; child++)
+		RequestSubtree({page.X * 2 + (child & 1), page.Y * 2 + (child >> 1), page.Mip - 1}, viewerX, viewerY,
+					   viewerHeight, mip0Distance);
+}
+
+std::vector<VirtualTexturePageTable::PageLoad> VirtualTexturePageTable::Update()
+{
+	std::vector<PageLoad> loads;
+	for (uint32_t slot : PinnedSlots)
+		if (Slots[slot].Stale)
+		{
+			Slots[slot].Stale = false;
+			loads.push_back({Slots[slot].Page, slot});
+		}
+
+	uint32_t budget = Config.MaxLoadsPerFrame;
+	for (uint32_t slot : Reloads)
+	{
+		if (budget == 0)
+			break;
+		Slots[slot].Stale = false;
+		loads.push_back({Slots[slot].Page, slot});
+		budget--;
+	}
+
+	// Coarse pages first, they are the fallback of the finer ones
+	std::stable_sort(Pending.begin(), Pending.end(), [](PageId a, PageId b) { return a.Mip > b.Mip; });
+	size_t loaded = 0;
+	for (; loaded < Pending.size() && budget > 0; loaded++, budget--)
+	{
+		uint32_t slot = AcquireSlot();
+		if (slot == NoSlot)
+			break;
+		MakeResident(Pending[loaded], slot, false);
+		Slots[slot].LastRequested = Frame;
+		loads.push_back({Pending[loaded], slot});
+	}
+
+	FrameStats.Missing = uint32_t(Pending.size() - loaded);
+	FrameStats.Loaded = uint32_t(loads.size());
+	FrameStats.TotalLoaded += loads.size();
+	FrameStats.Resident = uint32_t(Resident.size());
+	Pending.clear();
+	Reloads.clear();
+	return loads;
+}
+
+void VirtualTexturePageTable::InvalidateAll()
+{
+	for (auto& slot : Slots)
+		if (slot.Occupied)
+			slot.Stale = true;
+}
+
+VirtualTexturePageTable::Rect VirtualTexturePageTable::TakeIndirectionDirtyRect()
+{
+	if (DirtyMinX > DirtyMaxX)
+		return {};
+	Rect rect{DirtyMinX, DirtyMinY, DirtyMaxX - DirtyMinX + 1, DirtyMaxY - DirtyMinY + 1};
+	DirtyMinX = DirtyMinY = ~0u;
+	DirtyMaxX = DirtyMaxY = 0;
+	return rect;
+}
+
+uint32_t VirtualTexturePageTable::AcquireSlot()
+{
+	if (!FreeSlots.empty())
+	{
+		uint32_t slot = FreeSlots.back();
+		FreeSlots.pop_back();
+		return slot;
+	}
+	// Pages requested this frame stay, the rest of the request waits for a later frame
+	uint32_t slot = LruTail;
+	if (slot == NoSlot || Slots[slot].LastRequested == Frame)
+		return NoSlot;
+	Evict(slot);
+	return slot;
+}
+
+void VirtualTexturePageTable::Evict(uint32_t slotIndex)
+{
+	Slot& slot = Slots[slotIndex];
+	assert(slot.Occupied && !slot.Pinned);
+	PageId page = slot.Page;
+	Resident.erase(Key(page));
+	Unlink(slotIndex);
+	slot.Occupied = slot.Stale = false;
+
+	// The pinned top mip guarantees an ancestor
+	uint32_t fallback = InvalidEntry;
+	for (uint32_t mip = page.Mip + 1; mip < MipCount && fallback == InvalidEntry; mip++)
+	{
+		uint32_t shift = mip - page.Mip;
+		if (auto it = Resident.find(Key({page.X >> shift, page.Y >> shift, mip})); it != Resident.end())
+			fallback = PackEntry(it->second, mip);
+	}
+	assert(fallback != InvalidEntry);
+	UpdateIndirection(page, fallback, PackEntry(slotIndex, page.Mip));
+
+	FrameStats.Evicted++;
+	FrameStats.TotalEvicted++;
+}
+
+void VirtualTexturePageTable::MakeResident(PageId page, uint32_t slotIndex, bool pinned)
+{
+	Slot& slot = Slots[slotIndex];
+	slot = Slot{.Page = page, .Occupied = true, .Pinned = pinned};
+	Resident[Key(page)] = slotIndex;
+	if (!pinned)
+		PushFront(slotIndex);
+	UpdateIndirection(page, PackEntry(slotIndex, page.Mip), InvalidEntry);
+}
+
+void VirtualTexturePageTable::UpdateIndirection(PageId page, uint32_t entry, uint32_t evictedEntry)
+{
+	uint32_t span = 1u << page.Mip;
+	uint32_t minX = page.X * span, minY = page.Y * span;
+	for (uint32_t y = minY; y < minY + span; y++)
+		for (uint32_t x = minX; x < minX + span; x++)
+		{
+			uint32_t& current = Indirection[x + size_t(y) * PagesX];
+			bool replace = evictedEntry != InvalidEntry
+							   ? current == evictedEntry
+							   : current == InvalidEntry || EntryMip(current) > page.Mip;
+			if (replace)
+				current = entry;
+		}
+	DirtyMinX = std::min(DirtyMinX, minX);
+	DirtyMinY = std::min(DirtyMinY, minY);
+	DirtyMaxX = std::max(DirtyMaxX, minX + span - 1);
+	DirtyMaxY = std::max(DirtyMaxY, minY + span - 1);
+}
+
+void VirtualTexturePageTable::Touch(uint32_t slotIndex)
+{
+	Slots[slotIndex].LastRequested = Frame;
+	if (Slots[slotIndex].Pinned)
+		return;
+	Unlink(slotIndex);
+	PushFront(slotIndex);
+}
+
+void VirtualTexturePageTable::Unlink(uint32_t slotIndex)
+{
+	Slot& slot = Slots[slotIndex];
+	(slot.Prev != NoSlot ? Slots[slot.Prev].Next : LruHead) = slot.Next;
+	(slot.Next != NoSlot ? Slots[slot.Next].Prev : LruTail) = slot.Prev;
+	slot.Prev = slot.Next = NoSlot;
+}
+
+void VirtualTexturePageTable::PushFront(uint32_t slotIndex)
+{
+	Slot& slot = Slots[slotIndex];
+	slot.Prev = NoSlot;
+	slot.Next = LruHead;
+	(LruHead != NoSlot ? Slots[LruHead].Prev : LruTail) = slotIndex;
+	LruHead = slotIndex;
+}
+
+} // namespace rad
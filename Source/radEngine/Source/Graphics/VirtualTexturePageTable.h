@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace rad
+{
+
+/*
+Residency of a virtual texture split into square pages, kept in a fixed number of physical slots of an atlas. Page mip
+m covers 2^m x 2^m pages of mip 0, the coarsest mip is pinned so every texel always resolves to something.
+
+Each frame: BeginFrame, Request the pages the view needs (RequestByDistance walks the page quadtree around a viewer),
+then Update hands out the loads to copy into the atlas, coarse mips first, evicting the least recently requested pages.
+The indirection table has one entry per mip 0 page pointing to the finest resident page covering it, the rect that
+changed since the last TakeIndirectionDirtyRect has to be uploaded with the loads. Knows nothing about D3D12.
+*/
+struct VirtualTexturePageTable
+{
+	struct Settings
+	{
+		// Mip 0 size in texels, multiples of PageSize with a power of two page count on each side
+		uint32_t Width = 1024;
+		uint32_t Height = 1024;
+		uint32_t PageSize = 128;
+		uint32_t PhysicalPageCount = 64;
+		uint32_t MaxLoadsPerFrame = 16;
+	};
+
+	struct PageId
+	{
+		uint32_t X = 0, Y = 0, Mip = 0;
+	};
+
+	struct PageLoad
+	{
+		PageId Page;
+		uint32_t Slot = 0;
+	};
+
+	struct Rect
+	{
+		uint32_t X = 0, Y = 0, Width = 0, Height = 0;
+	};
+
+	struct Stats
+	{
+		uint32_t Resident = 0;
+		// Distinct pages requested this frame, resident or not
+		uint32_t Requested = 0;
+		// Requested pages that are still not resident after Update
+		uint32_t Missing = 0;
+		uint32_t Loaded = 0;
+		uint32_t Evicted = 0;
+		uint64_t TotalLoaded = 0;
+		uint64_t TotalEvicted = 0;
+	};
+
+	// Entries of the indirection table, the slot in the low 16 bits and the mip of the page above
+	static constexpr uint32_t InvalidEntry = ~0u;
+	static uint32_t PackEntry(uint32_t slot, uint32_t mip)
+	{
+		return slot | mip << 16;
+	}
+	static uint32_t EntrySlot(uint32_t entry)
+	{
+		return entry & 0xFFFF;
+	}
+	static uint32_t EntryMip(uint32_t entry)
+	{
+		return entry >> 16;
+	}
+
+	explicit VirtualTexturePageTable(Settings const& settings);
+
+	void BeginFrame();
+	void Request(PageId page);
+	// Viewer position in mip 0 texels, height above the texture plane included. Pages closer than mip0Distance texels
+	// get mip 0, every doubling of the distance drops a mip.
+	void RequestByDistance(float viewerX, float viewerY, float viewerHeight, float mip0Distance);
+	std::vector<PageLoad> Update();
+
+	// Resident pages keep their slot but are loaded again the next time they are requested, for when the source
+	// texture changed
+	void InvalidateAll();
+
+	std::span<const uint32_t> GetIndirection() const
+	{
+		return Indirection;
+	}
+	// Returns an empty rect when nothing changed
+	Rect TakeIndirectionDirtyRect();
+
+	bool IsResident(PageId page) const
+	{
+		return Resident.contains(Key(page));
+	}
+	Stats const& GetStats() const
+	{
+		return FrameStats;
+	}
+	Settings const& GetSettings() const
+	{
+		return Config;
+	}
+	uint32_t GetMipCount() const
+	{
+		return MipCount;
+	}
+	uint32_t GetPagesX(uint32_t mip = 0) const
+	{
+		return PagesX >> mip;
+	}
+	uint32_t GetPagesY(uint32_t mip = 0) const
+	{
+		return PagesY >> mip;
+	}
+
+  private:
+	static constexpr uint32_t NoSlot = ~0u;
+
+	struct Slot
+	{
+		PageId Page;
+		bool Occupied = false;
+		bool Pinned = false;
+		bool Stale = false;
+		uint64_t LastRequested = 0;
+		// Unpinned occupied slots form a list, most recently requested first
+		uint32_t Prev = NoSlot, Next = NoSlot;
+	};
+
+	static uint64_t Key(PageId page)
+	{
+		return uint64_t(page.Mip) << 48 | uint64_t(page.Y) << 24 | page.X;
+	}
+
+	uint32_t AcquireSlot();
+	void Evict(uint32_t slot);
+	void MakeResident(PageId page, uint32_t slot, bool pinned);
+	void Touch(uint32_t slot);
+	void Unlink(uint32_t slot);
+	void PushFront(uint32_t slot);
+	void RequestSubtree(PageId page, float viewerX, float viewerY, float viewerHeight, float mip0Distance);
+	// Points the footprint of page at entry, either where it holds evictedEntry or, when loading, where it holds a
+	// coarser page
+	void UpdateIndirection(PageId page, uint32_t entry, uint32_t evictedEntry);
+
+	Settings Config;
+	uint32_t PagesX = 0, PagesY = 0, MipCount = 0;
+	uint64_t Frame = 0;
+
+	std::vector<Slot> Slots;
+	std::vector<uint32_t> FreeSlots;
+	uint32_t LruHead = NoSlot, LruTail = NoSlot;
+	std::unordered_map<uint64_t, uint32_t> Resident;
+
+	std::vector<uint32_t> PinnedSlots;
+	std::vector<PageId> Pending;
+	std::unordered_set<uint64_t> PendingKeys;
+	std::vector<uint32_t> Reloads;
+
+	std::vector<uint32_t> Indirection;
+	uint32_t DirtyMinX = ~0u, DirtyMinY = ~0u, DirtyMaxX = 0, DirtyMaxY = 0;
+	Stats FrameStats;
+};
+
+} // namespace rad
@@ -155,8 +155,9 @@ void UpdateGame(float deltaTime, RenderFrameRecord& frameRecord)
 	g_EnttSystems->ViewpointControllerSystem.Update(g_EnttRegistry, InputManager::Get(), deltaTime, g_Renderer);
 	g_EnttSystems->CameraSystem.Update(g_EnttRegistry, frameRecord);
 	g_EnttSystems->LightSystem.Update(g_EnttRegistry, frameRecord);
-	g_EnttSystems->StaticRenderSystem.Update(g_EnttRegistry, frameRecord);
-	g_EnttSystems->UISystem.Update(g_EnttRegistry, g_Renderer);
+	g_Renderer.ModelManager->Update(frameRecord);
+	g_EnttSystems->StaticRenderSystem.Update(g_EnttRegistry, *g_Renderer.ModelManager, frameRecord);
+	g_EnttSystems->UISystem.Update(g_EnttRegistry, g_Renderer, g_EnttSystems->StaticRenderSystem);
 }
 
 bool InitRenderer(HWND window, uint32_t width, uint32_t height)
@@ -166,30 +167,13 @@ bool InitRenderer(HWND window, uint32_t width, uint32_t height)
 
 void LoadSceneData()
 {
-	OptionalRef<ObjModel> sponzaObj{};
-	g_Renderer.FrameIndependentCommand(
-		[&](CommandContext& commmandCtx)
-		{ sponzaObj = g_Renderer.ModelManager->LoadModel(RAD_SPONZA_DIR "sponza.obj", commmandCtx); });
-	if (!sponzaObj)
-	{
-		std::cout << "Failed to load sponza model" << std::endl;
-		return;
-	}
 	entt::entity sponzaRoot = g_EnttRegistry.create();
 	g_EnttRegistry.emplace<ecs::CEntityInfo>(sponzaRoot, "SponzaRoot");
 	auto& rootTransform = g_EnttRegistry.emplace<ecs::CSceneTransform>(sponzaRoot, sponzaRoot);
 	rootTransform.SetTransform(ecs::Transform{.Scale = glm::vec3(0.01f)});
-	for (auto& [name, meshInfo] : sponzaObj->Meshes)
-	{
-		entt::entity mesh = g_EnttRegistry.create();
-		g_EnttRegistry.emplace<ecs::CEntityInfo>(mesh, name);
-		auto& meshTransform = g_EnttRegistry.emplace<ecs::CSceneTransform>(mesh, mesh);
-		meshTransform.SetParent(&rootTransform);
-		assert(meshInfo.Model && meshInfo.Material);
-		g_EnttRegistry.emplace<ecs::CStaticRenderable>(mesh, ecs::CStaticRenderable{.Vertices = *meshInfo.Model,
-																					.Indices = meshInfo.Indices,
-																					.Material = *meshInfo.Material});
-	}
+	// Streams in while the scene renders, its meshes appear once the model is ready
+	g_EnttRegistry.emplace<ecs::CModelInstance>(sponzaRoot,
+												g_Renderer.ModelManager->LoadModelAsync(RAD_SPONZA_DIR "sponza.obj"));
 
 	{
 		auto& terrainSystem = g_EnttSystems->TerrainErosionSystem;
@@ -203,8 +187,8 @@ void LoadSceneData()
 		auto& erosionParams = g_EnttRegistry.emplace<proc::CErosionParameters>(terrainEnt, proc::CErosionParameters{});
 		auto& terrainRenderable = g_EnttRegistry.emplace<proc::CTerrainRenderable>(
 			terrainEnt, terrainSystem.CreateTerrainRenderable(terrain));
-		auto& waterRenderable =
-			g_EnttRegistry.emplace<proc::CWaterRenderable>(terrainEnt, terrainSystem.CreateWaterRenderable(terrain));
+		auto& waterRenderable = g_EnttRegistry.emplace<proc::CWaterRenderable>(
+			terrainEnt, terrainSystem.CreateWaterRenderable(terrain, indexedPlane));
 
 		terrainSystem.GenerateBaseHeightMap(cmdRec, terrain, erosionParams, terrainRenderable, waterRenderable);
 
@@ -243,12 +227,6 @@ void LoadSceneData()
 		g_Renderer.ViewableTextures.emplace("TextureSoftnessMap",
 											std::pair<Ref<DXTexture>, DescriptorAllocationView>{
 												*terrain.SoftnessMap, terrain.SoftnessMap->SRV.GetView()});
-		g_Renderer.ViewableTextures.emplace("TerrainThermalPipe1",
-											std::pair<Ref<DXTexture>, DescriptorAllocationView>{
-												*terrain.ThermalPipe1, terrain.ThermalPipe1->SRV.GetView()});
-		g_Renderer.ViewableTextures.emplace("TerrainThermalPipe2",
-											std::pair<Ref<DXTexture>, DescriptorAllocationView>{
-												*terrain.ThermalPipe2, terrain.ThermalPipe2->SRV.GetView()});
 		g_Renderer.ViewableTextures.emplace("TerrainAlbedoMap", std::pair<Ref<DXTexture>, DescriptorAllocationView>{
 																	*terrainRenderable.TerrainAlbedoTex,
 																	terrainRenderable.TerrainAlbedoTex->SRV.GetView()});
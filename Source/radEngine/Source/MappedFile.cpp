@@ -0,0 +1,84 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace rad
+{
+
+MappedFile::MappedFile(std::filesystem::path const& path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+							  FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+	{
+		// The view keeps the mapping and the file alive after their handles are closed
+		if (HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr))
+		{
+			if (void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))
+			{
+				Data = static_cast<std::byte const*>(view);
+				Size = size_t(size.QuadPart);
+			}
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return;
+	struct stat info;
+	if (fstat(file, &info) == 0 && info.st_size > 0)
+	{
+		void* view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (view != MAP_FAILED)
+		{
+			Data = static_cast<std::byte const*>(view);
+			Size = size_t(info.st_size);
+		}
+	}
+	close(file);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	if (!Data)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(Data);
+#else
+	munmap(const_cast<std::byte*>(Data), Size);
+#endif
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: Data(std::exchange(other.Data, nullptr)), Size(std::exchange(other.Size, 0))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		this->~MappedFile();
+		Data = std::exchange(other.Data, nullptr);
+		Size = std::exchange(other.Size, 0);
+	}
+	return *this;
+}
+
+} // namespace rad
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace rad
+{
+
+// Read only mapping of a whole file, invalid when the file is missing or empty
+struct MappedFile
+{
+	MappedFile() = default;
+	explicit MappedFile(std::filesystem::path const& path);
+	~MappedFile();
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	bool IsValid() const
+	{
+		return Data != nullptr;
+	}
+	std::span<const std::byte> GetBytes() const
+	{
+		return {Data, Size};
+	}
+
+  private:
+	std::byte const* Data = nullptr;
+	size_t Size = 0;
+};
+
+} // namespace rad
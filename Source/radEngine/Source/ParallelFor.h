@@ -0,0 +1,46 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace rad
+{
+
+inline uint32_t DefaultThreadCount()
+{
+	return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs fn(i) for every i in [0, count) on up to threadCount threads, the calling thread included. Items are handed out
+// one at a time, so uneven items balance out. threadCount 0 picks DefaultThreadCount().
+template <typename Fn>
+void ParallelFor(uint32_t count, uint32_t threadCount, Fn&& fn)
+{
+	if (threadCount == 0)
+		threadCount = DefaultThreadCount();
+	threadCount = std::min(threadCount, count);
+	if (threadCount <= 1)
+	{
+		for (uint32_t i = 0; i < count; i++)
+			fn(i);
+		return;
+	}
+
+	std::atomic<uint32_t> next = 0;
+	auto worker = [&]()
+	{
+		for (uint32_t i = next.fetch_add(1, std::memory_order_relaxed); i < count;
+			 i = next.fetch_add(1, std::memory_order_relaxed))
+			fn(i);
+	};
+	std::vector<std::jthread> threads;
+	threads.reserve(threadCount - 1);
+	for (uint32_t t = 1; t < threadCount; t++)
+		threads.emplace_back(worker);
+	worker();
+}
+
+} // namespace rad
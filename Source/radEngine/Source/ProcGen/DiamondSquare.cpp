@@ -0,0 +1,142 @@
+#include "DiamondSquare.h"
+
+#include <cassert>
+#include <cmath>
+
+namespace rad::proc
+{
+
+static size_t GetIndex(size_t x, size_t y, size_t width)
+{
+	return x + y * width;
+}
+
+template <typename T> struct MapVector : std::vector<T>
+{
+	// Signed, the steps probe neighbours that may lie outside the map
+	int X, Y;
+	MapVector(int x, int y) : std::vector<T>(size_t(x) * y), X(x), Y(y) {}
+	T& operator()(size_t x, size_t y)
+	{
+		return (*this)[GetIndex(x, y, X)];
+	}
+};
+
+// from https://medium.com/@nickobrien/diamond-square-algorithm-explanation-and-c-implementation-5efa891e486f
+static float random(std::mt19937& generator)
+{
+	std::uniform_real_distribution<float> distribution(0.f, 1.f);
+	return distribution(generator);
+}
+
+static float randomRange(std::mt19937& generator, float range)
+{
+	return (random(generator) * 2.f - 1.f) * range;
+}
+
+static void diamondStep(MapVector<float>& map, int x, int y, int reach, float roughness, std::mt19937& generator)
+{
+	int count = 0;
+	float avg = 0.0f;
+	if (x - reach >= 0)
+	{
+		avg += map(x - reach, y);
+		count++;
+	}
+	if (x + reach < map.X)
+	{
+		avg += map(x + reach, y);
+		count++;
+	}
+	if (y - reach >= 0)
+	{
+		avg += map(x, y - reach);
+		count++;
+	}
+	if (y + reach < map.Y)
+	{
+		avg += map(x, y + reach);
+		count++;
+	}
+	avg /= (float)count;
+	avg += randomRange(generator, reach / (float)map.X) * roughness;
+	map(x, y) = avg;
+}
+
+static void squareStep(MapVector<float>& map, int x, int y, int reach, float roughness, std::mt19937& generator)
+{
+	int count = 0;
+	float avg = 0.0f;
+	if (x - reach >= 0 && y - reach >= 0)
+	{
+		avg += map(x - reach, y - reach);
+		count++;
+	}
+	if (x - reach >= 0 && y + reach < map.Y)
+	{
+		avg += map(x - reach, y + reach);
+		count++;
+	}
+	if (x + reach < map.X && y - reach >= 0)
+	{
+		avg += map(x + reach, y - reach);
+		count++;
+	}
+	if (x + reach < map.X && y + reach < map.Y)
+	{
+		avg += map(x + reach, y + reach);
+		count++;
+	}
+	avg /= (float)count;
+	avg += randomRange(generator, reach / (float)(map.X - 1)) * roughness;
+	map(x, y) = avg;
+}
+
+static void diamondSquare(MapVector<float>& map, int size, float roughness, std::mt19937& generator)
+{
+	int half = size / 2;
+	if (half < 1)
+		return;
+	// square steps
+	for (int y = half; y < map.Y; y += size)
+		for (int x = half; x < map.X; x += size)
+			squareStep(map, x % map.X, y % map.Y, half, roughness, generator);
+	// diamond steps
+	int col = 0;
+	for (int x = 0; x < map.X; x += half)
+	{
+		col++;
+		// If this is an odd column.
+		if (col % 2 == 1)
+			for (int y = half; y < map.Y; y += size)
+				diamondStep(map, x % map.X, y % map.Y, half, roughness, generator);
+		else
+			for (int y = 0; y < map.Y; y += size)
+				diamondStep(map, x % map.X, y % map.Y, half, roughness, generator);
+	}
+	diamondSquare(map, size / 2, roughness, generator);
+}
+
+std::vector<float> CreateDiamondSquareHeightMap(uint32_t width, float roughness, std::mt19937& generator)
+{
+	// Make sure width is a power of two
+	assert(std::log2(width) == std::floor(std::log2(width)));
+
+	width = width + 1;
+	MapVector<float> heightMap{int(width), int(width)};
+	heightMap[0] = random(generator);
+	heightMap[width - 1] = random(generator);
+	heightMap[width * (width - 1)] = random(generator);
+	heightMap[width * width - 1] = random(generator);
+
+	diamondSquare(heightMap, width - 1, roughness, generator);
+
+	// Get rid of rightmost column and bottom row to make it a power of two
+	std::vector<float> heightMapVals((width - 1) * (width - 1));
+	for (uint32_t y = 0; y < width - 1; y++)
+		for (uint32_t x = 0; x < width - 1; x++)
+			heightMapVals[GetIndex(x, y, width - 1)] = heightMap(x, y);
+	return heightMapVals;
+}
+
+} // namespace rad::proc
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace rad::proc
+{
+
+// width x width heights in roughly [0, 1], width a power of two. Consumes generator in a fixed order, so a seeded
+// generator always gives the same map.
+std::vector<float> CreateDiamondSquareHeightMap(uint32_t width, float roughness, std::mt19937& generator);
+
+} // namespace rad::proc
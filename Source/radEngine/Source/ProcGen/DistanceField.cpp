@@ -0,0 +1,187 @@
+#include "DistanceField.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace rad::proc
+{
+
+static constexpr float Infinity = std::numeric_limits<float>::infinity();
+// Columns swept together by one task, wide enough that each row read covers whole cache lines
+static constexpr uint32_t ColumnStripWidth = 64;
+static constexpr uint32_t RowsPerTask = 16;
+
+/*
+Lower envelope of the parabolas (q - i)^2 + f(i) sampled at every q. v and z are scratch of n and n + 1 entries.
+Squared distances pass 2^24 on maps over 4096 cells wide, where floats no longer hold them exactly and the parabola
+intersections go wrong, so the envelope is built in doubles.
+*/
+static void DistanceTransform1D(std::span<const double> f, std::span<uint32_t> v, std::span<double> z,
+								std::span<double> output)
+{
+	constexpr double DoubleInfinity = std::numeric_limits<double>::infinity();
+	uint32_t n = uint32_t(f.size());
+	uint32_t k = 0;
+	uint32_t first = 0;
+	while (first < n && f[first] == DoubleInfinity)
+		first++;
+	if (first == n)
+	{
+		std::fill(output.begin(), output.end(), DoubleInfinity);
+		return;
+	}
+
+	v[0] = first;
+	z[0] = -DoubleInfinity;
+	z[1] = DoubleInfinity;
+	auto intersect = [&](uint32_t q, uint32_t p)
+	{ return ((f[q] + double(q) * q) - (f[p] + double(p) * p)) / (2.0 * (double(q) - p)); };
+	for (uint32_t q = first + 1; q < n; q++)
+	{
+		if (f[q] == DoubleInfinity)
+			continue;
+		double s = intersect(q, v[k]);
+		while (s <= z[k])
+			s = intersect(q, v[--k]);
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = DoubleInfinity;
+	}
+
+	k = 0;
+	for (uint32_t q = 0; q < n; q++)
+	{
+		while (z[k + 1] < double(q))
+			k++;
+		double d = double(q) - v[k];
+		output[q] = d * d + f[v[k]];
+	}
+}
+
+// Vertical distance in cells to the closest cell of each column whose mask is set (or clear, with invert)
+static void ColumnDistances(std::span<const uint8_t> mask, bool invert, uint32_t width, uint32_t height,
+							uint32_t threadCount, std::span<float> distances)
+{
+	uint32_t stripCount = (width + ColumnStripWidth - 1) / ColumnStripWidth;
+	ParallelFor(stripCount, threadCount,
+				[&](uint32_t strip)
+				{
+					uint32_t x0 = strip * ColumnStripWidth, x1 = std::min(x0 + ColumnStripWidth, width);
+					for (uint32_t x = x0; x < x1; x++)
+						distances[x] = bool(mask[x]) != invert ? 0.0f : Infinity;
+					for (uint32_t y = 1; y < height; y++)
+					{
+						size_t row = size_t(y) * width;
+						for (uint32_t x = x0; x < x1; x++)
+							distances[row + x] =
+								bool(mask[row + x]) != invert ? 0.0f : distances[row - width + x] + 1.0f;
+					}
+					for (uint32_t y = height - 1; y-- > 0;)
+					{
+						size_t row = size_t(y) * width;
+						for (uint32_t x = x0; x < x1; x++)
+							distances[row + x] = std::min(distances[row + x], distances[row + width + x] + 1.0f);
+					}
+				});
+}
+
+// Runs the row pass over the column distances and hands every row's squared distances to store(y, row)
+template <typename Fn>
+static void RowDistances(std::span<const float> columnDistances, uint32_t width, uint32_t height,
+						 uint32_t threadCount, Fn&& store)
+{
+	uint32_t taskCount = (height + RowsPerTask - 1) / RowsPerTask;
+	ParallelFor(taskCount, threadCount,
+				[&](uint32_t task)
+				{
+					std::vector<double> f(width), row(width);
+					std::vector<uint32_t> v(width);
+					std::vector<double> z(width + 1);
+					uint32_t y1 = std::min((task + 1) * RowsPerTask, height);
+					for (uint32_t y = task * RowsPerTask; y < y1; y++)
+					{
+						auto columns = columnDistances.subspan(size_t(y) * width, width);
+						for (uint32_t x = 0; x < width; x++)
+							f[x] = double(columns[x]) * columns[x];
+						DistanceTransform1D(f, v, z, row);
+						store(y, std::span<const double>(row));
+					}
+				});
+}
+
+std::vector<double> ComputeSquaredDistance(std::span<const uint8_t> mask, uint32_t width, uint32_t height,
+										   uint32_t threadCount)
+{
+	size_t cellCount = size_t(width) * height;
+	assert(mask.size() >= cellCount);
+	std::vector<double> distances(cellCount);
+	if (cellCount == 0)
+		return distances;
+
+	std::vector<float> columns(cellCount);
+	ColumnDistances(mask, false, width, height, threadCount, columns);
+	RowDistances(columns, width, height, threadCount, [&](uint32_t y, std::span<const double> row)
+				 { std::ranges::copy(row, distances.begin() + size_t(y) * width); });
+	return distances;
+}
+
+std::vector<float> ComputeSignedDistance(std::span<const uint8_t> mask, uint32_t width, uint32_t height,
+										 float cellLength, uint32_t threadCount)
+{
+	size_t cellCount = size_t(width) * height;
+	assert(mask.size() >= cellCount);
+	std::vector<float> distances(cellCount);
+	if (cellCount == 0)
+		return distances;
+
+	// Each side measures to the closest cell center on the other side, the edge lies half a cell before it
+	std::vector<float> columns(cellCount);
+	for (bool inside : {false, true})
+	{
+		ColumnDistances(mask, inside, width, height, threadCount, columns);
+		RowDistances(columns, width, height, threadCount,
+					 [&](uint32_t y, std::span<const double> row)
+					 {
+						 size_t offset = size_t(y) * width;
+						 for (uint32_t x = 0; x < width; x++)
+							 if (bool(mask[offset + x]) == inside)
+							 {
+								 float distance = float((std::sqrt(row[x]) - 0.5) * cellLength);
+								 distances[offset + x] = inside ? -distance : distance;
+							 }
+					 });
+	}
+	return distances;
+}
+
+std::vector<uint8_t> MaskAboveThreshold(std::span<const float> values, float threshold)
+{
+	std::vector<uint8_t> mask(values.size());
+	for (size_t i = 0; i < values.size(); i++)
+		mask[i] = values[i] >= threshold;
+	return mask;
+}
+
+std::vector<uint8_t> MaskSteeperThan(std::span<const float> heights, uint32_t width, uint32_t height,
+									 float cellLength, float maxSlope)
+{
+	assert(heights.size() >= size_t(width) * height);
+	std::vector<uint8_t> mask(size_t(width) * height);
+	float maxRiseSquared = maxSlope * maxSlope * 4.0f * cellLength * cellLength;
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+		{
+			auto at = [&](uint32_t cx, uint32_t cy) { return heights[cx + size_t(cy) * width]; };
+			float dx = at(std::min(x + 1, width - 1), y) - at(x ? x - 1 : 0, y);
+			float dy = at(x, std::min(y + 1, height - 1)) - at(x, y ? y - 1 : 0);
+			mask[x + size_t(y) * width] = dx * dx + dy * dy > maxRiseSquared;
+		}
+	return mask;
+}
+
+} // namespace rad::proc
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rad::proc
+{
+
+/*
+Exact Euclidean distance transforms of boolean masks over a width x height grid, in cells. The column pass sweeps each
+column down and up for the distance to the closest set cell in it, the row pass then takes the lower envelope of the
+column parabolas (Felzenszwalb & Huttenlocher). Both passes are split over threads, columns in strips of adjacent
+columns so the sweeps read whole rows.
+*/
+
+// Squared distance of every cell to the closest cell with mask != 0, 0 on the mask. Without any set cell every
+// distance is infinite. Doubles, floats stop holding the integer squares exactly past 4096 cells.
+std::vector<double> ComputeSquaredDistance(std::span<const uint8_t> mask, uint32_t width, uint32_t height,
+										   uint32_t threadCount = 0);
+
+// Distance to the mask's edge scaled by cellLength, positive outside the mask and negative inside. The edge runs
+// between cell centers, so the cells on either side of it are +-0.5 cells away and the zero crossing is the shoreline.
+std::vector<float> ComputeSignedDistance(std::span<const uint8_t> mask, uint32_t width, uint32_t height,
+										 float cellLength = 1.0f, uint32_t threadCount = 0);
+
+// mask = values >= threshold, for WaterHeightMap or SedimentMap
+std::vector<uint8_t> MaskAboveThreshold(std::span<const float> values, float threshold);
+// mask = slope of the height map above maxSlope (rise over run, central differences)
+std::vector<uint8_t> MaskSteeperThan(std::span<const float> heights, uint32_t width, uint32_t height,
+									 float cellLength, float maxSlope);
+
+} // namespace rad::proc
@@ -0,0 +1,43 @@
+#include "ErosionBudget.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rad::proc
+{
+
+void ErosionBudgetController::AddSample(uint32_t iterations, double milliseconds)
+{
+	if (iterations == 0 || !(milliseconds >= 0.0))
+		return;
+	double sample = milliseconds / iterations;
+	if (!MsPerIteration)
+		MsPerIteration = sample;
+	else
+		MsPerIteration = *MsPerIteration + (sample - *MsPerIteration) * std::clamp(Smoothing, 0.0f, 1.0f);
+	LastSampleIterations = iterations;
+}
+
+uint32_t ErosionBudgetController::GetIterationCount(float budgetMs) const
+{
+	if (!MsPerIteration || *MsPerIteration <= 0.0)
+		return MinIterations;
+	double fit = std::floor(std::max(0.0f, budgetMs) / *MsPerIteration);
+	double growthLimit = std::max<double>(MinIterations, std::ceil(LastSampleIterations * MaxGrowthFactor));
+	return uint32_t(std::clamp<double>(std::min(fit, growthLimit), MinIterations, MaxIterations));
+}
+
+uint32_t ErosionBudgetController::NextIterationCount(float budgetMs)
+{
+	LastIterationCount = GetIterationCount(budgetMs);
+	return LastIterationCount;
+}
+
+void ErosionBudgetController::Reset()
+{
+	MsPerIteration = std::nullopt;
+	LastSampleIterations = 0;
+	LastIterationCount = 0;
+}
+
+} // namespace rad::proc
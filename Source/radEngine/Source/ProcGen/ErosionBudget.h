@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+namespace rad::proc
+{
+
+/*
+Picks how many erosion iterations to run next frame so that the measured GPU time stays within a budget. It knows
+nothing about D3D12, it is only fed (iterations, milliseconds) pairs once the GPU timings of a frame are available.
+*/
+struct ErosionBudgetController
+{
+	// Weight of a new sample in the exponential moving average of the per-iteration cost
+	float Smoothing = 0.2f;
+	uint32_t MinIterations = 1;
+	uint32_t MaxIterations = 1024;
+	// Limits the count to this many times the iterations of the last sample. Samples arrive frames late, limiting the
+	// growth per sample rather than per frame keeps the count from compounding while they are in flight.
+	float MaxGrowthFactor = 2.0f;
+
+	void AddSample(uint32_t iterations, double milliseconds);
+	// Iterations that fit budgetMs, for a run that isn't timed
+	uint32_t GetIterationCount(float budgetMs) const;
+	// Same, remembered as the count of the timed run this frame
+	uint32_t NextIterationCount(float budgetMs);
+	void Reset();
+
+	std::optional<double> GetMsPerIteration() const
+	{
+		return MsPerIteration;
+	}
+	uint32_t GetLastIterationCount() const
+	{
+		return LastIterationCount;
+	}
+
+  private:
+	std::optional<double> MsPerIteration = std::nullopt;
+	uint32_t LastSampleIterations = 0;
+	uint32_t LastIterationCount = 0;
+};
+
+} // namespace rad::proc
@@ -0,0 +1,493 @@
+#include "HeightfieldCodec.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace rad::proc
+{
+
+static constexpr uint32_t Magic = 0x31464852; // "RHF1"
+static constexpr uint32_t HeaderBytes = 32;
+// Regular contexts are indexed by the bit width of the local gradient activity, halved. Context 0, a flat
+// neighbourhood, switches to run mode where the number of cells repeating the west neighbour is coded instead.
+static constexpr uint32_t RegularContextCount = 18;
+static constexpr uint32_t RunContext = RegularContextCount;
+static constexpr uint32_t ContextCount = RegularContextCount + 1;
+// Residuals whose unary part would be longer than this are stored raw
+static constexpr uint32_t UnaryLimit = 24;
+
+enum class Predictor : uint32_t
+{
+	Gradient = 0,
+	Plane = 1,
+};
+
+namespace
+{
+
+uint32_t FloatToOrdered(float value)
+{
+	uint32_t bits = std::bit_cast<uint32_t>(value);
+	return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+float OrderedToFloat(uint32_t ordered)
+{
+	return std::bit_cast<float>(ordered & 0x80000000u ? ordered & 0x7FFFFFFFu : ~ordered);
+}
+
+struct BitWriter
+{
+	std::vector<uint8_t> Bytes;
+	uint64_t Bits = 0;
+	uint32_t Count = 0;
+
+	void Write(uint32_t value, uint32_t bitCount)
+	{
+		assert(bitCount <= 32);
+		Bits |= uint64_t(value) << Count;
+		Count += bitCount;
+		while (Count >= 8)
+		{
+			Bytes.push_back(uint8_t(Bits));
+			Bits >>= 8;
+			Count -= 8;
+		}
+	}
+	void Flush()
+	{
+		if (Count)
+			Bytes.push_back(uint8_t(Bits));
+		Bits = 0;
+		Count = 0;
+	}
+};
+
+struct BitReader
+{
+	std::span<const uint8_t> Bytes;
+	size_t Position = 0;
+	uint64_t Bits = 0;
+	uint32_t Count = 0;
+
+	void Refill()
+	{
+		while (Count <= 56)
+		{
+			// Past the end the stream reads as zeros, Overrun() tells the caller
+			uint64_t byte = Position < Bytes.size() ? Bytes[Position] : 0;
+			Position++;
+			Bits |= byte << Count;
+			Count += 8;
+		}
+	}
+	uint32_t Read(uint32_t bitCount)
+	{
+		if (bitCount == 0)
+			return 0;
+		if (Count < bitCount)
+			Refill();
+		uint32_t value = uint32_t(Bits & ((uint64_t(1) << bitCount) - 1));
+		Bits >>= bitCount;
+		Count -= bitCount;
+		return value;
+	}
+	// Number of zero bits before the next one bit, which is consumed too. Stops at UnaryLimit.
+	uint32_t ReadUnary()
+	{
+		if (Count <= UnaryLimit)
+			Refill();
+		uint32_t zeros = std::min<uint32_t>(std::countr_zero(Bits), UnaryLimit);
+		Bits >>= zeros + 1;
+		Count -= zeros + 1;
+		return zeros;
+	}
+	bool Overrun() const
+	{
+		return Position > Bytes.size() + 8;
+	}
+};
+
+// Golomb-Rice parameter per context from the running mean of the coded values, as in JPEG-LS
+struct RiceContexts
+{
+	std::array<uint64_t, ContextCount> Sums;
+	std::array<uint32_t, ContextCount> Counts;
+
+	RiceContexts()
+	{
+		Sums.fill(16);
+		Counts.fill(1);
+	}
+	// Smallest k with Counts << k >= Sums, which is one of the two around the difference of their bit widths
+	uint32_t Parameter(uint32_t context) const
+	{
+		uint64_t sum = Sums[context], count = Counts[context];
+		int k = std::max(int(std::bit_width(sum)) - int(std::bit_width(count)), 0);
+		if ((count << k) < sum)
+			k++;
+		return uint32_t(std::min(k, 31));
+	}
+	void Update(uint32_t context, uint32_t value)
+	{
+		Sums[context] += value;
+		if (++Counts[context] == 64)
+		{
+			Sums[context] >>= 1;
+			Counts[context] >>= 1;
+		}
+	}
+};
+
+uint32_t ZigZag(uint32_t residual)
+{
+	return (residual << 1) ^ uint32_t(int32_t(residual) >> 31);
+}
+
+uint32_t UnZigZag(uint32_t value)
+{
+	return (value >> 1) ^ (0u - (value & 1));
+}
+
+void WriteRice(BitWriter& writer, RiceContexts& contexts, uint32_t context, uint32_t value)
+{
+	uint32_t k = contexts.Parameter(context);
+	uint32_t unary = value >> k;
+	if (unary < UnaryLimit)
+	{
+		writer.Write(1u << unary, unary + 1);
+		writer.Write(value & uint32_t((uint64_t(1) << k) - 1), k);
+	}
+	else
+	{
+		writer.Write(1u << UnaryLimit, UnaryLimit + 1);
+		writer.Write(value, 32);
+	}
+	contexts.Update(context, value);
+}
+
+uint32_t ReadRice(BitReader& reader, RiceContexts& contexts, uint32_t context)
+{
+	uint32_t k = contexts.Parameter(context);
+	uint32_t unary = reader.ReadUnary();
+	uint32_t value = unary < UnaryLimit ? (unary << k) | reader.Read(k) : reader.Read(32);
+	contexts.Update(context, value);
+	return value;
+}
+
+struct Neighbourhood
+{
+	int64_t W, N, NW, NE, WW, NN, NNE;
+};
+
+// Missing neighbours at the tile's edges are replaced by the closest available ones
+Neighbourhood GatherNeighbours(uint32_t const* symbols, uint32_t x, uint32_t y, uint32_t tileWidth)
+{
+	auto at = [&](uint32_t cx, uint32_t cy) { return int64_t(symbols[cx + size_t(cy) * tileWidth]); };
+	Neighbourhood n;
+	n.W = x > 0 ? at(x - 1, y) : (y > 0 ? at(x, y - 1) : 0);
+	n.N = y > 0 ? at(x, y - 1) : n.W;
+	n.NW = x > 0 && y > 0 ? at(x - 1, y - 1) : n.N;
+	n.NE = y > 0 && x + 1 < tileWidth ? at(x + 1, y - 1) : n.N;
+	n.WW = x > 1 ? at(x - 2, y) : n.W;
+	n.NN = y > 1 ? at(x, y - 2) : n.N;
+	n.NNE = y > 1 && x + 1 < tileWidth ? at(x + 1, y - 2) : n.NE;
+	return n;
+}
+
+uint32_t ContextOf(Neighbourhood const& n)
+{
+	uint64_t activity = std::abs(n.W - n.NW) + std::abs(n.N - n.NW) + std::abs(n.NE - n.N);
+	return uint32_t(std::bit_width(activity) + 1) / 2;
+}
+
+// CALIC's GAP, its 80/32/8 edge thresholds assume 8-bit pixels and are scaled to the tile's gradient activity
+int64_t PredictGradient(Neighbourhood const& n, int64_t edgeThreshold)
+{
+	int64_t dh = std::abs(n.W - n.WW) + std::abs(n.N - n.NW) + std::abs(n.N - n.NE);
+	int64_t dv = std::abs(n.W - n.NW) + std::abs(n.N - n.NN) + std::abs(n.NE - n.NNE);
+	int64_t d = dv - dh;
+	if (d > edgeThreshold)
+		return n.W;
+	if (d < -edgeThreshold)
+		return n.N;
+	int64_t prediction = (n.W + n.N) / 2 + (n.NE - n.NW) / 4;
+	int64_t strong = edgeThreshold * 2 / 5, weak = edgeThreshold / 10;
+	if (d > strong)
+		prediction = (prediction + n.W) / 2;
+	else if (d > weak)
+		prediction = (3 * prediction + n.W) / 4;
+	else if (d < -strong)
+		prediction = (prediction + n.N) / 2;
+	else if (d < -weak)
+		prediction = (3 * prediction + n.N) / 4;
+	return prediction;
+}
+
+int64_t PredictPlane(Neighbourhood const& n)
+{
+	return n.W + n.N - n.NW;
+}
+
+uint32_t Predict(Predictor predictor, Neighbourhood const& n, int64_t edgeThreshold)
+{
+	int64_t prediction = predictor == Predictor::Gradient ? PredictGradient(n, edgeThreshold) : PredictPlane(n);
+	return uint32_t(std::clamp<int64_t>(prediction, 0, UINT32_MAX));
+}
+
+// Mean of the GAP gradient sums over the tile
+uint32_t MeasureEdgeThreshold(uint32_t const* symbols, uint32_t tileWidth, uint32_t tileHeight)
+{
+	uint64_t total = 0;
+	for (uint32_t y = 0; y < tileHeight; y++)
+		for (uint32_t x = 0; x < tileWidth; x++)
+		{
+			auto n = GatherNeighbours(symbols, x, y, tileWidth);
+			total += std::abs(n.W - n.WW) + std::abs(n.N - n.NW) + std::abs(n.N - n.NE) + std::abs(n.W - n.NW) +
+					 std::abs(n.N - n.NN) + std::abs(n.NE - n.NNE);
+		}
+	uint64_t mean = total / std::max<uint64_t>(uint64_t(tileWidth) * tileHeight, 1);
+	return uint32_t(std::clamp<uint64_t>(mean, 10, UINT32_MAX));
+}
+
+std::vector<uint8_t> EncodeTileSymbols(uint32_t const* symbols, uint32_t tileWidth, uint32_t tileHeight,
+									   Predictor predictor, uint32_t edgeThreshold)
+{
+	BitWriter writer;
+	writer.Write(uint32_t(predictor), 8);
+	writer.Write(edgeThreshold, 32);
+	RiceContexts contexts;
+	for (uint32_t y = 0; y < tileHeight; y++)
+	{
+		uint32_t const* row = symbols + size_t(y) * tileWidth;
+		for (uint32_t x = 0; x < tileWidth; x++)
+		{
+			auto n = GatherNeighbours(symbols, x, y, tileWidth);
+			uint32_t context = ContextOf(n);
+			if (context == 0)
+			{
+				uint32_t run = 0;
+				while (x + run < tileWidth && row[x + run] == n.W)
+					run++;
+				WriteRice(writer, contexts, RunContext, run);
+				x += run;
+				if (x == tileWidth)
+					break;
+				// The cell that ended the run is coded as usual
+				n = GatherNeighbours(symbols, x, y, tileWidth);
+				context = ContextOf(n);
+			}
+			WriteRice(writer, contexts, context, ZigZag(row[x] - Predict(predictor, n, edgeThreshold)));
+		}
+	}
+	writer.Flush();
+	return std::move(writer.Bytes);
+}
+
+template <Predictor predictor>
+bool DecodeTileSymbols(BitReader& reader, uint32_t* symbols, uint32_t tileWidth, uint32_t tileHeight,
+					   int64_t edgeThreshold)
+{
+	RiceContexts contexts;
+	for (uint32_t y = 0; y < tileHeight; y++)
+	{
+		uint32_t* row = symbols + size_t(y) * tileWidth;
+		for (uint32_t x = 0; x < tileWidth; x++)
+		{
+			auto n = GatherNeighbours(symbols, x, y, tileWidth);
+			uint32_t context = ContextOf(n);
+			if (context == 0)
+			{
+				uint32_t run = ReadRice(reader, contexts, RunContext);
+				if (run > tileWidth - x)
+					return false;
+				std::fill_n(row + x, run, uint32_t(n.W));
+				x += run;
+				if (x == tileWidth)
+					break;
+				n = GatherNeighbours(symbols, x, y, tileWidth);
+				context = ContextOf(n);
+			}
+			row[x] = Predict(predictor, n, edgeThreshold) + UnZigZag(ReadRice(reader, contexts, context));
+		}
+	}
+	return !reader.Overrun();
+}
+
+template <typename T> void WriteValue(std::vector<uint8_t>& bytes, size_t offset, T value)
+{
+	std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+template <typename T> T ReadValue(std::span<const uint8_t> bytes, size_t offset)
+{
+	T value;
+	std::memcpy(&value, bytes.data() + offset, sizeof(T));
+	return value;
+}
+
+} // namespace
+
+EncodedHeightfield EncodeHeightfield(std::span<const float> values, uint32_t width, uint32_t height,
+									 HeightfieldCodecSettings const& settings)
+{
+	assert(values.size() >= size_t(width) * height);
+	assert(settings.TileSize > 0);
+	uint32_t tileSize = settings.TileSize;
+	uint32_t tilesX = (width + tileSize - 1) / tileSize, tilesY = (height + tileSize - 1) / tileSize;
+	uint32_t tileCount = tilesX * tilesY;
+
+	float offset = 0.0f, step = 0.0f;
+	bool lossy = settings.MaxError > 0.0f;
+	if (lossy && width && height)
+	{
+		auto [low, high] = std::ranges::minmax(values.first(size_t(width) * height));
+		// Decoded values get rounded to float, the buckets are narrowed by that rounding to keep the bound. Maps too
+		// wide for 32-bit bucket indices or bounds below float precision are stored losslessly.
+		float largest = std::max(std::abs(low), std::abs(high));
+		float rounding = std::nextafter(largest, INFINITY) - largest;
+		offset = low;
+		step = 2.0f * settings.MaxError - 2.0f * rounding;
+		lossy = step > settings.MaxError && (double(high) - low) / step < double(UINT32_MAX);
+		if (!lossy)
+			offset = step = 0.0f;
+	}
+
+	std::vector<std::vector<uint8_t>> tileStreams(tileCount);
+	ParallelFor(tileCount, settings.ThreadCount,
+				[&](uint32_t tileIndex)
+				{
+					uint32_t x0 = tileIndex % tilesX * tileSize, y0 = tileIndex / tilesX * tileSize;
+					uint32_t tileWidth = std::min(tileSize, width - x0), tileHeight = std::min(tileSize, height - y0);
+					std::vector<uint32_t> symbols(size_t(tileWidth) * tileHeight);
+					for (uint32_t y = 0; y < tileHeight; y++)
+						for (uint32_t x = 0; x < tileWidth; x++)
+						{
+							float value = values[x0 + x + size_t(y0 + y) * width];
+							symbols[x + size_t(y) * tileWidth] =
+								lossy ? uint32_t(std::llround((double(value) - offset) / step)) : FloatToOrdered(value);
+						}
+
+					uint32_t edgeThreshold = MeasureEdgeThreshold(symbols.data(), tileWidth, tileHeight);
+					auto gradient =
+						EncodeTileSymbols(symbols.data(), tileWidth, tileHeight, Predictor::Gradient, edgeThreshold);
+					auto plane =
+						EncodeTileSymbols(symbols.data(), tileWidth, tileHeight, Predictor::Plane, edgeThreshold);
+					tileStreams[tileIndex] = gradient.size() <= plane.size() ? std::move(gradient) : std::move(plane);
+				});
+
+	size_t tableOffset = HeaderBytes, dataOffset = tableOffset + (tileCount + 1) * sizeof(uint64_t);
+	size_t totalBytes = dataOffset;
+	for (auto const& stream : tileStreams)
+		totalBytes += stream.size();
+
+	EncodedHeightfield encoded;
+	auto& bytes = encoded.Bytes;
+	bytes.resize(totalBytes);
+	WriteValue(bytes, 0, Magic);
+	WriteValue(bytes, 4, width);
+	WriteValue(bytes, 8, height);
+	WriteValue(bytes, 12, tileSize);
+	WriteValue(bytes, 16, lossy ? settings.MaxError : 0.0f);
+	WriteValue(bytes, 20, offset);
+	WriteValue(bytes, 24, step);
+	WriteValue(bytes, 28, tileCount);
+	uint64_t streamOffset = 0;
+	for (uint32_t tileIndex = 0; tileIndex < tileCount; tileIndex++)
+	{
+		WriteValue(bytes, tableOffset + tileIndex * sizeof(uint64_t), streamOffset);
+		std::ranges::copy(tileStreams[tileIndex], bytes.begin() + dataOffset + streamOffset);
+		streamOffset += tileStreams[tileIndex].size();
+	}
+	WriteValue(bytes, tableOffset + tileCount * sizeof(uint64_t), streamOffset);
+	return encoded;
+}
+
+std::optional<HeightfieldDecoder> HeightfieldDecoder::Open(std::span<const uint8_t> bytes)
+{
+	if (bytes.size() < HeaderBytes || ReadValue<uint32_t>(bytes, 0) != Magic)
+		return std::nullopt;
+	HeightfieldDecoder decoder;
+	decoder.Width = ReadValue<uint32_t>(bytes, 4);
+	decoder.Height = ReadValue<uint32_t>(bytes, 8);
+	decoder.TileSize = ReadValue<uint32_t>(bytes, 12);
+	decoder.MaxError = ReadValue<float>(bytes, 16);
+	decoder.Offset = ReadValue<float>(bytes, 20);
+	decoder.Step = ReadValue<float>(bytes, 24);
+	uint32_t tileCount = ReadValue<uint32_t>(bytes, 28);
+	if (decoder.TileSize == 0 || uint64_t(decoder.GetTilesX()) * decoder.GetTilesY() != tileCount)
+		return std::nullopt;
+
+	size_t tableBytes = (size_t(tileCount) + 1) * sizeof(uint64_t);
+	if (bytes.size() < HeaderBytes + tableBytes)
+		return std::nullopt;
+	decoder.TileTable = bytes.subspan(HeaderBytes, tableBytes);
+	decoder.TileData = bytes.subspan(HeaderBytes + tableBytes);
+	uint64_t previous = 0;
+	for (uint32_t tileIndex = 0; tileIndex <= tileCount; tileIndex++)
+	{
+		uint64_t streamOffset = ReadValue<uint64_t>(decoder.TileTable, tileIndex * sizeof(uint64_t));
+		if (streamOffset < previous || streamOffset > decoder.TileData.size())
+			return std::nullopt;
+		previous = streamOffset;
+	}
+	return decoder;
+}
+
+bool HeightfieldDecoder::DecodeTile(uint32_t tileX, uint32_t tileY, float* out, size_t outRowPitch) const
+{
+	assert(tileX < GetTilesX() && tileY < GetTilesY());
+	uint32_t tileIndex = tileX + tileY * GetTilesX();
+	uint64_t begin = ReadValue<uint64_t>(TileTable, tileIndex * sizeof(uint64_t));
+	uint64_t end = ReadValue<uint64_t>(TileTable, (tileIndex + 1) * sizeof(uint64_t));
+	uint32_t tileWidth = std::min(TileSize, Width - tileX * TileSize);
+	uint32_t tileHeight = std::min(TileSize, Height - tileY * TileSize);
+
+	BitReader reader{.Bytes = TileData.subspan(begin, end - begin)};
+	auto predictor = Predictor(reader.Read(8));
+	int64_t edgeThreshold = reader.Read(32);
+
+	thread_local std::vector<uint32_t> symbols;
+	symbols.resize(size_t(tileWidth) * tileHeight);
+	bool valid = false;
+	if (predictor == Predictor::Gradient)
+		valid = DecodeTileSymbols<Predictor::Gradient>(reader, symbols.data(), tileWidth, tileHeight, edgeThreshold);
+	else if (predictor == Predictor::Plane)
+		valid = DecodeTileSymbols<Predictor::Plane>(reader, symbols.data(), tileWidth, tileHeight, edgeThreshold);
+	if (!valid)
+		return false;
+
+	bool lossy = Step > 0.0f;
+	for (uint32_t y = 0; y < tileHeight; y++)
+	{
+		float* row = out + y * outRowPitch;
+		uint32_t const* rowSymbols = symbols.data() + size_t(y) * tileWidth;
+		for (uint32_t x = 0; x < tileWidth; x++)
+			row[x] = lossy ? float(Offset + double(rowSymbols[x]) * Step) : OrderedToFloat(rowSymbols[x]);
+	}
+	return true;
+}
+
+bool HeightfieldDecoder::DecodeAll(std::span<float> out, uint32_t threadCount) const
+{
+	assert(out.size() >= size_t(Width) * Height);
+	std::atomic<bool> valid = true;
+	ParallelFor(GetTilesX() * GetTilesY(), threadCount,
+				[&](uint32_t tileIndex)
+				{
+					uint32_t tileX = tileIndex % GetTilesX(), tileY = tileIndex / GetTilesX();
+					float* tileOut = out.data() + tileX * TileSize + size_t(tileY) * TileSize * Width;
+					if (!DecodeTile(tileX, tileY, tileOut, Width))
+						valid = false;
+				});
+	return valid;
+}
+
+} // namespace rad::proc
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace rad::proc
+{
+
+struct HeightfieldCodecSettings
+{
+	// 0 keeps the exact float bits, otherwise every decoded value is within MaxError of the input
+	float MaxError = 0.0f;
+	uint32_t TileSize = 256;
+	// 0 picks DefaultThreadCount()
+	uint32_t ThreadCount = 0;
+};
+
+/*
+Compressed height, water or sediment map. The map is cut into tiles that are coded independently, so any tile can be
+decoded on its own and all of them in parallel.
+
+Every value becomes an integer first: the float bits mapped to an order preserving uint32 in lossless mode, the index
+of a 2 * MaxError wide bucket in lossy mode. A tile is predicted in raster order either with CALIC's gradient adjusted
+prediction (GAP) or with the plane through the west, north and north west neighbours, whichever codes the tile
+smaller. Residuals are Golomb-Rice coded with the parameter adapted per context, the context being the local gradient
+activity.
+
+Layout: header, tile offsets, then the tile bitstreams.
+*/
+struct EncodedHeightfield
+{
+	std::vector<uint8_t> Bytes;
+};
+
+EncodedHeightfield EncodeHeightfield(std::span<const float> values, uint32_t width, uint32_t height,
+									 HeightfieldCodecSettings const& settings = {});
+
+struct HeightfieldDecoder
+{
+	// Checks the header and the tile table, returns nothing if the data is not a valid encoded heightfield. The
+	// decoder keeps referencing bytes.
+	static std::optional<HeightfieldDecoder> Open(std::span<const uint8_t> bytes);
+
+	uint32_t GetWidth() const
+	{
+		return Width;
+	}
+	uint32_t GetHeight() const
+	{
+		return Height;
+	}
+	uint32_t GetTileSize() const
+	{
+		return TileSize;
+	}
+	uint32_t GetTilesX() const
+	{
+		return (Width + TileSize - 1) / TileSize;
+	}
+	uint32_t GetTilesY() const
+	{
+		return (Height + TileSize - 1) / TileSize;
+	}
+	float GetMaxError() const
+	{
+		return MaxError;
+	}
+
+	// Writes the tile into out, a map of outRowPitch floats per row whose first element is the tile's top left cell.
+	// Returns false if the tile's bitstream is corrupt.
+	bool DecodeTile(uint32_t tileX, uint32_t tileY, float* out, size_t outRowPitch) const;
+	bool DecodeAll(std::span<float> out, uint32_t threadCount = 0) const;
+
+  private:
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t TileSize = 0;
+	float MaxError = 0.0f;
+	float Offset = 0.0f;
+	float Step = 0.0f;
+	std::span<const uint8_t> TileTable;
+	std::span<const uint8_t> TileData;
+};
+
+} // namespace rad::proc
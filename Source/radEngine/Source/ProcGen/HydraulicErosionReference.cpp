@@ -0,0 +1,290 @@
+#include "HydraulicErosionReference.h"
+#include "StrataColumns.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace rad::proc
+{
+
+// Same ordering as IndexToOffset4 in TerrainCommon.hlsli
+static constexpr std::array<std::array<int, 2>, 4> Offsets4 = {{{-1, 0}, {0, -1}, {1, 0}, {0, 1}}};
+
+HydraulicErosionState::HydraulicErosionState(uint32_t width, uint32_t height) : Width(width), Height(height)
+{
+	size_t cellCount = size_t(width) * height;
+	Heights.resize(cellCount);
+	Water.resize(cellCount);
+	Sediment.resize(cellCount);
+	Softness.resize(cellCount, 1.0f);
+	Outflux.resize(cellCount);
+	Velocity.resize(cellCount);
+	TempHeights.resize(cellCount);
+	TempSediment.resize(cellCount);
+}
+
+void HydraulicAddWater(HydraulicErosionState& state, HydraulicErosionSettings const& settings)
+{
+	float rain = settings.RainRate * settings.DeltaTime;
+	ParallelFor(state.Height, settings.ThreadCount,
+				[&](uint32_t y)
+				{
+					float* water = state.Water.data() + size_t(y) * state.Width;
+					for (uint32_t x = 0; x < state.Width; x++)
+						water[x] += rain;
+				});
+}
+
+void HydraulicCalculateOutflux(HydraulicErosionState& state, HydraulicErosionSettings const& settings)
+{
+	int width = state.Width, height = state.Height;
+	float fluxFactor = settings.DeltaTime * settings.PipeCrossSection * settings.Gravity / settings.PipeLength;
+	ParallelFor(state.Height, settings.ThreadCount,
+				[&](uint32_t row)
+				{
+					int y = int(row);
+					for (int x = 0; x < width; x++)
+					{
+						size_t index = x + size_t(y) * width;
+						float curWater = state.Water[index];
+						float curTotHeight = curWater + state.Heights[index];
+						auto outflux = state.Outflux[index];
+						float totOutflux = 0.0f;
+						for (int i = 0; i < 4; i++)
+						{
+							int nx = x + Offsets4[i][0], ny = y + Offsets4[i][1];
+							if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+								continue;
+							size_t neighbor = nx + size_t(ny) * width;
+							float neighborTotHeight = state.Heights[neighbor] + state.Water[neighbor];
+							outflux[i] = std::max(0.0f, outflux[i] + fluxFactor * (curTotHeight - neighborTotHeight));
+							totOutflux += outflux[i];
+						}
+						float k = std::min(1.0f, curWater * settings.PipeLength * settings.PipeLength /
+													 (totOutflux * settings.DeltaTime));
+						for (auto& flux : outflux)
+							flux *= k;
+						state.Outflux[index] = outflux;
+					}
+				});
+}
+
+void HydraulicUpdateWaterVelocity(HydraulicErosionState& state, HydraulicErosionSettings const& settings)
+{
+	int width = state.Width, height = state.Height;
+	ParallelFor(state.Height, settings.ThreadCount,
+				[&](uint32_t row)
+				{
+					int y = int(row);
+					for (int x = 0; x < width; x++)
+					{
+						size_t index = x + size_t(y) * width;
+						float curWater = state.Water[index];
+						auto const& curOutflux = state.Outflux[index];
+						std::array<float, 4> neighborOutflux = {};
+						for (int i = 0; i < 4; i++)
+						{
+							int nx = x + Offsets4[i][0], ny = y + Offsets4[i][1];
+							if (nx >= 0 && ny >= 0 && nx < width && ny < height)
+								neighborOutflux[i] = state.Outflux[nx + size_t(ny) * width][(i + 2) % 4];
+						}
+						float volumeChange = 0.0f;
+						for (int i = 0; i < 4; i++)
+							volumeChange += neighborOutflux[i] - curOutflux[i];
+						volumeChange *= settings.DeltaTime;
+
+						float newWater =
+							std::max(curWater + volumeChange / (settings.PipeLength * settings.PipeLength), 0.0f);
+						float xChange = neighborOutflux[0] + curOutflux[2] - neighborOutflux[2] - curOutflux[0];
+						float yChange = neighborOutflux[1] + curOutflux[3] - neighborOutflux[3] - curOutflux[1];
+						state.Water[index] = newWater;
+						float avgWater = (newWater + curWater) / 2.0f;
+						if (avgWater < 0.0001f)
+							state.Velocity[index] = {0.0f, 0.0f};
+						else
+						{
+							float invAvgL = 1.0f / (avgWater * settings.PipeLength);
+							state.Velocity[index] = {0.5f * xChange * invAvgL, 0.5f * yChange * invAvgL};
+						}
+					}
+				});
+}
+
+// Softness handling of H4, the exposed soil hardens as it is eroded and softens as sediment settles on it
+struct SoftnessMapMaterial
+{
+	HydraulicErosionState& State;
+	HydraulicErosionSettings const& Settings;
+
+	float GetSoftness(size_t index) const
+	{
+		return State.Softness[index];
+	}
+	float Erode(size_t index, float amount)
+	{
+		State.Softness[index] =
+			std::max(Settings.MinimumSoftness, State.Softness[index] - amount * Settings.SoilHardeningRate);
+		return amount;
+	}
+	void Deposit(size_t index, float amount)
+	{
+		State.Softness[index] = std::min(1.0f, State.Softness[index] + amount * Settings.SoilSofteningRate);
+	}
+};
+
+struct StrataMaterial
+{
+	StrataColumns& Strata;
+	HydraulicErosionSettings const& Settings;
+
+	float GetSoftness(size_t index) const
+	{
+		return Strata.GetTopSoftness(index);
+	}
+	float Erode(size_t index, float amount)
+	{
+		return Strata.Erode(index, amount);
+	}
+	void Deposit(size_t index, float amount)
+	{
+		Strata.Deposit(index, amount, Settings.DepositedSoftness);
+	}
+};
+
+template <typename Material>
+static void ErosionAndDeposition(HydraulicErosionState& state, HydraulicErosionSettings const& settings,
+								 Material material, uint32_t threadCount)
+{
+	int width = state.Width, height = state.Height;
+	auto sampleHeight = [&](int x, int y, int dx, int dy, float& outHeight)
+	{
+		int nx = x + dx, ny = y + dy;
+		if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+		{
+			outHeight = state.Heights[x + size_t(y) * width];
+			return 0.0f;
+		}
+		outHeight = state.Heights[nx + size_t(ny) * width];
+		return 1.0f;
+	};
+
+	ParallelFor(state.Height, threadCount,
+				[&](uint32_t row)
+				{
+					int y = int(row);
+					for (int x = 0; x < width; x++)
+					{
+						size_t index = x + size_t(y) * width;
+						float curHeight = state.Heights[index];
+
+						float left, right, top, bottom;
+						float leftDistance = sampleHeight(x, y, -1, 0, left);
+						float rightDistance = sampleHeight(x, y, 1, 0, right);
+						float topDistance = sampleHeight(x, y, 0, 1, top);
+						float bottomDistance = sampleHeight(x, y, 0, -1, bottom);
+						// normal = normalize(cross(dhdx, dhdy)), only its y component is needed
+						float dxLength = (rightDistance + leftDistance) * settings.PipeLength, dxHeight = right - left;
+						float dyLength = (topDistance + bottomDistance) * settings.PipeLength, dyHeight = top - bottom;
+						float dxNorm = std::sqrt(dxLength * dxLength + dxHeight * dxHeight);
+						float dyNorm = std::sqrt(dyLength * dyLength + dyHeight * dyHeight);
+						float ax = dxLength / dxNorm, ay = dxHeight / dxNorm;
+						float by = dyHeight / dyNorm, bz = dyLength / dyNorm;
+						float nx = ay * bz, ny = -ax * bz, nz = ax * by;
+						float normalY = ny / std::sqrt(nx * nx + ny * ny + nz * nz);
+						float sinTiltAngle = std::abs(std::sqrt(1.0f - normalY * normalY));
+
+						auto const& velocity = state.Velocity[index];
+						float speed = std::sqrt(velocity[0] * velocity[0] + velocity[1] * velocity[1]);
+						float curWater = state.Water[index];
+						float lmax = std::clamp(1.0f - std::max(0.0f, settings.MaximalErosionDepth - curWater) /
+														   settings.MaximalErosionDepth,
+												0.0f, 1.0f);
+						float softness = material.GetSoftness(index);
+						float capacity = settings.SedimentCapacity * speed * std::max(sinTiltAngle, 0.05f) * lmax;
+						float sediment = state.Sediment[index];
+
+						if (sediment < capacity)
+						{
+							float erodible = std::min(
+								softness * settings.DeltaTime * settings.SoilSuspensionRate * (capacity - sediment),
+								curHeight);
+							// The material may hold less than that, only what it gives up is suspended
+							float mod = material.Erode(index, erodible);
+							state.TempHeights[index] = curHeight - mod;
+							state.Sediment[index] += mod;
+							state.Water[index] += mod;
+						}
+						else
+						{
+							float mod = std::min(
+								settings.DeltaTime * settings.SedimentDepositionRate * (sediment - capacity), curWater);
+							state.TempHeights[index] = curHeight + mod;
+							state.Sediment[index] -= mod;
+							state.Water[index] -= mod;
+							material.Deposit(index, mod);
+						}
+					}
+				});
+	std::swap(state.Heights, state.TempHeights);
+}
+
+void HydraulicErosionAndDeposition(HydraulicErosionState& state, HydraulicErosionSettings const& settings,
+								   StrataColumns* strata)
+{
+	if (strata)
+		// Columns share the layer arena, so strata are eroded on one thread
+		ErosionAndDeposition(state, settings, StrataMaterial{*strata, settings}, 1);
+	else
+		ErosionAndDeposition(state, settings, SoftnessMapMaterial{state, settings}, settings.ThreadCount);
+}
+
+void HydraulicSedimentTransportationAndEvaporation(HydraulicErosionState& state,
+												   HydraulicErosionSettings const& settings)
+{
+	int width = state.Width, height = state.Height;
+	float texelSize = 1.0f / float(width);
+	// Bilinear sample with clamped addressing, like linearSampler
+	auto sampleSediment = [&](float u, float v)
+	{
+		float fx = u * width - 0.5f, fy = v * height - 0.5f;
+		float x0 = std::floor(fx), y0 = std::floor(fy);
+		float tx = fx - x0, ty = fy - y0;
+		auto at = [&](int x, int y)
+		{ return state.Sediment[std::clamp(x, 0, width - 1) + size_t(std::clamp(y, 0, height - 1)) * width]; };
+		int ix = int(x0), iy = int(y0);
+		float top = at(ix, iy) * (1 - tx) + at(ix + 1, iy) * tx;
+		float bottom = at(ix, iy + 1) * (1 - tx) + at(ix + 1, iy + 1) * tx;
+		return top * (1 - ty) + bottom * ty;
+	};
+
+	float evaporation = 1.0f - settings.EvaporationRate * settings.DeltaTime;
+	ParallelFor(state.Height, settings.ThreadCount,
+				[&](uint32_t row)
+				{
+					int y = int(row);
+					for (int x = 0; x < width; x++)
+					{
+						size_t index = x + size_t(y) * width;
+						auto const& velocity = state.Velocity[index];
+						float step = settings.DeltaTime * texelSize * settings.PipeLength;
+						float u = std::clamp(float(x) / width + texelSize * 0.5f - velocity[0] * step, 0.0f, 1.0f);
+						float v = std::clamp(float(y) / height + texelSize * 0.5f - velocity[1] * step, 0.0f, 1.0f);
+						state.TempSediment[index] = sampleSediment(u, v);
+						state.Water[index] *= evaporation;
+					}
+				});
+	std::swap(state.Sediment, state.TempSediment);
+}
+
+void HydraulicErosionStep(HydraulicErosionState& state, HydraulicErosionSettings const& settings,
+						  StrataColumns* strata)
+{
+	HydraulicAddWater(state, settings);
+	HydraulicCalculateOutflux(state, settings);
+	HydraulicUpdateWaterVelocity(state, settings);
+	HydraulicErosionAndDeposition(state, settings, strata);
+	HydraulicSedimentTransportationAndEvaporation(state, settings);
+}
+
+} // namespace rad::proc
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace rad::proc
+{
+
+struct StrataColumns;
+
+// Defaults match the hlsl::Hydrolic*Resources structs
+struct HydraulicErosionSettings
+{
+	float DeltaTime = 0.02f;
+	float Gravity = 9.81f;
+	float PipeCrossSection = 20.0f;
+	float PipeLength = 0.8f;
+	float RainRate = 0.015f;
+	float SedimentCapacity = 1.0f;
+	float SoilSuspensionRate = 0.5f;
+	float SedimentDepositionRate = 1.0f;
+	float SoilHardeningRate = 0.1f;
+	float SoilSofteningRate = 0.3f;
+	float MinimumSoftness = 0.01f;
+	float MaximalErosionDepth = 1.0f;
+	float EvaporationRate = 0.015f;
+	// Softness of the layers deposition creates when eroding a StrataColumns model
+	float DepositedSoftness = 1.0f;
+	// Rows are independent within a pass, 0 picks DefaultThreadCount(). Eroding a StrataColumns model stays on one
+	// thread.
+	uint32_t ThreadCount = 0;
+};
+
+// CPU copy of the maps of CTerrain that the hydraulic step touches
+struct HydraulicErosionState
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<float> Heights;
+	std::vector<float> Water;
+	std::vector<float> Sediment;
+	std::vector<float> Softness;
+	// Left, bottom, right, top, same order as IndexToOffset4
+	std::vector<std::array<float, 4>> Outflux;
+	std::vector<std::array<float, 2>> Velocity;
+	std::vector<float> TempHeights;
+	std::vector<float> TempSediment;
+
+	HydraulicErosionState() = default;
+	HydraulicErosionState(uint32_t width, uint32_t height);
+};
+
+/*
+CPU references of the H1-H5 compute passes. Rain is spread uniformly instead of H1's random drops, everything else
+follows the shaders. Erosion and deposition either uses State.Softness like H4 or, when given a StrataColumns model, the
+softness of the exposed layer, eroding its top layers and depositing new soft ones.
+*/
+void HydraulicAddWater(HydraulicErosionState& state, HydraulicErosionSettings const& settings);
+void HydraulicCalculateOutflux(HydraulicErosionState& state, HydraulicErosionSettings const& settings);
+void HydraulicUpdateWaterVelocity(HydraulicErosionState& state, HydraulicErosionSettings const& settings);
+void HydraulicErosionAndDeposition(HydraulicErosionState& state, HydraulicErosionSettings const& settings,
+								   StrataColumns* strata = nullptr);
+void HydraulicSedimentTransportationAndEvaporation(HydraulicErosionState& state,
+												   HydraulicErosionSettings const& settings);
+
+void HydraulicErosionStep(HydraulicErosionState& state, HydraulicErosionSettings const& settings,
+						  StrataColumns* strata = nullptr);
+
+} // namespace rad::proc
@@ -0,0 +1,148 @@
+#include "MapFilters.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace rad::proc
+{
+
+void ComputeNormalMap(std::span<const float> heights, uint32_t width, uint32_t height, float cellLength,
+					  std::span<float> normalX, std::span<float> normalY, std::span<float> normalZ,
+					  uint32_t threadCount)
+{
+	float scale = 1.0f / (2.0f * cellLength);
+	RunStencil<1, 3>({heights}, {normalX, normalY, normalZ}, width, height,
+					 {.Radius = 1, .ThreadCount = threadCount},
+					 [scale](StencilRow<1, 3> const& row)
+					 {
+						 float const* above = row.In(0, -1);
+						 float const* left = row.In(0) - 1;
+						 float const* right = row.In(0) + 1;
+						 float const* below = row.In(0, 1);
+						 float* outX = row.Out(0);
+						 float* outY = row.Out(1);
+						 float* outZ = row.Out(2);
+						 for (uint32_t i = 0; i < row.Count; i++)
+						 {
+							 float dx = (right[i] - left[i]) * scale;
+							 float dz = (below[i] - above[i]) * scale;
+							 float inverseLength = 1.0f / std::sqrt(dx * dx + dz * dz + 1.0f);
+							 outX[i] = -dx * inverseLength;
+							 outY[i] = inverseLength;
+							 outZ[i] = -dz * inverseLength;
+						 }
+					 });
+}
+
+void ComputeSlopeMap(std::span<const float> heights, uint32_t width, uint32_t height, float cellLength,
+					 std::span<float> slope, uint32_t threadCount)
+{
+	float scale = 1.0f / (2.0f * cellLength);
+	RunStencil<1, 1>({heights}, {slope}, width, height, {.Radius = 1, .ThreadCount = threadCount},
+					 [scale](StencilRow<1, 1> const& row)
+					 {
+						 float const* above = row.In(0, -1);
+						 float const* left = row.In(0) - 1;
+						 float const* right = row.In(0) + 1;
+						 float const* below = row.In(0, 1);
+						 float* out = row.Out(0);
+						 for (uint32_t i = 0; i < row.Count; i++)
+						 {
+							 float dx = (right[i] - left[i]) * scale;
+							 float dz = (below[i] - above[i]) * scale;
+							 out[i] = std::atan(std::sqrt(dx * dx + dz * dz));
+						 }
+					 });
+}
+
+void GaussianBlur(std::span<const float> values, uint32_t width, uint32_t height, uint32_t radius,
+				  std::span<float> out, StencilBorder border, uint32_t threadCount)
+{
+	std::vector<float> weights(2 * size_t(radius) + 1);
+	float sigma = std::max(0.5f, radius * 0.5f), total = 0.0f;
+	for (int k = -int(radius); k <= int(radius); k++)
+		total += weights[k + radius] = std::exp(-0.5f * k * k / (sigma * sigma));
+	for (float& weight : weights)
+		weight /= total;
+
+	// The horizontal pass only needs the halo along the row, the vertical one only across rows
+	std::vector<float> horizontal(size_t(width) * height);
+	StencilSettings settings{.Radius = radius, .Border = border, .ThreadCount = threadCount};
+	RunStencil<1, 1>({values}, {std::span<float>(horizontal)}, width, height, settings,
+					 [&weights, radius](StencilRow<1, 1> const& row)
+					 {
+						 float const* in = row.In(0);
+						 float* result = row.Out(0);
+						 std::fill_n(result, row.Count, 0.0f);
+						 for (int k = -int(radius); k <= int(radius); k++)
+						 {
+							 float weight = weights[k + radius];
+							 float const* shifted = in + k;
+							 for (uint32_t i = 0; i < row.Count; i++)
+								 result[i] += weight * shifted[i];
+						 }
+					 });
+	RunStencil<1, 1>({std::span<const float>(horizontal)}, {out}, width, height, settings,
+					 [&weights, radius](StencilRow<1, 1> const& row)
+					 {
+						 float* result = row.Out(0);
+						 std::fill_n(result, row.Count, 0.0f);
+						 for (int k = -int(radius); k <= int(radius); k++)
+						 {
+							 float weight = weights[k + radius];
+							 float const* in = row.In(0, k);
+							 for (uint32_t i = 0; i < row.Count; i++)
+								 result[i] += weight * in[i];
+						 }
+					 });
+}
+
+void RemapRange(std::span<float> values, uint32_t width, uint32_t height, float newMin, float newMax, float exponent,
+				uint32_t threadCount)
+{
+	// Min and max per band of rows, then a radius 0 stencil that may write in place
+	uint32_t bandHeight = 32, bandCount = (height + bandHeight - 1) / bandHeight;
+	std::vector<float> bandMin(bandCount, std::numeric_limits<float>::max());
+	std::vector<float> bandMax(bandCount, std::numeric_limits<float>::lowest());
+	ParallelFor(bandCount, threadCount,
+				[&](uint32_t band)
+				{
+					size_t begin = size_t(band) * bandHeight * width;
+					size_t end = std::min(size_t(band + 1) * bandHeight, size_t(height)) * width;
+					float low = bandMin[band], high = bandMax[band];
+					for (size_t i = begin; i < end; i++)
+					{
+						low = std::min(low, values[i]);
+						high = std::max(high, values[i]);
+					}
+					bandMin[band] = low;
+					bandMax[band] = high;
+				});
+	float low = *std::min_element(bandMin.begin(), bandMin.end());
+	float high = *std::max_element(bandMax.begin(), bandMax.end());
+	float inverseRange = high > low ? 1.0f / (high - low) : 0.0f;
+	float outRange = newMax - newMin;
+
+	RunStencil<1, 1>({std::span<const float>(values)}, {values}, width, height, {.ThreadCount = threadCount},
+					 [=](StencilRow<1, 1> const& row)
+					 {
+						 float const* in = row.In(0);
+						 float* out = row.Out(0);
+						 if (exponent == 1.0f)
+							 for (uint32_t i = 0; i < row.Count; i++)
+								 out[i] = (in[i] - low) * inverseRange * outRange + newMin;
+						 else if (exponent == 2.0f)
+							 for (uint32_t i = 0; i < row.Count; i++)
+							 {
+								 float t = (in[i] - low) * inverseRange;
+								 out[i] = t * t * outRange + newMin;
+							 }
+						 else
+							 for (uint32_t i = 0; i < row.Count; i++)
+								 out[i] = std::pow((in[i] - low) * inverseRange, exponent) * outRange + newMin;
+					 });
+}
+
+} // namespace rad::proc
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Stencil.h"
+
+#include <cstdint>
+#include <span>
+
+namespace rad::proc
+{
+
+/*
+Whole map operations on width x height float planes, built on RunStencil. Heights are sampled on a grid of cellLength,
+x runs along a row and z down the rows, y is up. threadCount 0 picks DefaultThreadCount().
+*/
+
+// Unit normals from central differences, one plane per component
+void ComputeNormalMap(std::span<const float> heights, uint32_t width, uint32_t height, float cellLength,
+					  std::span<float> normalX, std::span<float> normalY, std::span<float> normalZ,
+					  uint32_t threadCount = 0);
+// Slope angle in radians, the asin(sqrt(1 - n.y^2)) of HeightMapToTerrainMaterial.hlsl
+void ComputeSlopeMap(std::span<const float> heights, uint32_t width, uint32_t height, float cellLength,
+					 std::span<float> slope, uint32_t threadCount = 0);
+// Separable Gaussian with sigma = radius / 2, out must not alias values
+void GaussianBlur(std::span<const float> values, uint32_t width, uint32_t height, uint32_t radius,
+				  std::span<float> out, StencilBorder border = StencilBorder::Clamp, uint32_t threadCount = 0);
+// Maps [min, max] of values to [newMin, newMax] in place, with pow(t, exponent) applied to the normalized value
+void RemapRange(std::span<float> values, uint32_t width, uint32_t height, float newMin, float newMax,
+				float exponent = 1.0f, uint32_t threadCount = 0);
+
+} // namespace rad::proc
@@ -0,0 +1,605 @@
+#include "NavMesh.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+
+namespace rad::proc
+{
+
+// Side order of NavPolygon::OpenSides
+static constexpr std::array<int, 4> SideDX = {-1, 0, 1, 0};
+static constexpr std::array<int, 4> SideDZ = {0, 1, 0, -1};
+
+NavMeshBuilder::NavMeshBuilder(Settings const& settings, float minX, float minZ, float maxX, float maxZ)
+	: Config(settings), MinX(minX), MinZ(minZ)
+{
+	float tileLength = Config.TileSize * Config.CellSize;
+	TilesX = std::max(1u, uint32_t(std::ceil((maxX - minX) / tileLength)));
+	TilesY = std::max(1u, uint32_t(std::ceil((maxZ - minZ) / tileLength)));
+	Border = uint32_t(std::ceil(Config.AgentRadius / Config.CellSize)) + 1;
+	TileTriangles.resize(size_t(TilesX) * TilesY);
+	Tiles.resize(size_t(TilesX) * TilesY);
+	Dirty.assign(size_t(TilesX) * TilesY, 1);
+	MinY = std::numeric_limits<float>::max();
+	MaxY = std::numeric_limits<float>::lowest();
+}
+
+uint32_t NavMeshBuilder::SetHeightfield(std::span<const float> heights, uint32_t width, uint32_t height,
+										float originX, float originZ, float spacing, float tolerance)
+{
+	assert(heights.size() >= size_t(width) * height && width > 1 && height > 1);
+	bool sameGrid = width == HeightsWidth && height == HeightsHeight && originX == HeightsOriginX &&
+					originZ == HeightsOriginZ && spacing == HeightsSpacing;
+	auto [low, high] = std::minmax_element(heights.begin(), heights.begin() + size_t(width) * height);
+	// The vertical range only grows. Spans are quantised from its bottom and clamped to its top, so when it grows every
+	// tile is rebuilt, otherwise the voxels of clean tiles stay where they were.
+	bool rangeGrew = *low < MinY || *high > MaxY;
+	MinY = std::min(MinY, std::floor(*low) - 1.0f);
+	MaxY = std::max(MaxY, std::ceil(*high) + 1.0f);
+
+	if (!sameGrid || rangeGrew)
+		std::fill(Dirty.begin(), Dirty.end(), 1);
+	else
+		for (uint32_t y = 0; y < height; y++)
+			for (uint32_t x = 0; x < width; x++)
+			{
+				size_t index = x + size_t(y) * width;
+				if (std::abs(heights[index] - Heights[index]) <= tolerance)
+					continue;
+				// Bilinear sampling and slopes reach one sample further
+				float sampleX = originX + x * spacing, sampleZ = originZ + y * spacing;
+				MarkTilesInRect(sampleX - 2 * spacing, sampleZ - 2 * spacing, sampleX + 2 * spacing,
+								sampleZ + 2 * spacing);
+			}
+
+	Heights.assign(heights.begin(), heights.begin() + size_t(width) * height);
+	HeightsWidth = width;
+	HeightsHeight = height;
+	HeightsOriginX = originX;
+	HeightsOriginZ = originZ;
+	HeightsSpacing = spacing;
+	return GetDirtyTileCount();
+}
+
+void NavMeshBuilder::AddMesh(std::span<const float> positions, std::span<const uint32_t> indices)
+{
+	float tileLength = Config.TileSize * Config.CellSize;
+	float borderLength = Border * Config.CellSize;
+	float previousMinY = MinY, previousMaxY = MaxY;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		uint32_t triangle = uint32_t(Triangles.size() / 9);
+		float minX = std::numeric_limits<float>::max(), minZ = minX, maxX = std::numeric_limits<float>::lowest();
+		float maxZ = maxX;
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			float const* position = &positions[size_t(indices[i + corner]) * 3];
+			Triangles.insert(Triangles.end(), position, position + 3);
+			minX = std::min(minX, position[0]);
+			maxX = std::max(maxX, position[0]);
+			minZ = std::min(minZ, position[2]);
+			maxZ = std::max(maxZ, position[2]);
+			MinY = std::min(MinY, std::floor(position[1]) - 1.0f);
+			MaxY = std::max(MaxY, std::ceil(position[1]) + 1.0f);
+		}
+
+		int firstX = std::max(0, int(std::floor((minX - borderLength - MinX) / tileLength)));
+		int lastX = std::min(int(TilesX) - 1, int(std::floor((maxX + borderLength - MinX) / tileLength)));
+		int firstY = std::max(0, int(std::floor((minZ - borderLength - MinZ) / tileLength)));
+		int lastY = std::min(int(TilesY) - 1, int(std::floor((maxZ + borderLength - MinZ) / tileLength)));
+		for (int tileY = firstY; tileY <= lastY; tileY++)
+			for (int tileX = firstX; tileX <= lastX; tileX++)
+			{
+				TileTriangles[tileX + size_t(tileY) * TilesX].push_back(triangle);
+				Dirty[tileX + size_t(tileY) * TilesX] = 1;
+			}
+	}
+	// Every tile quantises its spans from MinY, as in SetHeightfield a grown range rebuilds them all
+	if (MinY != previousMinY || MaxY != previousMaxY)
+		std::fill(Dirty.begin(), Dirty.end(), 1);
+}
+
+void NavMeshBuilder::ClearMeshes()
+{
+	Triangles.clear();
+	for (size_t tile = 0; tile < TileTriangles.size(); tile++)
+		if (!TileTriangles[tile].empty())
+		{
+			TileTriangles[tile].clear();
+			Dirty[tile] = 1;
+		}
+}
+
+void NavMeshBuilder::MarkDirty(float minX, float minZ, float maxX, float maxZ)
+{
+	MarkTilesInRect(minX, minZ, maxX, maxZ);
+}
+
+void NavMeshBuilder::MarkTilesInRect(float minX, float minZ, float maxX, float maxZ)
+{
+	float tileLength = Config.TileSize * Config.CellSize;
+	float borderLength = Border * Config.CellSize;
+	int firstX = std::max(0, int(std::floor((minX - borderLength - MinX) / tileLength)));
+	int lastX = std::min(int(TilesX) - 1, int(std::floor((maxX + borderLength - MinX) / tileLength)));
+	int firstY = std::max(0, int(std::floor((minZ - borderLength - MinZ) / tileLength)));
+	int lastY = std::min(int(TilesY) - 1, int(std::floor((maxZ + borderLength - MinZ) / tileLength)));
+	for (int tileY = firstY; tileY <= lastY; tileY++)
+		for (int tileX = firstX; tileX <= lastX; tileX++)
+			Dirty[tileX + size_t(tileY) * TilesX] = 1;
+}
+
+uint32_t NavMeshBuilder::GetDirtyTileCount() const
+{
+	return uint32_t(std::count(Dirty.begin(), Dirty.end(), uint8_t(1)));
+}
+
+size_t NavMeshBuilder::GetPolygonCount() const
+{
+	size_t count = 0;
+	for (auto const& tile : Tiles)
+		count += tile.Polygons.size();
+	return count;
+}
+
+uint32_t NavMeshBuilder::Build()
+{
+	auto start = std::chrono::steady_clock::now();
+	std::vector<uint32_t> dirtyTiles;
+	for (uint32_t i = 0; i < Dirty.size(); i++)
+		if (Dirty[i])
+			dirtyTiles.push_back(i);
+
+	ParallelFor(uint32_t(dirtyTiles.size()), Config.ThreadCount,
+				[&](uint32_t i)
+				{
+					uint32_t tile = dirtyTiles[i];
+					Tiles[tile] = BuildTile(tile % TilesX, tile / TilesX);
+				});
+
+	LastBuild = BuildStats{.BuiltTiles = uint32_t(dirtyTiles.size())};
+	for (uint32_t tile : dirtyTiles)
+	{
+		Dirty[tile] = 0;
+		LastBuild.MeanTileMs += Tiles[tile].BuildMs;
+		LastBuild.MaxTileMs = std::max(LastBuild.MaxTileMs, Tiles[tile].BuildMs);
+	}
+	if (!dirtyTiles.empty())
+		LastBuild.MeanTileMs /= dirtyTiles.size();
+	LastBuild.TotalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return LastBuild.BuiltTiles;
+}
+
+float NavMeshBuilder::SampleHeightfield(float x, float z, bool& inside) const
+{
+	float u = (x - HeightsOriginX) / HeightsSpacing, v = (z - HeightsOriginZ) / HeightsSpacing;
+	inside = !Heights.empty() && u >= 0 && v >= 0 && u <= HeightsWidth - 1 && v <= HeightsHeight - 1;
+	if (Heights.empty())
+		return 0.0f;
+	u = std::clamp(u, 0.0f, float(HeightsWidth - 1));
+	v = std::clamp(v, 0.0f, float(HeightsHeight - 1));
+	uint32_t x0 = std::min(uint32_t(u), HeightsWidth - 2), z0 = std::min(uint32_t(v), HeightsHeight - 2);
+	float fx = u - x0, fz = v - z0;
+	float const* row0 = &Heights[x0 + size_t(z0) * HeightsWidth];
+	float const* row1 = row0 + HeightsWidth;
+	return (row0[0] * (1 - fx) + row0[1] * fx) * (1 - fz) + (row1[0] * (1 - fx) + row1[1] * fx) * fz;
+}
+
+namespace
+{
+
+struct SolidSpan
+{
+	uint16_t Min = 0, Max = 0;
+	bool Walkable = false;
+	int32_t Next = -1;
+};
+
+// Solid spans of every column of a tile, sorted bottom up in linked lists that share one pool
+struct SpanColumns
+{
+	std::vector<SolidSpan> Pool;
+	std::vector<int32_t> Heads;
+	int32_t FreeList = -1;
+	int Climb = 0;
+
+	void Add(size_t column, uint16_t spanMin, uint16_t spanMax, bool walkable)
+	{
+		int32_t previous = -1, current = Heads[column];
+		while (current != -1)
+		{
+			SolidSpan& other = Pool[current];
+			if (other.Min > spanMax)
+				break;
+			if (other.Max < spanMin)
+			{
+				previous = current;
+				current = other.Next;
+				continue;
+			}
+			// Overlapping, the merged top keeps the walkable flag of the higher surface unless both are within climb
+			if (std::abs(int(other.Max) - int(spanMax)) <= Climb)
+				walkable = walkable || other.Walkable;
+			else if (other.Max > spanMax)
+				walkable = other.Walkable;
+			spanMin = std::min(spanMin, other.Min);
+			spanMax = std::max(spanMax, other.Max);
+			int32_t next = other.Next;
+			other.Next = FreeList;
+			FreeList = current;
+			(previous == -1 ? Heads[column] : Pool[previous].Next) = next;
+			current = next;
+		}
+
+		int32_t index = FreeList;
+		if (index != -1)
+			FreeList = Pool[index].Next;
+		else
+		{
+			index = int32_t(Pool.size());
+			Pool.emplace_back();
+		}
+		Pool[index] = SolidSpan{spanMin, spanMax, walkable, current};
+		(previous == -1 ? Heads[column] : Pool[previous].Next) = index;
+	}
+};
+
+struct OpenSpan
+{
+	uint16_t X = 0, Z = 0;
+	uint16_t Floor = 0, Ceiling = 0;
+	std::array<int32_t, 4> Neighbours = {-1, -1, -1, -1};
+	uint32_t Distance = 0;
+	int32_t Polygon = -1;
+	bool Removed = false;
+};
+
+// Splits a convex polygon by the plane coordinate[axis] == split, below gets the part under it
+uint32_t DividePolygon(std::span<const float> in, uint32_t inCount, float* below, uint32_t& belowCount, float* above,
+					   float split, int axis)
+{
+	std::array<float, 12> distance;
+	for (uint32_t i = 0; i < inCount; i++)
+		distance[i] = split - in[i * 3 + axis];
+	uint32_t aboveCount = 0;
+	belowCount = 0;
+	for (uint32_t i = 0, j = inCount - 1; i < inCount; j = i, i++)
+	{
+		bool inA = distance[j] >= 0, inB = distance[i] >= 0;
+		if (inA != inB)
+		{
+			float s = distance[j] / (distance[j] - distance[i]);
+			for (int k = 0; k < 3; k++)
+				below[belowCount * 3 + k] = above[aboveCount * 3 + k] =
+					in[j * 3 + k] + (in[i * 3 + k] - in[j * 3 + k]) * s;
+			belowCount++;
+			aboveCount++;
+			if (distance[i] > 0)
+				std::copy_n(&in[i * 3], 3, &below[3 * belowCount++]);
+			else if (distance[i] < 0)
+				std::copy_n(&in[i * 3], 3, &above[3 * aboveCount++]);
+			continue;
+		}
+		if (distance[i] >= 0)
+		{
+			std::copy_n(&in[i * 3], 3, &below[3 * belowCount++]);
+			if (distance[i] != 0)
+				continue;
+		}
+		std::copy_n(&in[i * 3], 3, &above[3 * aboveCount++]);
+	}
+	return aboveCount;
+}
+
+} // namespace
+
+NavMeshTile NavMeshBuilder::BuildTile(uint32_t tileX, uint32_t tileY) const
+{
+	auto start = std::chrono::steady_clock::now();
+	NavMeshTile tile;
+	tile.X = tileX;
+	tile.Y = tileY;
+
+	float cellSize = Config.CellSize, cellHeight = Config.CellHeight;
+	uint32_t gridSize = Config.TileSize + 2 * Border;
+	float gridMinX = MinX + (float(tileX * Config.TileSize) - float(Border)) * cellSize;
+	float gridMinZ = MinZ + (float(tileY * Config.TileSize) - float(Border)) * cellSize;
+	float spanLimit = std::min(float(std::numeric_limits<uint16_t>::max() - 1), (MaxY - MinY) / cellHeight);
+	int climb = int(std::floor(Config.MaxClimb / cellHeight));
+	int agentHeight = int(std::ceil(Config.AgentHeight / cellHeight));
+	float minNormalY = std::cos(Config.MaxSlopeDegrees * 3.14159265f / 180.0f);
+	auto toSpanHeight = [&](float y) { return std::clamp((y - MinY) / cellHeight, 0.0f, spanLimit); };
+
+	SpanColumns columns;
+	columns.Heads.assign(size_t(gridSize) * gridSize, -1);
+	columns.Climb = climb;
+
+	// Heightfield columns are solid from the bottom of the volume up to the surface
+	if (!Heights.empty())
+		for (uint32_t z = 0; z < gridSize; z++)
+			for (uint32_t x = 0; x < gridSize; x++)
+			{
+				float centerX = gridMinX + (x + 0.5f) * cellSize, centerZ = gridMinZ + (z + 0.5f) * cellSize;
+				bool inside = false;
+				float surface = SampleHeightfield(centerX, centerZ, inside);
+				if (!inside)
+					continue;
+				bool unused;
+				float gradientX = (SampleHeightfield(centerX + cellSize, centerZ, unused) -
+								   SampleHeightfield(centerX - cellSize, centerZ, unused)) /
+								  (2 * cellSize);
+				float gradientZ = (SampleHeightfield(centerX, centerZ + cellSize, unused) -
+								   SampleHeightfield(centerX, centerZ - cellSize, unused)) /
+								  (2 * cellSize);
+				float normalY = 1.0f / std::sqrt(1.0f + gradientX * gradientX + gradientZ * gradientZ);
+				columns.Add(x + size_t(z) * gridSize, 0, uint16_t(std::ceil(toSpanHeight(surface))),
+							normalY >= minNormalY);
+			}
+
+	// Triangles are clipped to each column they cross, the clipped part's height range becomes a span
+	std::array<float, 7 * 3> in, inRow, cell, rest, rowRest;
+	for (uint32_t triangle : TileTriangles[tileX + size_t(tileY) * TilesX])
+	{
+		float const* vertices = &Triangles[size_t(triangle) * 9];
+		float edge0[3], edge1[3];
+		for (int k = 0; k < 3; k++)
+		{
+			edge0[k] = vertices[3 + k] - vertices[k];
+			edge1[k] = vertices[6 + k] - vertices[k];
+		}
+		float normal[3] = {edge0[1] * edge1[2] - edge0[2] * edge1[1], edge0[2] * edge1[0] - edge0[0] * edge1[2],
+						   edge0[0] * edge1[1] - edge0[1] * edge1[0]};
+		float normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		// Either winding, the surface faces up once the voxels merge
+		bool walkable = normalLength > 0 && std::abs(normal[1]) / normalLength >= minNormalY;
+
+		float minZ = std::min({vertices[2], vertices[5], vertices[8]});
+		float maxZ = std::max({vertices[2], vertices[5], vertices[8]});
+		int firstZ = std::max(0, int(std::floor((minZ - gridMinZ) / cellSize)));
+		int lastZ = std::min(int(gridSize) - 1, int(std::floor((maxZ - gridMinZ) / cellSize)));
+		if (firstZ > lastZ)
+			continue;
+
+		std::copy_n(vertices, 9, in.begin());
+		uint32_t inCount = 3;
+		// Drop the part in front of the grid
+		if (float gridFront = gridMinZ + firstZ * cellSize; minZ < gridFront)
+		{
+			uint32_t frontCount = 0;
+			inCount = DividePolygon(in, inCount, cell.data(), frontCount, rest.data(), gridFront, 2);
+			std::swap(in, rest);
+		}
+		for (int z = firstZ; z <= lastZ && inCount >= 3; z++)
+		{
+			uint32_t rowCount = 0;
+			float splitZ = gridMinZ + (z + 1) * cellSize;
+			uint32_t restCount = DividePolygon(in, inCount, inRow.data(), rowCount, rest.data(), splitZ, 2);
+			std::swap(in, rest);
+			inCount = restCount;
+			if (rowCount < 3)
+				continue;
+
+			float rowMinX = inRow[0], rowMaxX = inRow[0];
+			for (uint32_t i = 1; i < rowCount; i++)
+			{
+				rowMinX = std::min(rowMinX, inRow[i * 3]);
+				rowMaxX = std::max(rowMaxX, inRow[i * 3]);
+			}
+			int firstX = std::max(0, int(std::floor((rowMinX - gridMinX) / cellSize)));
+			int lastX = std::min(int(gridSize) - 1, int(std::floor((rowMaxX - gridMinX) / cellSize)));
+			if (firstX > lastX)
+				continue;
+			// Drop the part left of the grid
+			if (float gridLeft = gridMinX + firstX * cellSize; rowMinX < gridLeft)
+			{
+				uint32_t leftCount = 0;
+				rowCount = DividePolygon(inRow, rowCount, cell.data(), leftCount, rowRest.data(), gridLeft, 0);
+				std::swap(inRow, rowRest);
+			}
+			for (int x = firstX; x <= lastX && rowCount >= 3; x++)
+			{
+				uint32_t cellCount = 0;
+				float splitX = gridMinX + (x + 1) * cellSize;
+				rowCount = DividePolygon(inRow, rowCount, cell.data(), cellCount, rowRest.data(), splitX, 0);
+				std::swap(inRow, rowRest);
+				if (cellCount < 3)
+					continue;
+				float spanMin = cell[1], spanMax = cell[1];
+				for (uint32_t i = 1; i < cellCount; i++)
+				{
+					spanMin = std::min(spanMin, cell[i * 3 + 1]);
+					spanMax = std::max(spanMax, cell[i * 3 + 1]);
+				}
+				columns.Add(x + size_t(z) * gridSize, uint16_t(std::floor(toSpanHeight(spanMin))),
+							uint16_t(std::ceil(toSpanHeight(spanMax))), walkable);
+			}
+		}
+	}
+
+	// Low obstacles such as steps and kerbs are walkable when the span below them is
+	for (int32_t head : columns.Heads)
+	{
+		bool previousWalkable = false;
+		int previousTop = 0;
+		for (int32_t index = head; index != -1; index = columns.Pool[index].Next)
+		{
+			SolidSpan& span = columns.Pool[index];
+			bool wasWalkable = span.Walkable;
+			if (!span.Walkable && previousWalkable && int(span.Max) - previousTop <= climb)
+				span.Walkable = true;
+			previousWalkable = wasWalkable;
+			previousTop = span.Max;
+		}
+	}
+
+	// Open spans, stored column by column
+	std::vector<OpenSpan> spans;
+	std::vector<uint32_t> columnStart(size_t(gridSize) * gridSize + 1, 0);
+	for (uint32_t z = 0; z < gridSize; z++)
+		for (uint32_t x = 0; x < gridSize; x++)
+		{
+			size_t column = x + size_t(z) * gridSize;
+			columnStart[column] = uint32_t(spans.size());
+			for (int32_t index = columns.Heads[column]; index != -1; index = columns.Pool[index].Next)
+			{
+				SolidSpan const& span = columns.Pool[index];
+				int ceiling = span.Next != -1 ? columns.Pool[span.Next].Min : std::numeric_limits<uint16_t>::max();
+				if (span.Walkable && ceiling - int(span.Max) >= agentHeight)
+					spans.push_back(OpenSpan{.X = uint16_t(x), .Z = uint16_t(z), .Floor = span.Max,
+											 .Ceiling = uint16_t(ceiling)});
+			}
+		}
+	columnStart.back() = uint32_t(spans.size());
+
+	for (auto& span : spans)
+		for (int side = 0; side < 4; side++)
+		{
+			int x = span.X + SideDX[side], z = span.Z + SideDZ[side];
+			if (x < 0 || z < 0 || x >= int(gridSize) || z >= int(gridSize))
+				continue;
+			size_t column = x + size_t(z) * gridSize;
+			for (uint32_t other = columnStart[column]; other < columnStart[column + 1]; other++)
+			{
+				OpenSpan const& neighbour = spans[other];
+				int bottom = std::max(span.Floor, neighbour.Floor), top = std::min(span.Ceiling, neighbour.Ceiling);
+				if (top - bottom >= agentHeight && std::abs(int(neighbour.Floor) - int(span.Floor)) <= climb)
+				{
+					span.Neighbours[side] = int32_t(other);
+					break;
+				}
+			}
+		}
+
+	// Erode by the agent radius, distances grow from the spans missing a neighbour
+	uint32_t radius = uint32_t(std::ceil(Config.AgentRadius / cellSize));
+	if (radius > 0)
+	{
+		std::deque<uint32_t> queue;
+		for (uint32_t i = 0; i < spans.size(); i++)
+		{
+			bool edge = std::ranges::any_of(spans[i].Neighbours, [](int32_t n) { return n == -1; });
+			spans[i].Distance = edge ? 0 : std::numeric_limits<uint32_t>::max();
+			if (edge)
+				queue.push_back(i);
+		}
+		while (!queue.empty())
+		{
+			uint32_t index = queue.front();
+			queue.pop_front();
+			for (int32_t neighbour : spans[index].Neighbours)
+				if (neighbour != -1 && spans[neighbour].Distance > spans[index].Distance + 1)
+				{
+					spans[neighbour].Distance = spans[index].Distance + 1;
+					queue.push_back(uint32_t(neighbour));
+				}
+		}
+		for (auto& span : spans)
+			span.Removed = span.Distance < radius;
+	}
+
+	// Greedy rectangles over the tile's own cells
+	uint32_t coreBegin = Border, coreEnd = Border + Config.TileSize;
+	int rise = int(std::floor(Config.MaxPolygonRise / cellHeight));
+	auto inCore = [&](OpenSpan const& span)
+	{ return span.X >= coreBegin && span.X < coreEnd && span.Z >= coreBegin && span.Z < coreEnd; };
+	std::unordered_map<uint64_t, uint16_t> vertexLookup;
+	auto addVertex = [&](uint32_t x, uint32_t z, uint16_t floor)
+	{
+		uint64_t key = uint64_t(x) | uint64_t(z) << 16 | uint64_t(floor) << 32;
+		auto [it, inserted] = vertexLookup.try_emplace(key, uint16_t(tile.Vertices.size()));
+		if (inserted)
+			tile.Vertices.push_back(NavVertex{gridMinX + x * cellSize, MinY + floor * cellHeight, gridMinZ + z * cellSize});
+		return it->second;
+	};
+
+	std::vector<std::vector<int32_t>> rectangles;
+	std::vector<int32_t> rows;
+	for (uint32_t first = 0; first < spans.size(); first++)
+	{
+		OpenSpan const& seed = spans[first];
+		if (seed.Removed || seed.Polygon != -1 || !inCore(seed))
+			continue;
+		auto accepts = [&](int32_t index)
+		{
+			if (index == -1)
+				return false;
+			OpenSpan const& span = spans[index];
+			return !span.Removed && span.Polygon == -1 && inCore(span) &&
+				   std::abs(int(span.Floor) - int(seed.Floor)) <= rise;
+		};
+
+		rows.assign(1, int32_t(first));
+		while (rows.size() < Config.MaxPolygonCells && accepts(spans[rows.back()].Neighbours[2]))
+			rows.push_back(spans[rows.back()].Neighbours[2]);
+		size_t width = rows.size(), height = 1;
+		while (height < Config.MaxPolygonCells)
+		{
+			size_t previousRow = (height - 1) * width;
+			bool fits = true;
+			for (size_t k = 0; k < width && fits; k++)
+			{
+				int32_t next = spans[rows[previousRow + k]].Neighbours[1];
+				fits = accepts(next) && (k == 0 || spans[rows[previousRow + width + k - 1]].Neighbours[2] == next);
+				if (fits)
+					rows.push_back(next);
+			}
+			if (!fits)
+			{
+				rows.resize(height * width);
+				break;
+			}
+			height++;
+		}
+
+		int32_t polygon = int32_t(rectangles.size());
+		for (int32_t index : rows)
+			spans[index].Polygon = polygon;
+		tile.WalkableCells += uint32_t(rows.size());
+		OpenSpan const& corner00 = spans[rows[0]];
+		OpenSpan const& corner10 = spans[rows[width - 1]];
+		OpenSpan const& corner11 = spans[rows[height * width - 1]];
+		OpenSpan const& corner01 = spans[rows[(height - 1) * width]];
+		NavPolygon navPolygon;
+		navPolygon.Vertices = {addVertex(corner00.X, corner00.Z, corner00.Floor),
+							   addVertex(corner10.X + 1, corner10.Z, corner10.Floor),
+							   addVertex(corner11.X + 1, corner11.Z + 1, corner11.Floor),
+							   addVertex(corner01.X, corner01.Z + 1, corner01.Floor)};
+		tile.Polygons.push_back(navPolygon);
+		rectangles.push_back(rows);
+	}
+
+	// Links across the rectangle edges
+	for (uint32_t polygon = 0; polygon < rectangles.size(); polygon++)
+	{
+		NavPolygon& navPolygon = tile.Polygons[polygon];
+		navPolygon.FirstLink = uint32_t(tile.Links.size());
+		for (int32_t index : rectangles[polygon])
+			for (int side = 0; side < 4; side++)
+			{
+				int32_t neighbour = spans[index].Neighbours[side];
+				if (neighbour == -1 || spans[neighbour].Removed || spans[neighbour].Polygon == int32_t(polygon))
+					continue;
+				if (!inCore(spans[neighbour]))
+				{
+					navPolygon.OpenSides |= uint8_t(1 << side);
+					continue;
+				}
+				uint32_t other = uint32_t(spans[neighbour].Polygon);
+				auto links = std::span(tile.Links).subspan(navPolygon.FirstLink);
+				if (std::ranges::find(links, other) == links.end())
+					tile.Links.push_back(other);
+			}
+		navPolygon.LinkCount = uint16_t(tile.Links.size() - navPolygon.FirstLink);
+	}
+
+	tile.BuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return tile;
+}
+
+} // namespace rad::proc
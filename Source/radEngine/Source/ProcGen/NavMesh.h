@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rad::proc
+{
+
+struct NavVertex
+{
+	float X = 0, Y = 0, Z = 0;
+};
+
+/*
+Walkable rectangle of a tile, vertices go around it starting at its min x, min z corner. The heights are the floors of
+the corner cells, so a polygon on a slope isn't planar but stays within MaxPolygonRise of its first cell.
+*/
+struct NavPolygon
+{
+	std::array<uint16_t, 4> Vertices{};
+	// Range in NavMeshTile::Links of the polygons of the same tile sharing an edge with this one
+	uint32_t FirstLink = 0;
+	uint16_t LinkCount = 0;
+	// Bit per side (-x, +z, +x, -z) where the walkable area carries on into the neighbouring tile
+	uint8_t OpenSides = 0;
+};
+
+struct NavMeshTile
+{
+	uint32_t X = 0, Y = 0;
+	std::vector<NavVertex> Vertices;
+	std::vector<NavPolygon> Polygons;
+	std::vector<uint32_t> Links;
+	uint32_t WalkableCells = 0;
+	double BuildMs = 0.0;
+};
+
+/*
+Tiled navigation mesh baked from a heightfield and triangle meshes, in the spirit of Recast.
+
+Per tile, plus a border wide enough for the agent radius:
+	1. Voxelize the heightfield columns and the triangles into solid spans, the top of a span is walkable when its
+	   surface is flatter than MaxSlopeDegrees. Ledges lower than MaxClimb keep the walkable flag of the span below.
+	2. Open spans are the walkable tops with AgentHeight of room above, linked to the open spans of the 4 neighbouring
+	   columns that are within MaxClimb and leave AgentHeight of room between them.
+	3. Spans closer than AgentRadius to an edge of the walkable area (4-connected distance) are dropped.
+	4. The rest is greedily merged into rectangles of up to MaxPolygonCells cells on a side.
+
+Tiles only depend on the input inside their bounds and border, so they build in parallel and only the tiles touched by
+a changed heightfield cell or an added mesh are rebuilt.
+*/
+struct NavMeshBuilder
+{
+	struct Settings
+	{
+		float CellSize = 0.5f;
+		float CellHeight = 0.1f;
+		float AgentHeight = 2.0f;
+		float AgentRadius = 0.5f;
+		float MaxClimb = 0.5f;
+		float MaxSlopeDegrees = 40.0f;
+		float MaxPolygonRise = 1.0f;
+		uint32_t TileSize = 64;
+		uint32_t MaxPolygonCells = 16;
+		// 0 picks DefaultThreadCount()
+		uint32_t ThreadCount = 0;
+	};
+
+	struct BuildStats
+	{
+		uint32_t BuiltTiles = 0;
+		double TotalMs = 0.0;
+		double MeanTileMs = 0.0;
+		double MaxTileMs = 0.0;
+	};
+
+	// Bounds of the mesh on the xz plane, every tile is dirty until the first Build
+	NavMeshBuilder(Settings const& settings, float minX, float minZ, float maxX, float maxZ);
+
+	// Heights of a width x height grid whose sample (i, j) sits at (originX + i * spacing, originZ + j * spacing).
+	// Marks the tiles around the samples that moved by more than tolerance, or all of them when the grid changed, and
+	// returns how many tiles are dirty.
+	uint32_t SetHeightfield(std::span<const float> heights, uint32_t width, uint32_t height, float originX,
+							float originZ, float spacing, float tolerance = 0.0f);
+	// World space triangles, 3 floats per position
+	void AddMesh(std::span<const float> positions, std::span<const uint32_t> indices);
+	void ClearMeshes();
+	void MarkDirty(float minX, float minZ, float maxX, float maxZ);
+
+	// Rebuilds the dirty tiles, returns how many were built
+	uint32_t Build();
+
+	std::span<const NavMeshTile> GetTiles() const
+	{
+		return Tiles;
+	}
+	uint32_t GetTilesX() const
+	{
+		return TilesX;
+	}
+	uint32_t GetTilesY() const
+	{
+		return TilesY;
+	}
+	uint32_t GetDirtyTileCount() const;
+	size_t GetPolygonCount() const;
+	BuildStats const& GetLastBuildStats() const
+	{
+		return LastBuild;
+	}
+	Settings const& GetSettings() const
+	{
+		return Config;
+	}
+
+  private:
+	NavMeshTile BuildTile(uint32_t tileX, uint32_t tileY) const;
+	// Clamped to the edge of the heightfield, inside is false when the point lies off it
+	float SampleHeightfield(float x, float z, bool& inside) const;
+	void MarkTilesInRect(float minX, float minZ, float maxX, float maxZ);
+
+	Settings Config;
+	float MinX = 0, MinZ = 0;
+	uint32_t TilesX = 0, TilesY = 0;
+	// Cells around a tile that are voxelized with it
+	uint32_t Border = 0;
+	float MinY = 0, MaxY = 0;
+
+	std::vector<float> Heights;
+	uint32_t HeightsWidth = 0, HeightsHeight = 0;
+	float HeightsOriginX = 0, HeightsOriginZ = 0, HeightsSpacing = 1.0f;
+
+	// 9 floats per triangle, each tile lists the triangles overlapping it and its border
+	std::vector<float> Triangles;
+	std::vector<std::vector<uint32_t>> TileTriangles;
+
+	std::vector<NavMeshTile> Tiles;
+	std::vector<uint8_t> Dirty;
+	BuildStats LastBuild;
+};
+
+} // namespace rad::proc
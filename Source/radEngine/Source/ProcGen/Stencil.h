@@ -0,0 +1,154 @@
+#pragma once
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace rad::proc
+{
+
+enum class StencilBorder
+{
+	// Reads past the edge repeat the edge value
+	Clamp,
+	// Reads past the edge come from the opposite side
+	Wrap,
+};
+
+struct StencilSettings
+{
+	// Reach of the kernel in cells, every input row is readable from -Radius to Count + Radius and every row up to
+	// Radius above and below the current one
+	uint32_t Radius = 0;
+	StencilBorder Border = StencilBorder::Clamp;
+	// 256 x 32 floats with a small halo stays well inside L2 for a few input planes
+	uint32_t TileWidth = 256;
+	uint32_t TileHeight = 32;
+	// 0 picks DefaultThreadCount()
+	uint32_t ThreadCount = 0;
+};
+
+// One row segment of a tile as handed to the kernel. The inputs point into a copy of the tile with its halo already
+// resolved, so the kernel's loop over Count has no bounds checks and vectorizes.
+template <size_t InputCount, size_t OutputCount>
+struct StencilRow
+{
+	uint32_t X = 0;
+	uint32_t Y = 0;
+	uint32_t Count = 0;
+	std::array<float const*, InputCount> Inputs{};
+	std::array<float*, OutputCount> Outputs{};
+	ptrdiff_t InputPitch = 0;
+
+	// Row dy away from the current one, element i is the cell at X + i
+	float const* In(size_t plane, int dy = 0) const
+	{
+		return Inputs[plane] + dy * InputPitch;
+	}
+	float* Out(size_t plane) const
+	{
+		return Outputs[plane];
+	}
+};
+
+inline uint32_t ResolveStencilBorder(int64_t coordinate, uint32_t size, StencilBorder border)
+{
+	if (border == StencilBorder::Clamp)
+		return uint32_t(std::clamp<int64_t>(coordinate, 0, int64_t(size) - 1));
+	int64_t wrapped = coordinate % int64_t(size);
+	return uint32_t(wrapped < 0 ? wrapped + size : wrapped);
+}
+
+/*
+Runs kernel(StencilRow const&) over every row segment of a width x height map, tile by tile on ParallelFor. Each tile
+copies its inputs plus a Radius wide halo into a per thread buffer, resolving the border there, with a Radius of 0 the
+inputs are read in place. All planes are tightly packed width x height floats. Outputs may alias inputs only when
+Radius is 0, otherwise a tile could read cells another tile already wrote.
+*/
+template <size_t InputCount, size_t OutputCount, typename Kernel>
+void RunStencil(std::array<std::span<const float>, InputCount> const& inputs,
+				std::array<std::span<float>, OutputCount> const& outputs, uint32_t width, uint32_t height,
+				StencilSettings const& settings, Kernel&& kernel)
+{
+	if (width == 0 || height == 0)
+		return;
+	[[maybe_unused]] auto coversMap = [&](auto const& plane) { return plane.size() >= size_t(width) * height; };
+	assert(std::ranges::all_of(inputs, coversMap) && std::ranges::all_of(outputs, coversMap));
+
+	uint32_t tileWidth = std::min(settings.TileWidth, width), tileHeight = std::min(settings.TileHeight, height);
+	uint32_t tilesX = (width + tileWidth - 1) / tileWidth, tilesY = (height + tileHeight - 1) / tileHeight;
+	int radius = int(settings.Radius);
+	size_t pitch = tileWidth + 2 * size_t(radius);
+	size_t planeSize = pitch * (tileHeight + 2 * size_t(radius));
+
+	ParallelFor(tilesX * tilesY, settings.ThreadCount,
+				[&](uint32_t tile)
+				{
+					uint32_t x0 = tile % tilesX * tileWidth, y0 = tile / tilesX * tileHeight;
+					uint32_t w = std::min(tileWidth, width - x0), h = std::min(tileHeight, height - y0);
+
+					StencilRow<InputCount, OutputCount> stencilRow;
+					stencilRow.X = x0;
+					stencilRow.Count = w;
+					auto runRows = [&](auto&& inputRow)
+					{
+						for (uint32_t row = 0; row < h; row++)
+						{
+							stencilRow.Y = y0 + row;
+							for (size_t plane = 0; plane < InputCount; plane++)
+								stencilRow.Inputs[plane] = inputRow(plane, row);
+							for (size_t plane = 0; plane < OutputCount; plane++)
+								stencilRow.Outputs[plane] = outputs[plane].data() + size_t(y0 + row) * width + x0;
+							kernel(std::as_const(stencilRow));
+						}
+					};
+
+					// Without a halo the kernel can read the source rows directly
+					if (radius == 0)
+					{
+						stencilRow.InputPitch = ptrdiff_t(width);
+						runRows([&](size_t plane, uint32_t row)
+								{ return inputs[plane].data() + size_t(y0 + row) * width + x0; });
+						return;
+					}
+
+					thread_local std::vector<float> scratch;
+					scratch.resize(std::max(scratch.size(), InputCount * planeSize));
+					// Columns of the tile and its halo that can be copied straight from the source row
+					int64_t first = std::max<int64_t>(int64_t(x0) - radius, 0);
+					int64_t last = std::min<int64_t>(int64_t(x0) + w + radius, width);
+
+					for (size_t plane = 0; plane < InputCount; plane++)
+					{
+						float* tileRows = scratch.data() + plane * planeSize;
+						for (int row = -radius; row < int(h) + radius; row++)
+						{
+							float const* source =
+								inputs[plane].data() +
+								size_t(ResolveStencilBorder(int64_t(y0) + row, height, settings.Border)) * width;
+							float* target = tileRows + size_t(row + radius) * pitch;
+							int64_t column = int64_t(x0) - radius;
+							for (; column < first; column++)
+								*target++ = source[ResolveStencilBorder(column, width, settings.Border)];
+							std::memcpy(target, source + first, size_t(last - first) * sizeof(float));
+							target += last - first;
+							for (column = last; column < int64_t(x0) + w + radius; column++)
+								*target++ = source[ResolveStencilBorder(column, width, settings.Border)];
+						}
+					}
+
+					stencilRow.InputPitch = ptrdiff_t(pitch);
+					runRows([&](size_t plane, uint32_t row)
+							{ return scratch.data() + plane * planeSize + size_t(row + radius) * pitch + radius; });
+				});
+}
+
+} // namespace rad::proc
@@ -0,0 +1,226 @@
+#include "StrataColumns.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+namespace rad::proc
+{
+
+StrataColumns::StrataColumns(uint32_t width, uint32_t height)
+	: Width(width), Height(height), Columns(size_t(width) * height), TopSoftness(size_t(width) * height)
+{
+	std::fill(TopSoftness.begin(), TopSoftness.end(), BedrockSoftness);
+}
+
+void StrataColumns::BuildFromBands(std::span<const float> heights, std::span<const StrataLayer> bands)
+{
+	assert(heights.size() >= Columns.size() && !bands.empty());
+	Arena.clear();
+	for (auto& freeList : FreeBlocks)
+		freeList.clear();
+	std::fill(Columns.begin(), Columns.end(), Column{});
+	std::fill(TopSoftness.begin(), TopSoftness.end(), BedrockSoftness);
+
+	for (size_t i = 0; i < Columns.size(); i++)
+	{
+		float elevation = 0.0f;
+		for (size_t band = 0; elevation < heights[i]; band = (band + 1) % bands.size())
+		{
+			float thickness = std::min(bands[band].Thickness, heights[i] - elevation);
+			Deposit(i, thickness, bands[band].Softness);
+			elevation += thickness;
+		}
+	}
+	Compact();
+}
+
+void StrataColumns::Compact()
+{
+	auto capacityClassFor = [](uint16_t count)
+	{ return std::max<uint8_t>(InitialCapacityClass, uint8_t(std::bit_width(count - 1u))); };
+	size_t arenaSize = 0;
+	for (auto const& col : Columns)
+		if (col.Count)
+			arenaSize += size_t(1) << capacityClassFor(col.Count);
+
+	std::vector<StrataLayer> arena;
+	arena.reserve(arenaSize);
+	for (auto& col : Columns)
+	{
+		if (!col.Count)
+		{
+			col = Column{};
+			continue;
+		}
+		uint8_t capacityClass = capacityClassFor(col.Count);
+		uint32_t offset = uint32_t(arena.size());
+		arena.resize(arena.size() + (size_t(1) << capacityClass));
+		std::copy_n(Arena.begin() + col.Offset, col.Count, arena.begin() + offset);
+		col.Offset = offset;
+		col.CapacityClass = capacityClass;
+	}
+	Arena = std::move(arena);
+	for (auto& freeList : FreeBlocks)
+		freeList.clear();
+}
+
+std::span<const StrataLayer> StrataColumns::GetLayers(size_t column) const
+{
+	auto const& col = Columns[column];
+	return std::span<const StrataLayer>(Arena.data() + col.Offset, col.Count);
+}
+
+float StrataColumns::GetThickness(size_t column) const
+{
+	float thickness = 0.0f;
+	for (auto const& layer : GetLayers(column))
+		thickness += layer.Thickness;
+	return thickness;
+}
+
+float StrataColumns::GetSoftnessAtDepth(size_t column, float depth) const
+{
+	auto layers = GetLayers(column);
+	for (auto it = layers.rbegin(); it != layers.rend(); ++it)
+	{
+		if (depth < it->Thickness)
+			return it->Softness;
+		depth -= it->Thickness;
+	}
+	return BedrockSoftness;
+}
+
+void StrataColumns::GetTopSoftnessMap(std::span<float> outSoftness) const
+{
+	assert(outSoftness.size() >= TopSoftness.size());
+	std::copy(TopSoftness.begin(), TopSoftness.end(), outSoftness.begin());
+}
+
+void StrataColumns::UpdateTopSoftness(size_t column)
+{
+	auto const& col = Columns[column];
+	TopSoftness[column] = col.Count ? Arena[col.Offset + col.Count - 1].Softness : BedrockSoftness;
+}
+
+float StrataColumns::Erode(size_t column, float amount)
+{
+	auto& col = Columns[column];
+	float removed = 0.0f;
+	while (amount > 0.0f && col.Count)
+	{
+		auto& top = Arena[col.Offset + col.Count - 1];
+		float taken = std::min(top.Thickness, amount);
+		top.Thickness -= taken;
+		amount -= taken;
+		removed += taken;
+		if (top.Thickness < MinThickness)
+		{
+			// The sliver left of a dropped layer joins the one below, or is removed with it at the bottom
+			float leftover = top.Thickness;
+			col.Count--;
+			if (col.Count)
+				Arena[col.Offset + col.Count - 1].Thickness += leftover;
+			else
+				removed += leftover;
+		}
+	}
+	UpdateTopSoftness(column);
+	return removed;
+}
+
+void StrataColumns::Deposit(size_t column, float amount, float softness)
+{
+	if (amount <= 0.0f)
+		return;
+	auto& col = Columns[column];
+	if (col.Count)
+	{
+		auto& top = Arena[col.Offset + col.Count - 1];
+		if (std::abs(top.Softness - softness) <= MergeTolerance)
+		{
+			float thickness = top.Thickness + amount;
+			top.Softness = (top.Softness * top.Thickness + softness * amount) / thickness;
+			top.Thickness = thickness;
+			UpdateTopSoftness(column);
+			return;
+		}
+	}
+	PushLayer(col, {amount, softness});
+	UpdateTopSoftness(column);
+}
+
+size_t StrataColumns::GetLayerCount() const
+{
+	size_t count = 0;
+	for (auto const& col : Columns)
+		count += col.Count;
+	return count;
+}
+
+void StrataColumns::PushLayer(Column& column, StrataLayer layer)
+{
+	if (column.Count >= MaxLayersPerColumn)
+		MergeClosestLayers(column);
+	if (column.CapacityClass == NoBlock || column.Count >= (1u << column.CapacityClass))
+		Grow(column);
+	Arena[column.Offset + column.Count++] = layer;
+}
+
+void StrataColumns::Grow(Column& column)
+{
+	if (column.CapacityClass == NoBlock)
+	{
+		column.Offset = AllocateBlock(InitialCapacityClass);
+		column.CapacityClass = InitialCapacityClass;
+		return;
+	}
+	uint8_t capacityClass = column.CapacityClass + 1;
+	assert(capacityClass < CapacityClassCount);
+	uint32_t offset = AllocateBlock(capacityClass);
+	std::copy_n(Arena.begin() + column.Offset, column.Count, Arena.begin() + offset);
+	FreeBlocks[column.CapacityClass].push_back(column.Offset);
+	column.Offset = offset;
+	column.CapacityClass = capacityClass;
+}
+
+void StrataColumns::MergeClosestLayers(Column& column)
+{
+	assert(column.Count >= 2);
+	StrataLayer* layers = Arena.data() + column.Offset;
+	uint32_t best = 0;
+	float bestDifference = INFINITY;
+	for (uint32_t i = 0; i + 1 < column.Count; i++)
+	{
+		float difference = std::abs(layers[i].Softness - layers[i + 1].Softness);
+		if (difference < bestDifference)
+		{
+			bestDifference = difference;
+			best = i;
+		}
+	}
+	auto& lower = layers[best];
+	auto const& upper = layers[best + 1];
+	float thickness = lower.Thickness + upper.Thickness;
+	lower.Softness = (lower.Softness * lower.Thickness + upper.Softness * upper.Thickness) / thickness;
+	lower.Thickness = thickness;
+	std::copy(layers + best + 2, layers + column.Count, layers + best + 1);
+	column.Count--;
+}
+
+uint32_t StrataColumns::AllocateBlock(uint8_t capacityClass)
+{
+	auto& freeList = FreeBlocks[capacityClass];
+	if (!freeList.empty())
+	{
+		uint32_t offset = freeList.back();
+		freeList.pop_back();
+		return offset;
+	}
+	uint32_t offset = uint32_t(Arena.size());
+	Arena.resize(Arena.size() + (size_t(1) << capacityClass));
+	return offset;
+}
+
+} // namespace rad::proc
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rad::proc
+{
+
+struct StrataLayer
+{
+	float Thickness = 0.0f;
+	// Same meaning as SoftnessMap, scales how fast the layer is eroded
+	float Softness = 0.0f;
+};
+
+/*
+Layered material model of a heightfield: every column holds a run-length list of layers, bottom layer first, and the
+column's thickness is the terrain height. Anything below the bottom layer is bedrock.
+
+Layers of all columns live in one arena, each column owning a block whose capacity is a power of two. Blocks that a
+column outgrows go to a free list of their size and are reused by other columns, so the arena stops growing once the
+columns have settled. A column never holds more than MaxLayersPerColumn layers, past that the two adjacent layers with
+the closest softness are merged.
+*/
+struct StrataColumns
+{
+	float BedrockSoftness = 0.05f;
+	// A deposit onto a top layer this close in softness thickens it instead of adding a layer
+	float MergeTolerance = 0.02f;
+	// Layers thinner than this are dropped when eroding
+	float MinThickness = 1e-4f;
+	// At most 128, the largest block size
+	uint32_t MaxLayersPerColumn = 16;
+
+	StrataColumns() = default;
+	StrataColumns(uint32_t width, uint32_t height);
+
+	// Fills every column up to its height with bands, repeated from elevation 0 upwards
+	void BuildFromBands(std::span<const float> heights, std::span<const StrataLayer> bands);
+	// Rewrites the arena in column order with the smallest blocks that fit, dropping the free lists
+	void Compact();
+
+	std::span<const StrataLayer> GetLayers(size_t column) const;
+	float GetThickness(size_t column) const;
+	float GetTopSoftness(size_t column) const
+	{
+		return TopSoftness[column];
+	}
+	float GetSoftnessAtDepth(size_t column, float depth) const;
+	void GetTopSoftnessMap(std::span<float> outSoftness) const;
+
+	// Removes up to amount from the top of the column and returns how much was removed. That is less than amount once
+	// the column runs out of layers, and can exceed it by less than MinThickness when the bottom layer is dropped.
+	float Erode(size_t column, float amount);
+	void Deposit(size_t column, float amount, float softness);
+
+	uint32_t GetWidth() const
+	{
+		return Width;
+	}
+	uint32_t GetHeight() const
+	{
+		return Height;
+	}
+	size_t GetLayerCount() const;
+	size_t GetArenaBytes() const
+	{
+		return Arena.capacity() * sizeof(StrataLayer) + Columns.capacity() * sizeof(Column) +
+			   TopSoftness.capacity() * sizeof(float);
+	}
+
+  private:
+	static constexpr uint8_t NoBlock = 0xFF;
+	// Blocks hold 1 << CapacityClass layers, a column starts with 4
+	static constexpr uint8_t InitialCapacityClass = 2;
+	static constexpr size_t CapacityClassCount = 8;
+
+	struct Column
+	{
+		uint32_t Offset = 0;
+		uint16_t Count = 0;
+		uint8_t CapacityClass = NoBlock;
+	};
+
+	void PushLayer(Column& column, StrataLayer layer);
+	void Grow(Column& column);
+	void MergeClosestLayers(Column& column);
+	uint32_t AllocateBlock(uint8_t capacityClass);
+	void UpdateTopSoftness(size_t column);
+
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<Column> Columns;
+	std::vector<StrataLayer> Arena;
+	// Softness of the exposed layer of every column, kept apart since erosion reads it for every cell
+	std::vector<float> TopSoftness;
+	std::array<std::vector<uint32_t>, CapacityClassCount> FreeBlocks;
+};
+
+} // namespace rad::proc
@@ -4,125 +4,20 @@
 #include "Graphics/ShaderManager.h"
 #include "Graphics/TextureManager.h"
 #include <random>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 #include "Compute/Terrain/TerrainResources.hlsli"
 #include "Compute/Terrain/TerrainConstantBuffers.hlsli"
 #include "Systems.h"
+#include "MapFilters.h"
+#include "DiamondSquare.h"
 #include "stb_image.h"
 
 namespace rad::proc
 {
-size_t GetIndex(size_t x, size_t y, size_t width)
-{
-	return x + y * width;
-}
-
-template <typename T> struct MapVector : std::vector<T>
-{
-	size_t X, Y;
-	MapVector(size_t x, size_t y) : std::vector<T>(x * y), X(x), Y(y) {}
-	T& operator()(size_t x, size_t y)
-	{
-		return this->at(GetIndex(x, y, X));
-	}
-};
-
 static std::mt19937 generator = std::mt19937();
 
-// from https://medium.com/@nickobrien/diamond-square-algorithm-explanation-and-c-implementation-5efa891e486f
-float random()
-{
-	std::uniform_real_distribution<float> distribution(0.f, 1.f);
-	return distribution(generator);
-}
-
-float randomRange(float range)
-{
-	return (random() * 2.f - 1.f) * range;
-}
-
-void diamondStep(MapVector<float>& map, int x, int y, int reach, float roughness)
-{
-	int count = 0;
-	float avg = 0.0f;
-	if (x - reach >= 0)
-	{
-		avg += map(x - reach, y);
-		count++;
-	}
-	if (x + reach < map.X)
-	{
-		avg += map(x + reach, y);
-		count++;
-	}
-	if (y - reach >= 0)
-	{
-		avg += map(x, y - reach);
-		count++;
-	}
-	if (y + reach < map.Y)
-	{
-		avg += map(x, y + reach);
-		count++;
-	}
-	avg /= (float)count;
-	avg += randomRange(reach / (float)map.X) * roughness;
-	map(x, y) = avg;
-}
-
-void squareStep(MapVector<float>& map, int x, int y, int reach, float roughness)
-{
-	int count = 0;
-	float avg = 0.0f;
-	if (x - reach >= 0 && y - reach >= 0)
-	{
-		avg += map(x - reach, y - reach);
-		count++;
-	}
-	if (x - reach >= 0 && y + reach < map.Y)
-	{
-		avg += map(x - reach, y + reach);
-		count++;
-	}
-	if (x + reach < map.X && y - reach >= 0)
-	{
-		avg += map(x + reach, y - reach);
-		count++;
-	}
-	if (x + reach < map.X && y + reach < map.Y)
-	{
-		avg += map(x + reach, y + reach);
-		count++;
-	}
-	avg /= (float)count;
-	avg += randomRange(reach / (float)(map.X - 1)) * roughness;
-	map(x, y) = avg;
-}
-
-void diamondSquare(MapVector<float>& map, int size, float roughness)
-{
-	int half = size / 2;
-	if (half < 1)
-		return;
-	// square steps
-	for (int y = half; y < map.Y; y += size)
-		for (int x = half; x < map.X; x += size)
-			squareStep(map, x % map.X, y % map.Y, half, roughness);
-	// diamond steps
-	int col = 0;
-	for (int x = 0; x < map.X; x += half)
-	{
-		col++;
-		// If this is an odd column.
-		if (col % 2 == 1)
-			for (int y = half; y < map.Y; y += size)
-				diamondStep(map, x % map.X, y % map.Y, half, roughness);
-		else
-			for (int y = 0; y < map.Y; y += size)
-				diamondStep(map, x % map.X, y % map.Y, half, roughness);
-	}
-	diamondSquare(map, size / 2, roughness);
-}
-
 bool TerrainErosionSystem::Setup()
 {
 	HeightMapToTerrainMaterialPSO = PipelineState::CreateBindlessComputePipeline(
@@ -131,10 +26,10 @@ bool TerrainErosionSystem::Setup()
 	HeightMapToWaterMaterialPSO = PipelineState::CreateBindlessComputePipeline(
 		"HeightToWaterMaterialPipeline", Renderer, RAD_SHADERS_DIR L"Compute/Terrain/HeightMapToWaterMaterial.hlsl");
 
-	ThermalOutfluxPSO = PipelineState::CreateBindlessComputePipeline(
-		"ThermalErosionOutflux", Renderer, RAD_SHADERS_DIR L"Compute/Terrain/T1ThermalOutflux.hlsl");
-	ThermalDepositPSO = PipelineState::CreateBindlessComputePipeline(
-		"ThermalErosionDeposit", Renderer, RAD_SHADERS_DIR L"Compute/Terrain/T2ThermalDeposit.hlsl");
+	ThermalErosionPSO = PipelineState::CreateBindlessComputePipeline(
+		"ThermalErosion", Renderer, RAD_SHADERS_DIR L"Compute/Terrain/T1ThermalErosion.hlsl");
+	WaterChunkMaxPSO = PipelineState::CreateBindlessComputePipeline(
+		"WaterChunkMax", Renderer, RAD_SHADERS_DIR L"Compute/Terrain/WaterChunkMax.hlsl");
 
 	HydrolicAddWaterPSO = PipelineState::CreateBindlessComputePipeline(
 		"HydrolicAddWater", Renderer, RAD_SHADERS_DIR L"Compute/Terrain/H1AddWater.hlsl");
@@ -280,25 +175,7 @@ bool TerrainErosionSystem::Setup()
 
 std::vector<float> TerrainErosionSystem::CreateDiamondSquareHeightMap(uint32_t width, float roughness)
 {
-	// Make sure width is a power of two
-	assert(std::log2(width) == std::floor(std::log2(width)));
-
-	width = width + 1;
-	MapVector<float> heightMap(width, width);
-	heightMap[0] = random();
-	heightMap[width - 1] = random();
-	heightMap[width * (width - 1)] = random();
-	heightMap[width * width - 1] = random();
-
-	diamondSquare(heightMap, width - 1, roughness);
-
-	// Get rid of rightmost column and bottom row to make it a power of two
-	float min = FLT_MAX, max = FLT_MIN;
-	std::vector<float> heightMapVals((width - 1) * (width - 1));
-	for (int y = 0; y < width - 1; y++)
-		for (int x = 0; x < width - 1; x++)
-			heightMapVals[GetIndex(x, y, width - 1)] = heightMap(x, y);
-	return heightMapVals;
+	return proc::CreateDiamondSquareHeightMap(width, roughness, generator);
 }
 
 CTerrain TerrainErosionSystem::CreateTerrain(uint32_t heightMapWidth)
@@ -329,14 +206,30 @@ CTerrain TerrainErosionSystem::CreateTerrain(uint32_t heightMapWidth)
 	baseTextureInfo.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
 	terrain.WaterOutflux =
 		std::make_shared<RWTexture>(DXTexture::Create(Renderer.GetDevice(), L"WaterOutflux", baseTextureInfo));
-	terrain.ThermalPipe1 =
-		std::make_shared<RWTexture>(DXTexture::Create(Renderer.GetDevice(), L"ThermalPipe1", baseTextureInfo));
-	terrain.ThermalPipe2 =
-		std::make_shared<RWTexture>(DXTexture::Create(Renderer.GetDevice(), L"ThermalPipe2", baseTextureInfo));
 
 	baseTextureInfo.Format = DXGI_FORMAT_R32G32_FLOAT;
 	terrain.VelocityMap =
 		std::make_shared<RWTexture>(DXTexture::Create(Renderer.GetDevice(), L"VelocityMap", baseTextureInfo));
+
+	auto timer = std::make_shared<ErosionGPUTimer>();
+	timer->PairCount = Renderer.FramesInFlight + 2;
+	D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+	queryHeapDesc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = timer->PairCount * 2;
+	if (SUCCEEDED(Renderer.GetDevice().CreateQueryHeap(&queryHeapDesc, IID_PPV_ARGS(&timer->QueryHeap))) &&
+		SUCCEEDED(Renderer.CommandQueue->GetTimestampFrequency(&timer->TimestampFrequency)))
+	{
+		timer->QueryHeap->SetName(L"ErosionTimestamps");
+		terrain.ErosionTimer = std::move(timer);
+	}
+	terrain.WaterBodies = std::make_shared<WaterBodySurvey>();
+	terrain.Undo = std::make_shared<TerrainUndoState>();
+	terrain.NavMesh = std::make_shared<TerrainNavMesh>();
+
+	// History captures read back four maps at once, the ring has to hold them together
+	auto mapFootprint = ComputeRegionFootprint(heightMapWidth, heightMapWidth, sizeof(float));
+	uint64_t mapBytes = AlignUp(mapFootprint.TotalBytes, TextureDataPlacementAlignment);
+	Renderer.Readback->Reserve(Renderer.GetDevice(), 4 * mapBytes);
 	return terrain;
 }
 
@@ -346,23 +239,12 @@ void TerrainErosionSystem::GenerateBaseHeightMap(CommandRecord& cmdRecord, CTerr
 												 OptionalRef<CWaterRenderable> waterRenderable)
 {
 	// create heightmap
-	constexpr auto scaleHeightMaps = [](float* data, size_t size, float min, float max)
-	{
-		float valsMin = FLT_MAX, valsMax = FLT_MIN;
-		for (size_t i = 0; i < size; i++)
-		{
-			valsMin = std::min(valsMin, data[i]);
-			valsMax = std::max(valsMax, data[i]);
-		}
-		float oneOverRange = 1.0 / (valsMax - valsMin);
-		for (size_t i = 0; i < size; i++)
-			data[i] = std::pow((data[i] - valsMin) * oneOverRange, 2.0f) * (max - min) + min;
-	};
 	if (parameters.BaseFromFile)
 	{
 		int width, height, channels;
 		float* heightMapVals = stbi_loadf(RAD_ASSETS_DIR "heightmap.png", &width, &height, &channels, 1);
-		scaleHeightMaps(heightMapVals, width * height, parameters.MinHeight, parameters.MaxHeight);
+		RemapRange(std::span<float>(heightMapVals, size_t(width) * height), width, height, parameters.MinHeight,
+				   parameters.MaxHeight, 2.0f);
 		cmdRecord.Push(
 			"UploadHeightMap",
 			[heightMap = terrain.HeightMap, heightMapVals, width, height, channels](CommandContext& cmdContext)
@@ -378,7 +260,8 @@ void TerrainErosionSystem::GenerateBaseHeightMap(CommandRecord& cmdRecord, CTerr
 		else
 			generator = std::mt19937(time(0));
 		auto heightMapVals = CreateDiamondSquareHeightMap(terrain.HeightMap->Info.Width, parameters.InitialRoughness);
-		scaleHeightMaps(heightMapVals.data(), heightMapVals.size(), parameters.MinHeight, parameters.MaxHeight);
+		RemapRange(heightMapVals, terrain.HeightMap->Info.Width, terrain.HeightMap->Info.Width, parameters.MinHeight,
+				   parameters.MaxHeight, 2.0f);
 		cmdRecord.Push("UploadHeightMap", [heightMap = terrain.HeightMap,
 										   heightMapVals = std::move(heightMapVals)](CommandContext& cmdContext)
 					   { heightMap->UploadDataTyped<float>(cmdContext, heightMapVals); });
@@ -432,25 +315,39 @@ void TerrainErosionSystem::GenerateBaseHeightMap(CommandRecord& cmdRecord, CTerr
 void TerrainErosionSystem::ErodeTerrain(CommandRecord& cmdRecord, CTerrain& terrain,
 										CErosionParameters const& parameters,
 										OptionalRef<CTerrainRenderable> terrainRenderable,
-										OptionalRef<CWaterRenderable> waterRenderable)
+										OptionalRef<CWaterRenderable> waterRenderable, uint64_t frameNumber)
 {
-	for (int i = 0; i < parameters.Iterations; i++)
+	// Only erosion running each frame is timed, a single step would feed the budget a count it didn't pick
+	auto timer = frameNumber != 0 && parameters.ErodeEachFrame ? terrain.ErosionTimer : nullptr;
+	uint32_t iterations = uint32_t(std::max(parameters.Iterations, 0));
+	if (parameters.UseTimeBudget)
+		iterations = timer ? terrain.ErosionBudget.NextIterationCount(parameters.TimeBudgetMs)
+						   : terrain.ErosionBudget.GetIterationCount(parameters.TimeBudgetMs);
+	uint32_t timerPair = 0;
+	if (timer)
+	{
+		timerPair = timer->NextPair;
+		timer->NextPair = (timer->NextPair + 1) % timer->PairCount;
+		cmdRecord.Push("ErosionTimerBegin",
+					   [timer, timerPair](CommandContext& commandCtx)
+					   { commandCtx->EndQuery(timer->QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, timerPair * 2); });
+	}
+
+	for (uint32_t i = 0; i < iterations; i++)
 	{
 
 		cmdRecord.Push(
 			"Erosion",
 			[heightMap = terrain.HeightMap, waterHeightMap = terrain.WaterHeightMap, sedimentMap = terrain.SedimentMap,
 			 tempHeightMap = terrain.TempHeightMap, tempSedimentMap = terrain.TempSedimentMap,
-			 softnessMap = terrain.SoftnessMap, thermalPipe1 = terrain.ThermalPipe1,
-			 thermalPipe2 = terrain.ThermalPipe2, waterOutflux = terrain.WaterOutflux,
+			 softnessMap = terrain.SoftnessMap, waterOutflux = terrain.WaterOutflux,
 			 velocityMap = terrain.VelocityMap, parameters = CErosionParameters(parameters),
 			 iterationCount = terrain.IterationCount, hydrolicAddWaterPSO = Ref(HydrolicAddWaterPSO),
 			 hydrolicCalculateOutfluxPSO = Ref(HydrolicCalculateOutfluxPSO),
 			 hydrolicUpdateWaterVelocityPSO = Ref(HydrolicUpdateWaterVelocityPSO),
 			 hydrolicErosionAndDepositionPSO = Ref(HydrolicErosionAndDepositionPSO),
 			 hydrolicSedimentTransportationAndEvaporationPSO = Ref(HydrolicSedimentTransportationAndEvaporationPSO),
-			 thermalOutfluxPSO = Ref(ThermalOutfluxPSO),
-			 thermalDepositPSO = Ref(ThermalDepositPSO)](CommandContext& commandCtx)
+			 thermalErosionPSO = Ref(ThermalErosionPSO)](CommandContext& commandCtx)
 			{
 				uint32_t width = heightMap->Info.Width;
 				uint32_t height = heightMap->Info.Height;
@@ -458,22 +355,16 @@ void TerrainErosionSystem::ErodeTerrain(CommandRecord& cmdRecord, CTerrain& terr
 				float pipeLength = parameters.TotalLength / width;
 				float crossSection = parameters.PipeCrossSection * pipeLength * pipeLength;
 
-				hlsl::ThermalOutfluxResources outfluxResources{
+				hlsl::ThermalErosionResources thermalResources{
 					.InHeightMapIndex = heightMap->SRV.Index,
 					.InHardnessMapIndex = softnessMap->SRV.Index,
-					.OutFluxTextureIndex1 = thermalPipe1->UAV.Index,
-					.OutFluxTextureIndex2 = thermalPipe2->UAV.Index,
+					.OutHeightMapIndex = tempHeightMap->UAV.Index,
 					.ThermalErosionRate = parameters.ThermalErosionRate,
 					.PipeLength = pipeLength,
 					.SoftnessTalusCoefficient = parameters.SoftnessTalusCoefficient,
 					.MinTalusCoefficient = parameters.MinTalusCoefficient,
 				};
 
-				hlsl::ThermalDepositResources depositResources{
-					.InFluxTextureIndex1 = thermalPipe1->SRV.Index,
-					.InFluxTextureIndex2 = thermalPipe2->SRV.Index,
-					.OutHeightMapIndex = heightMap->UAV.Index,
-				};
 				hlsl::HydrolicAddWaterResources addWaterResources{
 					.WaterMapIndex = waterHeightMap->UAV.Index,
 					.RainRate = parameters.RainRate,
@@ -569,48 +460,61 @@ void TerrainErosionSystem::ErodeTerrain(CommandRecord& cmdRecord, CTerrain& terr
 				commandCtx->CopyResource(sedimentMap->Resource.Get(), tempSedimentMap->Resource.Get());
 
 				TransitionVec()
-					.Add(*thermalPipe1, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
-					.Add(*thermalPipe2, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+					.Add(*tempHeightMap, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
 					.Add(*heightMap, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
 					.Add(*softnessMap, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
 					.Execute(commandCtx);
-				thermalOutfluxPSO->ExecuteCompute(commandCtx, outfluxResources, width / 8, height / 8, 1);
-
+				thermalErosionPSO->ExecuteCompute(commandCtx, thermalResources, width / 8, height / 8, 1);
+				// Copy temp height map to height map
 				TransitionVec()
-					.Add(*thermalPipe1, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
-					.Add(*thermalPipe2, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
-					.Add(*heightMap, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+					.Add(*tempHeightMap, D3D12_RESOURCE_STATE_COPY_SOURCE)
+					.Add(*heightMap, D3D12_RESOURCE_STATE_COPY_DEST)
 					.Execute(commandCtx);
-				thermalDepositPSO->ExecuteCompute(commandCtx, depositResources, width / 8, height / 8, 1);
+				commandCtx->CopyResource(heightMap->Resource.Get(), tempHeightMap->Resource.Get());
 			});
 		terrain.IterationCount++;
 	}
 
+	if (timer)
+		cmdRecord.Push("ErosionTimerEnd",
+					   [timer, timerPair, iterations, readback = Ref(*Renderer.Readback)](CommandContext& commandCtx)
+					   {
+						   commandCtx->EndQuery(timer->QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, timerPair * 2 + 1);
+						   // A full ring just loses this frame's sample
+						   readback->ReadQueries(
+							   commandCtx, *timer->QueryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, timerPair * 2, 2,
+							   [timer, iterations](std::span<const std::byte> data)
+							   {
+								   uint64_t timestamps[2];
+								   std::memcpy(timestamps, data.data(), sizeof(timestamps));
+								   if (timestamps[1] > timestamps[0])
+									   timer->Samples.push_back(
+										   {.Iterations = iterations,
+											.Milliseconds = double(timestamps[1] - timestamps[0]) * 1000.0 /
+															double(timer->TimestampFrequency)});
+							   });
+					   });
+
 	if (terrainRenderable)
 		GenerateTerrainMaterial(cmdRecord, terrain, parameters, *terrainRenderable);
 	if (waterRenderable)
 		GenerateWaterMaterial(cmdRecord, terrain, parameters, *waterRenderable);
 }
 
+void TerrainErosionSystem::CollectErosionTimings(CTerrain& terrain)
+{
+	if (!terrain.ErosionTimer)
+		return;
+	for (auto const& sample : terrain.ErosionTimer->Samples)
+		terrain.ErosionBudget.AddSample(sample.Iterations, sample.Milliseconds);
+	terrain.ErosionTimer->Samples.clear();
+}
+
 CIndexedPlane TerrainErosionSystem::CreatePlane(CommandRecord& cmdRecord, uint32_t resX, uint32_t resY)
 {
-	std::vector<uint32_t> indices((resX - 1) * (resY - 1) * 6);
-	for (uint32_t y = 0; y < resY - 1; y++)
-		for (uint32_t x = 0; x < resX - 1; x++)
-		{
-			auto vtx1 = GetIndex(x, y, resX);
-			auto vtx2 = GetIndex(x + 1, y, resX);
-			auto vtx3 = GetIndex(x, y + 1, resX);
-			auto vtx4 = GetIndex(x + 1, y + 1, resX);
-			indices[6 * GetIndex(x, y, resX - 1) + 0] = vtx1;
-			indices[6 * GetIndex(x, y, resX - 1) + 1] = vtx3;
-			indices[6 * GetIndex(x, y, resX - 1) + 2] = vtx2;
-			indices[6 * GetIndex(x, y, resX - 1) + 3] = vtx3;
-			indices[6 * GetIndex(x, y, resX - 1) + 4] = vtx4;
-			indices[6 * GetIndex(x, y, resX - 1) + 5] = vtx2;
-		}
+	CIndexedPlane plane{.ResX = resX, .ResY = resY, .Grid = WaterChunkGrid{.ResX = resX, .ResY = resY}};
+	auto indices = BuildChunkedPlaneIndices(plane.Grid, plane.ChunkIndexOffsets);
 
-	CIndexedPlane plane{.ResX = resX, .ResY = resY};
 	plane.Indices = std::make_shared<DXTypedBuffer<uint32_t>>(DXTypedBuffer<uint32_t>::Create(
 		Renderer.GetDevice(), L"PlaneIdxBuffer", indices.size(), D3D12_HEAP_TYPE_DEFAULT));
 
@@ -643,7 +547,46 @@ CTerrainRenderable TerrainErosionSystem::CreateTerrainRenderable(CTerrain& terra
 	return renderable;
 }
 
-CWaterRenderable TerrainErosionSystem::CreateWaterRenderable(CTerrain& terrain)
+std::shared_ptr<TerrainVirtualTexture> TerrainErosionSystem::CreateTerrainVirtualTexture(
+	CTerrainRenderable const& renderable)
+{
+	auto const& texInfo = renderable.TerrainAlbedoTex->Info;
+
+	// Copies between GPU textures are cheap, every slot may be refilled in a frame
+	auto pageTableSettings = VirtualTexturePageTable::Settings{
+		.Width = texInfo.Width,
+		.Height = texInfo.Height,
+		.PageSize = 128,
+		.PhysicalPageCount = 64,
+		.MaxLoadsPerFrame = 64,
+	};
+	auto virtualTexture = std::make_shared<TerrainVirtualTexture>(pageTableSettings);
+	virtualTexture->AtlasSlotsX = 8;
+	uint32_t slotSize = pageTableSettings.PageSize + 2 * TerrainVirtualTexture::PageBorder;
+	auto atlasInfo = DXTexture::TextureCreateInfo{
+		.Width = virtualTexture->AtlasSlotsX * slotSize,
+		.Height = pageTableSettings.PhysicalPageCount / virtualTexture->AtlasSlotsX * slotSize,
+		.MipLevels = 1,
+		.Format = texInfo.Format,
+		.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+	};
+	virtualTexture->AlbedoAtlas =
+		std::make_shared<RWTexture>(DXTexture::Create(Renderer.GetDevice(), L"TerrainAlbedoAtlas", atlasInfo));
+	virtualTexture->NormalAtlas =
+		std::make_shared<RWTexture>(DXTexture::Create(Renderer.GetDevice(), L"TerrainNormalAtlas", atlasInfo));
+	auto indirectionInfo = DXTexture::TextureCreateInfo{
+		.Width = virtualTexture->PageTable.GetPagesX(),
+		.Height = virtualTexture->PageTable.GetPagesY(),
+		.MipLevels = 1,
+		.Format = DXGI_FORMAT_R32_UINT,
+		.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+	};
+	virtualTexture->Indirection = std::make_shared<RWTexture>(
+		DXTexture::Create(Renderer.GetDevice(), L"TerrainPageIndirection", indirectionInfo));
+	return virtualTexture;
+}
+
+CWaterRenderable TerrainErosionSystem::CreateWaterRenderable(CTerrain& terrain, CIndexedPlane const& plane)
 {
 	CWaterRenderable renderable{};
 	renderable.HeightMap = terrain.HeightMap;
@@ -660,6 +603,29 @@ CWaterRenderable TerrainErosionSystem::CreateWaterRenderable(CTerrain& terrain)
 		std::make_shared<RWTexture>(RWTexture(DXTexture::Create(Renderer.GetDevice(), L"WaterAlbedo", texInfo), -1));
 	renderable.WaterNormalMap =
 		std::make_shared<RWTexture>(RWTexture(DXTexture::Create(Renderer.GetDevice(), L"WaterNormal", texInfo), -1));
+	auto shoreDistanceInfo = DXTexture::TextureCreateInfo{
+		.Width = terrain.HeightMap->Info.Width,
+		.Height = terrain.HeightMap->Info.Height,
+		.MipLevels = 1,
+		.Format = DXGI_FORMAT_R32_FLOAT,
+		.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+	};
+	renderable.ShoreDistanceMap =
+		std::make_shared<RWTexture>(DXTexture::Create(Renderer.GetDevice(), L"ShoreDistance", shoreDistanceInfo));
+
+	auto culling = std::make_shared<WaterChunkCulling>();
+	culling->Grid = plane.Grid;
+	culling->ChunkIndexOffsets = plane.ChunkIndexOffsets;
+	auto chunkMaxInfo = DXTexture::TextureCreateInfo{
+		.Width = plane.Grid.ChunksX(),
+		.Height = plane.Grid.ChunksY(),
+		.MipLevels = 1,
+		.Format = DXGI_FORMAT_R32_FLOAT,
+		.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS,
+	};
+	culling->ChunkMaxMap =
+		std::make_shared<RWTexture>(DXTexture::Create(Renderer.GetDevice(), L"WaterChunkMax", chunkMaxInfo));
+	renderable.ChunkCulling = std::move(culling);
 	return renderable;
 }
 
@@ -667,6 +633,8 @@ void TerrainErosionSystem::GenerateTerrainMaterial(CommandRecord& cmdRecord, CTe
 												   CErosionParameters const& parameters, CTerrainRenderable& renderable)
 {
 	renderable.TotalLength = parameters.TotalLength;
+	if (renderable.VirtualTexture)
+		renderable.VirtualTexture->PageTable.InvalidateAll();
 	cmdRecord.Push("GenerateTerrainMaterial",
 				   [terrainAlbedo = renderable.TerrainAlbedoTex, terrainNormal = renderable.TerrainNormalMap,
 					heightMap = terrain.HeightMap, totalLength = parameters.TotalLength,
@@ -738,6 +706,360 @@ void TerrainErosionSystem::GenerateWaterMaterial(CommandRecord& cmdRecord, CTerr
 				   });
 }
 
+void TerrainErosionSystem::ClassifyWaterChunks(CommandRecord& cmdRecord, CWaterRenderable& renderable)
+{
+	auto& culling = renderable.ChunkCulling;
+	// The water level moves slowly, one reduction per frame in flight is plenty
+	if (!culling || culling->ReadbacksInFlight >= Renderer.FramesInFlight)
+		return;
+	culling->ReadbacksInFlight++;
+
+	cmdRecord.Push(
+		"ClassifyWaterChunks",
+		[culling, threshold = renderable.WetThreshold, waterHeightMap = renderable.WaterHeightMap,
+		 pso = Ref(WaterChunkMaxPSO), readback = Ref(*Renderer.Readback)](CommandContext& commandCtx)
+		{
+			auto& chunkMaxMap = *culling->ChunkMaxMap;
+			TransitionVec()
+				.Add(*waterHeightMap, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE)
+				.Add(chunkMaxMap, D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+				.Execute(commandCtx);
+
+			hlsl::WaterChunkMaxResources resources{
+				.WaterHeightMapIndex = waterHeightMap->SRV.Index,
+				.OutChunkMaxIndex = chunkMaxMap.UAV.Index,
+				.MeshResX = culling->Grid.ResX,
+				.MeshResY = culling->Grid.ResY,
+				.ChunkQuads = culling->Grid.ChunkQuads,
+			};
+			pso->ExecuteCompute(commandCtx, resources, culling->Grid.ChunksX(), culling->Grid.ChunksY(), 1);
+
+			bool recorded = readback->ReadTexture(
+				commandCtx, chunkMaxMap, 0, sizeof(float),
+				[culling, threshold](std::span<const std::byte> data, TextureRegionFootprint const& footprint)
+				{
+					culling->ReadbacksInFlight--;
+					std::vector<float> chunkMax(size_t(footprint.Width) * footprint.Height);
+					for (uint32_t row = 0; row < footprint.Height; row++)
+						std::memcpy(chunkMax.data() + row * footprint.Width, data.data() + row * footprint.RowPitch,
+									footprint.RowBytes);
+
+					auto wetChunks = ClassifyWetChunks(chunkMax, culling->Grid, threshold);
+					culling->WetChunkCount = uint32_t(std::count(wetChunks.begin(), wetChunks.end(), uint8_t(1)));
+					culling->DrawRanges = BuildWetDrawRanges(wetChunks, culling->ChunkIndexOffsets);
+					culling->HasClassification = true;
+				});
+			if (!recorded)
+				culling->ReadbacksInFlight--;
+		});
+}
+
+void TerrainErosionSystem::SurveyWaterBodies(CommandRecord& cmdRecord, CTerrain& terrain,
+											 CErosionParameters const& parameters)
+{
+	auto& survey = terrain.WaterBodies;
+	if (survey->ReadbacksPending)
+		return;
+	survey->Requested = false;
+	survey->ReadbacksPending = 2;
+
+	auto width = terrain.HeightMap->Info.Width, height = terrain.HeightMap->Info.Height;
+	survey->Heights.resize(size_t(width) * height);
+	survey->Water.resize(size_t(width) * height);
+	float cellLength = parameters.TotalLength / width;
+
+	// Both copies retire together, whichever callback runs last does the labelling. When the ring had no room for one
+	// of them the survey is requested again.
+	auto arrived = std::make_shared<uint32_t>(0);
+	auto onReadback = [survey, arrived, width, height, cellLength](
+						  std::vector<float>& target, std::span<const std::byte> data,
+						  TextureRegionFootprint const& footprint)
+	{
+		for (uint32_t row = 0; row < footprint.Height; row++)
+			std::memcpy(target.data() + row * footprint.Width, data.data() + row * footprint.RowPitch,
+						footprint.RowBytes);
+		++*arrived;
+		if (--survey->ReadbacksPending || *arrived != 2)
+			return;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		survey->Labels = LabelWaterBodies(survey->Water, survey->Heights, width, height,
+										  {.CellArea = cellLength * cellLength});
+		survey->LabelMs =
+			std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		survey->HasLabels = true;
+
+		start = std::chrono::high_resolution_clock::now();
+		auto waterMask = MaskAboveThreshold(survey->Water, WaterLabelSettings{}.Threshold);
+		survey->ShoreDistance = ComputeSignedDistance(waterMask, width, height, cellLength);
+		survey->ShoreDistanceMs =
+			std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		survey->ShoreDistanceDirty = true;
+	};
+
+	cmdRecord.Push("SurveyWaterBodies",
+				   [survey, onReadback, heightMap = terrain.HeightMap, waterHeightMap = terrain.WaterHeightMap,
+					readback = Ref(*Renderer.Readback)](CommandContext& commandCtx)
+				   {
+					   for (auto [texture, target] : {std::pair{heightMap.get(), &survey->Heights},
+													  std::pair{waterHeightMap.get(), &survey->Water}})
+					   {
+						   bool recorded = readback->ReadTexture(
+							   commandCtx, *texture, 0, sizeof(float),
+							   [onReadback, target](std::span<const std::byte> data,
+													TextureRegionFootprint const& footprint)
+							   { onReadback(*target, data, footprint); });
+						   if (!recorded)
+						   {
+							   survey->ReadbacksPending--;
+							   survey->Requested = true;
+						   }
+					   }
+				   });
+}
+
+void TerrainErosionSystem::UploadShoreDistance(CommandRecord& cmdRecord, CTerrain& terrain,
+											   CWaterRenderable& waterRenderable)
+{
+	auto& survey = terrain.WaterBodies;
+	if (!survey || !survey->ShoreDistanceDirty || !waterRenderable.ShoreDistanceMap)
+		return;
+	survey->ShoreDistanceDirty = false;
+	cmdRecord.Push("UploadShoreDistance",
+				   [shoreDistanceMap = waterRenderable.ShoreDistanceMap,
+					distances = std::move(survey->ShoreDistance)](CommandContext& commandCtx)
+				   {
+					   shoreDistanceMap->UploadDataTyped<float>(commandCtx, distances);
+					   TransitionVec(*shoreDistanceMap, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE).Execute(commandCtx);
+				   });
+}
+
+void TerrainErosionSystem::CaptureTerrainHistory(CommandRecord& cmdRecord, CTerrain& terrain, std::string label)
+{
+	auto& undo = terrain.Undo;
+	if (undo->ReadbacksPending)
+		return;
+	undo->RequestedCapture.clear();
+	undo->ReadbacksPending = TerrainUndoState::LayerCount;
+
+	auto width = terrain.HeightMap->Info.Width, height = terrain.HeightMap->Info.Height;
+	if (!undo->History)
+		undo->History = std::make_unique<TerrainHistory>(TerrainUndoState::LayerCount, width, height,
+														 TerrainHistory::Settings{});
+	for (auto& layer : undo->Layers)
+		layer.resize(size_t(width) * height);
+
+	// Same story as SurveyWaterBodies, the last callback commits, a missed copy makes the capture run again
+	auto arrived = std::make_shared<uint32_t>(0);
+	auto onReadback = [undo, arrived, label = std::move(label)](uint32_t layerIndex, std::span<const std::byte> data,
+																 TextureRegionFootprint const& footprint)
+	{
+		auto& layer = undo->Layers[layerIndex];
+		for (uint32_t row = 0; row < footprint.Height; row++)
+			std::memcpy(layer.data() + row * footprint.Width, data.data() + row * footprint.RowPitch,
+						footprint.RowBytes);
+		++*arrived;
+		if (--undo->ReadbacksPending || *arrived != TerrainUndoState::LayerCount)
+			return;
+		std::array<std::span<const float>, TerrainUndoState::LayerCount> layers;
+		std::ranges::copy(undo->Layers, layers.begin());
+		undo->History->Commit(label, layers);
+	};
+
+	cmdRecord.Push("CaptureTerrainHistory",
+				   [undo, onReadback,
+					textures = std::array{terrain.HeightMap, terrain.WaterHeightMap, terrain.SedimentMap,
+										  terrain.SoftnessMap},
+					readback = Ref(*Renderer.Readback)](CommandContext& commandCtx)
+				   {
+					   for (uint32_t layerIndex = 0; layerIndex < textures.size(); layerIndex++)
+					   {
+						   bool recorded = readback->ReadTexture(
+							   commandCtx, *textures[layerIndex], 0, sizeof(float),
+							   [onReadback, layerIndex](std::span<const std::byte> data,
+														TextureRegionFootprint const& footprint)
+							   { onReadback(layerIndex, data, footprint); });
+						   if (!recorded)
+						   {
+							   undo->ReadbacksPending--;
+							   if (undo->RequestedCapture.empty())
+								   undo->RequestedCapture = "Checkpoint";
+						   }
+					   }
+				   });
+}
+
+void TerrainErosionSystem::ApplyTerrainHistory(CommandRecord& cmdRecord, CTerrain& terrain,
+											   CErosionParameters const& parameters,
+											   OptionalRef<CTerrainRenderable> terrainRenderable,
+											   OptionalRef<CWaterRenderable> waterRenderable, bool redo)
+{
+	auto& history = terrain.Undo->History;
+	if (!history)
+		return;
+	auto restores = redo ? history->Redo() : history->Undo();
+	if (restores.empty())
+		return;
+
+	cmdRecord.Push("ApplyTerrainHistory",
+				   [restores = std::move(restores),
+					textures = std::array{terrain.HeightMap, terrain.WaterHeightMap, terrain.SedimentMap,
+										  terrain.SoftnessMap}](CommandContext& commandCtx)
+				   {
+					   for (auto const& tile : restores)
+						   textures[tile.Layer]->UploadRegionTyped<float>(
+							   commandCtx, {.X = tile.X, .Y = tile.Y, .Width = tile.Width, .Height = tile.Height},
+							   tile.Values);
+				   });
+	if (terrainRenderable)
+		GenerateTerrainMaterial(cmdRecord, terrain, parameters, *terrainRenderable);
+	if (waterRenderable)
+		GenerateWaterMaterial(cmdRecord, terrain, parameters, *waterRenderable);
+}
+
+void TerrainErosionSystem::BakeNavMesh(CommandRecord& cmdRecord, entt::registry& registry, CTerrain& terrain,
+									   CErosionParameters const& parameters)
+{
+	auto& navMesh = terrain.NavMesh;
+	if (navMesh->ReadbackPending)
+		return;
+	navMesh->Requested = false;
+	navMesh->ReadbackPending = true;
+
+	float origin = -parameters.TotalLength * 0.5f;
+	if (!navMesh->Builder)
+		navMesh->Builder =
+			std::make_unique<NavMeshBuilder>(NavMeshBuilder::Settings{}, origin, origin, -origin, -origin);
+	// Static meshes don't move, they are voxelized again only when models have spawned more of them. AddMesh marks the
+	// tiles under the new triangles dirty and ClearMeshes the ones under the old.
+	if (navMesh->StaticMeshesChanged)
+	{
+		navMesh->StaticMeshesChanged = false;
+		navMesh->Builder->ClearMeshes();
+		std::vector<float> positions;
+		auto staticView = registry.view<ecs::CStaticRenderable, ecs::CSceneTransform>();
+		for (auto entity : staticView)
+		{
+			auto& geometry = staticView.get<ecs::CStaticRenderable>(entity).Geometry;
+			if (!geometry)
+				continue;
+			auto worldMatrix = staticView.get<ecs::CSceneTransform>(entity).GetWorldTransform().WorldMatrix;
+			positions.clear();
+			for (auto const& position : *geometry->Positions)
+			{
+				auto worldPosition = worldMatrix * glm::vec4(position, 1.0f);
+				positions.insert(positions.end(), {worldPosition.x, worldPosition.y, worldPosition.z});
+			}
+			navMesh->Builder->AddMesh(positions, geometry->Indices);
+		}
+	}
+
+	auto width = terrain.HeightMap->Info.Width, height = terrain.HeightMap->Info.Height;
+	float spacing = parameters.TotalLength / width;
+	cmdRecord.Push(
+		"BakeNavMesh",
+		[navMesh, heightMap = terrain.HeightMap, readback = Ref(*Renderer.Readback), width, height, origin,
+		 spacing](CommandContext& commandCtx)
+		{
+			bool recorded = readback->ReadTexture(
+				commandCtx, *heightMap, 0, sizeof(float),
+				[navMesh, width, height, origin, spacing](std::span<const std::byte> data,
+														  TextureRegionFootprint const& footprint)
+				{
+					std::vector<float> heights(size_t(width) * height);
+					for (uint32_t row = 0; row < footprint.Height; row++)
+						std::memcpy(heights.data() + row * footprint.Width, data.data() + row * footprint.RowPitch,
+									footprint.RowBytes);
+					// Erosion nudges almost every cell a little, only the tiles with visible changes are rebuilt
+					navMesh->Builder->SetHeightfield(heights, width, height, origin, origin, spacing, 1e-3f);
+					navMesh->Builder->Build();
+					navMesh->ReadbackPending = false;
+				});
+			if (!recorded)
+			{
+				navMesh->ReadbackPending = false;
+				navMesh->Requested = true;
+			}
+		});
+}
+
+void TerrainErosionSystem::StreamTerrainPages(CommandRecord& cmdRecord, CTerrainRenderable& renderable,
+											  glm::vec3 viewerPosition)
+{
+	auto& pageTable = renderable.VirtualTexture->PageTable;
+	auto const& settings = pageTable.GetSettings();
+	float texelsPerUnit = settings.Width / renderable.TotalLength;
+	pageTable.BeginFrame();
+	float mip0Distance = renderable.VirtualTexture->Mip0Distance * texelsPerUnit;
+	pageTable.RequestByDistance((viewerPosition.x / renderable.TotalLength + 0.5f) * settings.Width,
+								(viewerPosition.z / renderable.TotalLength + 0.5f) * settings.Height,
+								viewerPosition.y * texelsPerUnit, mip0Distance);
+	auto loads = pageTable.Update();
+	auto dirtyRect = pageTable.TakeIndirectionDirtyRect();
+	if (loads.empty() && !dirtyRect.Width)
+		return;
+
+	std::vector<uint32_t> indirection(size_t(dirtyRect.Width) * dirtyRect.Height);
+	auto allEntries = pageTable.GetIndirection();
+	for (uint32_t row = 0; row < dirtyRect.Height; row++)
+		std::copy_n(allEntries.data() + dirtyRect.X + size_t(dirtyRect.Y + row) * pageTable.GetPagesX(),
+					dirtyRect.Width, indirection.data() + size_t(row) * dirtyRect.Width);
+
+	cmdRecord.Push(
+		"StreamTerrainPages",
+		[virtualTexture = renderable.VirtualTexture, albedo = renderable.TerrainAlbedoTex,
+		 normal = renderable.TerrainNormalMap, loads = std::move(loads), dirtyRect,
+		 indirection = std::move(indirection)](CommandContext& commandCtx)
+		{
+			auto& atlasAlbedo = *virtualTexture->AlbedoAtlas;
+			auto& atlasNormal = *virtualTexture->NormalAtlas;
+			TransitionVec()
+				.Add(*albedo, D3D12_RESOURCE_STATE_COPY_SOURCE)
+				.Add(*normal, D3D12_RESOURCE_STATE_COPY_SOURCE)
+				.Add(atlasAlbedo, D3D12_RESOURCE_STATE_COPY_DEST)
+				.Add(atlasNormal, D3D12_RESOURCE_STATE_COPY_DEST)
+				.Execute(commandCtx);
+
+			uint32_t pageSize = virtualTexture->PageTable.GetSettings().PageSize;
+			int border = int(TerrainVirtualTexture::PageBorder);
+			uint32_t slotSize = pageSize + 2 * border;
+			for (auto const& load : loads)
+			{
+				// The border is clamped at the texture's edges, the sampler never reaches it there
+				int mipWidth = int(std::max(1u, albedo->Info.Width >> load.Page.Mip));
+				int mipHeight = int(std::max(1u, albedo->Info.Height >> load.Page.Mip));
+				int left = int(load.Page.X * pageSize) - border, top = int(load.Page.Y * pageSize) - border;
+				D3D12_BOX box{
+					.left = UINT(std::max(left, 0)),
+					.top = UINT(std::max(top, 0)),
+					.front = 0,
+					.right = UINT(std::min(left + int(slotSize), mipWidth)),
+					.bottom = UINT(std::min(top + int(slotSize), mipHeight)),
+					.back = 1,
+				};
+				uint32_t dstX = load.Slot % virtualTexture->AtlasSlotsX * slotSize + (box.left - left);
+				uint32_t dstY = load.Slot / virtualTexture->AtlasSlotsX * slotSize + (box.top - top);
+				for (auto [source, atlas] : {std::pair{albedo.get(), &atlasAlbedo}, {normal.get(), &atlasNormal}})
+				{
+					CD3DX12_TEXTURE_COPY_LOCATION src(source->Resource.Get(), load.Page.Mip);
+					CD3DX12_TEXTURE_COPY_LOCATION dst(atlas->Resource.Get(), 0);
+					commandCtx->CopyTextureRegion(&dst, dstX, dstY, 0, &src, &box);
+				}
+			}
+			if (dirtyRect.Width)
+				virtualTexture->Indirection->UploadRegionTyped<uint32_t>(
+					commandCtx, {dirtyRect.X, dirtyRect.Y, dirtyRect.Width, dirtyRect.Height}, indirection);
+
+			TransitionVec()
+				.Add(*albedo, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+				.Add(*normal, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+				.Add(atlasAlbedo, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+				.Add(atlasNormal, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+				.Add(*virtualTexture->Indirection, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE)
+				.Execute(commandCtx);
+		});
+}
+
 void TerrainErosionSystem::Update(entt::registry& registry, InputManager& inputMan, RenderFrameRecord& frameRecord)
 {
 	auto erosionView = registry.view<CTerrain, CErosionParameters>();
@@ -747,15 +1069,64 @@ void TerrainErosionSystem::Update(entt::registry& registry, InputManager& inputM
 		auto& parameters = erosionView.get<CErosionParameters>(entity);
 		auto* terrainRenderable = registry.try_get<CTerrainRenderable>(entity);
 		auto* waterRenderable = registry.try_get<CWaterRenderable>(entity);
+		auto& undo = terrain.Undo;
+		// Set when the heights settled into a new state, which the navigation mesh follows
+		bool heightsChanged = false;
+		if (undo && (undo->UndoRequested || undo->RedoRequested))
+		{
+			// Erosion would overwrite the restored tiles. Stopping it captures the run below, the undo waits for that
+			// capture so it undoes the run.
+			if (parameters.ErodeEachFrame)
+				parameters.ErodeEachFrame = false;
+			else if (!undo->ReadbacksPending && undo->RequestedCapture.empty())
+			{
+				ApplyTerrainHistory(frameRecord.CommandRecord, terrain, parameters, terrainRenderable,
+									waterRenderable, undo->RedoRequested);
+				undo->UndoRequested = undo->RedoRequested = false;
+				heightsChanged = true;
+			}
+		}
 		if (inputMan.IsKeyPressed(SDL_SCANCODE_M))
+		{
 			GenerateBaseHeightMap(frameRecord.CommandRecord, terrain, parameters, terrainRenderable, waterRenderable);
-		if (parameters.ErodeEachFrame || inputMan.IsKeyPressed(SDL_SCANCODE_K))
-			ErodeTerrain(frameRecord.CommandRecord, terrain, parameters, terrainRenderable, waterRenderable);
+			if (undo)
+				undo->RequestedCapture = "Regenerate";
+			heightsChanged = true;
+		}
+		CollectErosionTimings(terrain);
+		if (terrain.WaterBodies && terrain.WaterBodies->Requested)
+			SurveyWaterBodies(frameRecord.CommandRecord, terrain, parameters);
+		if (waterRenderable)
+			UploadShoreDistance(frameRecord.CommandRecord, terrain, *waterRenderable);
+		bool erodeStep = inputMan.IsKeyPressed(SDL_SCANCODE_K);
+		if (parameters.ErodeEachFrame || erodeStep)
+			ErodeTerrain(frameRecord.CommandRecord, terrain, parameters, terrainRenderable, waterRenderable,
+						 frameRecord.FrameNumber);
+		if (auto& navMesh = terrain.NavMesh; navMesh && navMesh->Builder)
+		{
+			bool erosionStopped = !parameters.ErodeEachFrame && (erodeStep || (undo && undo->WasEroding));
+			if (heightsChanged || erosionStopped)
+				navMesh->Requested = true;
+		}
+		if (terrain.NavMesh && terrain.NavMesh->Requested)
+			BakeNavMesh(frameRecord.CommandRecord, registry, terrain, parameters);
+		if (undo)
+		{
+			if (erodeStep && !parameters.ErodeEachFrame)
+				undo->RequestedCapture = "Erosion Step";
+			else if (undo->WasEroding && !parameters.ErodeEachFrame)
+				undo->RequestedCapture = "Erosion Run";
+			undo->WasEroding = parameters.ErodeEachFrame;
+			if (!undo->RequestedCapture.empty())
+				CaptureTerrainHistory(frameRecord.CommandRecord, terrain, undo->RequestedCapture);
+		}
 	}
 
 	auto terrainRenderableView = registry.view<ecs::CSceneTransform, CIndexedPlane, CTerrainRenderable>();
 
 	std::vector<TerrainRenderData> terrainRenderDataVec;
+	auto cameraView = registry.view<ecs::CCamera, ecs::CSceneTransform>();
+	auto cameraEntity = cameraView.front();
 
 	for (auto entity : terrainRenderableView)
 	{
@@ -773,6 +1144,27 @@ void TerrainErosionSystem::Update(entt::registry& registry, InputManager& inputM
 			.TerrainNormalMapTextureIndex = renderable.TerrainNormalMap->SRV.Index,
 			.TotalLength = renderable.TotalLength,
 		};
+		if (!renderable.UseVirtualTexture)
+			renderable.VirtualTexture.reset();
+		else if (!renderable.VirtualTexture)
+			renderable.VirtualTexture = CreateTerrainVirtualTexture(renderable);
+		if (auto& virtualTexture = renderable.VirtualTexture; virtualTexture && cameraEntity != entt::null)
+		{
+			auto cameraPosition = cameraView.get<ecs::CSceneTransform>(cameraEntity).GetWorldTransform().GetPosition();
+			auto viewerPosition = glm::inverse(terrainRenderData.WorldMatrix) * glm::vec4(cameraPosition, 1.0f);
+			StreamTerrainPages(frameRecord.CommandRecord, renderable, glm::vec3(viewerPosition));
+
+			auto& resources = terrainRenderData.Resources;
+			resources.UseVirtualTexture = 1;
+			resources.IndirectionTextureIndex = virtualTexture->Indirection->SRV.Index;
+			resources.AlbedoAtlasTextureIndex = virtualTexture->AlbedoAtlas->SRV.Index;
+			resources.NormalAtlasTextureIndex = virtualTexture->NormalAtlas->SRV.Index;
+			resources.VirtualPagesX = virtualTexture->PageTable.GetPagesX();
+			resources.VirtualPagesY = virtualTexture->PageTable.GetPagesY();
+			resources.AtlasSlotsX = virtualTexture->AtlasSlotsX;
+			resources.PageSize = virtualTexture->PageTable.GetSettings().PageSize;
+			resources.PageBorder = TerrainVirtualTexture::PageBorder;
+		}
 		terrainRenderData.IndexBufferView = plane.IndexBufferView;
 		terrainRenderData.IndexCount = (plane.ResX - 1) * (plane.ResY - 1) * 6;
 		terrainRenderDataVec.push_back(terrainRenderData);
@@ -806,8 +1198,14 @@ void TerrainErosionSystem::Update(entt::registry& registry, InputManager& inputM
 			.TotalLength = renderable.TotalLength,
 		};
 		waterRenderData.IndexBufferView = plane.IndexBufferView;
-		waterRenderData.IndexCount = (plane.ResX - 1) * (plane.ResY - 1) * 6;
-		waterRenderDataVec.push_back(waterRenderData);
+		ClassifyWaterChunks(frameRecord.CommandRecord, renderable);
+		if (renderable.CullDryChunks && renderable.ChunkCulling && renderable.ChunkCulling->HasClassification)
+			waterRenderData.DrawRanges = renderable.ChunkCulling->DrawRanges;
+		else
+			waterRenderData.DrawRanges = {IndexRange{0, (plane.ResX - 1) * (plane.ResY - 1) * 6}};
+		if (waterRenderData.DrawRanges.empty())
+			continue;
+		waterRenderDataVec.push_back(std::move(waterRenderData));
 	}
 
 	frameRecord.Push(TypedRenderCommand<WaterRenderData>{.Name = "WaterRender",
@@ -884,7 +1282,8 @@ void TerrainErosionSystem::WaterPrepass(std::span<WaterRenderData> renderObjects
 		renderResources.Normal = glm::transpose(glm::inverse(renderObj.WorldMatrix));
 		renderResources.ViewTransformBufferIndex = passData.InViewTransformCBV.GetIndex();
 		WaterPrePassPSO.SetResources(cmd, renderResources);
-		cmd->DrawIndexedInstanced(renderObj.IndexCount, 1, 0, 0, 0);
+		for (auto const& range : renderObj.DrawRanges)
+			cmd->DrawIndexedInstanced(range.IndexCount, 1, range.StartIndex, 0, 0);
 	}
 }
 
@@ -913,7 +1312,8 @@ void TerrainErosionSystem::WaterForwardPass(std::span<WaterRenderData> renderObj
 		renderResources.ColorTextureIndex = passData.InColorSRV.GetIndex();
 		renderResources.DepthTextureIndex = passData.InOpaqueDepthSRV.GetIndex();
 		WaterForwardPSO.SetResources(cmd, renderResources);
-		cmd->DrawIndexedInstanced(renderObj.IndexCount, 1, 0, 0, 0);
+		for (auto const& range : renderObj.DrawRanges)
+			cmd->DrawIndexedInstanced(range.IndexCount, 1, range.StartIndex, 0, 0);
 	}
 }
 
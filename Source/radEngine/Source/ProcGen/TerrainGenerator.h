@@ -8,6 +8,13 @@
 #include "Compute/Terrain/TerrainResources.hlsli"
 #include "InputManager.h"
 #include "Graphics/Renderer.h"
+#include "Graphics/VirtualTexturePageTable.h"
+#include "ErosionBudget.h"
+#include "WaterChunks.h"
+#include "WaterBodies.h"
+#include "DistanceField.h"
+#include "TerrainHistory.h"
+#include "NavMesh.h"
 #include "entt/entt.hpp"
 
 namespace rad::proc
@@ -21,6 +28,67 @@ struct RWTexture : public DXTexture
 	DescriptorAllocation SRV{};
 };
 
+// GPU timestamps around the erosion iterations of a frame, read back through GPUReadback so the CPU never waits on them
+struct ErosionGPUTimer
+{
+	struct Sample
+	{
+		uint32_t Iterations = 0;
+		double Milliseconds = 0.0;
+	};
+	ComPtr<ID3D12QueryHeap> QueryHeap;
+	uint64_t TimestampFrequency = 0;
+	// Pairs of begin and end timestamps, one per frame that can be in flight
+	uint32_t PairCount = 0;
+	uint32_t NextPair = 0;
+	// Filled by the readbacks, drained into CTerrain::ErosionBudget
+	std::vector<Sample> Samples;
+};
+
+// Water bodies of the terrain, labelled on the CPU from a readback of HeightMap and WaterHeightMap
+struct WaterBodySurvey
+{
+	bool Requested = false;
+	uint32_t ReadbacksPending = 0;
+	std::vector<float> Heights;
+	std::vector<float> Water;
+
+	bool HasLabels = false;
+	double LabelMs = 0.0;
+	WaterBodyLabels Labels;
+
+	// Signed distance to the water's edge, waiting to be uploaded to CWaterRenderable::ShoreDistanceMap
+	std::vector<float> ShoreDistance;
+	bool ShoreDistanceDirty = false;
+	double ShoreDistanceMs = 0.0;
+};
+
+// Undo history of the terrain maps, fed by readbacks taken after each operation
+struct TerrainUndoState
+{
+	// HeightMap, WaterHeightMap, SedimentMap, SoftnessMap
+	static constexpr uint32_t LayerCount = 4;
+
+	std::unique_ptr<TerrainHistory> History;
+	// Capture to take on the next update, requests made while one is in flight are folded into the next one
+	std::string RequestedCapture = "Base";
+	uint32_t ReadbacksPending = 0;
+	std::array<std::vector<float>, LayerCount> Layers;
+	bool UndoRequested = false;
+	bool RedoRequested = false;
+	bool WasEroding = false;
+};
+
+// Navigation mesh over the terrain and the static meshes, its dirty tiles are rebuilt from a HeightMap readback
+struct TerrainNavMesh
+{
+	std::unique_ptr<NavMeshBuilder> Builder;
+	// Set when models finish loading, their meshes are voxelized with the next bake
+	bool StaticMeshesChanged = true;
+	bool Requested = false;
+	bool ReadbackPending = false;
+};
+
 struct CTerrain
 {
 	std::shared_ptr<RWTexture> HeightMap{};
@@ -32,10 +100,13 @@ struct CTerrain
 	std::shared_ptr<RWTexture> TempSedimentMap{};
 	std::shared_ptr<RWTexture> WaterOutflux{};
 	std::shared_ptr<RWTexture> VelocityMap{};
-	std::shared_ptr<RWTexture> ThermalPipe1{};
-	std::shared_ptr<RWTexture> ThermalPipe2{};
 	std::shared_ptr<RWTexture> SoftnessMap{};
 	uint32_t IterationCount = 0;
+	ErosionBudgetController ErosionBudget{};
+	std::shared_ptr<ErosionGPUTimer> ErosionTimer{};
+	std::shared_ptr<WaterBodySurvey> WaterBodies{};
+	std::shared_ptr<TerrainUndoState> Undo{};
+	std::shared_ptr<TerrainNavMesh> NavMesh{};
 };
 
 struct CIndexedPlane
@@ -43,6 +114,41 @@ struct CIndexedPlane
 	uint32_t ResX = 256, ResY = 256;
 	std::shared_ptr<DXTypedBuffer<uint32_t>> Indices;
 	D3D12_INDEX_BUFFER_VIEW IndexBufferView{};
+	// Indices are ordered chunk by chunk, see WaterChunks.h
+	WaterChunkGrid Grid{};
+	std::vector<uint32_t> ChunkIndexOffsets;
+};
+
+// Per chunk maximum water level, reduced on the GPU and read back a few frames later to pick the chunks the water
+// passes draw.
+struct WaterChunkCulling
+{
+	WaterChunkGrid Grid{};
+	std::vector<uint32_t> ChunkIndexOffsets;
+	std::shared_ptr<RWTexture> ChunkMaxMap{};
+	uint32_t ReadbacksInFlight = 0;
+
+	bool HasClassification = false;
+	uint32_t WetChunkCount = 0;
+	std::vector<IndexRange> DrawRanges;
+};
+
+// Pages of TerrainAlbedoTex and TerrainNormalMap copied into atlases around the camera, the page table picks which
+struct TerrainVirtualTexture
+{
+	// Texels copied around each page so bilinear filtering doesn't bleed into the neighbouring slots
+	static constexpr uint32_t PageBorder = 4;
+
+	explicit TerrainVirtualTexture(VirtualTexturePageTable::Settings const& settings) : PageTable(settings) {}
+
+	VirtualTexturePageTable PageTable;
+	uint32_t AtlasSlotsX = 0;
+	std::shared_ptr<RWTexture> AlbedoAtlas{};
+	std::shared_ptr<RWTexture> NormalAtlas{};
+	// One R32_UINT entry per mip 0 page, see VirtualTexturePageTable::PackEntry
+	std::shared_ptr<RWTexture> Indirection{};
+	// World units around the camera that get mip 0 pages
+	float Mip0Distance = 128.0f;
 };
 
 struct CTerrainRenderable
@@ -51,6 +157,10 @@ struct CTerrainRenderable
 	std::shared_ptr<RWTexture> TerrainAlbedoTex{};
 	std::shared_ptr<RWTexture> TerrainNormalMap{};
 	float TotalLength = 1024.0f;
+	// Off by default, the only source is the 1024^2 material which fits in memory whole anyway. The atlases are
+	// created when it's turned on and released when it's turned off.
+	bool UseVirtualTexture = false;
+	std::shared_ptr<TerrainVirtualTexture> VirtualTexture{};
 };
 
 struct CWaterRenderable
@@ -59,7 +169,13 @@ struct CWaterRenderable
 	std::shared_ptr<RWTexture> WaterHeightMap{};
 	std::shared_ptr<RWTexture> WaterAlbedoMap{};
 	std::shared_ptr<RWTexture> WaterNormalMap{};
+	// Distance to the shoreline in world units, negative under water
+	std::shared_ptr<RWTexture> ShoreDistanceMap{};
 	float TotalLength = 1024.0f;
+	// Same cutoff as the discard in the water shaders
+	float WetThreshold = 0.2f;
+	bool CullDryChunks = true;
+	std::shared_ptr<WaterChunkCulling> ChunkCulling{};
 };
 
 struct CErosionParameters
@@ -72,6 +188,9 @@ struct CErosionParameters
 	float MinHeight = 0.0f;
 	float MaxHeight = 120.0f;
 	int Iterations = 1;
+	// When set, Iterations is ignored and the count is picked each frame to fit TimeBudgetMs of GPU time
+	bool UseTimeBudget = false;
+	float TimeBudgetMs = 4.0f;
 	float RainRate = 0.015f;
 	float EvaporationRate = 0.006f;
 	float TotalLength = 1024.0;
@@ -99,16 +218,30 @@ struct TerrainErosionSystem
 	CTerrain CreateTerrain(uint32_t heightMapWidth);
 	CIndexedPlane CreatePlane(CommandRecord& cmdRecord, uint32_t resX, uint32_t resY);
 	CTerrainRenderable CreateTerrainRenderable(CTerrain& terrain);
-	CWaterRenderable CreateWaterRenderable(CTerrain& terrain);
+	std::shared_ptr<TerrainVirtualTexture> CreateTerrainVirtualTexture(CTerrainRenderable const& renderable);
+	CWaterRenderable CreateWaterRenderable(CTerrain& terrain, CIndexedPlane const& plane);
 	void GenerateBaseHeightMap(CommandRecord& cmdRecord, CTerrain& terrain, CErosionParameters const& parameters,
 							   OptionalRef<CTerrainRenderable> terrainRenderable,
 							   OptionalRef<CWaterRenderable> waterRenderable);
 	void ErodeTerrain(CommandRecord& cmdRecord, CTerrain& terrain, CErosionParameters const& parameters,
-					  OptionalRef<CTerrainRenderable> terrainRenderable, OptionalRef<CWaterRenderable> waterRenderable);
+					  OptionalRef<CTerrainRenderable> terrainRenderable, OptionalRef<CWaterRenderable> waterRenderable,
+					  uint64_t frameNumber = 0);
+	void CollectErosionTimings(CTerrain& terrain);
 	void GenerateTerrainMaterial(CommandRecord& cmdRecord, CTerrain& terrain, CErosionParameters const& parameters,
 								 CTerrainRenderable& terrainRenderable);
 	void GenerateWaterMaterial(CommandRecord& cmdRecord, CTerrain& terrain, CErosionParameters const& parameters,
 							   CWaterRenderable& waterRenderable);
+	void ClassifyWaterChunks(CommandRecord& cmdRecord, CWaterRenderable& waterRenderable);
+	void SurveyWaterBodies(CommandRecord& cmdRecord, CTerrain& terrain, CErosionParameters const& parameters);
+	void UploadShoreDistance(CommandRecord& cmdRecord, CTerrain& terrain, CWaterRenderable& waterRenderable);
+	void CaptureTerrainHistory(CommandRecord& cmdRecord, CTerrain& terrain, std::string label);
+	void ApplyTerrainHistory(CommandRecord& cmdRecord, CTerrain& terrain, CErosionParameters const& parameters,
+							 OptionalRef<CTerrainRenderable> terrainRenderable,
+							 OptionalRef<CWaterRenderable> waterRenderable, bool redo);
+	void BakeNavMesh(CommandRecord& cmdRecord, entt::registry& registry, CTerrain& terrain,
+					 CErosionParameters const& parameters);
+	// viewerPosition is in the terrain's local space
+	void StreamTerrainPages(CommandRecord& cmdRecord, CTerrainRenderable& renderable, glm::vec3 viewerPosition);
 
 	void Update(entt::registry& registry, InputManager& inputMan, RenderFrameRecord& frameRecord);
 
@@ -116,8 +249,8 @@ struct TerrainErosionSystem
 	Renderer& Renderer;
 	ComputePipelineState<hlsl::HeightToTerrainMaterialResources> HeightMapToTerrainMaterialPSO;
 	ComputePipelineState<hlsl::HeightToWaterMaterialResources> HeightMapToWaterMaterialPSO;
-	ComputePipelineState<hlsl::ThermalOutfluxResources> ThermalOutfluxPSO;
-	ComputePipelineState<hlsl::ThermalDepositResources> ThermalDepositPSO;
+	ComputePipelineState<hlsl::ThermalErosionResources> ThermalErosionPSO;
+	ComputePipelineState<hlsl::WaterChunkMaxResources> WaterChunkMaxPSO;
 
 	ComputePipelineState<hlsl::HydrolicAddWaterResources> HydrolicAddWaterPSO;
 	ComputePipelineState<hlsl::HydrolicCalculateOutfluxResources> HydrolicCalculateOutfluxPSO;
@@ -147,7 +280,7 @@ struct TerrainErosionSystem
 	struct WaterRenderData
 	{
 		glm::mat4 WorldMatrix;
-		uint32_t IndexCount;
+		std::vector<IndexRange> DrawRanges;
 		D3D12_INDEX_BUFFER_VIEW IndexBufferView;
 		hlsl::WaterRenderResources Resources;
 	};
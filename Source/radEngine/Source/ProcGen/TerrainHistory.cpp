@@ -0,0 +1,311 @@
+#include "TerrainHistory.h"
+
+#include "HeightfieldCodec.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstring>
+
+namespace rad::proc
+{
+
+static constexpr uint32_t NoBlob = ~0u;
+
+// Four independent multiply-xorshift lanes over pairs of floats, folded at the end
+static uint64_t HashValues(std::span<const float> values)
+{
+	uint64_t lanes[4] = {0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0x27D4EB2F165667C5ull};
+	size_t wordCount = values.size() / 2;
+	auto word = [&](size_t i)
+	{
+		uint64_t value;
+		std::memcpy(&value, values.data() + i * 2, sizeof(value));
+		return value;
+	};
+	size_t i = 0;
+	for (; i + 4 <= wordCount; i += 4)
+		for (size_t lane = 0; lane < 4; lane++)
+		{
+			lanes[lane] = (lanes[lane] ^ word(i + lane)) * 0xFF51AFD7ED558CCDull;
+			lanes[lane] ^= lanes[lane] >> 32;
+		}
+	uint64_t hash = values.size();
+	for (; i < wordCount; i++)
+		hash = ((hash ^ word(i)) * 0xFF51AFD7ED558CCDull) ^ (hash >> 29);
+	if (values.size() % 2)
+		hash = (hash ^ std::bit_cast<uint32_t>(values.back())) * 0xC4CEB9FE1A85EC53ull;
+	for (uint64_t lane : lanes)
+	{
+		hash = (hash ^ lane) * 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+	}
+	return hash;
+}
+
+// Same values cut to another shape must not share a blob, a 128x64 tile would be decoded into a 64x128 one
+static uint64_t HashTile(TerrainHistory::TileRestore const& tile)
+{
+	uint64_t hash = HashValues(tile.Values) ^ (uint64_t(tile.Width) << 32 | tile.Height);
+	hash *= 0xFF51AFD7ED558CCDull;
+	return hash ^ (hash >> 32);
+}
+
+TerrainHistory::TerrainHistory(uint32_t layerCount, uint32_t width, uint32_t height, Settings const& settings)
+	: Config(settings), LayerCount(layerCount), Width(width), Height(height)
+{
+	assert(Config.TileSize > 0);
+	TilesX = (width + Config.TileSize - 1) / Config.TileSize;
+	TilesY = (height + Config.TileSize - 1) / Config.TileSize;
+}
+
+bool TerrainHistory::Commit(std::string label, std::span<const std::span<const float>> layers)
+{
+	assert(layers.size() == LayerCount);
+	uint32_t tileCount = GetTileCount();
+	uint32_t slotCount = LayerCount * tileCount;
+	bool isBase = Current.empty();
+
+	struct EncodedTile
+	{
+		bool Changed = false;
+		uint64_t Hash = 0;
+		// Stored blob with the same content, otherwise Bytes holds the compressed tile
+		uint32_t Blob = NoBlob;
+		std::vector<uint8_t> Bytes;
+	};
+	std::vector<EncodedTile> tiles(slotCount);
+	auto gatherTile = [&](uint32_t slot)
+	{
+		auto restore = Restore(slot, NoBlob);
+		auto layer = layers[restore.Layer];
+		assert(layer.size() >= size_t(Width) * Height);
+		for (uint32_t y = 0; y < restore.Height; y++)
+			std::copy_n(layer.data() + restore.X + size_t(restore.Y + y) * Width, restore.Width,
+						restore.Values.data() + size_t(y) * restore.Width);
+		return restore;
+	};
+	auto encodeTile = [](TileRestore const& tile)
+	{
+		return EncodeHeightfield(tile.Values, tile.Width, tile.Height,
+								 {.TileSize = std::max(tile.Width, tile.Height), .ThreadCount = 1})
+			.Bytes;
+	};
+
+	// Only reads the store, tiles whose content is already stored are not compressed again. A matching hash is
+	// confirmed by decoding the blob, so a collision costs a decode rather than a lost edit.
+	ParallelFor(slotCount, Config.ThreadCount,
+				[&](uint32_t slot)
+				{
+					auto tile = gatherTile(slot);
+					uint64_t hash = HashTile(tile);
+					if (!isBase && Blobs[Current[slot]].Hash == hash && BlobHolds(Current[slot], tile))
+						return;
+					tiles[slot].Changed = true;
+					tiles[slot].Hash = hash;
+					tiles[slot].Blob = FindBlob(hash, tile);
+					if (tiles[slot].Blob == NoBlob)
+						tiles[slot].Bytes = encodeTile(tile);
+				});
+
+	if (std::ranges::none_of(tiles, &EncodedTile::Changed))
+		return false;
+
+	if (isBase)
+	{
+		size_t addedBytes = 0;
+		Current.resize(slotCount);
+		for (uint32_t slot = 0; slot < slotCount; slot++)
+		{
+			Current[slot] = AddBlob(tiles[slot].Hash, std::move(tiles[slot].Bytes), addedBytes);
+			AddRef(Current[slot]);
+		}
+		return false;
+	}
+
+	for (size_t i = Cursor; i < Steps.size(); i++)
+		DropStep(Steps[i]);
+	Steps.resize(Cursor);
+
+	// Dropping the redo steps may have freed a blob that was found above, before any new blob can reuse its index
+	for (uint32_t slot = 0; slot < slotCount; slot++)
+		if (tiles[slot].Blob != NoBlob && !Blobs[tiles[slot].Blob].RefCount)
+		{
+			tiles[slot].Blob = NoBlob;
+			tiles[slot].Bytes = encodeTile(gatherTile(slot));
+		}
+
+	Step step{.Info = {.Label = std::move(label), .ChangedTiles = 0, .Bytes = 0}, .Changes = {}};
+	for (uint32_t slot = 0; slot < slotCount; slot++)
+	{
+		auto& tile = tiles[slot];
+		if (!tile.Changed)
+			continue;
+		uint32_t after = tile.Blob != NoBlob ? tile.Blob : AddBlob(tile.Hash, std::move(tile.Bytes), step.Info.Bytes);
+		uint32_t before = Current[slot];
+		step.Changes.push_back({slot, before, after});
+		// The step keeps both blobs, the current state moves from before to after
+		AddRef(after);
+		AddRef(after);
+		Current[slot] = after;
+	}
+	step.Info.ChangedTiles = uint32_t(step.Changes.size());
+	Steps.push_back(std::move(step));
+	Cursor = Steps.size();
+	EnforceMemoryCap();
+	return true;
+}
+
+std::vector<TerrainHistory::TileRestore> TerrainHistory::Undo()
+{
+	if (!CanUndo())
+		return {};
+	auto& step = Steps[--Cursor];
+	std::vector<TileRestore> restores(step.Changes.size());
+	ParallelFor(uint32_t(step.Changes.size()), Config.ThreadCount,
+				[&](uint32_t i) { restores[i] = Restore(step.Changes[i].Slot, step.Changes[i].Before); });
+	for (auto const& change : step.Changes)
+	{
+		AddRef(change.Before);
+		Release(change.After);
+		Current[change.Slot] = change.Before;
+	}
+	return restores;
+}
+
+std::vector<TerrainHistory::TileRestore> TerrainHistory::Redo()
+{
+	if (!CanRedo())
+		return {};
+	auto& step = Steps[Cursor++];
+	std::vector<TileRestore> restores(step.Changes.size());
+	ParallelFor(uint32_t(step.Changes.size()), Config.ThreadCount,
+				[&](uint32_t i) { restores[i] = Restore(step.Changes[i].Slot, step.Changes[i].After); });
+	for (auto const& change : step.Changes)
+	{
+		AddRef(change.After);
+		Release(change.Before);
+		Current[change.Slot] = change.After;
+	}
+	return restores;
+}
+
+std::vector<TerrainHistory::StepInfo> TerrainHistory::GetSteps() const
+{
+	std::vector<StepInfo> infos;
+	infos.reserve(Steps.size());
+	for (auto const& step : Steps)
+		infos.push_back(step.Info);
+	return infos;
+}
+
+bool TerrainHistory::BlobHolds(uint32_t blob, TileRestore const& tile) const
+{
+	auto decoder = HeightfieldDecoder::Open(Blobs[blob].Bytes);
+	if (!decoder || decoder->GetWidth() != tile.Width || decoder->GetHeight() != tile.Height)
+		return false;
+	std::vector<float> values(tile.Values.size());
+	if (!decoder->DecodeTile(0, 0, values.data(), tile.Width))
+		return false;
+	// Bits rather than floats, the codec keeps them exactly and NaNs must match too
+	return std::memcmp(values.data(), tile.Values.data(), values.size() * sizeof(float)) == 0;
+}
+
+uint32_t TerrainHistory::FindBlob(uint64_t hash, TileRestore const& tile) const
+{
+	auto [first, last] = BlobsByHash.equal_range(hash);
+	for (auto it = first; it != last; ++it)
+		if (BlobHolds(it->second, tile))
+			return it->second;
+	return NoBlob;
+}
+
+uint32_t TerrainHistory::AddBlob(uint64_t hash, std::vector<uint8_t> bytes, size_t& addedBytes)
+{
+	// The codec is deterministic, equal tiles encode to equal bytes
+	auto [first, last] = BlobsByHash.equal_range(hash);
+	for (auto it = first; it != last; ++it)
+		if (Blobs[it->second].Bytes == bytes)
+			return it->second;
+	uint32_t blob;
+	if (!FreeBlobs.empty())
+	{
+		blob = FreeBlobs.back();
+		FreeBlobs.pop_back();
+	}
+	else
+	{
+		blob = uint32_t(Blobs.size());
+		Blobs.emplace_back();
+	}
+	addedBytes += bytes.size();
+	StoredBytes += bytes.size();
+	Blobs[blob] = {.Hash = hash, .RefCount = 0, .Bytes = std::move(bytes)};
+	BlobsByHash.emplace(hash, blob);
+	return blob;
+}
+
+void TerrainHistory::AddRef(uint32_t blob)
+{
+	Blobs[blob].RefCount++;
+}
+
+void TerrainHistory::Release(uint32_t blob)
+{
+	auto& entry = Blobs[blob];
+	assert(entry.RefCount > 0);
+	if (--entry.RefCount)
+		return;
+	StoredBytes -= entry.Bytes.size();
+	auto [first, last] = BlobsByHash.equal_range(entry.Hash);
+	BlobsByHash.erase(std::find_if(first, last, [blob](auto const& pair) { return pair.second == blob; }));
+	entry = {};
+	FreeBlobs.push_back(blob);
+}
+
+void TerrainHistory::DropStep(Step& step)
+{
+	for (auto const& change : step.Changes)
+	{
+		Release(change.Before);
+		Release(change.After);
+	}
+	step.Changes.clear();
+}
+
+// With NoBlob only fills in where the slot's tile is and sizes Values
+TerrainHistory::TileRestore TerrainHistory::Restore(uint32_t slot, uint32_t blob) const
+{
+	uint32_t tileCount = GetTileCount();
+	uint32_t tile = slot % tileCount;
+	uint32_t x = tile % TilesX * Config.TileSize, y = tile / TilesX * Config.TileSize;
+	uint32_t width = std::min(Config.TileSize, Width - x), height = std::min(Config.TileSize, Height - y);
+	TileRestore restore{
+		.Layer = slot / tileCount,
+		.X = x,
+		.Y = y,
+		.Width = width,
+		.Height = height,
+		.Values = std::vector<float>(size_t(width) * height),
+	};
+	if (blob == NoBlob)
+		return restore;
+
+	auto decoder = HeightfieldDecoder::Open(Blobs[blob].Bytes);
+	[[maybe_unused]] bool decoded = decoder && decoder->DecodeTile(0, 0, restore.Values.data(), restore.Width);
+	assert(decoded);
+	return restore;
+}
+
+void TerrainHistory::EnforceMemoryCap()
+{
+	while (StoredBytes > Config.MemoryCap && Cursor > 0)
+	{
+		DropStep(Steps.front());
+		Steps.pop_front();
+		Cursor--;
+	}
+}
+
+} // namespace rad::proc
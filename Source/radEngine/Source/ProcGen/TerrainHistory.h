@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace rad::proc
+{
+
+/*
+Undo/redo of a set of equally sized float maps (the layers), kept as losslessly compressed tiles.
+
+Every commit hands in the full layers. Tiles whose content hash matches the current state are skipped, the others are
+compressed with the heightfield codec and stored once per distinct content, so a tile that returns to an earlier state
+reuses the old blob. A step only references the blobs before and after each of its changed tiles, undoing it gives back
+just those tiles. When the stored blobs exceed MemoryCap the oldest undo steps are dropped.
+
+Tiles are looked up by a 64-bit hash of their shape and raw floats. A hash match is confirmed against the stored
+content before a tile counts as unchanged or reuses a blob, colliding tiles get blobs of their own.
+*/
+struct TerrainHistory
+{
+	struct Settings
+	{
+		uint32_t TileSize = 128;
+		size_t MemoryCap = size_t(256) << 20;
+		// 0 picks DefaultThreadCount()
+		uint32_t ThreadCount = 0;
+	};
+
+	struct TileRestore
+	{
+		uint32_t Layer = 0;
+		uint32_t X = 0;
+		uint32_t Y = 0;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		std::vector<float> Values;
+	};
+
+	struct StepInfo
+	{
+		std::string Label;
+		uint32_t ChangedTiles = 0;
+		// Compressed bytes of the tiles this step added to the store
+		size_t Bytes = 0;
+	};
+
+	TerrainHistory(uint32_t layerCount, uint32_t width, uint32_t height, Settings const& settings);
+
+	// The first commit only records the base state. Returns whether a step was recorded, which also drops the redo
+	// steps.
+	bool Commit(std::string label, std::span<const std::span<const float>> layers);
+	// Tiles to write back into the layers, empty when there is nothing to undo or redo
+	std::vector<TileRestore> Undo();
+	std::vector<TileRestore> Redo();
+
+	bool CanUndo() const
+	{
+		return Cursor > 0;
+	}
+	bool CanRedo() const
+	{
+		return Cursor < Steps.size();
+	}
+	bool HasBaseState() const
+	{
+		return !Current.empty();
+	}
+	// Oldest first, the first GetUndoCount() can be undone and the rest redone
+	std::vector<StepInfo> GetSteps() const;
+	size_t GetUndoCount() const
+	{
+		return Cursor;
+	}
+	size_t GetStoredBytes() const
+	{
+		return StoredBytes;
+	}
+	uint32_t GetTileCount() const
+	{
+		return TilesX * TilesY;
+	}
+
+  private:
+	struct Blob
+	{
+		uint64_t Hash = 0;
+		uint32_t RefCount = 0;
+		std::vector<uint8_t> Bytes;
+	};
+	struct TileChange
+	{
+		uint32_t Slot;
+		uint32_t Before;
+		uint32_t After;
+	};
+	struct Step
+	{
+		StepInfo Info;
+		std::vector<TileChange> Changes;
+	};
+
+	bool BlobHolds(uint32_t blob, TileRestore const& tile) const;
+	uint32_t FindBlob(uint64_t hash, TileRestore const& tile) const;
+	uint32_t AddBlob(uint64_t hash, std::vector<uint8_t> bytes, size_t& addedBytes);
+	void AddRef(uint32_t blob);
+	void Release(uint32_t blob);
+	void DropStep(Step& step);
+	TileRestore Restore(uint32_t slot, uint32_t blob) const;
+	void EnforceMemoryCap();
+
+	Settings Config;
+	uint32_t LayerCount = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t TilesX = 0;
+	uint32_t TilesY = 0;
+
+	std::vector<Blob> Blobs;
+	std::vector<uint32_t> FreeBlobs;
+	std::unordered_multimap<uint64_t, uint32_t> BlobsByHash;
+	size_t StoredBytes = 0;
+
+	// Blob of every tile of every layer, slot = layer * tile count + tile
+	std::vector<uint32_t> Current;
+	std::deque<Step> Steps;
+	size_t Cursor = 0;
+};
+
+} // namespace rad::proc
@@ -0,0 +1,289 @@
+#include "TerrainMaterialBaker.h"
+
+#include "ParallelFor.h"
+
+#include <cassert>
+#include <cmath>
+#include <numbers>
+
+namespace rad::proc
+{
+
+MaterialTexture::MaterialTexture(uint32_t width, uint32_t height) : Width(width), Height(height)
+{
+	uint32_t mipCount = 1;
+	while ((std::max(width, height) >> mipCount) > 0)
+		mipCount++;
+	Mips.resize(mipCount);
+	for (uint32_t mip = 0; mip < mipCount; mip++)
+		Mips[mip].resize(size_t(GetMipWidth(mip)) * GetMipHeight(mip) * 4);
+}
+
+namespace
+{
+
+// Bilinear taps along one axis of a clamp sampler, for the texel centers of an output of outputSize texels shifted by
+// offset map texels, the uv clamped to [0, 1] first like FindNormal does
+struct AxisTaps
+{
+	std::vector<uint32_t> First;
+	std::vector<uint32_t> Second;
+	std::vector<float> Weight;
+	std::vector<float> Uv;
+};
+
+AxisTaps MakeAxisTaps(uint32_t outputSize, uint32_t mapSize, int offset)
+{
+	AxisTaps taps;
+	taps.First.resize(outputSize);
+	taps.Second.resize(outputSize);
+	taps.Weight.resize(outputSize);
+	taps.Uv.resize(outputSize);
+	for (uint32_t i = 0; i < outputSize; i++)
+	{
+		float uv = float(i) / float(outputSize) + 0.5f / float(outputSize);
+		uv = std::clamp(uv + float(offset) / float(mapSize), 0.0f, 1.0f);
+		float position = uv * float(mapSize) - 0.5f;
+		float base = std::floor(position);
+		int64_t first = int64_t(base);
+		taps.First[i] = uint32_t(std::clamp<int64_t>(first, 0, mapSize - 1));
+		taps.Second[i] = uint32_t(std::clamp<int64_t>(first + 1, 0, mapSize - 1));
+		taps.Weight[i] = position - base;
+		taps.Uv[i] = uv;
+	}
+	return taps;
+}
+
+struct MaterialTaps
+{
+	AxisTaps Left, Center, Right;
+	AxisTaps Top, Middle, Bottom;
+};
+
+MaterialTaps MakeMaterialTaps(TerrainMaterialMaps const& maps, uint32_t outputWidth, uint32_t outputHeight)
+{
+	return {
+		.Left = MakeAxisTaps(outputWidth, maps.Width, -1),
+		.Center = MakeAxisTaps(outputWidth, maps.Width, 0),
+		.Right = MakeAxisTaps(outputWidth, maps.Width, 1),
+		.Top = MakeAxisTaps(outputHeight, maps.Height, -1),
+		.Middle = MakeAxisTaps(outputHeight, maps.Height, 0),
+		.Bottom = MakeAxisTaps(outputHeight, maps.Height, 1),
+	};
+}
+
+// Vertical half of a bilinear sample for a whole map row, summing the planes like FindNormal of the water material
+void LerpRows(std::span<const float> planeA, std::span<const float> planeB, uint32_t width, AxisTaps const& taps,
+			  uint32_t y, float* out)
+{
+	float weight = taps.Weight[y];
+	size_t first = size_t(taps.First[y]) * width, second = size_t(taps.Second[y]) * width;
+	float const* a0 = planeA.data() + first;
+	float const* a1 = planeA.data() + second;
+	if (planeB.empty())
+		for (uint32_t i = 0; i < width; i++)
+			out[i] = a0[i] * (1.0f - weight) + a1[i] * weight;
+	else
+	{
+		float const* b0 = planeB.data() + first;
+		float const* b1 = planeB.data() + second;
+		for (uint32_t i = 0; i < width; i++)
+			out[i] = (a0[i] + b0[i]) * (1.0f - weight) + (a1[i] + b1[i]) * weight;
+	}
+}
+
+// Horizontal half, the only gather of the sample
+void GatherRow(float const* row, AxisTaps const& taps, uint32_t count, float* out)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float weight = taps.Weight[i];
+		out[i] = row[taps.First[i]] * (1.0f - weight) + row[taps.Second[i]] * weight;
+	}
+}
+
+struct RowScratch
+{
+	std::vector<float> MapTop, MapMiddle, MapBottom, MapExtra;
+	std::vector<float> Left, Right, Top, Bottom, Center, Extra, NormalY;
+
+	void Resize(uint32_t mapWidth, uint32_t outputWidth)
+	{
+		for (auto* row : {&MapTop, &MapMiddle, &MapBottom, &MapExtra})
+			row->resize(mapWidth);
+		for (auto* row : {&Left, &Right, &Top, &Bottom, &Center, &Extra, &NormalY})
+			row->resize(outputWidth);
+	}
+};
+
+// FindNormal of both material shaders for a row, from the four neighbour samples. Writes the normal to the RGBA row in
+// the xzy * 0.5 + 0.5 encoding and returns its y in normalY for the slope.
+void FindNormalRow(RowScratch const& samples, MaterialTaps const& taps, uint32_t y, uint32_t count, float totalLength,
+				   float* normalTexels, float* normalY)
+{
+	float spanZ = (taps.Top.Uv[y] - taps.Bottom.Uv[y]) * totalLength;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		float ax = (taps.Right.Uv[i] - taps.Left.Uv[i]) * totalLength;
+		float ay = samples.Left[i] - samples.Right[i];
+		float inverseA = 1.0f / std::sqrt(ax * ax + ay * ay);
+		ax *= inverseA;
+		ay *= inverseA;
+		float by = samples.Bottom[i] - samples.Top[i];
+		float bz = spanZ;
+		float inverseB = 1.0f / std::sqrt(by * by + bz * bz);
+		by *= inverseB;
+		bz *= inverseB;
+
+		// cross((ax, ay, 0), (0, by, bz))
+		float nx = ay * bz, ny = -ax * bz, nz = ax * by;
+		float inverseN = 1.0f / std::sqrt(nx * nx + ny * ny + nz * nz);
+		nx *= inverseN;
+		ny *= inverseN;
+		nz *= inverseN;
+		normalTexels[i * 4 + 0] = nx * 0.5f + 0.5f;
+		normalTexels[i * 4 + 1] = nz * 0.5f + 0.5f;
+		normalTexels[i * 4 + 2] = ny * 0.5f + 0.5f;
+		normalTexels[i * 4 + 3] = 0.0f;
+		normalY[i] = ny;
+	}
+}
+
+void SampleNeighbours(TerrainMaterialMaps const& maps, std::span<const float> extraPlane, MaterialTaps const& taps,
+					  uint32_t y, uint32_t count, RowScratch& scratch)
+{
+	LerpRows(maps.Heights, extraPlane, maps.Width, taps.Top, y, scratch.MapTop.data());
+	LerpRows(maps.Heights, extraPlane, maps.Width, taps.Middle, y, scratch.MapMiddle.data());
+	LerpRows(maps.Heights, extraPlane, maps.Width, taps.Bottom, y, scratch.MapBottom.data());
+	GatherRow(scratch.MapMiddle.data(), taps.Left, count, scratch.Left.data());
+	GatherRow(scratch.MapMiddle.data(), taps.Right, count, scratch.Right.data());
+	GatherRow(scratch.MapTop.data(), taps.Center, count, scratch.Top.data());
+	GatherRow(scratch.MapBottom.data(), taps.Center, count, scratch.Bottom.data());
+}
+
+float Lerp(float a, float b, float t)
+{
+	return a + (b - a) * t;
+}
+
+} // namespace
+
+void BakeTerrainMaterial(TerrainMaterialMaps const& maps, MaterialTexture& albedo, MaterialTexture& normal,
+						 uint32_t threadCount)
+{
+	assert(albedo.Width == normal.Width && albedo.Height == normal.Height);
+	assert(maps.Heights.size() >= size_t(maps.Width) * maps.Height);
+	uint32_t width = albedo.Width;
+	MaterialTaps taps = MakeMaterialTaps(maps, width, albedo.Height);
+
+	ParallelFor(albedo.Height, threadCount,
+				[&](uint32_t y)
+				{
+					thread_local RowScratch scratch;
+					scratch.Resize(maps.Width, width);
+					SampleNeighbours(maps, {}, taps, y, width, scratch);
+					GatherRow(scratch.MapMiddle.data(), taps.Center, width, scratch.Center.data());
+
+					float* normalTexels = normal.Mips[0].data() + size_t(y) * width * 4;
+					float* albedoTexels = albedo.Mips[0].data() + size_t(y) * width * 4;
+					FindNormalRow(scratch, taps, y, width, maps.TotalLength, normalTexels, scratch.NormalY.data());
+
+					constexpr float sand[3] = {194.0f / 255.0f, 178.0f / 255.0f, 128.0f / 255.0f};
+					constexpr float grass[3] = {6.0f / 255.0f, 77.0f / 255.0f, 10.0f / 255.0f};
+					constexpr float snow[3] = {0.9f, 0.9f, 0.9f};
+					constexpr float rock = 0.25f;
+					constexpr float waterHeight = 0.3f, transitionDist = 0.05f, grassHeight = 0.7f, snowHeight = 1.0f;
+					constexpr float slopeMin = 50.0f / 180.0f;
+					for (uint32_t i = 0; i < width; i++)
+					{
+						float heightCenter = scratch.Center[i] / 100.0f;
+						float normalY = scratch.NormalY[i];
+						float slope = std::asin(std::sqrt(std::max(0.0f, 1.0f - normalY * normalY)));
+						float rockAmount =
+							std::max(0.0f, slope / (std::numbers::pi_v<float> / 2) - slopeMin) / (1.0f - slopeMin);
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							float color;
+							if (heightCenter < waterHeight)
+								color = sand[c];
+							else if (heightCenter < waterHeight + transitionDist)
+								color = Lerp(sand[c], grass[c], (heightCenter - waterHeight) / transitionDist);
+							else if (heightCenter < grassHeight)
+								color = grass[c];
+							else
+								color = Lerp(grass[c], snow[c], (heightCenter - grassHeight) / (snowHeight - grassHeight));
+							albedoTexels[i * 4 + c] = std::clamp(Lerp(color, rock, rockAmount), 0.0f, 1.0f);
+						}
+						albedoTexels[i * 4 + 3] = 1.0f;
+					}
+				});
+
+	GenerateMaterialMips(albedo, threadCount);
+	GenerateMaterialMips(normal, threadCount);
+}
+
+void BakeWaterMaterial(TerrainMaterialMaps const& maps, MaterialTexture& albedo, MaterialTexture& normal,
+					   uint32_t threadCount)
+{
+	assert(albedo.Width == normal.Width && albedo.Height == normal.Height);
+	assert(maps.Heights.size() >= size_t(maps.Width) * maps.Height);
+	assert(maps.Water.size() >= size_t(maps.Width) * maps.Height);
+	assert(maps.Sediment.size() >= size_t(maps.Width) * maps.Height);
+	uint32_t width = albedo.Width;
+	MaterialTaps taps = MakeMaterialTaps(maps, width, albedo.Height);
+
+	ParallelFor(albedo.Height, threadCount,
+				[&](uint32_t y)
+				{
+					thread_local RowScratch scratch;
+					scratch.Resize(maps.Width, width);
+					SampleNeighbours(maps, maps.Water, taps, y, width, scratch);
+					LerpRows(maps.Water, {}, maps.Width, taps.Middle, y, scratch.MapMiddle.data());
+					GatherRow(scratch.MapMiddle.data(), taps.Center, width, scratch.Center.data());
+					LerpRows(maps.Sediment, {}, maps.Width, taps.Middle, y, scratch.MapExtra.data());
+					GatherRow(scratch.MapExtra.data(), taps.Center, width, scratch.Extra.data());
+
+					float* normalTexels = normal.Mips[0].data() + size_t(y) * width * 4;
+					float* albedoTexels = albedo.Mips[0].data() + size_t(y) * width * 4;
+					FindNormalRow(scratch, taps, y, width, maps.TotalLength, normalTexels, scratch.NormalY.data());
+
+					for (uint32_t i = 0; i < width; i++)
+					{
+						float sediment = std::clamp(scratch.Extra[i], 0.0f, 1.0f);
+						albedoTexels[i * 4 + 0] = sediment;
+						albedoTexels[i * 4 + 1] = 0.0f;
+						albedoTexels[i * 4 + 2] = 1.0f - sediment;
+						albedoTexels[i * 4 + 3] = scratch.Center[i] > 0.05f ? 1.0f : 0.0f;
+					}
+				});
+
+	GenerateMaterialMips(albedo, threadCount);
+	GenerateMaterialMips(normal, threadCount);
+}
+
+void GenerateMaterialMips(MaterialTexture& texture, uint32_t threadCount)
+{
+	for (uint32_t mip = 1; mip < texture.Mips.size(); mip++)
+	{
+		uint32_t sourceWidth = texture.GetMipWidth(mip - 1), sourceHeight = texture.GetMipHeight(mip - 1);
+		uint32_t width = texture.GetMipWidth(mip);
+		float const* source = texture.Mips[mip - 1].data();
+		float* target = texture.Mips[mip].data();
+		ParallelFor(texture.GetMipHeight(mip), threadCount,
+					[&](uint32_t y)
+					{
+						float const* row0 = source + size_t(std::min(2 * y, sourceHeight - 1)) * sourceWidth * 4;
+						float const* row1 = source + size_t(std::min(2 * y + 1, sourceHeight - 1)) * sourceWidth * 4;
+						float* out = target + size_t(y) * width * 4;
+						for (uint32_t x = 0; x < width; x++)
+						{
+							size_t x0 = size_t(std::min(2 * x, sourceWidth - 1)) * 4;
+							size_t x1 = size_t(std::min(2 * x + 1, sourceWidth - 1)) * 4;
+							for (uint32_t c = 0; c < 4; c++)
+								out[x * 4 + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+						}
+					});
+	}
+}
+
+} // namespace rad::proc
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rad::proc
+{
+
+// RGBA float texels of every mip, mip 0 first, values already in [0, 1] like the R16G16B16A16_UNORM textures
+struct MaterialTexture
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<std::vector<float>> Mips;
+
+	MaterialTexture() = default;
+	// Allocates the full chain down to 1x1
+	MaterialTexture(uint32_t width, uint32_t height);
+
+	uint32_t GetMipWidth(uint32_t mip) const
+	{
+		return std::max(1u, Width >> mip);
+	}
+	uint32_t GetMipHeight(uint32_t mip) const
+	{
+		return std::max(1u, Height >> mip);
+	}
+};
+
+// The maps of CTerrain the material shaders read, Water and Sediment are only needed by BakeWaterMaterial
+struct TerrainMaterialMaps
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::span<const float> Heights;
+	std::span<const float> Water;
+	std::span<const float> Sediment;
+	float TotalLength = 0.0f;
+};
+
+/*
+CPU ports of HeightMapToTerrainMaterial and HeightMapToWaterMaterial for baking materials without a GPU. Each output
+texel samples the maps bilinearly with clamped addressing at the same uv as the shader, so the results match up to the
+filtering precision of the texture units and UNORM rounding. The sampling is split into a vertical lerp over whole map
+rows and a horizontal gather through per column tables, leaving the normal and colour math in flat loops the compiler
+vectorizes. Rows of the output are spread over ParallelFor, then the mips are box filtered like the SPD pass does.
+*/
+void BakeTerrainMaterial(TerrainMaterialMaps const& maps, MaterialTexture& albedo, MaterialTexture& normal,
+						 uint32_t threadCount = 0);
+void BakeWaterMaterial(TerrainMaterialMaps const& maps, MaterialTexture& albedo, MaterialTexture& normal,
+					   uint32_t threadCount = 0);
+
+// Rebuilds mips 1 and up from mip 0 with a 2x2 box filter, odd sizes clamp the last row and column
+void GenerateMaterialMips(MaterialTexture& texture, uint32_t threadCount = 0);
+
+} // namespace rad::proc
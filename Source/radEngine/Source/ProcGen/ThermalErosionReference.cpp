@@ -0,0 +1,132 @@
+#include "ThermalErosionReference.h"
+#include "ParallelFor.h"
+
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+namespace rad::proc
+{
+
+// Same ordering as IndexToOffset8 in TerrainCommon.hlsli
+static constexpr std::array<std::array<int, 2>, 8> Offsets8 = {
+	{{-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}}};
+
+static float TalusAngle(hlsl::ThermalErosionResources const& settings, float hardness)
+{
+	return hardness * (1.0f - settings.SoftnessTalusCoefficient) + settings.MinTalusCoefficient;
+}
+
+static float FluxPerHeightDiff(hlsl::ThermalErosionResources const& settings, float hardness)
+{
+	float cellArea = settings.PipeLength * settings.PipeLength;
+	return cellArea * settings.DeltaTime * hardness * settings.ThermalErosionRate * 0.5f;
+}
+
+static bool InBounds(int x, int y, uint32_t width, uint32_t height)
+{
+	return x >= 0 && y >= 0 && x < int(width) && y < int(height);
+}
+
+void ThermalErosionScatter(std::span<const float> heights, std::span<const float> softness, uint32_t width,
+						   uint32_t height, hlsl::ThermalErosionResources const& settings, std::span<float> outHeights,
+						   uint32_t threadCount)
+{
+	[[maybe_unused]] size_t cellCount = size_t(width) * height;
+	assert(heights.size() >= cellCount && softness.size() >= cellCount && outHeights.size() >= cellCount);
+
+	// Stands in for the ThermalPipe1/ThermalPipe2 textures
+	std::vector<std::array<float, 8>> pipes(cellCount);
+	ParallelFor(height, threadCount,
+				[&](uint32_t y)
+				{
+					for (uint32_t x = 0; x < width; x++)
+					{
+						size_t index = x + size_t(y) * width;
+						float heightCur = heights[index];
+						float hardness = softness[index];
+						float talus = TalusAngle(settings, hardness);
+						std::array<float, 8> heightDiffs;
+						float effectiveTotalHeightDiffs = 0;
+						for (int i = 0; i < 8; i++)
+						{
+							heightDiffs[i] = -1;
+							int nx = int(x) + Offsets8[i][0], ny = int(y) + Offsets8[i][1];
+							if (!InBounds(nx, ny, width, height))
+								continue;
+							float d =
+								std::sqrt(float(Offsets8[i][0] * Offsets8[i][0] + Offsets8[i][1] * Offsets8[i][1])) *
+								settings.PipeLength;
+							float heightDiff = heightCur - heights[nx + size_t(ny) * width];
+							if (heightDiff > 0 && heightDiff / d > talus)
+							{
+								heightDiffs[i] = heightDiff;
+								effectiveTotalHeightDiffs += heightDiff;
+							}
+						}
+						float deltaS = FluxPerHeightDiff(settings, hardness) * effectiveTotalHeightDiffs;
+						for (int i = 0; i < 8; i++)
+							pipes[index][i] =
+								heightDiffs[i] > 0 ? deltaS * heightDiffs[i] / effectiveTotalHeightDiffs : 0.0f;
+					}
+				});
+
+	ParallelFor(height, threadCount,
+				[&](uint32_t y)
+				{
+					for (uint32_t x = 0; x < width; x++)
+					{
+						size_t index = x + size_t(y) * width;
+						float toAdd = 0;
+						for (int i = 0; i < 8; i++)
+						{
+							int nx = int(x) + Offsets8[i][0], ny = int(y) + Offsets8[i][1];
+							if (InBounds(nx, ny, width, height))
+								toAdd += pipes[nx + size_t(ny) * width][7 - i];
+							toAdd -= pipes[index][i];
+						}
+						outHeights[index] = heights[index] + toAdd;
+					}
+				});
+}
+
+void ThermalErosionGather(std::span<const float> heights, std::span<const float> softness, uint32_t width,
+						  uint32_t height, hlsl::ThermalErosionResources const& settings, std::span<float> outHeights,
+						  uint32_t threadCount)
+{
+	[[maybe_unused]] size_t cellCount = size_t(width) * height;
+	assert(heights.size() >= cellCount && softness.size() >= cellCount && outHeights.size() >= cellCount);
+
+	ParallelFor(height, threadCount,
+				[&](uint32_t y)
+				{
+					for (uint32_t x = 0; x < width; x++)
+					{
+						size_t index = x + size_t(y) * width;
+						float heightCur = heights[index];
+						float talusCur = TalusAngle(settings, softness[index]);
+						float outHeightDiffs = 0;
+						float inFlux = 0;
+						for (int i = 0; i < 8; i++)
+						{
+							int nx = int(x) + Offsets8[i][0], ny = int(y) + Offsets8[i][1];
+							if (!InBounds(nx, ny, width, height))
+								continue;
+							size_t neighborIndex = nx + size_t(ny) * width;
+							float d =
+								std::sqrt(float(Offsets8[i][0] * Offsets8[i][0] + Offsets8[i][1] * Offsets8[i][1])) *
+								settings.PipeLength;
+							float heightDiff = heightCur - heights[neighborIndex];
+							if (heightDiff > 0 && heightDiff / d > talusCur)
+								outHeightDiffs += heightDiff;
+							else if (-heightDiff > 0 && -heightDiff / d > TalusAngle(settings, softness[neighborIndex]))
+								inFlux += FluxPerHeightDiff(settings, softness[neighborIndex]) * -heightDiff;
+						}
+						outHeights[index] =
+							heightCur + inFlux - FluxPerHeightDiff(settings, softness[index]) * outHeightDiffs;
+					}
+				});
+}
+
+} // namespace rad::proc
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include "Compute/Terrain/TerrainResources.hlsli"
+
+namespace rad::proc
+{
+
+/*
+CPU references of one thermal erosion step, used to validate the T1ThermalErosion compute shader against the old two
+pass formulation. Both read heights and softness of a width x height map and write the eroded heights to outHeights,
+the texture indices in the settings are ignored. Rows are spread over threadCount threads, 0 picks
+DefaultThreadCount().
+
+Scatter (old T1ThermalOutflux + T2ThermalDeposit): the first pass writes 8 outflux values per cell into two RGBA32F
+textures, the second pass sums the incoming and outgoing flux of each cell.
+	Extra memory: 32 bytes per cell (32 MiB at 1024^2, 512 MiB at 4096^2)
+	Traffic per cell: 8 B read + 32 B written, then 64 B pipe reads + 8 B height read/write, ~112 B over two dispatches
+
+Gather (T1ThermalErosion): every cell recomputes the outflux of its neighbours towards itself from their height and
+softness, which only depends on the height difference and the neighbour's softness.
+	Extra memory: none, the result goes to TempHeightMap which the hydraulic step already owns
+	Traffic per cell: 8 B read + 4 B written, plus an 8 B copy back into HeightMap, ~20 B in one dispatch
+*/
+void ThermalErosionScatter(std::span<const float> heights, std::span<const float> softness, uint32_t width,
+						   uint32_t height, hlsl::ThermalErosionResources const& settings, std::span<float> outHeights,
+						   uint32_t threadCount = 0);
+void ThermalErosionGather(std::span<const float> heights, std::span<const float> softness, uint32_t width,
+						  uint32_t height, hlsl::ThermalErosionResources const& settings, std::span<float> outHeights,
+						  uint32_t threadCount = 0);
+
+} // namespace rad::proc
@@ -0,0 +1,267 @@
+#include "WaterBodies.h"
+
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+
+namespace rad::proc
+{
+
+static constexpr uint32_t DryCell = ~0u;
+
+namespace
+{
+
+struct Tile
+{
+	uint32_t X0, Y0, X1, Y1;
+};
+
+// Per tile sums of a body, merged into WaterBody once every tile is done
+struct BodyPartial
+{
+	uint32_t Label;
+	uint32_t MinX, MinY, MaxX, MaxY;
+	uint32_t Area;
+	double Depth;
+	double Level;
+};
+
+// Only used while a tile is labelled on its own, no other thread touches its cells
+uint32_t FindLocal(std::vector<uint32_t>& parents, uint32_t cell)
+{
+	while (parents[cell] != cell)
+	{
+		parents[cell] = parents[parents[cell]];
+		cell = parents[cell];
+	}
+	return cell;
+}
+
+void UniteLocal(std::vector<uint32_t>& parents, uint32_t a, uint32_t b)
+{
+	a = FindLocal(parents, a);
+	b = FindLocal(parents, b);
+	if (a != b)
+		parents[std::max(a, b)] = std::min(a, b);
+}
+
+// Links may be rewritten by other threads while the tile borders are merged
+uint32_t LoadShared(std::vector<uint32_t>& parents, uint32_t cell)
+{
+	return std::atomic_ref(parents[cell]).load(std::memory_order_relaxed);
+}
+
+uint32_t FindShared(std::vector<uint32_t>& parents, uint32_t cell)
+{
+	for (;;)
+	{
+		uint32_t parent = LoadShared(parents, cell);
+		if (parent == cell)
+			return cell;
+		cell = parent;
+	}
+}
+
+// A root only ever gets linked to a smaller root, the exchange fails if another thread linked it first
+void UniteShared(std::vector<uint32_t>& parents, uint32_t a, uint32_t b)
+{
+	for (;;)
+	{
+		a = FindShared(parents, a);
+		b = FindShared(parents, b);
+		if (a == b)
+			return;
+		if (a < b)
+			std::swap(a, b);
+		uint32_t expected = a;
+		if (std::atomic_ref(parents[a]).compare_exchange_weak(expected, b, std::memory_order_relaxed))
+			return;
+	}
+}
+
+} // namespace
+
+WaterBodyLabels LabelWaterBodies(std::span<const float> water, std::span<const float> heights, uint32_t width,
+								 uint32_t height, WaterLabelSettings const& settings)
+{
+	size_t cellCount = size_t(width) * height;
+	assert(water.size() >= cellCount && heights.size() >= cellCount);
+	assert(cellCount < DryCell);
+
+	WaterBodyLabels result{
+		.Width = width, .Height = height, .Labels = std::vector<uint32_t>(cellCount), .Bodies = {}};
+	if (cellCount == 0)
+		return result;
+
+	uint32_t tileSize = std::max(settings.TileSize, 1u);
+	uint32_t tilesX = (width + tileSize - 1) / tileSize;
+	uint32_t tilesY = (height + tileSize - 1) / tileSize;
+	std::vector<Tile> tiles;
+	tiles.reserve(size_t(tilesX) * tilesY);
+	for (uint32_t ty = 0; ty < tilesY; ty++)
+		for (uint32_t tx = 0; tx < tilesX; tx++)
+			tiles.push_back({tx * tileSize, ty * tileSize, std::min((tx + 1) * tileSize, width),
+							 std::min((ty + 1) * tileSize, height)});
+	uint32_t tileCount = uint32_t(tiles.size());
+
+	// Cells that started a new tree in their tile, the ones still roots after the border merge are the bodies
+	std::vector<std::vector<uint32_t>> tileRoots(tileCount);
+	std::vector<uint32_t> parents(cellCount);
+	ParallelFor(tileCount, settings.ThreadCount,
+				[&](uint32_t tileIndex)
+				{
+					auto const& tile = tiles[tileIndex];
+					for (uint32_t y = tile.Y0; y < tile.Y1; y++)
+						for (uint32_t x = tile.X0; x < tile.X1; x++)
+						{
+							uint32_t cell = x + y * width;
+							if (water[cell] < settings.Threshold)
+							{
+								parents[cell] = DryCell;
+								continue;
+							}
+							bool hasLeft = x > tile.X0 && parents[cell - 1] != DryCell;
+							bool hasUp = y > tile.Y0 && parents[cell - width] != DryCell;
+							// Copying the neighbour's link keeps rows cheap, later unions shorten the paths
+							if (hasLeft)
+								parents[cell] = parents[cell - 1];
+							else if (hasUp)
+								parents[cell] = parents[cell - width];
+							else
+							{
+								parents[cell] = cell;
+								tileRoots[tileIndex].push_back(cell);
+							}
+							if (hasLeft && hasUp && parents[cell - width] != parents[cell])
+								UniteLocal(parents, cell - width, cell);
+						}
+				});
+
+	// Every tile merges its left and top border with the neighbouring tiles
+	ParallelFor(tileCount, settings.ThreadCount,
+				[&](uint32_t tileIndex)
+				{
+					auto const& tile = tiles[tileIndex];
+					if (tile.X0 > 0)
+						for (uint32_t y = tile.Y0; y < tile.Y1; y++)
+						{
+							uint32_t cell = tile.X0 + y * width;
+							if (LoadShared(parents, cell) != DryCell && LoadShared(parents, cell - 1) != DryCell)
+								UniteShared(parents, cell, cell - 1);
+						}
+					if (tile.Y0 > 0)
+						for (uint32_t x = tile.X0; x < tile.X1; x++)
+						{
+							uint32_t cell = x + tile.Y0 * width;
+							if (LoadShared(parents, cell) != DryCell && LoadShared(parents, cell - width) != DryCell)
+								UniteShared(parents, cell, cell - width);
+						}
+				});
+
+	std::vector<uint32_t> tileFirstLabels(tileCount + 1);
+	uint32_t bodyCount = 0;
+	for (uint32_t tileIndex = 0; tileIndex < tileCount; tileIndex++)
+	{
+		tileFirstLabels[tileIndex] = bodyCount + 1;
+		for (uint32_t root : tileRoots[tileIndex])
+			if (parents[root] == root)
+				result.Labels[root] = ++bodyCount;
+	}
+	tileFirstLabels[tileCount] = bodyCount + 1;
+
+	// Cells are summed per row run of one body. A body's root lies in exactly one tile, that tile adds the runs
+	// straight into bodySums, runs of bodies rooted in other tiles are merged afterwards.
+	std::vector<BodyPartial> bodySums(bodyCount, BodyPartial{0, DryCell, DryCell, 0, 0, 0, 0.0, 0.0});
+	std::vector<std::vector<BodyPartial>> tilePartials(tileCount);
+	ParallelFor(tileCount, settings.ThreadCount,
+				[&](uint32_t tileIndex)
+				{
+					auto const& tile = tiles[tileIndex];
+					uint32_t firstLabel = tileFirstLabels[tileIndex], endLabel = tileFirstLabels[tileIndex + 1];
+					BodyPartial run{};
+					auto flushRun = [&]()
+					{
+						if (!run.Area)
+							return;
+						if (run.Label < firstLabel || run.Label >= endLabel)
+						{
+							tilePartials[tileIndex].push_back(run);
+							return;
+						}
+						auto& sum = bodySums[run.Label - 1];
+						sum.MinX = std::min(sum.MinX, run.MinX);
+						sum.MinY = std::min(sum.MinY, run.MinY);
+						sum.MaxX = std::max(sum.MaxX, run.MaxX);
+						sum.MaxY = std::max(sum.MaxY, run.MaxY);
+						sum.Area += run.Area;
+						sum.Depth += run.Depth;
+						sum.Level += run.Level;
+					};
+
+					uint32_t lastParent = DryCell, lastLabel = 0;
+					for (uint32_t y = tile.Y0; y < tile.Y1; y++)
+					{
+						for (uint32_t x = tile.X0; x < tile.X1; x++)
+						{
+							uint32_t cell = x + y * width;
+							uint32_t parent = parents[cell];
+							if (parent == DryCell)
+							{
+								flushRun();
+								run.Area = 0;
+								continue;
+							}
+							if (parent != lastParent)
+							{
+								lastParent = parent;
+								lastLabel = result.Labels[FindShared(parents, parent)];
+							}
+							// Roots were labelled above and are read by other tiles, only write the other cells
+							if (parent != cell)
+								result.Labels[cell] = lastLabel;
+							if (!run.Area || run.Label != lastLabel)
+							{
+								flushRun();
+								run = {lastLabel, x, y, x, y, 0, 0.0, 0.0};
+							}
+							run.MaxX = x;
+							run.Area++;
+							run.Depth += water[cell];
+							run.Level += double(water[cell]) + heights[cell];
+						}
+						flushRun();
+						run.Area = 0;
+					}
+				});
+
+	for (auto const& partials : tilePartials)
+		for (auto const& partial : partials)
+		{
+			auto& sum = bodySums[partial.Label - 1];
+			sum.MinX = std::min(sum.MinX, partial.MinX);
+			sum.MinY = std::min(sum.MinY, partial.MinY);
+			sum.MaxX = std::max(sum.MaxX, partial.MaxX);
+			sum.MaxY = std::max(sum.MaxY, partial.MaxY);
+			sum.Area += partial.Area;
+			sum.Depth += partial.Depth;
+			sum.Level += partial.Level;
+		}
+
+	result.Bodies.reserve(bodyCount);
+	for (auto const& sum : bodySums)
+		result.Bodies.push_back({
+			.MinX = sum.MinX,
+			.MinY = sum.MinY,
+			.MaxX = sum.MaxX,
+			.MaxY = sum.MaxY,
+			.Area = sum.Area,
+			.Volume = float(sum.Depth * settings.CellArea),
+			.MeanLevel = float(sum.Level / sum.Area),
+		});
+	return result;
+}
+
+} // namespace rad::proc
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rad::proc
+{
+
+struct WaterBody
+{
+	// Inclusive bounding rect in map cells
+	uint32_t MinX = 0;
+	uint32_t MinY = 0;
+	uint32_t MaxX = 0;
+	uint32_t MaxY = 0;
+	uint32_t Area = 0;
+	// Water depth summed over the cells, times CellArea
+	float Volume = 0.0f;
+	// Mean height of the water surface, terrain plus water
+	float MeanLevel = 0.0f;
+};
+
+struct WaterLabelSettings
+{
+	// Same cutoff as the discard in the water shaders
+	float Threshold = 0.2f;
+	float CellArea = 1.0f;
+	uint32_t TileSize = 128;
+	// 0 picks DefaultThreadCount()
+	uint32_t ThreadCount = 0;
+};
+
+struct WaterBodyLabels
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	// 0 for dry cells, otherwise the index into Bodies plus one
+	std::vector<uint32_t> Labels;
+	std::vector<WaterBody> Bodies;
+};
+
+/*
+Splits the cells with water at or above Threshold into 4-connected water bodies. The map is cut into tiles that are
+labelled in parallel with a union-find each, then the tile borders are merged with lock-free unions. Links always point
+to the smaller cell index, so every body's root is its first cell in raster order and the labels don't depend on the
+thread count. Bodies are numbered tile by tile, in raster order of their root within the tile.
+*/
+WaterBodyLabels LabelWaterBodies(std::span<const float> water, std::span<const float> heights, uint32_t width,
+								 uint32_t height, WaterLabelSettings const& settings = {});
+
+} // namespace rad::proc
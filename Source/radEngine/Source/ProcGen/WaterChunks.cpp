@@ -0,0 +1,96 @@
+#include "WaterChunks.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace rad::proc
+{
+
+std::vector<uint32_t> BuildChunkedPlaneIndices(WaterChunkGrid const& grid, std::vector<uint32_t>& outChunkIndexOffsets)
+{
+	std::vector<uint32_t> indices;
+	indices.reserve(size_t(grid.ResX - 1) * (grid.ResY - 1) * 6);
+	outChunkIndexOffsets.clear();
+	outChunkIndexOffsets.reserve(grid.ChunkCount() + 1);
+	for (uint32_t cy = 0; cy < grid.ChunksY(); cy++)
+		for (uint32_t cx = 0; cx < grid.ChunksX(); cx++)
+		{
+			outChunkIndexOffsets.push_back(uint32_t(indices.size()));
+			uint32_t xEnd = std::min((cx + 1) * grid.ChunkQuads, grid.ResX - 1);
+			uint32_t yEnd = std::min((cy + 1) * grid.ChunkQuads, grid.ResY - 1);
+			for (uint32_t y = cy * grid.ChunkQuads; y < yEnd; y++)
+				for (uint32_t x = cx * grid.ChunkQuads; x < xEnd; x++)
+				{
+					uint32_t vtx1 = x + y * grid.ResX;
+					uint32_t vtx2 = vtx1 + 1;
+					uint32_t vtx3 = vtx1 + grid.ResX;
+					uint32_t vtx4 = vtx3 + 1;
+					indices.insert(indices.end(), {vtx1, vtx3, vtx2, vtx3, vtx4, vtx2});
+				}
+		}
+	outChunkIndexOffsets.push_back(uint32_t(indices.size()));
+	return indices;
+}
+
+std::vector<float> ComputeChunkMaxWater(std::span<const float> waterMap, uint32_t mapWidth, uint32_t mapHeight,
+										WaterChunkGrid const& grid)
+{
+	assert(waterMap.size() >= size_t(mapWidth) * mapHeight);
+	std::vector<float> chunkMax(grid.ChunkCount(), 0.0f);
+	for (uint32_t cy = 0; cy < grid.ChunksY(); cy++)
+		for (uint32_t cx = 0; cx < grid.ChunksX(); cx++)
+		{
+			uint32_t firstX = cx * grid.ChunkQuads, firstY = cy * grid.ChunkQuads;
+			uint32_t lastX = std::min(firstX + grid.ChunkQuads, grid.ResX - 1);
+			uint32_t lastY = std::min(firstY + grid.ChunkQuads, grid.ResY - 1);
+			int minX = std::max(int(firstX * mapWidth / grid.ResX) - 1, 0);
+			int minY = std::max(int(firstY * mapHeight / grid.ResY) - 1, 0);
+			int maxX = std::min(int(lastX * mapWidth / grid.ResX) + 1, int(mapWidth) - 1);
+			int maxY = std::min(int(lastY * mapHeight / grid.ResY) + 1, int(mapHeight) - 1);
+			float maxWater = 0.0f;
+			for (int y = minY; y <= maxY; y++)
+				for (int x = minX; x <= maxX; x++)
+					maxWater = std::max(maxWater, waterMap[x + size_t(y) * mapWidth]);
+			chunkMax[cx + cy * grid.ChunksX()] = maxWater;
+		}
+	return chunkMax;
+}
+
+std::vector<uint8_t> ClassifyWetChunks(std::span<const float> chunkMaxWater, WaterChunkGrid const& grid,
+									   float threshold, uint32_t dilation)
+{
+	int chunksX = grid.ChunksX(), chunksY = grid.ChunksY();
+	assert(chunkMaxWater.size() >= size_t(chunksX) * chunksY);
+	std::vector<uint8_t> wet(size_t(chunksX) * chunksY, 0);
+	int reach = int(dilation);
+	for (int cy = 0; cy < chunksY; cy++)
+		for (int cx = 0; cx < chunksX; cx++)
+		{
+			if (chunkMaxWater[cx + cy * chunksX] < threshold)
+				continue;
+			for (int y = std::max(cy - reach, 0); y <= std::min(cy + reach, chunksY - 1); y++)
+				for (int x = std::max(cx - reach, 0); x <= std::min(cx + reach, chunksX - 1); x++)
+					wet[x + y * chunksX] = 1;
+		}
+	return wet;
+}
+
+std::vector<IndexRange> BuildWetDrawRanges(std::span<const uint8_t> wetChunks,
+										   std::span<const uint32_t> chunkIndexOffsets)
+{
+	assert(chunkIndexOffsets.size() == wetChunks.size() + 1);
+	std::vector<IndexRange> ranges;
+	for (size_t i = 0; i < wetChunks.size(); i++)
+	{
+		if (!wetChunks[i])
+			continue;
+		uint32_t start = chunkIndexOffsets[i], count = chunkIndexOffsets[i + 1] - chunkIndexOffsets[i];
+		if (!ranges.empty() && ranges.back().StartIndex + ranges.back().IndexCount == start)
+			ranges.back().IndexCount += count;
+		else
+			ranges.push_back({start, count});
+	}
+	return ranges;
+}
+
+} // namespace rad::proc
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace rad::proc
+{
+
+/*
+Splits an indexed plane into square chunks of quads so that the water passes can skip the chunks without water. The
+plane's indices are laid out chunk by chunk, which turns any set of chunks into a few contiguous index ranges.
+*/
+struct WaterChunkGrid
+{
+	// Vertices of the plane along each axis
+	uint32_t ResX = 0;
+	uint32_t ResY = 0;
+	uint32_t ChunkQuads = 16;
+
+	uint32_t ChunksX() const
+	{
+		return (ResX - 1 + ChunkQuads - 1) / ChunkQuads;
+	}
+	uint32_t ChunksY() const
+	{
+		return (ResY - 1 + ChunkQuads - 1) / ChunkQuads;
+	}
+	uint32_t ChunkCount() const
+	{
+		return ChunksX() * ChunksY();
+	}
+};
+
+struct IndexRange
+{
+	uint32_t StartIndex = 0;
+	uint32_t IndexCount = 0;
+};
+
+// Same triangles as a row-major plane, ordered chunk by chunk. outChunkIndexOffsets gets ChunkCount() + 1 entries.
+std::vector<uint32_t> BuildChunkedPlaneIndices(WaterChunkGrid const& grid, std::vector<uint32_t>& outChunkIndexOffsets);
+
+// CPU version of WaterChunkMax.hlsl
+std::vector<float> ComputeChunkMaxWater(std::span<const float> waterMap, uint32_t mapWidth, uint32_t mapHeight,
+										WaterChunkGrid const& grid);
+
+// A chunk is wet when it, or a chunk within dilation chunks of it, has water at or above threshold. The dilation hides
+// the frames of latency between the GPU reduction and its readback.
+std::vector<uint8_t> ClassifyWetChunks(std::span<const float> chunkMaxWater, WaterChunkGrid const& grid,
+									   float threshold, uint32_t dilation = 1);
+
+// Merges the wet chunks into as few index ranges as the chunk order allows
+std::vector<IndexRange> BuildWetDrawRanges(std::span<const uint8_t> wetChunks,
+										   std::span<const uint32_t> chunkIndexOffsets);
+
+} // namespace rad::proc
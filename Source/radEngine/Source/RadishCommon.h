@@ -143,4 +143,4 @@ template <typename T> struct OptionalRef
 			return hash<uint32_t>()(id.Id);                                                                            \
 		}                                                                                                              \
 	};                                                                                                                 \
-	}
\ No newline at end of file
+	}
@@ -115,23 +115,79 @@ bool CStaticRenderSystem::Init(Renderer& renderer)
 	return true;
 }
 
-void CStaticRenderSystem::Update(entt::registry& registry, RenderFrameRecord& frameRecord)
+static void SpawnModelMeshes(entt::registry& registry, entt::entity root, ObjModel& model)
 {
+	auto& rootTransform = registry.get<CSceneTransform>(root);
+	for (auto& [name, meshInfo] : model.Meshes)
+	{
+		entt::entity mesh = registry.create();
+		registry.emplace<CEntityInfo>(mesh, name);
+		auto& meshTransform = registry.emplace<CSceneTransform>(mesh, mesh);
+		meshTransform.SetParent(&rootTransform);
+		assert(meshInfo.Material);
+		registry.emplace<CStaticRenderable>(mesh, CStaticRenderable{.Vertices = meshInfo.Vertices,
+																	.Indices = meshInfo.Indices,
+																	.Material = *meshInfo.Material,
+																	.Bounds = meshInfo.Bounds,
+																	.Geometry = meshInfo.Geometry});
+		registry.emplace<CWorldBounds>(mesh);
+	}
+}
+
+void CStaticRenderSystem::Update(entt::registry& registry, ModelManager& modelManager, RenderFrameRecord& frameRecord)
+{
+	// Instances of models still loading are skipped until the model is ready
+	std::vector<entt::entity> finishedInstances;
+	for (auto [entity, instance] : registry.view<CModelInstance>().each())
+		if (modelManager.GetLoadState(instance.Model) != ModelLoadState::Loading)
+			finishedInstances.push_back(entity);
+	bool spawned = false;
+	for (auto entity : finishedInstances)
+	{
+		if (auto model = modelManager.GetModel(registry.get<CModelInstance>(entity).Model))
+		{
+			SpawnModelMeshes(registry, entity, *model);
+			spawned = true;
+		}
+		registry.remove<CModelInstance>(entity);
+	}
+	// Nav meshes baked before the model arrived voxelize its meshes with their next bake
+	if (spawned)
+		for (auto [entity, terrain] : registry.view<proc::CTerrain>().each())
+			if (auto& navMesh = terrain.NavMesh)
+			{
+				navMesh->StaticMeshesChanged = true;
+				if (navMesh->Builder)
+					navMesh->Requested = true;
+			}
+
+	for (auto [entity, renderable, transform, worldBounds] :
+		 registry.view<CStaticRenderable, CSceneTransform, CWorldBounds>().each())
+		if (worldBounds.TransformRevision != transform.GetRevision())
+		{
+			worldBounds.Bounds = TransformMeshBounds(renderable.Bounds, transform.GetWorldTransform().WorldMatrix);
+			worldBounds.TransformRevision = transform.GetRevision();
+		}
+
+	LastDepthOnlyLodStats = std::exchange(DepthOnlyLodStats, {});
+	LastDeferredLodStats = std::exchange(DeferredLodStats, {});
+
 	std::vector<StaticRenderData> renderObjects;
 
 	auto view = registry.view<CStaticRenderable, CSceneTransform>();
 	for (auto entity : view)
 	{
 		auto& transform = view.get<CSceneTransform>(entity);
-		auto locTransform = transform.LocalTransform();
-		transform.SetTransform(locTransform);
 		auto& renderable = view.get<CStaticRenderable>(entity);
 
 		StaticRenderData renderData;
 		renderData.WorldMatrix = transform.GetWorldTransform().WorldMatrix;
-		renderData.IndexCount = renderable.Indices.Size / sizeof(uint32_t);
-		renderData.VertexBufferView = renderable.Vertices.VertexBufferView();
-		renderData.IndexBufferView = renderable.Indices.IndexBufferView();
+		renderData.StartIndex = renderable.Indices.Offset;
+		renderData.BaseVertex = int32_t(renderable.Vertices.Offset);
+		renderData.IndexCount = renderable.Indices.Count;
+		renderData.Geometry = renderable.Geometry;
+		renderData.VertexBufferView = modelManager.GeometryPool.VertexBufferView(renderable.Vertices.Page);
+		renderData.IndexBufferView = modelManager.GeometryPool.IndexBufferView(renderable.Indices.Page);
 		renderData.Material = renderable.Material.MaterialInfo.GetView();
 
 		renderObjects.push_back(renderData);
@@ -143,12 +199,32 @@ void CStaticRenderSystem::Update(entt::registry& registry, RenderFrameRecord& fr
 		.DepthOnlyPass = [this](auto span, auto view, auto passData) { DepthOnlyPass(span, view, passData); },
 		.DeferredPass = [this](auto span, auto view, auto passData) { DeferredPass(span, view, passData); }});
 }
+// The index range to draw of a render object in a view, with the level of detail the view needs, counted in stats.
+// IndexCount spans every level when there are several.
+static MeshLod SelectStaticRenderLod(CStaticRenderSystem::StaticRenderData const& renderObj,
+									 LodSelectionView const& lodView, CStaticRenderSystem::LodStats& stats)
+{
+	auto const* geometry = renderObj.Geometry.get();
+	MeshLod lod = {0, renderObj.IndexCount};
+	if (geometry && geometry->Lods.empty())
+		lod.IndexCount = uint32_t(geometry->Indices.size());
+	else if (geometry)
+		lod = geometry->Lods[SelectMeshLod(geometry->Lods, renderObj.WorldMatrix, geometry->Bounds.Center,
+										   geometry->Bounds.Radius, lodView)];
+	stats.Draws++;
+	stats.SelectedIndices += lod.IndexCount;
+	stats.FullIndices += geometry ? geometry->Indices.size() : renderObj.IndexCount;
+	return lod;
+}
+
 void CStaticRenderSystem::DepthOnlyPass(std::span<StaticRenderData> renderObjects, const RenderView& view,
 										DepthOnlyPassData& passData)
 {
 	auto& cmd = passData.CmdContext;
 	cmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	ShadowMapPipelineState.Bind(cmd);
+	LodSelectionView lodView(view.ProjectionMatrix, view.ViewPosition, float(passData.OutDepth->Info.Height),
+							 LodThresholdPixels);
 
 	StaticRenderData lastRenderData{};
 	for (auto& renderObj : renderObjects)
@@ -167,7 +243,8 @@ void CStaticRenderSystem::DepthOnlyPass(std::span<StaticRenderData> renderObject
 		rad::hlsl::ShadowMapResources shadowMapResources{};
 		shadowMapResources.MVP = view.ViewProjectionMatrix * renderObj.WorldMatrix;
 		ShadowMapPipelineState.SetResources(cmd, shadowMapResources);
-		cmd->DrawIndexedInstanced(renderObj.IndexCount, 1, 0, 0, 0);
+		MeshLod lod = SelectStaticRenderLod(renderObj, lodView, DepthOnlyLodStats);
+		cmd->DrawIndexedInstanced(lod.IndexCount, 1, renderObj.StartIndex + lod.IndexOffset, renderObj.BaseVertex, 0);
 	}
 }
 void CStaticRenderSystem::DeferredPass(std::span<StaticRenderData> renderObjects, const RenderView& view,
@@ -176,6 +253,8 @@ void CStaticRenderSystem::DeferredPass(std::span<StaticRenderData> renderObjects
 	auto& cmd = passData.CmdContext;
 	cmd->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 	StaticMeshPipelineState.Bind(cmd);
+	LodSelectionView lodView(view.ProjectionMatrix, view.ViewPosition, float(passData.OutDepth->Info.Height),
+							 LodThresholdPixels);
 
 	StaticRenderData lastRenderData{};
 	for (auto& renderObj : renderObjects)
@@ -196,7 +275,8 @@ void CStaticRenderSystem::DeferredPass(std::span<StaticRenderData> renderObjects
 		staticMeshResources.Normal = glm::transpose(glm::inverse(renderObj.WorldMatrix));
 		staticMeshResources.MaterialBufferIndex = renderObj.Material.GetIndex();
 		cmd->SetGraphicsRoot32BitConstants(0, sizeof(staticMeshResources) / 4, &staticMeshResources, 0);
-		cmd->DrawIndexedInstanced(renderObj.IndexCount, 1, 0, 0, 0);
+		MeshLod lod = SelectStaticRenderLod(renderObj, lodView, DeferredLodStats);
+		cmd->DrawIndexedInstanced(lod.IndexCount, 1, renderObj.StartIndex + lod.IndexOffset, renderObj.BaseVertex, 0);
 	}
 }
 
@@ -436,7 +516,7 @@ static void UIDrawMeshTree(entt::registry& registry, entt::entity curEntity)
 
 	ImGui::PopID();
 }
-void CUISystem::Update(entt::registry& registry, Renderer& renderer)
+void CUISystem::Update(entt::registry& registry, Renderer& renderer, CStaticRenderSystem& staticRenderSystem)
 {
 	// Start the Dear ImGui frame
 	ImGui_ImplDX12_NewFrame();
@@ -515,6 +595,22 @@ void CUISystem::Update(entt::registry& registry, Renderer& renderer)
 			}
 			ImGui::PopID();
 		}
+
+		if (ImGui::CollapsingHeader("Static Meshes"))
+		{
+			ImGui::PushID("StaticMeshes");
+			ImGui::SliderFloat("LOD Threshold (px)", &staticRenderSystem.LodThresholdPixels, 0.1f, 16.0f);
+			auto lodText = [](char const* pass, CStaticRenderSystem::LodStats const& stats)
+			{
+				double share = stats.FullIndices ? 100.0 * stats.SelectedIndices / stats.FullIndices : 100.0;
+				ImGui::Text("%s: %llu draws, %llu / %llu indices (%.1f%%)", pass, (unsigned long long)stats.Draws,
+							(unsigned long long)stats.SelectedIndices, (unsigned long long)stats.FullIndices, share);
+			};
+			lodText("Depth", staticRenderSystem.LastDepthOnlyLodStats);
+			lodText("Deferred", staticRenderSystem.LastDeferredLodStats);
+			ImGui::PopID();
+		}
+
 		auto terrainView = registry.view<proc::CTerrain, proc::CErosionParameters>();
 		for (auto terrainEnt : terrainView)
 		{
@@ -527,6 +623,81 @@ void CUISystem::Update(entt::registry& registry, Renderer& renderer)
 			{
 				ImGui::PushID("Terrain");
 				ImGui::Checkbox("With Water", &erosionParams.MeshWithWater);
+				if (auto* water = registry.try_get<proc::CWaterRenderable>(terrainEnt))
+				{
+					ImGui::Checkbox("Cull Dry Water Chunks", &water->CullDryChunks);
+					if (auto& culling = water->ChunkCulling; culling && culling->HasClassification)
+						ImGui::Text("Wet Water Chunks: %u / %u", culling->WetChunkCount, culling->Grid.ChunkCount());
+				}
+				if (auto* renderable = registry.try_get<proc::CTerrainRenderable>(terrainEnt))
+				{
+					ImGui::Checkbox("Virtual Texture", &renderable->UseVirtualTexture);
+					// Created by the next TerrainErosionSystem::Update
+					if (renderable->UseVirtualTexture && renderable->VirtualTexture)
+					{
+						auto const& pageTable = renderable->VirtualTexture->PageTable;
+						auto const& stats = pageTable.GetStats();
+						ImGui::SliderFloat("Mip 0 Distance", &renderable->VirtualTexture->Mip0Distance, 8.0f, 512.0f);
+						ImGui::Text("Pages: %u resident / %u slots, %u requested, %u missing", stats.Resident,
+									pageTable.GetSettings().PhysicalPageCount, stats.Requested, stats.Missing);
+						ImGui::Text("Loaded: %u (%llu total), Evicted: %u (%llu total)", stats.Loaded,
+									(unsigned long long)stats.TotalLoaded, stats.Evicted,
+									(unsigned long long)stats.TotalEvicted);
+					}
+				}
+				if (auto& survey = terrain.WaterBodies)
+				{
+					if (ImGui::Button("Label Water Bodies"))
+						survey->Requested = true;
+					if (survey->HasLabels)
+					{
+						auto const& bodies = survey->Labels.Bodies;
+						ImGui::Text("Water Bodies: %zu (%.2f ms)", bodies.size(), survey->LabelMs);
+						ImGui::Text("Shore Distance: %.2f ms", survey->ShoreDistanceMs);
+						auto largest = std::ranges::max_element(bodies, {}, &proc::WaterBody::Area);
+						if (largest != bodies.end())
+							ImGui::Text("Largest: %u cells, volume %.1f, mean level %.2f", largest->Area,
+										largest->Volume, largest->MeanLevel);
+					}
+				}
+				if (auto& navMesh = terrain.NavMesh)
+				{
+					if (ImGui::Button("Bake NavMesh"))
+						navMesh->Requested = true;
+					if (navMesh->Builder && !navMesh->ReadbackPending)
+					{
+						auto const& builder = *navMesh->Builder;
+						auto const& stats = builder.GetLastBuildStats();
+						ImGui::Text("NavMesh: %zu polygons, %u x %u tiles", builder.GetPolygonCount(),
+									builder.GetTilesX(), builder.GetTilesY());
+						ImGui::Text("Last Build: %u tiles in %.1f ms (%.2f ms/tile, max %.2f)", stats.BuiltTiles,
+									stats.TotalMs, stats.MeanTileMs, stats.MaxTileMs);
+					}
+				}
+				if (auto& undo = terrain.Undo; undo && undo->History && undo->History->HasBaseState())
+				{
+					auto const& history = *undo->History;
+					if (ImGui::Button("Checkpoint"))
+						undo->RequestedCapture = "Checkpoint";
+					if (history.CanUndo())
+					{
+						ImGui::SameLine();
+						if (ImGui::Button("Undo"))
+							undo->UndoRequested = true;
+					}
+					if (history.CanRedo())
+					{
+						ImGui::SameLine();
+						if (ImGui::Button("Redo"))
+							undo->RedoRequested = true;
+					}
+					ImGui::Text("History: %.2f MiB", history.GetStoredBytes() / double(1 << 20));
+					auto steps = history.GetSteps();
+					// Newest first, redo steps are marked
+					for (size_t i = steps.size(); i-- > 0;)
+						ImGui::Text("%s %s: %u tiles, %.1f KiB", i < history.GetUndoCount() ? " " : ">",
+									steps[i].Label.c_str(), steps[i].ChangedTiles, steps[i].Bytes / 1024.0);
+				}
 				ImGui::Checkbox("Base from File", &erosionParams.BaseFromFile);
 				if (!erosionParams.BaseFromFile)
 				{
@@ -538,7 +709,17 @@ void CUISystem::Update(entt::registry& registry, Renderer& renderer)
 				ImGui::SliderFloat("Min Height", &erosionParams.MinHeight, 0.0f, 100.0f);
 				ImGui::SliderFloat("Max Height", &erosionParams.MaxHeight, 0.0f, 200.0f);
 				ImGui::Checkbox("Erode Each Frame", &erosionParams.ErodeEachFrame);
-				ImGui::SliderInt("Iterations", &erosionParams.Iterations, 1, 1024);
+				ImGui::Checkbox("Use Time Budget", &erosionParams.UseTimeBudget);
+				if (erosionParams.UseTimeBudget)
+					ImGui::SliderFloat("Time Budget (ms)", &erosionParams.TimeBudgetMs, 0.1f, 33.0f);
+				else
+					ImGui::SliderInt("Iterations", &erosionParams.Iterations, 1, 1024);
+				if (auto msPerIteration = terrain.ErosionBudget.GetMsPerIteration())
+				{
+					ImGui::Text("GPU Cost: %.3f ms/iteration", *msPerIteration);
+					if (erosionParams.UseTimeBudget)
+						ImGui::Text("Budgeted Iterations: %u", terrain.ErosionBudget.GetLastIterationCount());
+				}
 				ImGui::SliderFloat("Total Length", &erosionParams.TotalLength, 100.0f, 2048.0f);
 
 				ImGui::SliderFloat("Rain Rate", &erosionParams.RainRate, 0.0f, 0.1f);
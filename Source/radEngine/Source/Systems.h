@@ -4,6 +4,7 @@
 #include "RadishCommon.h"
 #include "ConstantBuffers.hlsli"
 #include "Graphics/Model.h"
+#include "Graphics/ModelManager.h"
 #include "Graphics/Renderer.h"
 #include "Graphics/PipelineState.h"
 #include "InputManager.h"
@@ -24,6 +25,7 @@ struct Transform
 	glm::vec3 Scale = glm::vec3(1.0f);
 
 	glm::mat4 GetModelMatrix(glm::mat4 parentWorldMatrix = glm::mat4(1.0f)) const;
+	bool operator==(Transform const& other) const = default;
 };
 struct WorldTransform
 {
@@ -102,16 +104,26 @@ struct CSceneTransform
 
 	void SetTransform(const ecs::Transform& transform)
 	{
+		if (transform == Transform)
+			return;
 		Transform = transform;
+		Revision++;
 		InvalidateChildTransforms();
 	}
 
 	void InvalidateParentTransform() const
 	{
 		CachedParentWorldTransform.reset();
+		Revision++;
 		InvalidateChildTransforms();
 	}
 
+	// Changes whenever the world transform may have, so whatever is derived from it can tell when to update
+	uint32_t GetRevision() const
+	{
+		return Revision;
+	}
+
 	void InvalidateChildTransforms() const
 	{
 		for (auto child : Children)
@@ -121,27 +133,65 @@ struct CSceneTransform
   private:
 	Transform Transform;
 	mutable std::optional<WorldTransform> CachedParentWorldTransform;
+	mutable uint32_t Revision = 0;
 };
 
 struct CStaticRenderable
 {
 	bool Hidden = false;
-	DXTypedBuffer<Vertex> Vertices;
-	DXTypedBuffer<uint32_t> Indices;
+	// Ranges of the ModelManager's GeometryPool
+	GeometryRange Vertices;
+	GeometryRange Indices;
 	Material Material;
+	// In the space of the vertices
+	MeshBounds Bounds;
+	std::shared_ptr<const MeshGeometry> Geometry{};
+};
+
+// World space bounds of a CStaticRenderable, updated by CStaticRenderSystem when its CSceneTransform changes
+struct CWorldBounds
+{
+	MeshBounds Bounds;
+	// Of the CSceneTransform the bounds were computed for
+	uint32_t TransformRevision = ~0u;
+};
+
+// A model that may still be loading. Once it is ready its meshes become children of the entity, each with a
+// CStaticRenderable, and the component is removed.
+struct CModelInstance
+{
+	ModelId Model;
 };
 
 struct CStaticRenderSystem
 {
 	GraphicsPipelineState<hlsl::StaticMeshResources> StaticMeshPipelineState;
 	GraphicsPipelineState<hlsl::ShadowMapResources> ShadowMapPipelineState;
+	// Largest error a level of detail may show on screen, in pixels
+	float LodThresholdPixels = 1.0f;
+	// What a pass drew over a frame, at the selected levels of detail and at full resolution
+	struct LodStats
+	{
+		uint64_t Draws = 0;
+		uint64_t SelectedIndices = 0;
+		uint64_t FullIndices = 0;
+	};
+	// Added up while the passes record, moved to the Last ones by Update for the UI
+	LodStats DepthOnlyLodStats;
+	LodStats DeferredLodStats;
+	LodStats LastDepthOnlyLodStats;
+	LodStats LastDeferredLodStats;
 	bool Init(Renderer& renderer);
-	void Update(entt::registry& registry, RenderFrameRecord& frameRecord);
+	void Update(entt::registry& registry, ModelManager& modelManager, RenderFrameRecord& frameRecord);
 
 	struct StaticRenderData
 	{
 		glm::mat4 WorldMatrix;
+		uint32_t StartIndex;
+		int32_t BaseVertex;
 		uint32_t IndexCount;
+		// Levels of detail and bounds to pick one per view with, null to draw IndexCount indices
+		std::shared_ptr<const MeshGeometry> Geometry;
 		D3D12_VERTEX_BUFFER_VIEW VertexBufferView;
 		D3D12_INDEX_BUFFER_VIEW IndexBufferView;
 		DescriptorAllocationView Material;
@@ -211,6 +261,6 @@ struct CUISystem
 	void Init(Renderer& renderer, SDL_Window* window);
 	void Destroy();
 	void ProcessEvent(const SDL_Event& event);
-	void Update(entt::registry& registry, Renderer& renderer);
+	void Update(entt::registry& registry, Renderer& renderer, CStaticRenderSystem& staticRenderSystem);
 };
 } // namespace rad::ecs
\ No newline at end of file
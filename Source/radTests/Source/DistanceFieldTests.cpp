@@ -0,0 +1,111 @@
+#include "Test.h"
+
+#include "ProcGen/DistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
+using namespace rad::proc;
+
+namespace
+{
+
+std::vector<uint8_t> CreateRandomMask(uint32_t width, uint32_t height, uint32_t oneIn, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::vector<uint8_t> mask(size_t(width) * height);
+	for (auto& cell : mask)
+		cell = generator() % oneIn == 0;
+	return mask;
+}
+
+// Squared distance from every cell to every set cell
+std::vector<double> BruteForceSquaredDistance(std::span<const uint8_t> mask, uint32_t width, uint32_t height)
+{
+	std::vector<double> distances(mask.size(), std::numeric_limits<double>::infinity());
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			for (uint32_t sy = 0; sy < height; sy++)
+				for (uint32_t sx = 0; sx < width; sx++)
+					if (mask[sx + sy * width])
+					{
+						double dx = double(x) - sx, dy = double(y) - sy;
+						distances[x + y * width] = std::min(distances[x + y * width], dx * dx + dy * dy);
+					}
+	return distances;
+}
+
+} // namespace
+
+RAD_TEST(DistanceField, MatchesBruteForce)
+{
+	uint32_t sizes[][2] = {{1, 1}, {1, 9}, {9, 1}, {13, 7}, {40, 33}, {70, 65}};
+	uint32_t densities[] = {2, 9, 60, 1000};
+	for (auto [width, height] : sizes)
+		for (uint32_t density : densities)
+		{
+			auto mask = CreateRandomMask(width, height, density, width * 31 + density);
+			auto expected = BruteForceSquaredDistance(mask, width, height);
+			auto distances = ComputeSquaredDistance(mask, width, height, 3);
+			RAD_CHECK(distances == expected);
+		}
+}
+
+RAD_TEST(DistanceField, ExactPastFloatPrecision)
+{
+	// Squared distances past 2^24 that floats would round, one set cell at each end of long rows
+	uint32_t width = 9000, height = 3;
+	std::vector<uint8_t> mask(size_t(width) * height, 0);
+	mask[0] = 1;
+	mask[width - 1 + 2 * width] = 1;
+	auto distances = ComputeSquaredDistance(mask, width, height);
+	auto squared = [](double dx, double dy) { return dx * dx + dy * dy; };
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+		{
+			double expected = std::min(squared(x, y), squared(double(width - 1) - x, 2.0 - y));
+			RAD_CHECK_EQ(distances[x + y * width], expected);
+		}
+}
+
+RAD_TEST(DistanceField, SignedDistanceCrossesZeroAtEdge)
+{
+	uint32_t width = 50, height = 41;
+	auto mask = CreateRandomMask(width, height, 3, 17);
+	float cellLength = 2.0f;
+	auto signedDistances = ComputeSignedDistance(mask, width, height, cellLength);
+	std::vector<uint8_t> inverted(mask.size());
+	for (size_t i = 0; i < mask.size(); i++)
+		inverted[i] = !mask[i];
+	auto outside = BruteForceSquaredDistance(mask, width, height);
+	auto inside = BruteForceSquaredDistance(inverted, width, height);
+
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+		{
+			size_t cell = x + y * width;
+			float distance = signedDistances[cell];
+			double expected = (std::sqrt(mask[cell] ? inside[cell] : outside[cell]) - 0.5) * cellLength;
+			RAD_CHECK_NEAR(distance, mask[cell] ? -expected : expected, 1e-5);
+			RAD_CHECK(mask[cell] ? distance < 0.0f : distance > 0.0f);
+
+			// Neighbours across the edge sit half a cell either side of it
+			bool onEdge = (x > 0 && mask[cell - 1] != mask[cell]) || (x + 1 < width && mask[cell + 1] != mask[cell]) ||
+						  (y > 0 && mask[cell - width] != mask[cell]) ||
+						  (y + 1 < height && mask[cell + width] != mask[cell]);
+			if (onEdge)
+				RAD_CHECK_EQ(std::abs(distance), 0.5f * cellLength);
+		}
+}
+
+RAD_TEST(DistanceField, EmptyAndFullMasks)
+{
+	float infinity = std::numeric_limits<float>::infinity();
+	auto empty = ComputeSignedDistance(std::vector<uint8_t>(12 * 8, 0), 12, 8);
+	RAD_CHECK(std::ranges::all_of(empty, [&](float distance) { return distance == infinity; }));
+	auto full = ComputeSignedDistance(std::vector<uint8_t>(12 * 8, 1), 12, 8);
+	RAD_CHECK(std::ranges::all_of(full, [&](float distance) { return distance == -infinity; }));
+	RAD_CHECK(ComputeSquaredDistance({}, 0, 0).empty());
+}
@@ -0,0 +1,120 @@
+#include "Test.h"
+
+#include "ProcGen/ErosionBudget.h"
+
+#include <limits>
+
+using namespace rad::proc;
+
+RAD_TEST(ErosionBudget, StartsAtMinimumWithoutSamples)
+{
+	ErosionBudgetController budget;
+	budget.MinIterations = 3;
+	RAD_CHECK(!budget.GetMsPerIteration());
+	RAD_CHECK_EQ(budget.NextIterationCount(100.0f), 3u);
+	RAD_CHECK_EQ(budget.GetLastIterationCount(), 3u);
+}
+
+RAD_TEST(ErosionBudget, GrowsTowardsBudgetAtMaxGrowth)
+{
+	ErosionBudgetController budget;
+	budget.AddSample(1, 0.5);
+	RAD_CHECK_NEAR(*budget.GetMsPerIteration(), 0.5, 1e-12);
+
+	// 0.5 ms per iteration fits 8 in 4 ms, reached by doubling the count of each sample
+	uint32_t expected[] = {2, 4, 8, 8, 8};
+	for (uint32_t count : expected)
+	{
+		RAD_CHECK_EQ(budget.NextIterationCount(4.0f), count);
+		budget.AddSample(count, count * 0.5);
+	}
+}
+
+RAD_TEST(ErosionBudget, GrowthWaitsForSamples)
+{
+	ErosionBudgetController budget;
+	budget.Smoothing = 1.0f;
+	budget.AddSample(1, 0.1);
+
+	// Samples three frames late: the count doubles once per round trip rather than every frame
+	uint32_t counts[12];
+	for (uint32_t frame = 0; frame < 12; frame++)
+	{
+		counts[frame] = budget.NextIterationCount(4.0f);
+		if (frame >= 3)
+			budget.AddSample(counts[frame - 3], counts[frame - 3] * 0.1);
+	}
+	uint32_t expected[] = {2, 2, 2, 2, 4, 4, 4, 4, 8, 8, 8, 8};
+	for (uint32_t frame = 0; frame < 12; frame++)
+		RAD_CHECK_EQ(counts[frame], expected[frame]);
+}
+
+RAD_TEST(ErosionBudget, ShrinksImmediately)
+{
+	ErosionBudgetController budget;
+	budget.Smoothing = 1.0f;
+	budget.AddSample(20, 2.0);
+	RAD_CHECK_EQ(budget.NextIterationCount(4.0f), 40u);
+
+	// A slower GPU is followed by the very next count, growth is limited but shrinking isn't
+	budget.AddSample(40, 40.0);
+	RAD_CHECK_EQ(budget.NextIterationCount(4.0f), 4u);
+}
+
+RAD_TEST(ErosionBudget, UntimedRunsLeaveTheCountAlone)
+{
+	ErosionBudgetController budget;
+	budget.AddSample(4, 2.0);
+	RAD_CHECK_EQ(budget.NextIterationCount(4.0f), 8u);
+	RAD_CHECK_EQ(budget.GetIterationCount(1.0f), 2u);
+	RAD_CHECK_EQ(budget.GetLastIterationCount(), 8u);
+	RAD_CHECK_EQ(budget.NextIterationCount(4.0f), 8u);
+}
+
+RAD_TEST(ErosionBudget, SmoothsSamples)
+{
+	ErosionBudgetController budget;
+	budget.Smoothing = 0.25f;
+	budget.AddSample(1, 1.0);
+	budget.AddSample(1, 3.0);
+	RAD_CHECK_NEAR(*budget.GetMsPerIteration(), 1.5, 1e-12);
+	budget.AddSample(2, 2.0);
+	RAD_CHECK_NEAR(*budget.GetMsPerIteration(), 1.375, 1e-12);
+}
+
+RAD_TEST(ErosionBudget, IgnoresInvalidSamples)
+{
+	ErosionBudgetController budget;
+	budget.AddSample(0, 1.0);
+	budget.AddSample(4, -1.0);
+	budget.AddSample(4, std::numeric_limits<double>::quiet_NaN());
+	RAD_CHECK(!budget.GetMsPerIteration());
+}
+
+RAD_TEST(ErosionBudget, ClampsToLimits)
+{
+	ErosionBudgetController budget;
+	budget.MinIterations = 2;
+	budget.MaxIterations = 16;
+	budget.MaxGrowthFactor = 1000.0f;
+	budget.AddSample(1, 0.001);
+	RAD_CHECK_EQ(budget.NextIterationCount(100.0f), 16u);
+
+	// Even when not a single iteration fits
+	budget.AddSample(1, 1000.0);
+	budget.Smoothing = 1.0f;
+	budget.AddSample(1, 1000.0);
+	RAD_CHECK_EQ(budget.NextIterationCount(1.0f), 2u);
+	RAD_CHECK_EQ(budget.NextIterationCount(-1.0f), 2u);
+}
+
+RAD_TEST(ErosionBudget, ResetForgetsCost)
+{
+	ErosionBudgetController budget;
+	budget.AddSample(1, 0.5);
+	budget.NextIterationCount(4.0f);
+	budget.Reset();
+	RAD_CHECK(!budget.GetMsPerIteration());
+	RAD_CHECK_EQ(budget.GetLastIterationCount(), 0u);
+	RAD_CHECK_EQ(budget.NextIterationCount(4.0f), 1u);
+}
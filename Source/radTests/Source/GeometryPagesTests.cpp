@@ -0,0 +1,159 @@
+#include "Test.h"
+
+#include "Graphics/GeometryPages.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <random>
+#include <vector>
+
+using namespace rad;
+
+namespace
+{
+
+using RetireCallbacks = std::vector<std::move_only_function<void()>>;
+
+// What the renderer does once a command context's fence has passed
+void Retire(RetireCallbacks& callbacks)
+{
+	for (auto& callback : callbacks)
+		callback();
+	callbacks.clear();
+}
+
+} // namespace
+
+RAD_TEST(GeometryPages, FillsPagesInOrder)
+{
+	GeometryPages pages(100);
+	auto a = pages.Allocate(60);
+	RAD_CHECK_EQ(a.NewPageSize, 100u);
+	RAD_CHECK(a.Range.Page == 0 && a.Range.Offset == 0 && a.Range.Count == 60);
+	auto b = pages.Allocate(30);
+	RAD_CHECK_EQ(b.NewPageSize, 0u);
+	RAD_CHECK(b.Range.Page == 0 && b.Range.Offset == 60);
+
+	// Too large for what the first page has left
+	auto c = pages.Allocate(20);
+	RAD_CHECK_EQ(c.NewPageSize, 100u);
+	RAD_CHECK(c.Range.Page == 1 && c.Range.Offset == 0);
+	// Larger than a page
+	auto d = pages.Allocate(250);
+	RAD_CHECK_EQ(d.NewPageSize, 250u);
+	RAD_CHECK(d.Range.Page == 2 && d.Range.Offset == 0);
+	RAD_CHECK_EQ(pages.GetPage(2).GetFreeSize(), 0u);
+	// The first page with room still comes first
+	auto e = pages.Allocate(10);
+	RAD_CHECK(e.NewPageSize == 0 && e.Range.Page == 0 && e.Range.Offset == 90);
+	RAD_CHECK_EQ(pages.GetPageCount(), 3u);
+
+	auto empty = pages.Allocate(0);
+	RAD_CHECK(empty.NewPageSize == 0 && empty.Range.Count == 0);
+	RetireCallbacks callbacks;
+	pages.Free(empty.Range, callbacks);
+	RAD_CHECK(callbacks.empty());
+}
+
+RAD_TEST(GeometryPages, FreedRangesWaitForTheirRetire)
+{
+	GeometryPages pages(100);
+	auto whole = pages.Allocate(100);
+	RetireCallbacks inFlight;
+	pages.Free(whole.Range, inFlight);
+	RAD_CHECK_EQ(inFlight.size(), 1u);
+	RAD_CHECK_EQ(pages.GetPage(0).GetFreeSize(), 0u);
+
+	// Draws recorded before the free may still read the range, so it isn't handed out again yet
+	auto next = pages.Allocate(40);
+	RAD_CHECK(next.NewPageSize == 100 && next.Range.Page == 1);
+
+	Retire(inFlight);
+	RAD_CHECK_EQ(pages.GetPage(0).GetFreeSize(), 100u);
+	auto reused = pages.Allocate(100);
+	RAD_CHECK(reused.NewPageSize == 0 && reused.Range.Page == 0 && reused.Range.Offset == 0);
+	RAD_CHECK_EQ(pages.GetPageCount(), 2u);
+}
+
+RAD_TEST(GeometryPages, ChurnNeverReusesRangesInFlight)
+{
+	// Models of 20 to 200 ranges of 16 to 1k elements load and unload with three frames in flight, a range freed in a
+	// frame comes back when that frame retires
+	constexpr uint32_t PageSize = 1 << 16;
+	constexpr size_t FramesInFlight = 3;
+	GeometryPages pages(PageSize);
+	// Per page, whether each element is live or waiting for its retire
+	std::vector<std::vector<uint8_t>> taken;
+	std::vector<std::vector<GeometryRange>> models;
+	std::deque<std::pair<RetireCallbacks, std::vector<GeometryRange>>> frames;
+	std::mt19937 generator(12);
+	std::uniform_real_distribution<double> logSize(std::log(16.0), std::log(1024.0));
+	uint64_t live = 0;
+	uint32_t overlaps = 0;
+	uint64_t allocations = 0;
+
+	auto retireOldest = [&]()
+	{
+		auto& [callbacks, ranges] = frames.front();
+		Retire(callbacks);
+		for (GeometryRange range : ranges)
+			std::fill_n(taken[range.Page].begin() + range.Offset, range.Count, 0);
+		frames.pop_front();
+	};
+	for (uint32_t frame = 0; frame < 3000; frame++)
+	{
+		auto& [callbacks, freed] = frames.emplace_back();
+		if (models.empty() || live < 2 * PageSize)
+		{
+			auto& model = models.emplace_back();
+			uint32_t rangeCount = 20 + generator() % 181;
+			for (uint32_t i = 0; i < rangeCount; i++)
+			{
+				auto [range, newPageSize] = pages.Allocate(uint32_t(std::exp(logSize(generator))));
+				allocations++;
+				if (newPageSize)
+					taken.emplace_back(newPageSize, 0);
+				auto first = taken[range.Page].begin() + range.Offset;
+				overlaps += std::any_of(first, first + range.Count, [](uint8_t value) { return value != 0; });
+				std::fill_n(first, range.Count, 1);
+				live += range.Count;
+				model.push_back(range);
+			}
+		}
+		else
+		{
+			size_t unloaded = generator() % models.size();
+			for (GeometryRange range : models[unloaded])
+			{
+				pages.Free(range, callbacks);
+				freed.push_back(range);
+				live -= range.Count;
+			}
+			std::swap(models[unloaded], models.back());
+			models.pop_back();
+		}
+		if (frames.size() > FramesInFlight)
+			retireOldest();
+	}
+	RAD_CHECK(allocations > 100000u);
+	RAD_CHECK_EQ(overlaps, 0u);
+	// About two pages live and a few frames of frees waiting, reuse keeps the pool from growing
+	RAD_CHECK(pages.GetPageCount() <= 5u);
+
+	// Unloading everything gives every page back whole once the frames retire
+	auto& [callbacks, freed] = frames.back();
+	for (auto& model : models)
+		for (GeometryRange range : model)
+		{
+			pages.Free(range, callbacks);
+			freed.push_back(range);
+		}
+	while (!frames.empty())
+		retireOldest();
+	for (uint32_t page = 0; page < pages.GetPageCount(); page++)
+	{
+		RAD_CHECK_EQ(pages.GetPage(page).GetFreeSize(), pages.GetPage(page).GetCapacity());
+		RAD_CHECK_EQ(pages.GetPage(page).GetFreeRangeCount(), 1u);
+	}
+}
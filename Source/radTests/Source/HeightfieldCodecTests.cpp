@@ -0,0 +1,207 @@
+#include "Test.h"
+
+#include "ProcGen/HeightfieldCodec.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace rad::proc;
+
+namespace
+{
+
+// Rolling hills with noise on top, cut flat at zero
+std::vector<float> CreateTerrain(uint32_t width, uint32_t height, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+	std::vector<float> values(size_t(width) * height);
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+		{
+			float hills = 40.0f * std::sin(x * 0.05f) * std::cos(y * 0.07f) + 10.0f * std::sin((x + y) * 0.21f);
+			values[x + size_t(y) * width] = std::max(hills + noise(generator), 0.0f);
+		}
+	return values;
+}
+
+bool BitEqual(std::span<const float> a, std::span<const float> b)
+{
+	return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size_bytes()) == 0;
+}
+
+std::vector<float> DecodeAll(std::span<const uint8_t> bytes, uint32_t threadCount = 0)
+{
+	auto decoder = HeightfieldDecoder::Open(bytes);
+	RAD_CHECK(decoder.has_value());
+	if (!decoder)
+		return {};
+	std::vector<float> values(size_t(decoder->GetWidth()) * decoder->GetHeight());
+	RAD_CHECK(decoder->DecodeAll(values, threadCount));
+	return values;
+}
+
+} // namespace
+
+RAD_TEST(HeightfieldCodec, LosslessIsBitExact)
+{
+	uint32_t width = 300, height = 170;
+	auto values = CreateTerrain(width, height, 1);
+	// Bit patterns a map can hold that aren't ordinary heights, the ordered integer mapping has to keep them all
+	float specials[] = {std::numeric_limits<float>::quiet_NaN(),
+						-std::numeric_limits<float>::quiet_NaN(),
+						std::bit_cast<float>(0x7FC12345u),
+						0.0f,
+						-0.0f,
+						-1.5f,
+						-1e30f,
+						std::numeric_limits<float>::infinity(),
+						-std::numeric_limits<float>::infinity(),
+						std::numeric_limits<float>::denorm_min(),
+						-std::numeric_limits<float>::max()};
+	std::mt19937 generator(2);
+	for (float special : specials)
+		for (int copy = 0; copy < 20; copy++)
+			values[generator() % values.size()] = special;
+	// A negative patch, runs of equal values cross the sign
+	for (uint32_t y = 100; y < 140; y++)
+		for (uint32_t x = 10; x < 90; x++)
+			values[x + y * width] = x < 50 ? -3.25f : 0.0f;
+
+	for (uint32_t tileSize : {256u, 64u, 1u})
+	{
+		auto encoded = EncodeHeightfield(values, width, height, {.TileSize = tileSize, .ThreadCount = 3});
+		RAD_CHECK(BitEqual(DecodeAll(encoded.Bytes), values));
+	}
+	auto encoded = EncodeHeightfield(values, width, height);
+	RAD_CHECK(encoded.Bytes.size() < values.size() * sizeof(float));
+
+	// A constant map codes a run per row, under a quarter bit per cell
+	std::vector<float> flat(size_t(width) * height, 12.0f);
+	auto flatEncoded = EncodeHeightfield(flat, width, height, {.TileSize = 64});
+	RAD_CHECK(flatEncoded.Bytes.size() * 8 < flat.size() / 4);
+	RAD_CHECK(BitEqual(DecodeAll(flatEncoded.Bytes), flat));
+}
+
+RAD_TEST(HeightfieldCodec, LossyStaysWithinMaxError)
+{
+	uint32_t width = 257, height = 129;
+	auto values = CreateTerrain(width, height, 3);
+	values[5] = -1000.0f;
+	values[6] = 5000.0f;
+	size_t previousBytes = std::numeric_limits<size_t>::max();
+	for (float maxError : {1e-3f, 1e-2f, 0.1f, 1.0f})
+	{
+		auto encoded = EncodeHeightfield(values, width, height, {.MaxError = maxError, .TileSize = 64});
+		auto decoder = HeightfieldDecoder::Open(encoded.Bytes);
+		RAD_CHECK(decoder && decoder->GetMaxError() == maxError);
+		auto decoded = DecodeAll(encoded.Bytes);
+		RAD_CHECK_EQ(decoded.size(), values.size());
+		float largest = 0.0f;
+		for (size_t i = 0; i < std::min(decoded.size(), values.size()); i++)
+			largest = std::max(largest, std::abs(decoded[i] - values[i]));
+		RAD_CHECK(largest <= maxError);
+		// Wider buckets, fewer bits
+		RAD_CHECK(encoded.Bytes.size() < previousBytes);
+		previousBytes = encoded.Bytes.size();
+	}
+
+	// A bound below float precision of the values falls back to lossless
+	auto encoded = EncodeHeightfield(values, width, height, {.MaxError = 1e-9f});
+	RAD_CHECK_EQ(HeightfieldDecoder::Open(encoded.Bytes)->GetMaxError(), 0.0f);
+	RAD_CHECK(BitEqual(DecodeAll(encoded.Bytes), values));
+}
+
+RAD_TEST(HeightfieldCodec, TilesDecodeOnTheirOwn)
+{
+	// 5 x 3 tiles of 48, the last column 16 wide and the last row 10 high
+	uint32_t width = 208, height = 106, tileSize = 48;
+	auto values = CreateTerrain(width, height, 4);
+	for (float maxError : {0.0f, 0.05f})
+	{
+		auto encoded = EncodeHeightfield(values, width, height, {.MaxError = maxError, .TileSize = tileSize});
+		auto decoder = HeightfieldDecoder::Open(encoded.Bytes);
+		RAD_CHECK(decoder.has_value());
+		if (!decoder)
+			continue;
+		RAD_CHECK_EQ(decoder->GetWidth(), width);
+		RAD_CHECK_EQ(decoder->GetHeight(), height);
+		RAD_CHECK_EQ(decoder->GetTilesX(), 5u);
+		RAD_CHECK_EQ(decoder->GetTilesY(), 3u);
+		auto all = DecodeAll(encoded.Bytes, 4);
+
+		// Every tile into a map of its own with a wider pitch, in reverse order, each matching its part of DecodeAll
+		// and leaving the padding alone
+		for (uint32_t tileY = decoder->GetTilesY(); tileY-- > 0;)
+			for (uint32_t tileX = decoder->GetTilesX(); tileX-- > 0;)
+			{
+				uint32_t tileWidth = std::min(tileSize, width - tileX * tileSize);
+				uint32_t tileHeight = std::min(tileSize, height - tileY * tileSize);
+				size_t pitch = tileSize + 3;
+				std::vector<float> tile(pitch * tileSize, -7.0f);
+				RAD_CHECK(decoder->DecodeTile(tileX, tileY, tile.data(), pitch));
+				bool matches = true, padded = true;
+				for (uint32_t y = 0; y < tileSize; y++)
+					for (uint32_t x = 0; x < pitch; x++)
+					{
+						float value = tile[x + y * pitch];
+						if (x < tileWidth && y < tileHeight)
+							matches &= std::bit_cast<uint32_t>(value) ==
+									   std::bit_cast<uint32_t>(
+										   all[tileX * tileSize + x + size_t(tileY * tileSize + y) * width]);
+						else
+							padded &= value == -7.0f;
+					}
+				RAD_CHECK(matches && padded);
+			}
+	}
+}
+
+RAD_TEST(HeightfieldCodec, RejectsTruncatedAndCorruptBytes)
+{
+	uint32_t width = 128, height = 96;
+	auto values = CreateTerrain(width, height, 5);
+	auto encoded = EncodeHeightfield(values, width, height, {.TileSize = 32});
+	auto const& bytes = encoded.Bytes;
+	RAD_CHECK(HeightfieldDecoder::Open(bytes).has_value());
+
+	// Cut anywhere, the header or the tile table no longer adds up
+	for (size_t size : {size_t(0), size_t(4), size_t(31), size_t(32), size_t(100), bytes.size() / 2, bytes.size() - 1})
+		RAD_CHECK(!HeightfieldDecoder::Open(std::span(bytes).first(size)));
+
+	auto corrupt = [&](size_t offset, auto value)
+	{
+		std::vector<uint8_t> copy = bytes;
+		std::memcpy(copy.data() + offset, &value, sizeof(value));
+		return copy;
+	};
+	RAD_CHECK(!HeightfieldDecoder::Open(corrupt(0, uint32_t(0x12345678))));
+	RAD_CHECK(!HeightfieldDecoder::Open(corrupt(12, uint32_t(0))));
+	// Tile size and count disagree with the dimensions
+	RAD_CHECK(!HeightfieldDecoder::Open(corrupt(12, uint32_t(64))));
+	RAD_CHECK(!HeightfieldDecoder::Open(corrupt(28, uint32_t(13))));
+
+	// The tile table starts after the 32 byte header, one offset per tile and the end
+	size_t table = 32, tileCount = 4 * 3;
+	uint64_t secondTile;
+	std::memcpy(&secondTile, bytes.data() + table + sizeof(uint64_t), sizeof(secondTile));
+	// Offsets going backwards or past the data
+	RAD_CHECK(!HeightfieldDecoder::Open(corrupt(table + sizeof(uint64_t), uint64_t(secondTile + 100000))));
+	RAD_CHECK(!HeightfieldDecoder::Open(corrupt(table + tileCount * sizeof(uint64_t), uint64_t(1) << 40)));
+
+	std::vector<float> tile(32 * 32);
+	// The first tile's stream cut to a few bytes runs out before its last cell
+	auto shortened = corrupt(table + sizeof(uint64_t), uint64_t(6));
+	auto decoder = HeightfieldDecoder::Open(shortened);
+	RAD_CHECK(decoder && !decoder->DecodeTile(0, 0, tile.data(), 32));
+	// An unknown predictor in the first byte of a tile's stream
+	size_t data = table + (tileCount + 1) * sizeof(uint64_t);
+	auto unknownPredictor = corrupt(data + secondTile, uint8_t(7));
+	decoder = HeightfieldDecoder::Open(unknownPredictor);
+	RAD_CHECK(decoder && decoder->DecodeTile(0, 0, tile.data(), 32) && !decoder->DecodeTile(1, 0, tile.data(), 32));
+	std::vector<float> all(values.size());
+	RAD_CHECK(!decoder->DecodeAll(all));
+}
@@ -0,0 +1,147 @@
+#include "Test.h"
+
+#include "Graphics/MeshBounds.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace rad;
+
+namespace
+{
+
+struct Mesh
+{
+	std::vector<glm::vec3> Positions;
+	std::vector<uint32_t> Indices;
+};
+
+// Indices of random vertices of a cloud, some left out. The first vertex is an outlier no index uses.
+Mesh CreateCloud(std::mt19937& generator, uint32_t vertexCount, bool sphere)
+{
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	Mesh mesh;
+	mesh.Positions.push_back({1e4f, -1e4f, 1e4f});
+	while (mesh.Positions.size() < vertexCount)
+	{
+		glm::vec3 position = {unit(generator), unit(generator), unit(generator)};
+		if (sphere && glm::length(position) > 1.0f)
+			continue;
+		mesh.Positions.push_back(position * glm::vec3{3.0f, 1.0f, 0.5f} + glm::vec3{10.0f, -2.0f, 7.0f});
+	}
+	for (uint32_t i = 0; i < vertexCount * 2; i++)
+		mesh.Indices.push_back(1 + generator() % (vertexCount - 1));
+	return mesh;
+}
+
+// Rings of a sphere of radius 2 around (1, 2, 3), every triangle of the surface
+Mesh CreateUVSphere(uint32_t rings, uint32_t segments)
+{
+	Mesh mesh;
+	for (uint32_t ring = 0; ring <= rings; ring++)
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			float theta = 3.14159265f * ring / rings, phi = 2.0f * 3.14159265f * segment / segments;
+			glm::vec3 direction = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+			mesh.Positions.push_back(glm::vec3{1.0f, 2.0f, 3.0f} + 2.0f * direction);
+		}
+	for (uint32_t ring = 0; ring < rings; ring++)
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			uint32_t a = ring * segments + segment, b = ring * segments + (segment + 1) % segments;
+			mesh.Indices.insert(mesh.Indices.end(), {a, b, a + segments, b, b + segments, a + segments});
+		}
+	return mesh;
+}
+
+void CheckHoldsEveryVertex(MeshBounds const& bounds, Mesh const& mesh)
+{
+	for (uint32_t index : mesh.Indices)
+	{
+		glm::vec3 position = mesh.Positions[index];
+		for (int axis = 0; axis < 3; axis++)
+			RAD_CHECK(position[axis] >= bounds.Min[axis] && position[axis] <= bounds.Max[axis]);
+		RAD_CHECK(glm::length(position - bounds.Center) <= bounds.Radius * (1.0f + 1e-6f));
+	}
+}
+
+} // namespace
+
+RAD_TEST(MeshBounds, MatchesBruteForce)
+{
+	std::mt19937 generator(5);
+	std::vector<Mesh> meshes = {CreateUVSphere(24, 48), CreateUVSphere(3, 5), CreateCloud(generator, 9, false),
+								CreateCloud(generator, 2000, false), CreateCloud(generator, 2000, true)};
+	for (Mesh const& mesh : meshes)
+	{
+		MeshBounds bounds = ComputeMeshBounds(mesh.Positions, mesh.Indices);
+
+		// The box is exact, the sphere holds every vertex and is no larger than the one around the box's center
+		glm::vec3 minimum = mesh.Positions[mesh.Indices[0]], maximum = minimum;
+		for (uint32_t index : mesh.Indices)
+		{
+			minimum = glm::min(minimum, mesh.Positions[index]);
+			maximum = glm::max(maximum, mesh.Positions[index]);
+		}
+		RAD_CHECK(bounds.Min == minimum && bounds.Max == maximum);
+		CheckHoldsEveryVertex(bounds, mesh);
+		float boxRadius = 0.0f;
+		for (uint32_t index : mesh.Indices)
+			boxRadius = std::max(boxRadius, glm::length(mesh.Positions[index] - (minimum + maximum) * 0.5f));
+		RAD_CHECK(bounds.Radius <= boxRadius);
+	}
+
+	// Vertices of a sphere are as tight as it gets
+	MeshBounds sphere = ComputeMeshBounds(meshes[0].Positions, meshes[0].Indices);
+	RAD_CHECK_NEAR(sphere.Radius, 2.0f, 1e-4);
+	RAD_CHECK(glm::length(sphere.Center - glm::vec3{1.0f, 2.0f, 3.0f}) < 1e-4f);
+
+	// A single vertex, and nothing
+	std::vector<uint32_t> single = {4, 4, 4};
+	MeshBounds point = ComputeMeshBounds(meshes[0].Positions, single);
+	RAD_CHECK(point.Min == meshes[0].Positions[4] && point.Max == point.Min && point.Radius == 0.0f);
+	RAD_CHECK(ComputeMeshBounds(meshes[0].Positions, {}).IsEmpty());
+}
+
+RAD_TEST(MeshBounds, MergedAndTransformedHoldEveryVertex)
+{
+	std::mt19937 generator(9);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (int trial = 0; trial < 200; trial++)
+	{
+		Mesh a = CreateCloud(generator, 20 + generator() % 200, trial % 2);
+		Mesh b = CreateCloud(generator, 20 + generator() % 200, trial % 3);
+		for (glm::vec3& position : b.Positions)
+			position += glm::vec3{unit(generator), unit(generator), unit(generator)} * float(trial % 20);
+		MeshBounds boundsA = ComputeMeshBounds(a.Positions, a.Indices);
+		MeshBounds boundsB = ComputeMeshBounds(b.Positions, b.Indices);
+		MeshBounds merged = MergeMeshBounds(boundsA, boundsB);
+		CheckHoldsEveryVertex(merged, a);
+		CheckHoldsEveryVertex(merged, b);
+		RAD_CHECK(MergeMeshBounds(boundsA, {}).Radius == boundsA.Radius);
+		RAD_CHECK(MergeMeshBounds({}, boundsB).Radius == boundsB.Radius);
+
+		// Rotated, scaled unevenly or mirrored, and moved
+		glm::vec3 axis = glm::normalize(glm::vec3{unit(generator), unit(generator), 1.0f});
+		glm::vec3 scale = {0.5f + unit(generator) * 0.4f, trial % 4 ? 2.0f : -1.0f, 1.0f};
+		glm::mat4 world = glm::translate(glm::mat4(1.0f), glm::vec3{unit(generator), 5.0f, unit(generator)} * 10.0f);
+		world = glm::scale(glm::rotate(world, unit(generator) * 3.0f, axis), scale);
+		MeshBounds transformed = TransformMeshBounds(boundsA, world);
+		for (uint32_t index : a.Indices)
+		{
+			glm::vec3 position = glm::vec3(world * glm::vec4(a.Positions[index], 1.0f));
+			float tolerance = 1e-4f * (1.0f + glm::length(position));
+			for (int component = 0; component < 3; component++)
+			{
+				RAD_CHECK(position[component] >= transformed.Min[component] - tolerance);
+				RAD_CHECK(position[component] <= transformed.Max[component] + tolerance);
+			}
+			RAD_CHECK(glm::length(position - transformed.Center) <= transformed.Radius + tolerance);
+		}
+	}
+	RAD_CHECK(TransformMeshBounds({}, glm::mat4(1.0f)).IsEmpty());
+}
@@ -0,0 +1,213 @@
+#include "Test.h"
+
+#include "Graphics/MeshCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+using namespace rad;
+
+namespace
+{
+
+// A scratch directory of its own, removed again with everything in it
+struct TemporaryDirectory
+{
+	std::filesystem::path Path;
+
+	explicit TemporaryDirectory(char const* name) : Path(std::filesystem::temp_directory_path() / name)
+	{
+		std::filesystem::remove_all(Path);
+		std::filesystem::create_directories(Path);
+	}
+	~TemporaryDirectory()
+	{
+		std::error_code error;
+		std::filesystem::remove_all(Path, error);
+	}
+};
+
+void WriteText(std::filesystem::path const& path, std::string_view text)
+{
+	std::ofstream(path, std::ios::binary) << text;
+}
+
+// The storage a model load keeps around for its view: two shapes, the second without a material or levels of detail
+struct TestModel
+{
+	std::vector<Vertex> Vertices;
+	std::vector<uint32_t> Indices[2];
+	std::vector<MeshLod> Lods[2];
+	std::vector<Meshlet> Meshlets;
+	std::vector<uint32_t> MeshletVertices;
+	std::vector<uint8_t> MeshletTriangles;
+	std::string Names[4] = {"floor", "pillar_01", "stone", "textures/stone_ddn.png"};
+
+	TestModel()
+	{
+		for (uint32_t i = 0; i < 7; i++)
+			Vertices.push_back({.Position = {float(i), -float(i), 0.5f},
+								.Normal = {0.0f, 1.0f, 0.0f},
+								.TexCoord = {0.25f * i, 1.0f},
+								.Tangent = {1.0f, 0.0f, float(i)}});
+		Indices[0] = {0, 1, 2, 2, 1, 3, 0, 1, 3};
+		Lods[0] = {{0, 6, 0.0f}, {6, 3, 0.125f}};
+		Indices[1] = {4, 5, 6};
+		Lods[1] = {{0, 3, 0.0f}};
+		Meshlets.push_back({.VertexOffset = 0, .TriangleOffset = 0, .VertexCount = 4, .TriangleCount = 2});
+		Meshlets.back().Center = {1.5f, -1.5f, 0.5f};
+		Meshlets.back().ConeCutoff = 0.5f;
+		MeshletVertices = {0, 1, 2, 3};
+		MeshletTriangles = {0, 1, 2, 2, 1, 3};
+	}
+
+	MeshCacheView View() const
+	{
+		MeshCacheView view;
+		view.Vertices = Vertices;
+		view.Shapes.push_back({.Name = Names[0],
+							   .Indices = Indices[0],
+							   .Lods = Lods[0],
+							   .Meshlets = Meshlets,
+							   .MeshletVertices = MeshletVertices,
+							   .MeshletTriangles = MeshletTriangles,
+							   .MaterialIndex = 0,
+							   .Bounds = {{0, -3, 0.5f}, {3, 0, 0.5f}, {1.5f, -1.5f, 0.5f}, 2.2f}});
+		auto& pillar = view.Shapes.emplace_back();
+		pillar.Name = Names[1];
+		pillar.Indices = Indices[1];
+		pillar.Lods = Lods[1];
+		auto& stone = view.Materials.emplace_back();
+		stone.Name = Names[2];
+		stone.NormalMapTexture = Names[3];
+		stone.Diffuse = {0.5f, 0.25f, 1.0f};
+		return view;
+	}
+};
+
+bool SameBytes(auto a, auto b)
+{
+	return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size_bytes()) == 0);
+}
+
+bool SameShape(MeshCacheShape const& a, MeshCacheShape const& b)
+{
+	auto sameLod = [](MeshLod const& x, MeshLod const& y)
+	{ return x.IndexOffset == y.IndexOffset && x.IndexCount == y.IndexCount && x.Error == y.Error; };
+	return a.Name == b.Name && SameBytes(a.Indices, b.Indices) && std::ranges::equal(a.Lods, b.Lods, sameLod) &&
+		   SameBytes(a.Meshlets, b.Meshlets) && SameBytes(a.MeshletVertices, b.MeshletVertices) &&
+		   SameBytes(a.MeshletTriangles, b.MeshletTriangles) && a.MaterialIndex == b.MaterialIndex &&
+		   a.Bounds.Min == b.Bounds.Min && a.Bounds.Max == b.Bounds.Max && a.Bounds.Center == b.Bounds.Center &&
+		   a.Bounds.Radius == b.Bounds.Radius;
+}
+
+bool Parses(std::span<const std::byte> bytes, uint64_t sourceHash)
+{
+	MeshCacheView view;
+	return ParseMeshCache(bytes, sourceHash, view);
+}
+
+} // namespace
+
+RAD_TEST(MeshCache, RoundTripsThroughAMappedFile)
+{
+	TemporaryDirectory directory("radMeshCacheRoundTrip");
+	TestModel model;
+	MeshCacheView written = model.View();
+	auto bytes = SerializeMeshCache(0x1234567890ABCDEFull, written);
+	std::filesystem::path path = GetMeshCachePath(directory.Path / "model.obj");
+	RAD_CHECK(path.filename() == "model.radmesh");
+	RAD_CHECK(WriteMeshCache(path, bytes));
+	RAD_CHECK(!std::filesystem::exists(path.string() + ".tmp"));
+
+	MappedFile file(path);
+	RAD_CHECK(file.IsValid() && SameBytes(file.GetBytes(), std::span<const std::byte>(bytes)));
+	MeshCacheView read;
+	RAD_CHECK(ParseMeshCache(file.GetBytes(), 0x1234567890ABCDEFull, read));
+	RAD_CHECK(std::ranges::equal(read.Vertices, written.Vertices));
+	RAD_CHECK(SameBytes(read.Vertices, written.Vertices));
+	RAD_CHECK_EQ(read.Shapes.size(), 2u);
+	RAD_CHECK_EQ(read.Materials.size(), 1u);
+	for (size_t i = 0; i < std::min(read.Shapes.size(), written.Shapes.size()); i++)
+		RAD_CHECK(SameShape(read.Shapes[i], written.Shapes[i]));
+	if (read.Materials.size() == 1)
+	{
+		RAD_CHECK(read.Materials[0].Name == "stone");
+		RAD_CHECK(read.Materials[0].DiffuseTexture.empty());
+		RAD_CHECK(read.Materials[0].NormalMapTexture == "textures/stone_ddn.png");
+		RAD_CHECK(read.Materials[0].Diffuse == glm::vec3(0.5f, 0.25f, 1.0f));
+	}
+
+	// The arrays point straight into the mapping at their natural alignment, nothing was copied
+	auto inFile = [&](void const* pointer)
+	{
+		auto const* byte = static_cast<std::byte const*>(pointer);
+		return byte >= file.GetBytes().data() && byte < file.GetBytes().data() + file.GetBytes().size() &&
+			   (byte - file.GetBytes().data()) % 4 == 0;
+	};
+	RAD_CHECK(inFile(read.Vertices.data()));
+	if (read.Shapes.size() == 2)
+		RAD_CHECK(inFile(read.Shapes[0].Indices.data()) && inFile(read.Shapes[0].Meshlets.data()) &&
+				  inFile(read.Shapes[1].Lods.data()));
+
+	// Rewriting replaces the file
+	auto empty = SerializeMeshCache(7, {});
+	RAD_CHECK(WriteMeshCache(path, empty));
+	MappedFile rewritten(path);
+	MeshCacheView emptyView;
+	RAD_CHECK(ParseMeshCache(rewritten.GetBytes(), 7, emptyView));
+	RAD_CHECK(emptyView.Vertices.empty() && emptyView.Shapes.empty() && emptyView.Materials.empty());
+}
+
+RAD_TEST(MeshCache, RejectsOtherSourcesVersionsAndTruncation)
+{
+	TestModel model;
+	auto bytes = SerializeMeshCache(42, model.View());
+	RAD_CHECK(Parses(bytes, 42));
+	RAD_CHECK(!Parses(bytes, 43));
+	RAD_CHECK(!Parses(bytes, 0));
+
+	// The header starts with the magic and the version
+	auto corrupt = [&](size_t offset, uint32_t value)
+	{
+		std::vector<std::byte> copy = bytes;
+		std::memcpy(copy.data() + offset, &value, sizeof(value));
+		return copy;
+	};
+	uint32_t version;
+	std::memcpy(&version, bytes.data() + 4, sizeof(version));
+	RAD_CHECK(!Parses(corrupt(4, version - 1), 42));
+	RAD_CHECK(!Parses(corrupt(4, version + 1), 42));
+	RAD_CHECK(!Parses(corrupt(0, 0), 42));
+
+	// Cut anywhere, or with bytes left over, the sections no longer add up to the file
+	std::span<const std::byte> all(bytes);
+	for (size_t size : {size_t(0), size_t(7), size_t(16), all.size() / 3, all.size() / 2, all.size() - 1})
+		RAD_CHECK(!Parses(all.first(size), 42));
+	auto longer = bytes;
+	longer.push_back(std::byte(0));
+	RAD_CHECK(!Parses(longer, 42));
+}
+
+RAD_TEST(MeshCache, SourceHashFollowsTheObjAndItsMaterials)
+{
+	TemporaryDirectory directory("radMeshCacheHash");
+	std::filesystem::path obj = directory.Path / "model.obj";
+	RAD_CHECK_EQ(HashMeshSource(obj), 0u);
+
+	WriteText(obj, "mtllib model.mtl\nv 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+	uint64_t missingMtl = HashMeshSource(obj);
+	RAD_CHECK(missingMtl != 0);
+	RAD_CHECK_EQ(HashMeshSource(obj), missingMtl);
+
+	WriteText(directory.Path / "model.mtl", "newmtl stone\nKd 1 1 1\n");
+	uint64_t withMtl = HashMeshSource(obj);
+	RAD_CHECK(withMtl != missingMtl);
+	WriteText(directory.Path / "model.mtl", "newmtl stone\nKd 1 0 1\n");
+	RAD_CHECK(HashMeshSource(obj) != withMtl);
+
+	WriteText(obj, "mtllib model.mtl\nv 0 0 0\nv 1 0 0\nv 0 2 0\nf 1 2 3\n");
+	RAD_CHECK(HashMeshSource(obj) != withMtl);
+}
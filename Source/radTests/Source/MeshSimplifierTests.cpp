@@ -0,0 +1,233 @@
+#include "Test.h"
+
+#include "Graphics/MeshSimplifier.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <utility>
+
+using namespace rad;
+
+namespace
+{
+
+struct Grid
+{
+	std::vector<glm::vec3> Positions;
+	std::vector<uint32_t> Indices;
+};
+
+// cells x cells quads over [0, cells] in x and y with z from height. With a seam the vertices of the middle column are
+// duplicated and the right half uses the copies, like a UV seam would split them.
+Grid CreateGrid(uint32_t cells, std::function<float(float, float)> const& height, bool seam = false)
+{
+	Grid grid;
+	uint32_t row = cells + 1;
+	for (uint32_t y = 0; y <= cells; y++)
+		for (uint32_t x = 0; x <= cells; x++)
+			grid.Positions.push_back({float(x), float(y), height(float(x), float(y))});
+	uint32_t middle = cells / 2, copies = uint32_t(grid.Positions.size());
+	if (seam)
+		for (uint32_t y = 0; y <= cells; y++)
+			grid.Positions.push_back(grid.Positions[middle + y * row]);
+
+	auto vertex = [&](uint32_t x, uint32_t y, bool right)
+	{ return seam && right && x == middle ? copies + y : x + y * row; };
+	for (uint32_t y = 0; y < cells; y++)
+		for (uint32_t x = 0; x < cells; x++)
+		{
+			bool right = x >= middle;
+			uint32_t v00 = vertex(x, y, right), v10 = vertex(x + 1, y, right);
+			uint32_t v01 = vertex(x, y + 1, right), v11 = vertex(x + 1, y + 1, right);
+			grid.Indices.insert(grid.Indices.end(), {v00, v10, v11, v00, v11, v01});
+		}
+	return grid;
+}
+
+glm::vec3 TriangleNormal(std::span<const glm::vec3> positions, uint32_t const* triangle)
+{
+	glm::vec3 a = positions[triangle[0]], b = positions[triangle[1]], c = positions[triangle[2]];
+	return glm::cross(b - a, c - a);
+}
+
+// Area of the projection onto the xy plane, negative for triangles flipped over
+double ProjectedArea(std::span<const glm::vec3> positions, std::span<const uint32_t> indices)
+{
+	double area = 0.0;
+	for (size_t t = 0; t < indices.size(); t += 3)
+		area += 0.5 * TriangleNormal(positions, &indices[t]).z;
+	return area;
+}
+
+// Length of the edges only one triangle uses, vertices at the same position counting as one
+double OpenEdgeLength(std::span<const glm::vec3> positions, std::span<const uint32_t> indices)
+{
+	auto key = [&](uint32_t v) { return std::pair(positions[v].x, positions[v].y); };
+	std::map<std::pair<std::pair<float, float>, std::pair<float, float>>, int> edges;
+	for (size_t t = 0; t < indices.size(); t += 3)
+		for (int e = 0; e < 3; e++)
+		{
+			auto a = key(indices[t + e]), b = key(indices[t + (e + 1) % 3]);
+			edges[std::minmax(a, b)]++;
+		}
+	double length = 0.0;
+	for (auto const& [edge, count] : edges)
+		if (count == 1)
+			length += std::hypot(edge.first.first - edge.second.first, edge.first.second - edge.second.second);
+	return length;
+}
+
+// Largest height difference between the grid's vertices and the simplified surface below or above them
+float LargestHeightDeviation(Grid const& grid, std::span<const uint32_t> simplified)
+{
+	float deviation = 0.0f;
+	for (glm::vec3 point : grid.Positions)
+		for (size_t t = 0; t < simplified.size(); t += 3)
+		{
+			glm::vec3 a = grid.Positions[simplified[t]], b = grid.Positions[simplified[t + 1]];
+			glm::vec3 c = grid.Positions[simplified[t + 2]];
+			float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+			float u = ((b.x - point.x) * (c.y - point.y) - (c.x - point.x) * (b.y - point.y)) / area;
+			float v = ((c.x - point.x) * (a.y - point.y) - (a.x - point.x) * (c.y - point.y)) / area;
+			if (u < -1e-5f || v < -1e-5f || u + v > 1.0f + 1e-5f)
+				continue;
+			float z = a.z * u + b.z * v + c.z * (1.0f - u - v);
+			deviation = std::max(deviation, std::abs(z - point.z));
+			break;
+		}
+	return deviation;
+}
+
+float Bumps(float x, float y)
+{
+	return 2.0f * std::sin(x * 0.3f) * std::cos(y * 0.2f);
+}
+
+} // namespace
+
+RAD_TEST(MeshSimplifier, FlatGridCollapsesWithoutError)
+{
+	Grid grid = CreateGrid(32, [](float, float) { return 0.0f; });
+	float error = 1.0f;
+	auto simplified = SimplifyMesh(grid.Positions, grid.Indices, 0, 1e-4f, error);
+	RAD_CHECK(error <= 1e-4f);
+	RAD_CHECK(simplified.size() % 3 == 0 && simplified.size() * 20 < grid.Indices.size());
+
+	// Nothing flipped or degenerate, and the border keeps its length so the grid has no holes
+	for (size_t t = 0; t < simplified.size(); t += 3)
+		RAD_CHECK(TriangleNormal(grid.Positions, &simplified[t]).z > 0.0f);
+	RAD_CHECK_NEAR(ProjectedArea(grid.Positions, simplified), 32.0 * 32.0, 1e-3);
+	RAD_CHECK_NEAR(OpenEdgeLength(grid.Positions, simplified), 4.0 * 32.0, 1e-3);
+}
+
+RAD_TEST(MeshSimplifier, SeamKeepsItsShapeOnBothSides)
+{
+	Grid grid = CreateGrid(24, Bumps, true);
+	uint32_t copies = 25 * 25;
+	float error = 0.0f;
+	auto simplified = SimplifyMesh(grid.Positions, grid.Indices, grid.Indices.size() / 4, 1.0f, error);
+	RAD_CHECK(simplified.size() <= grid.Indices.size() / 4);
+
+	// Triangles stay on their side of the seam and use its vertices from that side
+	for (size_t t = 0; t < simplified.size(); t += 3)
+	{
+		int left = 0, right = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t v = simplified[t + corner];
+			glm::vec3 position = grid.Positions[v];
+			left += v < copies && position.x <= 12.0f;
+			right += v >= copies || position.x > 12.0f;
+		}
+		RAD_CHECK(left == 3 || right == 3);
+		RAD_CHECK(TriangleNormal(grid.Positions, &simplified[t]).z > 0.0f);
+	}
+	// Both halves collapsed the seam the same way, so no cracks open along it
+	RAD_CHECK_NEAR(ProjectedArea(grid.Positions, simplified), 24.0 * 24.0, 1e-3);
+	RAD_CHECK_NEAR(OpenEdgeLength(grid.Positions, simplified), 4.0 * 24.0, 1e-3);
+}
+
+RAD_TEST(MeshSimplifier, StopsBeforeMaxError)
+{
+	Grid grid = CreateGrid(40, Bumps);
+	size_t previousSize = 0;
+	for (float maxError : {0.4f, 0.1f, 0.02f})
+	{
+		float error = 0.0f;
+		auto simplified = SimplifyMesh(grid.Positions, grid.Indices, 0, maxError, error);
+		RAD_CHECK(error > 0.0f && error <= maxError);
+		// The error estimates how far the surface moved from the vertices it dropped, borders included
+		RAD_CHECK(LargestHeightDeviation(grid, simplified) <= 2.0f * error);
+		RAD_CHECK(simplified.size() > previousSize && simplified.size() < grid.Indices.size());
+		previousSize = simplified.size();
+	}
+
+	// Asked for no fewer indices than given, nothing changes
+	float error = 1.0f;
+	RAD_CHECK(SimplifyMesh(grid.Positions, grid.Indices, grid.Indices.size(), 1.0f, error) == grid.Indices);
+	RAD_CHECK_EQ(error, 0.0f);
+}
+
+RAD_TEST(MeshSimplifier, LodsChainFromTheFullMesh)
+{
+	Grid grid = CreateGrid(48, Bumps);
+	std::vector<uint32_t> indices = grid.Indices;
+	MeshLodSettings settings;
+	auto lods = BuildMeshLods(grid.Positions, indices, settings);
+	RAD_CHECK(lods.size() >= 3 && lods.size() <= settings.MaxLods);
+	RAD_CHECK(std::equal(grid.Indices.begin(), grid.Indices.end(), indices.begin()));
+	RAD_CHECK(lods[0].IndexOffset == 0 && lods[0].IndexCount == grid.Indices.size() && lods[0].Error == 0.0f);
+
+	float radius = glm::length(glm::vec3(48.0f, 48.0f, 4.0f)) * 0.5f;
+	for (size_t lod = 1; lod < lods.size(); lod++)
+	{
+		MeshLod const& level = lods[lod];
+		MeshLod const& previous = lods[lod - 1];
+		RAD_CHECK_EQ(level.IndexOffset, previous.IndexOffset + previous.IndexCount);
+		RAD_CHECK(level.IndexCount % 3 == 0);
+		RAD_CHECK(float(level.IndexCount) <= float(previous.IndexCount) * settings.MinReduction);
+		RAD_CHECK(level.Error >= previous.Error);
+		RAD_CHECK(level.Error - previous.Error <= settings.MaxRelativeError * radius);
+		auto levelIndices = std::span(indices).subspan(level.IndexOffset, level.IndexCount);
+		RAD_CHECK(std::ranges::all_of(levelIndices, [&](uint32_t v) { return v < grid.Positions.size(); }));
+		RAD_CHECK(LargestHeightDeviation(grid, levelIndices) <= 2.0f * level.Error);
+	}
+	RAD_CHECK_EQ(indices.size(), size_t(lods.back().IndexOffset + lods.back().IndexCount));
+
+	std::vector<uint32_t> empty;
+	RAD_CHECK_EQ(BuildMeshLods(grid.Positions, empty).size(), 1u);
+}
+
+RAD_TEST(MeshSimplifier, SelectsLodByProjectedError)
+{
+	MeshLod lods[] = {{0, 300, 0.0f}, {300, 150, 0.01f}, {450, 60, 0.1f}, {510, 30, 1.0f}};
+	// 500 pixels per unit of error one unit away, one pixel allowed
+	LodSelectionView view(glm::perspectiveLH(glm::radians(90.0f), 1.0f, 0.1f, 1000.0f), {}, 1000.0f, 1.0f);
+	glm::mat4 identity(1.0f);
+	auto select = [&](glm::mat4 const& world, float distance)
+	{ return SelectMeshLod(lods, world, {0.0f, 0.0f, distance}, 1.0f, view); };
+
+	// Distances from the sphere's surface
+	RAD_CHECK_EQ(select(identity, 0.5f), 0u);
+	RAD_CHECK_EQ(select(identity, 1.0f + 4.5f), 0u);
+	RAD_CHECK_EQ(select(identity, 1.0f + 5.5f), 1u);
+	RAD_CHECK_EQ(select(identity, 1.0f + 49.0f), 1u);
+	RAD_CHECK_EQ(select(identity, 1.0f + 51.0f), 2u);
+	RAD_CHECK_EQ(select(identity, 1.0f + 510.0f), 3u);
+
+	// Twice the size: twice the error and a sphere reaching twice as far towards the view
+	glm::mat4 scaled = glm::scale(identity, glm::vec3(1.0f, 2.0f, 1.0f));
+	RAD_CHECK_EQ(select(scaled, 2.0f + 9.0f), 0u);
+	RAD_CHECK_EQ(select(scaled, 2.0f + 11.0f), 1u);
+	glm::mat4 moved = glm::translate(identity, glm::vec3(0.0f, 0.0f, 100.0f));
+	RAD_CHECK_EQ(select(moved, 1.0f + 4.5f - 100.0f), 0u);
+
+	// 100 pixels per unit at any distance
+	LodSelectionView orthographic(glm::orthoLH(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 1000.0f), {}, 1000.0f, 1.0f);
+	for (float distance : {0.0f, 3.0f, 900.0f})
+		RAD_CHECK_EQ(SelectMeshLod(lods, identity, {0.0f, 0.0f, distance}, 1.0f, orthographic), 1u);
+}
@@ -0,0 +1,305 @@
+#include "Test.h"
+
+#include "Graphics/Meshlets.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+using namespace rad;
+
+namespace
+{
+
+struct TestMesh
+{
+	std::vector<glm::vec3> Positions;
+	std::vector<uint32_t> Indices;
+};
+
+glm::vec3 TriangleNormal(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
+{
+	return glm::cross(p1 - p0, p2 - p0);
+}
+
+// Rings around the y axis, triangles wound to face outwards
+TestMesh CreateSphere(uint32_t rings, uint32_t segments, float radius)
+{
+	TestMesh mesh;
+	for (uint32_t ring = 0; ring <= rings; ring++)
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			float polar = 3.14159265f * float(ring) / rings, azimuth = 6.2831853f * float(segment) / segments;
+			mesh.Positions.push_back({radius * std::sin(polar) * std::cos(azimuth), radius * std::cos(polar),
+									  radius * std::sin(polar) * std::sin(azimuth)});
+		}
+	for (uint32_t ring = 0; ring < rings; ring++)
+		for (uint32_t segment = 0; segment < segments; segment++)
+		{
+			uint32_t a = ring * segments + segment, b = ring * segments + (segment + 1) % segments;
+			for (std::array<uint32_t, 3> triangle : {std::array{a, b, a + segments}, {b, b + segments, a + segments}})
+			{
+				auto const& p = mesh.Positions;
+				glm::vec3 normal = TriangleNormal(p[triangle[0]], p[triangle[1]], p[triangle[2]]);
+				// The ones at the poles are degenerate
+				if (glm::dot(normal, normal) < 1e-12f)
+					continue;
+				if (glm::dot(normal, p[triangle[0]] + p[triangle[1]] + p[triangle[2]]) < 0.0f)
+					std::swap(triangle[1], triangle[2]);
+				mesh.Indices.insert(mesh.Indices.end(), triangle.begin(), triangle.end());
+			}
+		}
+	return mesh;
+}
+
+// Rolling hills of quads on the xz plane, facing up
+TestMesh CreateGrid(uint32_t quads, float cellLength)
+{
+	TestMesh mesh;
+	uint32_t size = quads + 1;
+	for (uint32_t z = 0; z < size; z++)
+		for (uint32_t x = 0; x < size; x++)
+			mesh.Positions.push_back({float(x) * cellLength, std::sin(float(x) * 0.3f) * std::cos(float(z) * 0.2f),
+									  float(z) * cellLength});
+	for (uint32_t z = 0; z < quads; z++)
+		for (uint32_t x = 0; x < quads; x++)
+		{
+			uint32_t cell = x + z * size;
+			for (uint32_t corner : {cell, cell + size, cell + 1, cell + 1, cell + size, cell + size + 1})
+				mesh.Indices.push_back(corner);
+		}
+	return mesh;
+}
+
+// Calls visit with the corners of every triangle of a meshlet, moved by worldMatrix
+template <typename Visit>
+void ForEachTriangle(MeshletData const& data, Meshlet const& meshlet, std::span<const glm::vec3> positions,
+					 glm::mat4 const& worldMatrix, Visit visit)
+{
+	for (uint32_t triangle = 0; triangle < meshlet.TriangleCount; triangle++)
+	{
+		glm::vec3 corners[3];
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint8_t local = data.Triangles[(size_t(meshlet.TriangleOffset) + triangle) * 3 + corner];
+			glm::vec3 position = positions[data.Vertices[meshlet.VertexOffset + local]];
+			corners[corner] = glm::vec3(worldMatrix * glm::vec4(position, 1.0f));
+		}
+		visit(corners[0], corners[1], corners[2]);
+	}
+}
+
+void CheckStats(MeshletData const& data, std::vector<uint32_t> const& visible, MeshletCullStats const& stats)
+{
+	uint64_t visibleTriangles = 0;
+	for (uint32_t i : visible)
+		visibleTriangles += data.Meshlets[i].TriangleCount;
+	RAD_CHECK_EQ(stats.Meshlets, uint64_t(data.Meshlets.size()));
+	RAD_CHECK_EQ(stats.VisibleMeshlets, uint64_t(visible.size()));
+	RAD_CHECK_EQ(stats.Triangles, uint64_t(data.Triangles.size() / 3));
+	RAD_CHECK_EQ(stats.FrustumCulledTriangles + stats.BackfaceCulledTriangles + visibleTriangles, stats.Triangles);
+}
+
+// Planes that hold everything, so only the cones cull
+MeshletCullView ConeOnlyView(glm::vec3 position)
+{
+	MeshletCullView view(glm::mat4(1.0f), position);
+	for (glm::vec4& plane : view.Planes)
+		plane = {0.0f, 0.0f, 0.0f, 1e30f};
+	return view;
+}
+
+} // namespace
+
+RAD_TEST(Meshlets, BuildCoversEveryTriangleOnce)
+{
+	TestMesh sphere = CreateSphere(20, 31, 1.0f);
+	// Shuffled faces leave the builder to find locality on its own
+	TestMesh grid = CreateGrid(40, 0.5f);
+	std::mt19937 generator(6);
+	for (size_t triangle = grid.Indices.size() / 3; triangle > 1; triangle--)
+		std::swap_ranges(grid.Indices.begin() + (triangle - 1) * 3, grid.Indices.begin() + triangle * 3,
+						 grid.Indices.begin() + (generator() % triangle) * 3);
+
+	MeshletSettings settings[] = {{}, {.MaxVertices = 3, .MaxTriangles = 1}, {.MaxVertices = 16, .MaxTriangles = 20}};
+	for (TestMesh const* mesh : {&sphere, &grid})
+		for (MeshletSettings const& setting : settings)
+		{
+			MeshletData data = BuildMeshlets(mesh->Positions, mesh->Indices, setting);
+			std::vector<std::array<uint32_t, 3>> expected, built;
+			// Winding is kept, so each triangle is compared from its smallest corner on
+			auto canonical = [](std::array<uint32_t, 3> triangle)
+			{
+				std::ranges::rotate(triangle, std::ranges::min_element(triangle));
+				return triangle;
+			};
+			for (size_t i = 0; i < mesh->Indices.size(); i += 3)
+				expected.push_back(canonical({mesh->Indices[i], mesh->Indices[i + 1], mesh->Indices[i + 2]}));
+
+			uint32_t vertexOffset = 0, triangleOffset = 0;
+			for (Meshlet const& meshlet : data.Meshlets)
+			{
+				RAD_CHECK(meshlet.VertexOffset == vertexOffset && meshlet.TriangleOffset == triangleOffset);
+				RAD_CHECK(meshlet.VertexCount <= setting.MaxVertices && meshlet.TriangleCount <= setting.MaxTriangles);
+				RAD_CHECK(meshlet.TriangleCount > 0);
+				vertexOffset += meshlet.VertexCount;
+				triangleOffset += meshlet.TriangleCount;
+				for (uint32_t i = 0; i < meshlet.VertexCount; i++)
+				{
+					glm::vec3 delta = mesh->Positions[data.Vertices[meshlet.VertexOffset + i]] - meshlet.Center;
+					RAD_CHECK(std::sqrt(glm::dot(delta, delta)) <= meshlet.Radius * (1.0f + 1e-5f) + 1e-6f);
+				}
+				for (uint32_t i = 0; i < meshlet.TriangleCount * 3; i++)
+					RAD_CHECK(data.Triangles[size_t(meshlet.TriangleOffset) * 3 + i] < meshlet.VertexCount);
+				for (uint32_t i = 0; i < meshlet.TriangleCount; i++)
+				{
+					uint8_t const* local = &data.Triangles[(size_t(meshlet.TriangleOffset) + i) * 3];
+					uint32_t const* vertices = &data.Vertices[meshlet.VertexOffset];
+					built.push_back(canonical({vertices[local[0]], vertices[local[1]], vertices[local[2]]}));
+				}
+			}
+			RAD_CHECK(vertexOffset == data.Vertices.size() && size_t(triangleOffset) * 3 == data.Triangles.size());
+			std::ranges::sort(expected);
+			std::ranges::sort(built);
+			RAD_CHECK(built == expected);
+		}
+	RAD_CHECK(BuildMeshlets(sphere.Positions, {}).Meshlets.empty());
+}
+
+RAD_TEST(Meshlets, ConesOnlyCullBackFaces)
+{
+	TestMesh sphere = CreateSphere(48, 64, 2.0f);
+	MeshletData data = BuildMeshlets(sphere.Positions, sphere.Indices);
+	glm::mat4 moved = glm::scale(glm::rotate(glm::translate(glm::mat4(1.0f), {5.0f, -3.0f, 2.0f}), 0.7f,
+											 {1.0f, 2.0f, -1.0f}),
+								 glm::vec3(3.0f));
+	std::mt19937 generator(11);
+	std::uniform_real_distribution<float> coordinate(-30.0f, 30.0f);
+	for (glm::mat4 const& worldMatrix : {glm::mat4(1.0f), moved})
+	{
+		uint64_t culled = 0, triangles = 0;
+		for (int sample = 0; sample < 300; sample++)
+		{
+			glm::vec3 position = {coordinate(generator), coordinate(generator), coordinate(generator)};
+			std::vector<uint32_t> visible;
+			MeshletCullStats stats;
+			CullMeshlets(data, worldMatrix, ConeOnlyView(position), visible, stats);
+			CheckStats(data, visible, stats);
+			RAD_CHECK_EQ(stats.FrustumCulledTriangles, 0u);
+			culled += stats.BackfaceCulledTriangles;
+			triangles += stats.Triangles;
+
+			// Every triangle of a culled meshlet faces away from the view
+			std::vector<uint8_t> isVisible(data.Meshlets.size(), 0);
+			for (uint32_t i : visible)
+				isVisible[i] = 1;
+			for (size_t i = 0; i < data.Meshlets.size(); i++)
+				if (!isVisible[i])
+					ForEachTriangle(data, data.Meshlets[i], sphere.Positions, worldMatrix,
+									[&](glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
+									{
+										glm::vec3 normal = glm::normalize(TriangleNormal(p0, p1, p2));
+										RAD_CHECK(glm::dot(normal, position - p0) <= 1e-4f);
+									});
+		}
+		// About half of a sphere faces away, cones wide enough to be tight catch a good share of it
+		RAD_CHECK(double(culled) > 0.25 * double(triangles));
+	}
+}
+
+RAD_TEST(Meshlets, ConesSkippedWhenScaleIsUnevenOrMirrored)
+{
+	TestMesh sphere = CreateSphere(24, 32, 1.0f);
+	MeshletData data = BuildMeshlets(sphere.Positions, sphere.Indices);
+	MeshletCullView view = ConeOnlyView({0.0f, 0.0f, -20.0f});
+	glm::mat4 sheared(1.0f);
+	sheared[1][0] = 0.5f;
+	glm::mat4 transforms[] = {glm::scale(glm::mat4(1.0f), {1.0f, 2.0f, 1.0f}),
+							  glm::scale(glm::mat4(1.0f), {-1.0f, 1.0f, 1.0f}), sheared};
+	for (glm::mat4 const& worldMatrix : transforms)
+	{
+		std::vector<uint32_t> visible;
+		MeshletCullStats stats;
+		CullMeshlets(data, worldMatrix, view, visible, stats);
+		RAD_CHECK_EQ(stats.BackfaceCulledTriangles, 0u);
+		RAD_CHECK_EQ(visible.size(), data.Meshlets.size());
+	}
+
+	std::vector<uint32_t> visible;
+	MeshletCullStats stats;
+	CullMeshlets(data, glm::mat4(1.0f), view, visible, stats);
+	RAD_CHECK(stats.BackfaceCulledTriangles > 0u);
+}
+
+RAD_TEST(Meshlets, FrustumOnlyCullsMeshletsOutside)
+{
+	TestMesh grid = CreateGrid(128, 1.0f);
+	MeshletData data = BuildMeshlets(grid.Positions, grid.Indices);
+	// Without cones only the frustum culls
+	for (Meshlet& meshlet : data.Meshlets)
+		meshlet.ConeCutoff = 1.0f;
+	glm::mat4 projection = glm::perspectiveLH(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 60.0f);
+	glm::mat4 worldMatrices[] = {glm::mat4(1.0f), glm::translate(glm::mat4(1.0f), {-64.0f, -2.0f, -64.0f})};
+
+	std::mt19937 generator(2);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	for (glm::mat4 const& worldMatrix : worldMatrices)
+	{
+		uint64_t culled = 0, visibleCount = 0;
+		for (int sample = 0; sample < 60; sample++)
+		{
+			// Somewhere over the grid, or past its edges, looking at another such place
+			glm::vec3 origin = glm::vec3(worldMatrix * glm::vec4(64.0f, 0.0f, 64.0f, 1.0f));
+			auto around = [&](float height)
+			{ return origin + glm::vec3{unit(generator) * 100.0f - 50.0f, height, unit(generator) * 100.0f - 50.0f}; };
+			glm::vec3 position = around(2.0f + unit(generator) * 20.0f);
+			glm::vec3 target = around(0.0f);
+			MeshletCullView view(projection * glm::lookAtLH(position, target, {0.0f, 1.0f, 0.0f}), position);
+
+			std::vector<uint32_t> visible;
+			MeshletCullStats stats;
+			CullMeshlets(data, worldMatrix, view, visible, stats);
+			CheckStats(data, visible, stats);
+			RAD_CHECK_EQ(stats.BackfaceCulledTriangles, 0u);
+			culled += data.Meshlets.size() - visible.size();
+			visibleCount += visible.size();
+
+			// A culled meshlet has every corner behind one plane
+			std::vector<uint8_t> isVisible(data.Meshlets.size(), 0);
+			for (uint32_t i : visible)
+				isVisible[i] = 1;
+			for (size_t i = 0; i < data.Meshlets.size(); i++)
+			{
+				if (isVisible[i])
+					continue;
+				bool behindOnePlane = std::ranges::any_of(
+					view.Planes,
+					[&](glm::vec4 const& plane)
+					{
+						bool allBehind = true;
+						ForEachTriangle(data, data.Meshlets[i], grid.Positions, worldMatrix,
+										[&](glm::vec3 p0, glm::vec3 p1, glm::vec3 p2)
+										{
+											for (glm::vec3 const& p : {p0, p1, p2})
+												allBehind = allBehind && glm::dot(glm::vec3(plane), p) + plane.w < 0.0f;
+										});
+						return allBehind;
+					});
+				RAD_CHECK(behindOnePlane);
+			}
+		}
+		RAD_CHECK(culled > 0u && visibleCount > 0u);
+	}
+
+	// Looking down from under the grid sees none of it
+	glm::vec3 below = {64.0f, -20.0f, 64.0f};
+	MeshletCullView view(projection * glm::lookAtLH(below, below + glm::vec3(0.0f, -1.0f, 0.0f), {0.0f, 0.0f, 1.0f}),
+						 below);
+	std::vector<uint32_t> visible;
+	MeshletCullStats stats;
+	CullMeshlets(data, glm::mat4(1.0f), view, visible, stats);
+	RAD_CHECK(visible.empty());
+	RAD_CHECK_EQ(stats.FrustumCulledTriangles, stats.Triangles);
+}
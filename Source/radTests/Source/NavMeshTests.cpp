@@ -0,0 +1,230 @@
+#include "Test.h"
+
+#include "ProcGen/NavMesh.h"
+
+#include <algorithm>
+#include <functional>
+
+using namespace rad::proc;
+
+namespace
+{
+
+// 32 x 32 units of 0.5 cells, 4 x 4 tiles of 16 cells
+constexpr float Extent = 32.0f;
+constexpr uint32_t Cells = 64;
+
+NavMeshBuilder::Settings TestSettings()
+{
+	return {.CellSize = 0.5f, .AgentRadius = 0.5f, .TileSize = 16, .MaxPolygonCells = 8, .ThreadCount = 3};
+}
+
+// A sample per unit over the whole extent
+std::vector<float> CreateHeights(std::function<float(float, float)> const& height)
+{
+	uint32_t samples = uint32_t(Extent) + 1;
+	std::vector<float> heights(size_t(samples) * samples);
+	for (uint32_t z = 0; z < samples; z++)
+		for (uint32_t x = 0; x < samples; x++)
+			heights[x + z * samples] = height(float(x), float(z));
+	return heights;
+}
+
+uint32_t SetHeights(NavMeshBuilder& builder, std::vector<float> const& heights, float tolerance = 0.0f)
+{
+	uint32_t samples = uint32_t(Extent) + 1;
+	return builder.SetHeightfield(heights, samples, samples, 0.0f, 0.0f, 1.0f, tolerance);
+}
+
+uint32_t WalkableCells(NavMeshBuilder const& builder)
+{
+	uint32_t cells = 0;
+	for (NavMeshTile const& tile : builder.GetTiles())
+		cells += tile.WalkableCells;
+	return cells;
+}
+
+bool SameTile(NavMeshTile const& a, NavMeshTile const& b)
+{
+	auto sameVertex = [](NavVertex const& u, NavVertex const& v) { return u.X == v.X && u.Y == v.Y && u.Z == v.Z; };
+	auto samePolygon = [](NavPolygon const& p, NavPolygon const& q)
+	{
+		return p.Vertices == q.Vertices && p.FirstLink == q.FirstLink && p.LinkCount == q.LinkCount &&
+			   p.OpenSides == q.OpenSides;
+	};
+	return a.X == b.X && a.Y == b.Y && a.WalkableCells == b.WalkableCells && a.Links == b.Links &&
+		   std::ranges::equal(a.Vertices, b.Vertices, sameVertex) &&
+		   std::ranges::equal(a.Polygons, b.Polygons, samePolygon);
+}
+
+// Two triangles of a horizontal rectangle at height y
+void AddQuad(NavMeshBuilder& builder, float minX, float minZ, float maxX, float maxZ, float y)
+{
+	std::vector<float> positions = {minX, y, minZ, maxX, y, minZ, maxX, y, maxZ, minX, y, maxZ};
+	std::vector<uint32_t> indices = {0, 1, 2, 0, 2, 3};
+	builder.AddMesh(positions, indices);
+}
+
+} // namespace
+
+RAD_TEST(NavMesh, FlatPlaneIsCoveredUpToTheAgentRadius)
+{
+	for (float radius : {0.5f, 1.0f})
+	{
+		auto settings = TestSettings();
+		settings.AgentRadius = radius;
+		NavMeshBuilder builder(settings, 0.0f, 0.0f, Extent, Extent);
+		RAD_CHECK_EQ(builder.GetTilesX(), 4u);
+		RAD_CHECK_EQ(builder.GetTilesY(), 4u);
+		RAD_CHECK_EQ(SetHeights(builder, CreateHeights([](float, float) { return 3.0f; })), 16u);
+		RAD_CHECK_EQ(builder.Build(), 16u);
+		RAD_CHECK_EQ(builder.GetDirtyTileCount(), 0u);
+
+		// Only the cells within the radius of the map's edge are dropped, tile borders don't erode anything
+		uint32_t eroded = uint32_t(radius / settings.CellSize);
+		RAD_CHECK_EQ(WalkableCells(builder), (Cells - 2 * eroded) * (Cells - 2 * eroded));
+		for (NavMeshTile const& tile : builder.GetTiles())
+		{
+			for (NavVertex const& vertex : tile.Vertices)
+				RAD_CHECK_NEAR(vertex.Y, 3.0f, settings.CellHeight);
+			for (NavPolygon const& polygon : tile.Polygons)
+			{
+				NavVertex const& first = tile.Vertices[polygon.Vertices[0]];
+				NavVertex const& opposite = tile.Vertices[polygon.Vertices[2]];
+				RAD_CHECK(opposite.X - first.X <= settings.MaxPolygonCells * settings.CellSize);
+				RAD_CHECK(opposite.Z - first.Z <= settings.MaxPolygonCells * settings.CellSize);
+			}
+		}
+	}
+}
+
+RAD_TEST(NavMesh, DropsSlopesSteeperThanTheLimit)
+{
+	// Flat up to x = 16, then a ramp of the given rise per unit
+	auto rampCells = [](float rise)
+	{
+		NavMeshBuilder builder(TestSettings(), 0.0f, 0.0f, Extent, Extent);
+		SetHeights(builder, CreateHeights([&](float x, float) { return std::max(0.0f, x - 16.0f) * rise; }));
+		builder.Build();
+		float highest = 0.0f;
+		for (NavMeshTile const& tile : builder.GetTiles())
+			for (NavVertex const& vertex : tile.Vertices)
+				highest = std::max(highest, vertex.Y);
+		return std::pair(WalkableCells(builder), highest);
+	};
+	// 27 degrees against the limit of 40 stays walkable, the polygons climb it
+	auto [gentleCells, gentleTop] = rampCells(0.5f);
+	RAD_CHECK_EQ(gentleCells, (Cells - 2) * (Cells - 2));
+	RAD_CHECK(gentleTop > 7.0f);
+	// 63 degrees is dropped along with the radius next to it, only the flat half is left
+	auto [steepCells, steepTop] = rampCells(2.0f);
+	RAD_CHECK(steepCells <= (Cells / 2 - 2) * (Cells - 2));
+	RAD_CHECK(steepCells >= (Cells / 2 - 4) * (Cells - 2));
+	RAD_CHECK(steepTop < 0.5f);
+}
+
+RAD_TEST(NavMesh, ClimbsStepsUpToMaxClimb)
+{
+	// A platform up to the map's edges, its own edge in the middle of the second tile column. It stops short of the
+	// cell boundaries so no sliver of it lands in the cells next to it.
+	auto stepCells = [](float stepHeight, bool& mixed)
+	{
+		NavMeshBuilder builder(TestSettings(), 0.0f, 0.0f, Extent, Extent);
+		SetHeights(builder, CreateHeights([](float, float) { return 0.0f; }));
+		AddQuad(builder, 11.1f, 0.1f, Extent - 0.1f, Extent - 0.1f, stepHeight);
+		builder.Build();
+		// A polygon spanning both levels only forms when the step can be walked
+		mixed = false;
+		for (NavMeshTile const& tile : builder.GetTiles())
+			for (NavPolygon const& polygon : tile.Polygons)
+			{
+				float low = tile.Vertices[polygon.Vertices[0]].Y, high = low;
+				for (uint16_t vertex : polygon.Vertices)
+				{
+					low = std::min(low, tile.Vertices[vertex].Y);
+					high = std::max(high, tile.Vertices[vertex].Y);
+				}
+				mixed |= high - low > stepHeight * 0.5f;
+			}
+		return WalkableCells(builder);
+	};
+	auto settings = TestSettings();
+	bool lowMixed = false, highMixed = false;
+	// Below MaxClimb the step doesn't erode anything, above it the radius is dropped on both sides of it
+	uint32_t lowCells = stepCells(settings.MaxClimb * 0.6f, lowMixed);
+	uint32_t highCells = stepCells(settings.MaxClimb * 2.0f, highMixed);
+	RAD_CHECK_EQ(lowCells, (Cells - 2) * (Cells - 2));
+	RAD_CHECK(lowMixed);
+	RAD_CHECK_EQ(highCells, (Cells - 2) * (Cells - 2) - 2 * (Cells - 2));
+	RAD_CHECK(!highMixed);
+}
+
+RAD_TEST(NavMesh, ChangedSamplesOnlyRebuildNearbyTiles)
+{
+	auto hills = [](float x, float z) { return 2.0f * std::sin(x * 0.2f) * std::cos(z * 0.15f); };
+	auto heights = CreateHeights(hills);
+	NavMeshBuilder builder(TestSettings(), 0.0f, 0.0f, Extent, Extent);
+	SetHeights(builder, heights);
+	builder.Build();
+	std::vector<NavMeshTile> before(builder.GetTiles().begin(), builder.GetTiles().end());
+
+	// Changes within the tolerance don't dirty anything
+	auto nudged = heights;
+	for (float& height : nudged)
+		height += 1e-4f;
+	RAD_CHECK_EQ(SetHeights(builder, nudged, 1e-3f), 0u);
+	RAD_CHECK_EQ(builder.Build(), 0u);
+	SetHeights(builder, heights, 1e-3f);
+
+	// A sample in the middle of tile (1, 2) only reaches that tile with its border, one on the corner of four tiles
+	// reaches all four
+	auto changed = heights;
+	changed[12 + 20 * 33] += 0.6f;
+	RAD_CHECK_EQ(SetHeights(builder, changed), 1u);
+	RAD_CHECK_EQ(builder.Build(), 1u);
+	changed[16 + 8 * 33] -= 0.6f;
+	RAD_CHECK_EQ(SetHeights(builder, changed), 4u);
+	RAD_CHECK_EQ(builder.Build(), 4u);
+
+	// Clean tiles keep their output, the rebuilt ones match a builder that never saw the old heights
+	NavMeshBuilder fresh(TestSettings(), 0.0f, 0.0f, Extent, Extent);
+	SetHeights(fresh, changed);
+	fresh.Build();
+	for (uint32_t tile = 0; tile < before.size(); tile++)
+	{
+		uint32_t tileX = tile % 4, tileY = tile / 4;
+		bool rebuilt = (tileX == 1 && tileY == 2) || ((tileX == 1 || tileX == 2) && (tileY == 0 || tileY == 1));
+		RAD_CHECK(SameTile(builder.GetTiles()[tile], fresh.GetTiles()[tile]));
+		if (!rebuilt)
+			RAD_CHECK(SameTile(builder.GetTiles()[tile], before[tile]));
+	}
+}
+
+RAD_TEST(NavMesh, MeshesGrowingTheHeightRangeRebuildEveryTile)
+{
+	auto heights = CreateHeights([](float x, float z) { return 0.35f + 0.01f * x - 0.02f * z; });
+	NavMeshBuilder builder(TestSettings(), 0.0f, 0.0f, Extent, Extent);
+	SetHeights(builder, heights);
+	builder.Build();
+
+	// Inside the vertical range only the tiles under the mesh and their borders are dirty
+	AddQuad(builder, 2.0f, 2.0f, 6.0f, 6.0f, 0.9f);
+	RAD_CHECK_EQ(builder.GetDirtyTileCount(), 1u);
+	builder.Build();
+	// A pit far below moves the bottom of the range, which every tile's spans are quantised from
+	AddQuad(builder, 26.0f, 26.0f, 30.0f, 30.0f, -5.55f);
+	RAD_CHECK_EQ(builder.GetDirtyTileCount(), 16u);
+	RAD_CHECK_EQ(builder.Build(), 16u);
+
+	NavMeshBuilder fresh(TestSettings(), 0.0f, 0.0f, Extent, Extent);
+	AddQuad(fresh, 26.0f, 26.0f, 30.0f, 30.0f, -5.55f);
+	SetHeights(fresh, heights);
+	AddQuad(fresh, 2.0f, 2.0f, 6.0f, 6.0f, 0.9f);
+	fresh.Build();
+	for (uint32_t tile = 0; tile < 16; tile++)
+		RAD_CHECK(SameTile(builder.GetTiles()[tile], fresh.GetTiles()[tile]));
+
+	// Removing the meshes rebuilds the tiles they were in
+	builder.ClearMeshes();
+	RAD_CHECK_EQ(builder.GetDirtyTileCount(), 2u);
+}
@@ -0,0 +1,355 @@
+#include "Test.h"
+
+#include "Graphics/ObjParser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+
+using namespace rad;
+
+namespace
+{
+
+// A scratch directory of its own, removed again with everything in it
+struct TemporaryDirectory
+{
+	std::filesystem::path Path;
+
+	explicit TemporaryDirectory(char const* name) : Path(std::filesystem::temp_directory_path() / name)
+	{
+		std::filesystem::remove_all(Path);
+		std::filesystem::create_directories(Path);
+	}
+	~TemporaryDirectory()
+	{
+		std::error_code error;
+		std::filesystem::remove_all(Path, error);
+	}
+};
+
+void WriteText(std::filesystem::path const& path, std::string_view text)
+{
+	std::ofstream(path, std::ios::binary) << text;
+}
+
+tinyobj::index_t Corner(int vertex, int texCoord = -1, int normal = -1)
+{
+	tinyobj::index_t corner;
+	corner.vertex_index = vertex;
+	corner.texcoord_index = texCoord;
+	corner.normal_index = normal;
+	return corner;
+}
+
+bool SameCorner(tinyobj::index_t a, tinyobj::index_t b)
+{
+	return a.vertex_index == b.vertex_index && a.texcoord_index == b.texcoord_index && a.normal_index == b.normal_index;
+}
+
+// Corners and material of each triangle of a shape
+struct ExpectedShape
+{
+	std::string Name;
+	std::vector<tinyobj::index_t> Corners;
+	std::vector<int> Materials;
+};
+
+bool Matches(tinyobj::shape_t const& shape, ExpectedShape const& expected)
+{
+	auto const& mesh = shape.mesh;
+	return shape.name == expected.Name && std::ranges::equal(mesh.indices, expected.Corners, SameCorner) &&
+		   mesh.material_ids == expected.Materials && mesh.num_face_vertices.size() == expected.Materials.size() &&
+		   std::ranges::all_of(mesh.num_face_vertices, [](auto count) { return count == 3; });
+}
+
+void CheckShapes(ObjData const& data, std::vector<ExpectedShape> const& expected)
+{
+	RAD_CHECK_EQ(data.Shapes.size(), expected.size());
+	for (size_t i = 0; i < std::min(data.Shapes.size(), expected.size()); i++)
+		RAD_CHECK(Matches(data.Shapes[i], expected[i]));
+}
+
+bool Same(ObjData const& a, ObjData const& b)
+{
+	auto sameShape = [](tinyobj::shape_t const& x, tinyobj::shape_t const& y)
+	{
+		return x.name == y.name && std::ranges::equal(x.mesh.indices, y.mesh.indices, SameCorner) &&
+			   x.mesh.material_ids == y.mesh.material_ids && x.mesh.num_face_vertices == y.mesh.num_face_vertices;
+	};
+	return a.Attrib.vertices == b.Attrib.vertices && a.Attrib.normals == b.Attrib.normals &&
+		   a.Attrib.texcoords == b.Attrib.texcoords && std::ranges::equal(a.Shapes, b.Shapes, sameShape) &&
+		   a.Materials.size() == b.Materials.size();
+}
+
+ObjData Parse(std::filesystem::path const& path, uint32_t threadCount = 0)
+{
+	ObjData data;
+	RAD_CHECK(ParseObj(path, data, threadCount));
+	RAD_CHECK(data.Error.empty());
+	return data;
+}
+
+} // namespace
+
+RAD_TEST(ObjParser, IndicesAndMissingAttributes)
+{
+	TemporaryDirectory directory("radObjParserIndices");
+	WriteText(directory.Path / "model.obj", "# Every way a corner can be written\n"
+											"v 0 0 0\n"
+											"v 1 0 0\n"
+											"v 1 1 0\n"
+											"v +0.5 1e1 -2.25\n"
+											"vt 0 0\n"
+											"vt 1 0.5\n"
+											"vn 0 0 1\n"
+											"f 1 2 3\n"
+											"f 1/1 2/2 3/1\n"
+											"f 1//1 2//1 3//1\n"
+											"f 1/2/1 2/1/1 4/2/1\n"
+											"f -4/-2/-1 -3/-1/-1 -1/-2/-1\n"
+											"vt 0.25 0.75\n"
+											"v 2 2 2\n"
+											"f -2/-1 -1/-3 -4/-2\n"
+											"f 1 2\n"
+											"f\t1\t 3   5 \n");
+	ObjData data = Parse(directory.Path / "model.obj");
+	RAD_CHECK(data.Attrib.vertices == std::vector<float>({0, 0, 0, 1, 0, 0, 1, 1, 0, 0.5f, 10, -2.25f, 2, 2, 2}));
+	RAD_CHECK(data.Attrib.texcoords == std::vector<float>({0, 0, 1, 0.5f, 0.25f, 0.75f}));
+	RAD_CHECK(data.Attrib.normals == std::vector<float>({0, 0, 1}));
+	RAD_CHECK(data.Materials.empty());
+
+	// Relative indices count back from the attributes before their line, the two corner face is dropped
+	CheckShapes(data, {{"",
+						{Corner(0), Corner(1), Corner(2), Corner(0, 0), Corner(1, 1), Corner(2, 0), Corner(0, -1, 0),
+						 Corner(1, -1, 0), Corner(2, -1, 0), Corner(0, 1, 0), Corner(1, 0, 0), Corner(3, 1, 0),
+						 Corner(0, 0, 0), Corner(1, 1, 0), Corner(3, 0, 0), Corner(3, 2), Corner(4, 0), Corner(1, 1),
+						 Corner(0), Corner(2), Corner(4)},
+						{-1, -1, -1, -1, -1, -1, -1}}});
+
+	// Zero, past the end, before the start and stray characters fail
+	for (char const* face : {"f 1 2 0\n", "f 1 2 4\n", "f 1 2 -4\n", "f 1/4 2 3\n", "f 1 2 3x\n", "f 1 2/a 3\n"})
+	{
+		WriteText(directory.Path / "bad.obj", std::string("v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\n") + face);
+		ObjData bad;
+		RAD_CHECK(!ParseObj(directory.Path / "bad.obj", bad));
+		RAD_CHECK(!bad.Error.empty());
+	}
+	ObjData missing;
+	RAD_CHECK(!ParseObj(directory.Path / "missing.obj", missing) && !missing.Error.empty());
+}
+
+RAD_TEST(ObjParser, QuadsAndPolygons)
+{
+	TemporaryDirectory directory("radObjParserPolygons");
+	WriteText(directory.Path / "model.obj", "v 0 0 0\n"
+											"v 3 0 0\n"
+											"v 1 1 0\n"
+											"v 0 3 0\n"
+											"v 1 0 0\n"
+											"v 1.2 1.2 0\n"
+											"v 0 1 0\n"
+											"f 1 2 3 4\n"
+											"f 1 5 6 7\n"
+											"f 1 5 6 7 4 2\n");
+	ObjData data = Parse(directory.Path / "model.obj");
+	// A quad splits along its shorter diagonal, 1-3 in the first and 5-7 in the kite, larger polygons fan from their
+	// first corner
+	CheckShapes(data, {{"",
+						{Corner(0), Corner(1), Corner(2), Corner(0), Corner(2), Corner(3), Corner(0), Corner(4),
+						 Corner(6), Corner(4), Corner(5), Corner(6), Corner(0), Corner(4), Corner(5), Corner(0),
+						 Corner(5), Corner(6), Corner(0), Corner(6), Corner(3), Corner(0), Corner(3), Corner(1)},
+						std::vector<int>(8, -1)}});
+}
+
+RAD_TEST(ObjParser, GroupsAndMaterials)
+{
+	TemporaryDirectory directory("radObjParserGroups");
+	WriteText(directory.Path / "scene.mtl", "newmtl stone\nKd 0.5 0.5 0.5\nnewmtl wood\nKd 0.6 0.3 0.1\n");
+	WriteText(directory.Path / "model.obj", "mtllib missing.mtl scene.mtl\n"
+											"v 0 0 0\n"
+											"v 1 0 0\n"
+											"v 1 1 0\n"
+											"v 0 1 0\n"
+											"f 1 2 3\n"
+											"g walls left\n"
+											"usemtl stone\n"
+											"f 1 2 3\n"
+											"usemtl missing\n"
+											"f 1 3 4\n"
+											"o  Door Frame \n"
+											"g empty\n"
+											"usemtl wood\n"
+											"g floor\n"
+											"f 1 2 4\n"
+											"o Roof\n"
+											"f 2 3 4\n"
+											"usemtl stone\n"
+											"f 1 2 4\n");
+	ObjData data = Parse(directory.Path / "model.obj");
+	RAD_CHECK_EQ(data.Materials.size(), 2u);
+	if (data.Materials.size() == 2)
+		RAD_CHECK(data.Materials[0].name == "stone" && data.Materials[1].name == "wood");
+
+	// Shapes without faces are dropped, the material carries over into the next shape, unknown ones are -1
+	CheckShapes(data, {{"", {Corner(0), Corner(1), Corner(2)}, {-1}},
+					   {"walls left", {Corner(0), Corner(1), Corner(2), Corner(0), Corner(2), Corner(3)}, {0, -1}},
+					   {"floor", {Corner(0), Corner(1), Corner(3)}, {1}},
+					   {"Roof", {Corner(1), Corner(2), Corner(3), Corner(0), Corner(1), Corner(3)}, {1, 0}}});
+}
+
+RAD_TEST(ObjParser, CrlfAndWhitespaceMatchLf)
+{
+	TemporaryDirectory directory("radObjParserCrlf");
+	std::string text = "mtllib scene.mtl\n"
+					   "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+					   "vt 0 0\nvn 0 0 1\n"
+					   "o Panel\n"
+					   "g glass pane\n"
+					   "usemtl wood\n"
+					   "f 1/1/1 2/1/1 3/1/1 4/1/1\n";
+	std::string crlf;
+	for (char c : text)
+	{
+		if (c == '\n')
+			crlf += '\r';
+		crlf += c;
+	}
+	std::string spaced = "  mtllib\tscene.mtl  \n"
+						 "\tv 0 0 0\nv  1\t0 0 \nv 1 1 0\r\nv 0 1 0\n"
+						 "vt 0 0\t\nvn 0 0 1\n"
+						 "o Panel \t\r\n"
+						 "g  glass\t pane \n"
+						 "\n   \n"
+						 "usemtl wood \r\n"
+						 "f  1/1/1 2/1/1\t3/1/1 4/1/1  \r\n";
+	WriteText(directory.Path / "scene.mtl", "newmtl wood\r\nKd 1 1 1\r\n");
+	WriteText(directory.Path / "lf.obj", text);
+	WriteText(directory.Path / "crlf.obj", crlf);
+	WriteText(directory.Path / "spaced.obj", spaced);
+
+	ObjData lf = Parse(directory.Path / "lf.obj");
+	CheckShapes(lf, {{"glass pane",
+					  {Corner(0, 0, 0), Corner(1, 0, 0), Corner(3, 0, 0), Corner(1, 0, 0), Corner(2, 0, 0),
+					   Corner(3, 0, 0)},
+					  {0, 0}}});
+	RAD_CHECK(Same(Parse(directory.Path / "crlf.obj"), lf));
+	RAD_CHECK(Same(Parse(directory.Path / "spaced.obj"), lf));
+}
+
+RAD_TEST(ObjParser, ChunkBoundariesInsideLines)
+{
+	// Chunks are at least 1 MiB and cut forward to the end of a line, so these 3.5 MiB always split into the same four
+	// chunks whatever the thread count
+	constexpr size_t MiB = 1 << 20;
+	TemporaryDirectory directory("radObjParserChunks");
+	WriteText(directory.Path / "scene.mtl", "newmtl stone\nnewmtl wood\n");
+
+	std::string text = "mtllib scene.mtl\n";
+	std::vector<float> vertices, texCoords, normals;
+	std::vector<ExpectedShape> shapes = {{"ground", {}, {}}};
+	int material = -1;
+	text += "g ground\n";
+	auto number = [&](float value)
+	{
+		char buffer[32];
+		text.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), value).ptr);
+	};
+	auto addVertex = [&](uint32_t i)
+	{
+		float position[3] = {float(i % 1000) * 0.25f, float(i % 7) - 3.0f, float(i / 1000) * 0.5f};
+		text += "v";
+		for (float value : position)
+		{
+			text += " ";
+			number(value);
+			vertices.push_back(value);
+		}
+		text += "\nvt ";
+		number(float(i % 64) / 64.0f);
+		text += " 0.5\nvn 0 1 0\n";
+		texCoords.insert(texCoords.end(), {float(i % 64) / 64.0f, 0.5f});
+		normals.insert(normals.end(), {0.0f, 1.0f, 0.0f});
+	};
+	// A triangle of the last three vertices, written relative, absolute or mixed
+	auto addFace = [&](uint32_t style)
+	{
+		int last = int(vertices.size() / 3) - 1;
+		text += "f";
+		for (int corner = 0; corner < 3; corner++)
+		{
+			int vertex = last - 2 + corner;
+			int relative = vertex - last - 1;
+			int index = (style + corner) % 3 ? vertex + 1 : relative;
+			std::string written = std::to_string(index);
+			text += ' ';
+			for (int component = 0; component < 3; component++)
+				text += (component ? "/" : "") + written;
+			shapes.back().Corners.push_back(Corner(vertex, vertex, vertex));
+		}
+		text += "\n";
+		shapes.back().Materials.push_back(material);
+	};
+	auto fill = [&](size_t until)
+	{
+		for (uint32_t i = 0; text.size() < until; i++)
+		{
+			addVertex(uint32_t(vertices.size() / 3));
+			if (i % 3 == 2)
+				addFace(i);
+		}
+	};
+	// Each cut is at the end of the line holding the byte a MiB after the previous one. padTo starts the next line
+	// just before that byte, with a comment, and cutAfter moves on to the next cut once that line is written.
+	size_t cut = 0;
+	auto padTo = [&](size_t offset)
+	{
+		size_t spaces = offset - text.size() - 2;
+		text += '#';
+		text.append(spaces, ' ');
+		text += '\n';
+	};
+	auto padToCut = [&]() { padTo(cut + MiB - 4); };
+	auto cutAfter = [&]() { cut = text.find('\n', cut + MiB - 1) + 1; };
+
+	// A vertex line across the first cut, faces right after it index it and the ones before relatively
+	fill(cut + MiB - 200);
+	padToCut();
+	addVertex(uint32_t(vertices.size() / 3));
+	cutAfter();
+	addFace(0);
+	addFace(1);
+
+	// The material and a group set at the end of the second chunk, the group's name across the cut
+	fill(cut + MiB - 300);
+	text += "usemtl wood\n";
+	material = 1;
+	padToCut();
+	text += "g second group\n";
+	cutAfter();
+	shapes.push_back({"second group", {}, {}});
+	addFace(2);
+
+	// A face across the third cut, and the last chunk's first line switches material before any face
+	fill(cut + MiB - 200);
+	addVertex(uint32_t(vertices.size() / 3));
+	addVertex(uint32_t(vertices.size() / 3));
+	padToCut();
+	addFace(0);
+	cutAfter();
+	text += "usemtl stone\n";
+	material = 0;
+	addFace(1);
+	fill(cut + MiB / 2);
+	WriteText(directory.Path / "model.obj", text);
+
+	for (uint32_t threadCount : {1u, 4u})
+	{
+		ObjData data = Parse(directory.Path / "model.obj", threadCount);
+		RAD_CHECK(data.Attrib.vertices == vertices);
+		RAD_CHECK(data.Attrib.texcoords == texCoords);
+		RAD_CHECK(data.Attrib.normals == normals);
+		RAD_CHECK_EQ(data.Materials.size(), 2u);
+		CheckShapes(data, shapes);
+	}
+}
@@ -0,0 +1,203 @@
+#include "Test.h"
+
+#include "Graphics/RangeAllocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace rad;
+
+namespace
+{
+
+using Range = std::pair<uint64_t, uint64_t>;
+
+// Offset and size of every run of free units
+std::vector<Range> FreeRuns(std::vector<uint8_t> const& used)
+{
+	std::vector<Range> runs;
+	for (uint64_t unit = 0; unit < used.size();)
+	{
+		if (used[unit])
+		{
+			unit++;
+			continue;
+		}
+		uint64_t start = unit;
+		while (unit < used.size() && !used[unit])
+			unit++;
+		runs.push_back({start, unit - start});
+	}
+	return runs;
+}
+
+void Mark(std::vector<uint8_t>& used, Range range, uint8_t value)
+{
+	std::fill_n(used.begin() + range.first, range.second, value);
+}
+
+struct ChurnStats
+{
+	uint64_t Allocations = 0;
+	uint64_t Failed = 0;
+	// Of 1 - largest free range / free size, after every model load
+	double MeanFragmentation = 0.0;
+};
+
+/*
+Models of 20 to 400 ranges with sizes log uniform over 64 to 64k units load while the space is below occupancy and a
+random one unloads otherwise. A range that doesn't fit counts as failed, the pool would take a new page for it.
+*/
+ChurnStats RunChurn(uint64_t capacity, double occupancy, uint32_t events, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<double> logSize(std::log(64.0), std::log(65536.0));
+	RangeAllocator allocator(capacity);
+	std::vector<std::vector<Range>> models;
+	ChurnStats stats;
+	uint32_t loads = 0;
+	for (uint32_t event = 0; event < events; event++)
+	{
+		uint64_t used = capacity - allocator.GetFreeSize();
+		if (models.empty() || double(used) < occupancy * double(capacity))
+		{
+			auto& model = models.emplace_back();
+			uint32_t rangeCount = 20 + generator() % 381;
+			for (uint32_t i = 0; i < rangeCount; i++)
+			{
+				uint64_t size = uint64_t(std::exp(logSize(generator)));
+				stats.Allocations++;
+				if (auto offset = allocator.Allocate(size))
+					model.push_back({*offset, size});
+				else
+					stats.Failed++;
+			}
+			if (allocator.GetFreeSize())
+				stats.MeanFragmentation +=
+					1.0 - double(allocator.GetLargestFreeRange()) / double(allocator.GetFreeSize());
+			loads++;
+		}
+		else
+		{
+			size_t unloaded = generator() % models.size();
+			for (auto [offset, size] : models[unloaded])
+				allocator.Free(offset, size);
+			std::swap(models[unloaded], models.back());
+			models.pop_back();
+		}
+	}
+	stats.MeanFragmentation /= std::max(loads, 1u);
+	return stats;
+}
+
+} // namespace
+
+RAD_TEST(RangeAllocator, MatchesReferenceBitmap)
+{
+	uint64_t capacity = 2048;
+	RangeAllocator allocator(capacity);
+	std::vector<uint8_t> used(capacity, 0);
+	std::vector<Range> live;
+	std::mt19937 generator(7);
+	auto runs = FreeRuns(used);
+	uint64_t failed = 0;
+	for (int operation = 0; operation < 200000; operation++)
+	{
+		if (live.empty() || generator() % 2)
+		{
+			uint64_t size = generator() % 16 ? 1 + generator() % 64 : 1 + generator() % 512;
+			auto offset = allocator.Allocate(size);
+			// Best fit: the smallest free run that is large enough, from its start
+			uint64_t bestSize = 0;
+			for (auto [runOffset, runSize] : runs)
+				if (runSize >= size && (bestSize == 0 || runSize < bestSize))
+					bestSize = runSize;
+			RAD_CHECK_EQ(offset.has_value(), bestSize != 0);
+			if (offset)
+			{
+				auto run = std::ranges::find(runs, *offset, &Range::first);
+				RAD_CHECK(run != runs.end() && run->second == bestSize);
+				Mark(used, {*offset, size}, 1);
+				live.push_back({*offset, size});
+			}
+			else
+				failed++;
+		}
+		else
+		{
+			size_t index = generator() % live.size();
+			allocator.Free(live[index].first, live[index].second);
+			Mark(used, live[index], 0);
+			std::swap(live[index], live.back());
+			live.pop_back();
+		}
+
+		runs = FreeRuns(used);
+		uint64_t freeSize = 0, largest = 0;
+		for (auto [runOffset, runSize] : runs)
+		{
+			freeSize += runSize;
+			largest = std::max(largest, runSize);
+		}
+		RAD_CHECK_EQ(allocator.GetFreeSize(), freeSize);
+		RAD_CHECK_EQ(allocator.GetFreeRangeCount(), runs.size());
+		RAD_CHECK_EQ(allocator.GetLargestFreeRange(), largest);
+	}
+	// Full often enough for both outcomes to be covered
+	RAD_CHECK(failed > 1000u);
+	RAD_CHECK(!allocator.Allocate(0));
+}
+
+RAD_TEST(RangeAllocator, FreeingEverythingCoalesces)
+{
+	uint64_t capacity = 1 << 16;
+	std::mt19937 generator(11);
+	for (int order = 0; order < 3; order++)
+	{
+		RangeAllocator allocator(capacity);
+		std::vector<Range> live;
+		while (auto offset = allocator.Allocate(1 + generator() % 300))
+			live.push_back({*offset, 0});
+		// The last size that failed may still leave a few units
+		while (auto offset = allocator.Allocate(1))
+			live.push_back({*offset, 0});
+		std::ranges::sort(live);
+		for (size_t i = 0; i < live.size(); i++)
+			live[i].second = (i + 1 < live.size() ? live[i + 1].first : capacity) - live[i].first;
+		RAD_CHECK_EQ(allocator.GetFreeSize(), 0u);
+		RAD_CHECK_EQ(allocator.GetFreeRangeCount(), 0u);
+
+		// In address order, backwards and shuffled
+		if (order == 1)
+			std::ranges::reverse(live);
+		else if (order == 2)
+			std::ranges::shuffle(live, generator);
+		for (auto [offset, size] : live)
+			allocator.Free(offset, size);
+		RAD_CHECK_EQ(allocator.GetFreeRangeCount(), 1u);
+		RAD_CHECK_EQ(allocator.GetLargestFreeRange(), capacity);
+		RAD_CHECK_EQ(allocator.Allocate(capacity).value_or(1), 0u);
+	}
+}
+
+RAD_TEST(RangeAllocator, ChurnKeepsFragmentationLow)
+{
+	// A vertex page of 16M units, loaded and unloaded model by model
+	uint64_t capacity = 16 << 20;
+	ChurnStats half = RunChurn(capacity, 0.5, 3000, 1);
+	RAD_CHECK(half.Allocations > 100000u);
+	RAD_CHECK_EQ(half.Failed, 0u);
+	RAD_CHECK(half.MeanFragmentation < 0.25);
+
+	ChurnStats mostly = RunChurn(capacity, 0.7, 3000, 2);
+	RAD_CHECK_EQ(mostly.Failed, 0u);
+	RAD_CHECK(mostly.MeanFragmentation < 0.45);
+
+	// Close to full a few ranges no longer fit, which is what adding pages is for
+	ChurnStats full = RunChurn(capacity, 0.85, 3000, 3);
+	RAD_CHECK(double(full.Failed) < 0.03 * double(full.Allocations));
+	RAD_CHECK(full.MeanFragmentation < 0.8);
+}
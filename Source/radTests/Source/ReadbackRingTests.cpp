@@ -0,0 +1,136 @@
+#include "Test.h"
+
+#include "Graphics/ReadbackRing.h"
+
+#include <algorithm>
+#include <deque>
+#include <random>
+
+using namespace rad;
+
+RAD_TEST(ReadbackRing, RejectsImpossibleSizes)
+{
+	ReadbackRing ring(1024);
+	RAD_CHECK(!ring.Allocate(0, 16));
+	RAD_CHECK(!ring.Allocate(1025, 16));
+	RAD_CHECK(ring.Allocate(1024, 16));
+	RAD_CHECK(!ring.Allocate(1, 1));
+}
+
+RAD_TEST(ReadbackRing, AlignsOffsets)
+{
+	ReadbackRing ring(4096);
+	auto a = ring.Allocate(10, 1);
+	auto b = ring.Allocate(10, 256);
+	auto c = ring.Allocate(3, 512);
+	RAD_CHECK(a && b && c);
+	RAD_CHECK_EQ(a->Offset, 0u);
+	RAD_CHECK_EQ(b->Offset, 256u);
+	RAD_CHECK_EQ(c->Offset, 512u);
+	// Alignment padding counts as used until the allocation retires
+	RAD_CHECK_EQ(ring.GetUsedBytes(), 515u);
+}
+
+RAD_TEST(ReadbackRing, WrapsAround)
+{
+	ReadbackRing ring(1000);
+	auto a = ring.Allocate(400, 1);
+	auto b = ring.Allocate(400, 1);
+	RAD_CHECK(a && b);
+	ring.Complete(a->Id);
+	RAD_CHECK_EQ(ring.GetUsedBytes(), 400u);
+
+	// 200 bytes left at the end, so 300 goes to the start and the tail is skipped
+	auto c = ring.Allocate(300, 1);
+	RAD_CHECK(c);
+	RAD_CHECK_EQ(c->Offset, 0u);
+	RAD_CHECK_EQ(ring.GetUsedBytes(), 400u + 200u + 300u);
+	// Only the 100 bytes between c and b are free now
+	RAD_CHECK(!ring.Allocate(101, 1));
+	auto d = ring.Allocate(100, 1);
+	RAD_CHECK(d);
+	RAD_CHECK_EQ(d->Offset, 300u);
+
+	ring.Complete(b->Id);
+	ring.Complete(c->Id);
+	ring.Complete(d->Id);
+	RAD_CHECK_EQ(ring.GetUsedBytes(), 0u);
+	RAD_CHECK_EQ(ring.GetLiveAllocationCount(), 0u);
+	// An empty ring starts over at 0 whatever its head was
+	auto e = ring.Allocate(1000, 1);
+	RAD_CHECK(e);
+	RAD_CHECK_EQ(e->Offset, 0u);
+}
+
+RAD_TEST(ReadbackRing, RetiresInAllocationOrder)
+{
+	ReadbackRing ring(300);
+	auto a = ring.Allocate(100, 1);
+	auto b = ring.Allocate(100, 1);
+	auto c = ring.Allocate(100, 1);
+	RAD_CHECK(a && b && c);
+
+	// A newer copy finishing first gives nothing back while an older one is still in flight
+	ring.Complete(c->Id);
+	ring.Complete(b->Id);
+	RAD_CHECK_EQ(ring.GetUsedBytes(), 300u);
+	RAD_CHECK_EQ(ring.GetLiveAllocationCount(), 3u);
+	RAD_CHECK(!ring.Allocate(1, 1));
+
+	ring.Complete(a->Id);
+	RAD_CHECK_EQ(ring.GetUsedBytes(), 0u);
+	RAD_CHECK_EQ(ring.GetLiveAllocationCount(), 0u);
+}
+
+RAD_TEST(ReadbackRing, RandomTrafficNeverOverlaps)
+{
+	// Copies retire a few frames late and out of order, live ranges must never overlap or leave the ring
+	struct Live
+	{
+		uint64_t Id, Offset, Size;
+	};
+	std::mt19937 generator(11);
+	uint64_t capacity = 64 * 1024;
+	ReadbackRing ring(capacity);
+	std::deque<Live> live;
+	uint64_t succeeded = 0, failed = 0;
+	uint64_t alignments[] = {1, 8, 16, 256, 512};
+	for (int step = 0; step < 100000; step++)
+	{
+		if (live.empty() || generator() % 3 != 0)
+		{
+			uint64_t size = 1 + generator() % (capacity / 8);
+			uint64_t alignment = alignments[generator() % 5];
+			if (auto allocation = ring.Allocate(size, alignment))
+			{
+				RAD_CHECK_EQ(allocation->Offset % alignment, 0u);
+				RAD_CHECK(allocation->Offset + size <= capacity);
+				for (Live const& other : live)
+					RAD_CHECK(allocation->Offset + size <= other.Offset ||
+							  other.Offset + other.Size <= allocation->Offset);
+				live.push_back({allocation->Id, allocation->Offset, size});
+				succeeded++;
+			}
+			else
+				failed++;
+		}
+		else
+		{
+			// Mostly the oldest, sometimes one of the next few
+			size_t index = std::min<size_t>(generator() % 4 == 0 ? generator() % 4 : 0, live.size() - 1);
+			ring.Complete(live[index].Id);
+			live.erase(live.begin() + index);
+		}
+		RAD_CHECK(ring.GetUsedBytes() <= capacity);
+	}
+	RAD_CHECK(succeeded > 10000);
+	RAD_CHECK(failed > 0);
+
+	while (!live.empty())
+	{
+		ring.Complete(live.back().Id);
+		live.pop_back();
+	}
+	RAD_CHECK_EQ(ring.GetUsedBytes(), 0u);
+	RAD_CHECK_EQ(ring.GetLiveAllocationCount(), 0u);
+}
@@ -0,0 +1,98 @@
+#include "Test.h"
+
+#include "ProcGen/HydraulicErosionReference.h"
+#include "ProcGen/StrataColumns.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace rad::proc;
+
+RAD_TEST(StrataColumns, ErodingEmptyColumnRemovesNothing)
+{
+	StrataColumns strata(2, 1);
+	RAD_CHECK_EQ(strata.Erode(0, 1.0f), 0.0f);
+	RAD_CHECK_EQ(strata.GetTopSoftness(0), strata.BedrockSoftness);
+}
+
+RAD_TEST(StrataColumns, DroppedSliverJoinsLayerBelow)
+{
+	StrataColumns strata(1, 1);
+	strata.Deposit(0, 1.0f, 0.1f);
+	strata.Deposit(0, 1.0f, 0.9f);
+	// Leaves a top layer thinner than MinThickness, which is dropped
+	float removed = strata.Erode(0, 1.0f - 0.5f * strata.MinThickness);
+	RAD_CHECK_NEAR(removed, 1.0f - 0.5f * strata.MinThickness, 1e-7f);
+	RAD_CHECK_EQ(strata.GetLayers(0).size(), 1u);
+	RAD_CHECK_NEAR(strata.GetThickness(0), 2.0f - removed, 1e-6f);
+	RAD_CHECK_EQ(strata.GetTopSoftness(0), 0.1f);
+}
+
+RAD_TEST(StrataColumns, DroppedBottomSliverIsRemoved)
+{
+	StrataColumns strata(1, 1);
+	strata.Deposit(0, 1.0f, 0.5f);
+	float removed = strata.Erode(0, 1.0f - 0.5f * strata.MinThickness);
+	RAD_CHECK_EQ(strata.GetLayers(0).size(), 0u);
+	RAD_CHECK_NEAR(removed, 1.0f, 1e-7f);
+	RAD_CHECK_EQ(strata.GetTopSoftness(0), strata.BedrockSoftness);
+}
+
+RAD_TEST(StrataColumns, ErosionConservesMaterial)
+{
+	// Whatever isn't reported as removed stays in the column
+	std::mt19937 generator(21);
+	std::uniform_real_distribution<float> amountDistribution(0.0f, 2.0f);
+	std::uniform_real_distribution<float> softnessDistribution(0.0f, 1.0f);
+	StrataColumns strata(8, 8);
+	std::vector<double> expected(64, 0.0);
+	for (int step = 0; step < 20000; step++)
+	{
+		size_t column = generator() % 64;
+		float amount = amountDistribution(generator);
+		if (generator() % 2)
+		{
+			strata.Deposit(column, amount, softnessDistribution(generator));
+			expected[column] += amount;
+		}
+		else
+		{
+			float removed = strata.Erode(column, amount);
+			RAD_CHECK(removed <= amount + strata.MinThickness);
+			expected[column] -= removed;
+		}
+	}
+	for (size_t column = 0; column < 64; column++)
+	{
+		RAD_CHECK(strata.GetLayers(column).size() <= strata.MaxLayersPerColumn);
+		RAD_CHECK_NEAR(strata.GetThickness(column), expected[column], 1e-3);
+	}
+}
+
+RAD_TEST(StrataColumns, HeightsFollowColumnsWhenErodingToBedrock)
+{
+	// Thin strata under fast flowing water run out, the heights must not drop below what the columns gave up
+	uint32_t size = 32;
+	HydraulicErosionState state(size, size);
+	for (uint32_t y = 0; y < size; y++)
+		for (uint32_t x = 0; x < size; x++)
+			state.Heights[x + y * size] = 0.05f + 0.02f * float((x * 7 + y * 3) % 5);
+	std::fill(state.Water.begin(), state.Water.end(), 0.5f);
+	HydraulicErosionSettings settings;
+	settings.PipeLength = 1.0f;
+	settings.SedimentCapacity = 50.0f;
+
+	StrataColumns strata(size, size);
+	StrataLayer bands[] = {{0.01f, 1.0f}, {0.02f, 0.9f}};
+	strata.BuildFromBands(state.Heights, bands);
+
+	for (int step = 0; step < 50; step++)
+		HydraulicErosionStep(state, settings, &strata);
+
+	float maxDrift = 0.0f;
+	for (size_t i = 0; i < state.Heights.size(); i++)
+		maxDrift = std::max(maxDrift, std::abs(state.Heights[i] - strata.GetThickness(i)));
+	RAD_CHECK_NEAR(maxDrift, 0.0f, 1e-5f);
+	RAD_CHECK(std::ranges::all_of(state.Heights, [](float height) { return height >= -1e-6f; }));
+	RAD_CHECK(std::ranges::all_of(state.Sediment, [](float sediment) { return sediment >= -1e-6f; }));
+}
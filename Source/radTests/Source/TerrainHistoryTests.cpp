@@ -0,0 +1,149 @@
+#include "Test.h"
+
+#include "ProcGen/TerrainHistory.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace rad::proc;
+
+namespace
+{
+
+using Layers = std::vector<std::vector<float>>;
+
+bool Commit(TerrainHistory& history, std::string label, Layers const& layers)
+{
+	std::vector<std::span<const float>> spans(layers.begin(), layers.end());
+	return history.Commit(std::move(label), spans);
+}
+
+void Apply(std::vector<TerrainHistory::TileRestore> const& restores, Layers& layers, uint32_t width)
+{
+	for (auto const& restore : restores)
+		for (uint32_t y = 0; y < restore.Height; y++)
+			std::copy_n(restore.Values.data() + size_t(y) * restore.Width, restore.Width,
+						layers[restore.Layer].data() + restore.X + size_t(restore.Y + y) * width);
+}
+
+// Raises a random rectangle of one layer, like a brush stroke
+void Edit(Layers& layers, uint32_t width, uint32_t height, std::mt19937& generator)
+{
+	auto& layer = layers[generator() % layers.size()];
+	uint32_t x0 = uint32_t(generator() % width), y0 = uint32_t(generator() % height);
+	uint32_t x1 = std::min(width, x0 + 1 + uint32_t(generator() % 90));
+	uint32_t y1 = std::min(height, y0 + 1 + uint32_t(generator() % 90));
+	float amount = float(generator() % 1000) * 0.01f;
+	for (uint32_t y = y0; y < y1; y++)
+		for (uint32_t x = x0; x < x1; x++)
+			layer[x + y * width] += amount;
+}
+
+} // namespace
+
+RAD_TEST(TerrainHistory, UndoAndRedoRestoreEveryState)
+{
+	uint32_t width = 200, height = 150;
+	TerrainHistory history(3, width, height, {.TileSize = 64, .ThreadCount = 4});
+	std::mt19937 generator(3);
+	Layers layers(3, std::vector<float>(size_t(width) * height, 1.0f));
+	RAD_CHECK(!Commit(history, "Base", layers));
+	RAD_CHECK(history.HasBaseState() && !history.CanUndo());
+
+	std::vector<Layers> states = {layers};
+	for (int step = 0; step < 12; step++)
+	{
+		Edit(layers, width, height, generator);
+		RAD_CHECK(Commit(history, "Edit", layers));
+		states.push_back(layers);
+	}
+	// Nothing changed, no step
+	RAD_CHECK(!Commit(history, "Nothing", layers));
+	RAD_CHECK_EQ(history.GetUndoCount(), 12u);
+
+	for (size_t state = states.size() - 1; state-- > 0;)
+	{
+		Apply(history.Undo(), layers, width);
+		RAD_CHECK(layers == states[state]);
+	}
+	RAD_CHECK(!history.CanUndo() && history.Undo().empty());
+	for (size_t state = 1; state < states.size(); state++)
+	{
+		Apply(history.Redo(), layers, width);
+		RAD_CHECK(layers == states[state]);
+	}
+	RAD_CHECK(!history.CanRedo());
+}
+
+RAD_TEST(TerrainHistory, TilesOfAnotherShapeDoNotShareBlobs)
+{
+	// 192 cells with 128 wide tiles: the right column is 64x128 and the bottom row 128x64, same number of zeros
+	uint32_t size = 192;
+	TerrainHistory history(1, size, size, {.TileSize = 128});
+	Layers layers(1, std::vector<float>(size_t(size) * size, 0.0f));
+	Commit(history, "Base", layers);
+	Layers base = layers;
+
+	std::mt19937 generator(8);
+	for (float& value : layers[0])
+		value = float(generator() % 100);
+	RAD_CHECK(Commit(history, "Noise", layers));
+	RAD_CHECK_EQ(history.GetSteps().back().ChangedTiles, 4u);
+
+	auto restores = history.Undo();
+	for (auto const& restore : restores)
+		RAD_CHECK_EQ(restore.Values.size(), size_t(restore.Width) * restore.Height);
+	Apply(restores, layers, size);
+	RAD_CHECK(layers == base);
+}
+
+RAD_TEST(TerrainHistory, ReturningToEarlierContentReusesBlobs)
+{
+	uint32_t width = 256, height = 256;
+	TerrainHistory history(1, width, height, {.TileSize = 64});
+	std::mt19937 generator(5);
+	Layers original(1, std::vector<float>(size_t(width) * height));
+	for (float& value : original[0])
+		value = float(generator() % 4096) * 0.25f;
+	Commit(history, "Base", original);
+	size_t baseBytes = history.GetStoredBytes();
+
+	Layers edited = original;
+	for (uint32_t y = 0; y < 64; y++)
+		for (uint32_t x = 0; x < 64; x++)
+			edited[0][x + y * width] += 1.0f;
+	RAD_CHECK(Commit(history, "Raise", edited));
+	size_t editedBytes = history.GetStoredBytes();
+	RAD_CHECK(editedBytes > baseBytes);
+
+	// Back to the original content, the step only references blobs that are already stored
+	RAD_CHECK(Commit(history, "Lower", original));
+	RAD_CHECK_EQ(history.GetSteps().back().Bytes, 0u);
+	RAD_CHECK_EQ(history.GetStoredBytes(), editedBytes);
+}
+
+RAD_TEST(TerrainHistory, CommitDropsRedoSteps)
+{
+	uint32_t width = 100, height = 100;
+	TerrainHistory history(2, width, height, {.TileSize = 32});
+	std::mt19937 generator(12);
+	Layers layers(2, std::vector<float>(size_t(width) * height, 0.0f));
+	Commit(history, "Base", layers);
+	for (int step = 0; step < 4; step++)
+	{
+		Edit(layers, width, height, generator);
+		Commit(history, "Edit", layers);
+	}
+	Apply(history.Undo(), layers, width);
+	Apply(history.Undo(), layers, width);
+	RAD_CHECK(history.CanRedo());
+
+	// Reuses content the dropped redo steps held
+	Layers expected = layers;
+	Edit(layers, width, height, generator);
+	RAD_CHECK(Commit(history, "Other", layers));
+	RAD_CHECK(!history.CanRedo());
+	RAD_CHECK_EQ(history.GetSteps().size(), 3u);
+	Apply(history.Undo(), layers, width);
+	RAD_CHECK(layers == expected);
+}
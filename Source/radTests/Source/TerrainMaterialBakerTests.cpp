@@ -0,0 +1,311 @@
+#include "Test.h"
+
+#include "ProcGen/TerrainMaterialBaker.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <utility>
+
+using namespace rad::proc;
+
+namespace
+{
+
+// HeightMapToTerrainMaterial.hlsl and HeightMapToWaterMaterial.hlsl written out texel by texel, with Sample as a
+// bilinear clamp sampler. Kept as close to the shaders as C++ allows so it can be checked against them line by line.
+struct ShaderReference
+{
+	TerrainMaterialMaps Maps;
+	uint32_t OutputWidth = 0;
+	uint32_t OutputHeight = 0;
+
+	static float Sample(std::span<const float> map, uint32_t width, uint32_t height, float u, float v)
+	{
+		auto tap = [](float uv, uint32_t size, int& first, int& second)
+		{
+			float position = uv * float(size) - 0.5f;
+			float base = std::floor(position);
+			first = std::clamp(int(base), 0, int(size) - 1);
+			second = std::clamp(int(base) + 1, 0, int(size) - 1);
+			return position - base;
+		};
+		int x0, x1, y0, y1;
+		float fx = tap(u, width, x0, x1), fy = tap(v, height, y0, y1);
+		auto at = [&](int x, int y) { return map[size_t(x) + size_t(y) * width]; };
+		float top = at(x0, y0) * (1.0f - fx) + at(x1, y0) * fx;
+		float bottom = at(x0, y1) * (1.0f - fx) + at(x1, y1) * fx;
+		return top * (1.0f - fy) + bottom * fy;
+	}
+
+	float SampleHeight(float u, float v, bool withWater) const
+	{
+		float height = Sample(Maps.Heights, Maps.Width, Maps.Height, u, v);
+		return withWater ? height + Sample(Maps.Water, Maps.Width, Maps.Height, u, v) : height;
+	}
+
+	glm::vec3 FindNormal(float u, float v, bool withWater) const
+	{
+		float texelX = 1.0f / float(Maps.Width), texelY = 1.0f / float(Maps.Height);
+		float leftU = std::clamp(u - texelX, 0.0f, 1.0f), rightU = std::clamp(u + texelX, 0.0f, 1.0f);
+		float topV = std::clamp(v - texelY, 0.0f, 1.0f), bottomV = std::clamp(v + texelY, 0.0f, 1.0f);
+
+		float heightLeft = SampleHeight(leftU, v, withWater);
+		float heightRight = SampleHeight(rightU, v, withWater);
+		float heightTop = SampleHeight(u, topV, withWater);
+		float heightBottom = SampleHeight(u, bottomV, withWater);
+
+		float xDif = heightLeft - heightRight;
+		float yDif = heightBottom - heightTop;
+
+		return glm::normalize(glm::cross(glm::normalize(glm::vec3((rightU - leftU) * Maps.TotalLength, xDif, 0.0f)),
+										 glm::normalize(glm::vec3(0.0f, yDif, (topV - bottomV) * Maps.TotalLength))));
+	}
+
+	void TexCoord(uint32_t x, uint32_t y, float& u, float& v) const
+	{
+		u = float(x) / float(OutputWidth) + 0.5f / float(OutputWidth);
+		v = float(y) / float(OutputHeight) + 0.5f / float(OutputHeight);
+	}
+
+	static glm::vec3 Lerp(glm::vec3 a, glm::vec3 b, float t)
+	{
+		return a + (b - a) * t;
+	}
+
+	void Terrain(uint32_t x, uint32_t y, float* albedo, float* normalTexel) const
+	{
+		float u, v;
+		TexCoord(x, y, u, v);
+		float heightCenter = Sample(Maps.Heights, Maps.Width, Maps.Height, u, v);
+
+		glm::vec3 normal = FindNormal(u, v, false);
+		glm::vec3 mapVal = glm::vec3(normal.x, normal.z, normal.y) * 0.5f + glm::vec3(0.5f);
+		normalTexel[0] = mapVal.x, normalTexel[1] = mapVal.y, normalTexel[2] = mapVal.z, normalTexel[3] = 0.0f;
+
+		glm::vec3 sandColor(194.0f / 255.0f, 178.0f / 255.0f, 128.0f / 255.0f);
+		glm::vec3 grassColor(6.0f / 255.0f, 77.0f / 255.0f, 10.0f / 255.0f);
+		glm::vec3 snowColor(0.9f, 0.9f, 0.9f);
+
+		float waterHeight = 0.3f;
+		float transitionDist = 0.05f;
+		float grassHeight = 0.7f;
+		float snowHeight = 1.0f;
+
+		float slope = std::asin(std::sqrt(std::max(0.0f, 1.0f - normal.y * normal.y)));
+
+		glm::vec3 surfaceColor;
+		heightCenter /= 100.0f;
+		if (heightCenter < waterHeight)
+			surfaceColor = sandColor;
+		else if (heightCenter < waterHeight + transitionDist)
+			surfaceColor = Lerp(sandColor, grassColor, (heightCenter - waterHeight) / transitionDist);
+		else if (heightCenter < grassHeight)
+			surfaceColor = grassColor;
+		else
+			surfaceColor = Lerp(grassColor, snowColor, (heightCenter - grassHeight) / (snowHeight - grassHeight));
+		float slopeMin = 50.0f / 180.0f;
+		surfaceColor = Lerp(surfaceColor, glm::vec3(0.25f),
+							std::max(0.0f, slope / (std::numbers::pi_v<float> / 2) - slopeMin) / (1.0f - slopeMin));
+		// Stored in UNORM
+		for (int c = 0; c < 3; c++)
+			albedo[c] = std::clamp(surfaceColor[c], 0.0f, 1.0f);
+		albedo[3] = 1.0f;
+	}
+
+	void Water(uint32_t x, uint32_t y, float* albedo, float* normalTexel) const
+	{
+		float u, v;
+		TexCoord(x, y, u, v);
+		float water = Sample(Maps.Water, Maps.Width, Maps.Height, u, v);
+
+		glm::vec3 waterNormal = FindNormal(u, v, true);
+		waterNormal = glm::vec3(waterNormal.x, waterNormal.z, waterNormal.y) * 0.5f + glm::vec3(0.5f);
+		normalTexel[0] = waterNormal.x, normalTexel[1] = waterNormal.y, normalTexel[2] = waterNormal.z;
+		normalTexel[3] = 0.0f;
+
+		float sediment = Sample(Maps.Sediment, Maps.Width, Maps.Height, u, v);
+		glm::vec3 waterCol =
+			Lerp(glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f), std::clamp(sediment, 0.0f, 1.0f));
+		albedo[0] = waterCol.x, albedo[1] = waterCol.y, albedo[2] = waterCol.z;
+		albedo[3] = water > 0.05f ? 1.0f : 0.0f;
+	}
+};
+
+struct Maps
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<float> Heights, Water, Sediment;
+
+	TerrainMaterialMaps View(float totalLength) const
+	{
+		return {Width, Height, Heights, Water, Sediment, totalLength};
+	}
+};
+
+Maps CreateMaps(uint32_t width, uint32_t height, auto const& heights, float water, float sediment)
+{
+	Maps maps;
+	maps.Width = width;
+	maps.Height = height;
+	for (uint32_t y = 0; y < height; y++)
+		for (uint32_t x = 0; x < width; x++)
+			maps.Heights.push_back(heights(float(x), float(y)));
+	maps.Water.assign(maps.Heights.size(), water);
+	maps.Sediment.assign(maps.Heights.size(), sediment);
+	return maps;
+}
+
+// Largest difference of mip 0 of both materials from the reference, over every channel of every texel
+float LargestDifference(TerrainMaterialMaps const& maps, uint32_t outputWidth, uint32_t outputHeight)
+{
+	MaterialTexture albedo(outputWidth, outputHeight), normal(outputWidth, outputHeight);
+	MaterialTexture waterAlbedo(outputWidth, outputHeight), waterNormal(outputWidth, outputHeight);
+	BakeTerrainMaterial(maps, albedo, normal, 3);
+	BakeWaterMaterial(maps, waterAlbedo, waterNormal, 3);
+
+	ShaderReference reference{maps, outputWidth, outputHeight};
+	float largest = 0.0f;
+	for (uint32_t y = 0; y < outputHeight; y++)
+		for (uint32_t x = 0; x < outputWidth; x++)
+		{
+			float texels[4][4];
+			reference.Terrain(x, y, texels[0], texels[1]);
+			reference.Water(x, y, texels[2], texels[3]);
+			MaterialTexture const* baked[] = {&albedo, &normal, &waterAlbedo, &waterNormal};
+			for (int texture = 0; texture < 4; texture++)
+				for (int c = 0; c < 4; c++)
+				{
+					float value = baked[texture]->Mips[0][(x + size_t(y) * outputWidth) * 4 + c];
+					largest = std::max(largest, std::abs(value - texels[texture][c]));
+				}
+		}
+	return largest;
+}
+
+// Texel (x, y) of mip 0
+float const* Texel(MaterialTexture const& texture, uint32_t x, uint32_t y)
+{
+	return texture.Mips[0].data() + (x + size_t(y) * texture.Width) * 4;
+}
+
+} // namespace
+
+RAD_TEST(TerrainMaterialBaker, MatchesTheShadersPerTexel)
+{
+	// Hills crossing every colour band with cliffs, water that comes and goes and sediment past saturation, baked at
+	// the map's size, larger and smaller than it
+	std::mt19937 generator(11);
+	std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+	uint32_t width = 37, height = 29;
+	auto maps = CreateMaps(width, height,
+						   [&](float x, float y) { return 55.0f + 45.0f * std::sin(x * 0.4f) * std::cos(y * 0.3f); },
+						   0.0f, 0.0f);
+	for (size_t i = 0; i < maps.Heights.size(); i++)
+	{
+		maps.Heights[i] += noise(generator) * (i % 7 == 0 ? 20.0f : 1.0f);
+		maps.Water[i] = std::max(0.0f, noise(generator) * 0.2f);
+		maps.Sediment[i] = noise(generator) + 0.5f;
+	}
+	for (float totalLength : {8.0f, 200.0f})
+		for (auto [outputWidth, outputHeight] : {std::pair(37u, 29u), std::pair(64u, 48u), std::pair(20u, 13u)})
+			RAD_CHECK(LargestDifference(maps.View(totalLength), outputWidth, outputHeight) < 1e-4f);
+}
+
+RAD_TEST(TerrainMaterialBaker, FlatTerrainTakesTheColourOfItsHeight)
+{
+	float const sand[3] = {194.0f / 255.0f, 178.0f / 255.0f, 128.0f / 255.0f};
+	float const grass[3] = {6.0f / 255.0f, 77.0f / 255.0f, 10.0f / 255.0f};
+	// Heights are in hundredths: sand below 30, half way to grass at 32.5, grass from 35 to 70, half way to snow at 85
+	struct Band
+	{
+		float Height;
+		float Color[3];
+	} bands[] = {
+		{10.0f, {sand[0], sand[1], sand[2]}},
+		{32.5f, {(sand[0] + grass[0]) / 2, (sand[1] + grass[1]) / 2, (sand[2] + grass[2]) / 2}},
+		{50.0f, {grass[0], grass[1], grass[2]}},
+		{85.0f, {(grass[0] + 0.9f) / 2, (grass[1] + 0.9f) / 2, (grass[2] + 0.9f) / 2}},
+	};
+	for (Band const& band : bands)
+	{
+		auto maps = CreateMaps(16, 16, [&](float, float) { return band.Height; }, 0.0f, 0.0f);
+		MaterialTexture albedo(16, 16), normal(16, 16);
+		BakeTerrainMaterial(maps.View(100.0f), albedo, normal);
+		for (uint32_t c = 0; c < 3; c++)
+			RAD_CHECK_NEAR(Texel(albedo, 5, 9)[c], band.Color[c], 1e-5);
+		RAD_CHECK_EQ(Texel(albedo, 5, 9)[3], 1.0f);
+		// Straight up, in the xzy encoding
+		RAD_CHECK_NEAR(Texel(normal, 5, 9)[0], 0.5f, 1e-6);
+		RAD_CHECK_NEAR(Texel(normal, 5, 9)[1], 0.5f, 1e-6);
+		RAD_CHECK_NEAR(Texel(normal, 5, 9)[2], 1.0f, 1e-6);
+	}
+}
+
+RAD_TEST(TerrainMaterialBaker, SlopesPastFiftyDegreesTurnToRock)
+{
+	float const grass[3] = {6.0f / 255.0f, 77.0f / 255.0f, 10.0f / 255.0f};
+	// A ramp rising along x over grass, map texels a quarter unit apart
+	uint32_t size = 32;
+	float spacing = 0.25f;
+	for (float degrees : {30.0f, 50.0f, 60.0f, 75.0f})
+	{
+		float angle = degrees * std::numbers::pi_v<float> / 180.0f;
+		float rise = std::tan(angle) * spacing;
+		auto maps = CreateMaps(size, size, [&](float x, float) { return 40.0f + x * rise; }, 0.0f, 0.0f);
+		MaterialTexture albedo(size, size), normal(size, size);
+		BakeTerrainMaterial(maps.View(size * spacing), albedo, normal);
+
+		// Rock blends in linearly from 50 degrees to all rock at 90
+		float rock = std::max(0.0f, degrees / 90.0f - 50.0f / 180.0f) / (1.0f - 50.0f / 180.0f);
+		for (uint32_t c = 0; c < 3; c++)
+			RAD_CHECK_NEAR(Texel(albedo, 16, 16)[c], grass[c] + (0.25f - grass[c]) * rock, 1e-4);
+		// The normal tips over along x, its y is the cosine of the slope
+		RAD_CHECK_NEAR(Texel(normal, 16, 16)[0], 0.5f + std::sin(angle) * 0.5f, 1e-4);
+		RAD_CHECK_NEAR(Texel(normal, 16, 16)[1], 0.5f, 1e-6);
+		RAD_CHECK_NEAR(Texel(normal, 16, 16)[2], 0.5f + std::cos(angle) * 0.5f, 1e-4);
+	}
+}
+
+RAD_TEST(TerrainMaterialBaker, WaterShowsPastItsDepthAndReddensWithSediment)
+{
+	struct Case
+	{
+		float Water, Sediment;
+		float Color[4];
+	} cases[] = {
+		{0.0f, 0.0f, {0.0f, 0.0f, 1.0f, 0.0f}},
+		{0.04f, 0.5f, {0.5f, 0.0f, 0.5f, 0.0f}},
+		{0.06f, 0.25f, {0.25f, 0.0f, 0.75f, 1.0f}},
+		{3.0f, 2.0f, {1.0f, 0.0f, 0.0f, 1.0f}},
+		{3.0f, -1.0f, {0.0f, 0.0f, 1.0f, 1.0f}},
+	};
+	for (Case const& test : cases)
+	{
+		auto maps = CreateMaps(16, 16, [](float x, float) { return 20.0f + x; }, test.Water, test.Sediment);
+		MaterialTexture albedo(16, 16), normal(16, 16);
+		BakeWaterMaterial(maps.View(16.0f), albedo, normal);
+		for (uint32_t c = 0; c < 4; c++)
+			RAD_CHECK_NEAR(Texel(albedo, 7, 3)[c], test.Color[c], 1e-6);
+		// An even depth of water follows the ground under it, 45 degrees here
+		RAD_CHECK_NEAR(Texel(normal, 7, 3)[0], 0.5f + std::sqrt(0.5f) * 0.5f, 1e-4);
+		RAD_CHECK_NEAR(Texel(normal, 7, 3)[2], 0.5f + std::sqrt(0.5f) * 0.5f, 1e-4);
+	}
+}
+
+RAD_TEST(TerrainMaterialBaker, MipsAverageTheirTexels)
+{
+	// 5 x 3 clamps its last column and row: mip 1 is 2 x 1 from the first 4 x 2, mip 2 averages that row
+	MaterialTexture texture(5, 3);
+	RAD_CHECK_EQ(texture.Mips.size(), 3u);
+	for (size_t i = 0; i < texture.Mips[0].size(); i++)
+		texture.Mips[0][i] = float(i / 4);
+	GenerateMaterialMips(texture);
+	RAD_CHECK_EQ(texture.Mips[1].size(), 2u * 1u * 4u);
+	RAD_CHECK_NEAR(texture.Mips[1][0], (0.0f + 1.0f + 5.0f + 6.0f) / 4, 1e-6);
+	RAD_CHECK_NEAR(texture.Mips[1][4], (2.0f + 3.0f + 7.0f + 8.0f) / 4, 1e-6);
+	RAD_CHECK_NEAR(texture.Mips[2][0], (3.0f + 5.0f) / 2, 1e-6);
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+A test is a function registered in a group with RAD_TEST, every file registers its cases in one group named after it.
+Checks report and keep going, so one run lists every failing case.
+
+	radTests [group]
+*/
+
+namespace rad::test
+{
+
+struct TestCase
+{
+	char const* Group;
+	char const* Name;
+	void (*Run)();
+};
+
+std::vector<TestCase>& Registry();
+void ReportFailure(char const* file, int line, std::string const& message);
+
+struct Registrar
+{
+	Registrar(char const* group, char const* name, void (*run)())
+	{
+		Registry().push_back({group, name, run});
+	}
+};
+
+} // namespace rad::test
+
+#define RAD_TEST(group, name)                                                                                          \
+	static void group##_##name();                                                                                      \
+	static rad::test::Registrar group##_##name##_Registrar(#group, #name, group##_##name);                             \
+	static void group##_##name()
+
+#define RAD_CHECK(condition)                                                                                           \
+	do                                                                                                                 \
+	{                                                                                                                  \
+		if (!(condition))                                                                                              \
+			rad::test::ReportFailure(__FILE__, __LINE__, #condition);                                                  \
+	} while (false)
+
+#define RAD_CHECK_EQ(a, b)                                                                                             \
+	do                                                                                                                 \
+	{                                                                                                                  \
+		auto const& radCheckA = (a);                                                                                   \
+		auto const& radCheckB = (b);                                                                                   \
+		if (!(radCheckA == radCheckB))                                                                                 \
+		{                                                                                                              \
+			std::ostringstream radCheckMessage;                                                                        \
+			radCheckMessage << #a " == " #b " (" << radCheckA << " vs " << radCheckB << ")";                          \
+			rad::test::ReportFailure(__FILE__, __LINE__, radCheckMessage.str());                                       \
+		}                                                                                                              \
+	} while (false)
+
+#define RAD_CHECK_NEAR(a, b, tolerance)                                                                                \
+	do                                                                                                                 \
+	{                                                                                                                  \
+		double radCheckA = double(a);                                                                                  \
+		double radCheckB = double(b);                                                                                  \
+		if (!(std::abs(radCheckA - radCheckB) <= double(tolerance)))                                                   \
+		{                                                                                                              \
+			std::ostringstream radCheckMessage;                                                                        \
+			radCheckMessage << #a " ~= " #b " (" << radCheckA << " vs " << radCheckB << ", tolerance " << (tolerance)  \
+							<< ")";                                                                                    \
+			rad::test::ReportFailure(__FILE__, __LINE__, radCheckMessage.str());                                       \
+		}                                                                                                              \
+	} while (false)
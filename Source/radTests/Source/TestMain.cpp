@@ -0,0 +1,55 @@
+#include "Test.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace rad::test
+{
+
+namespace
+{
+
+uint32_t FailureCount = 0;
+
+} // namespace
+
+std::vector<TestCase>& Registry()
+{
+	static std::vector<TestCase> registry;
+	return registry;
+}
+
+void ReportFailure(char const* file, int line, std::string const& message)
+{
+	std::cerr << file << "(" << line << "): check failed: " << message << "\n";
+	FailureCount++;
+}
+
+} // namespace rad::test
+
+int main(int argc, char** argv)
+{
+	using namespace rad::test;
+
+	char const* group = argc > 1 ? argv[1] : nullptr;
+	uint32_t ranCount = 0, failedCount = 0;
+	for (TestCase const& test : Registry())
+	{
+		if (group && std::strcmp(group, test.Group) != 0)
+			continue;
+		uint32_t failuresBefore = FailureCount;
+		test.Run();
+		ranCount++;
+		bool failed = FailureCount != failuresBefore;
+		failedCount += failed;
+		std::cerr << (failed ? "FAILED " : "passed ") << test.Group << "." << test.Name << "\n";
+	}
+
+	if (ranCount == 0)
+	{
+		std::cerr << "No tests in group " << (group ? group : "") << "\n";
+		return 1;
+	}
+	std::cerr << ranCount - failedCount << "/" << ranCount << " passed\n";
+	return failedCount ? 1 : 0;
+}
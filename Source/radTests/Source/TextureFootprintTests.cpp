@@ -0,0 +1,145 @@
+#include "Test.h"
+
+#include "Graphics/TextureFootprint.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace rad;
+
+namespace
+{
+
+// Image of width x height texels whose bytes count up, so every misplaced byte shows
+std::vector<std::byte> CreateImage(uint32_t width, uint32_t height, uint32_t bytesPerPixel)
+{
+	std::vector<std::byte> image(size_t(width) * height * bytesPerPixel);
+	for (size_t i = 0; i < image.size(); i++)
+		image[i] = std::byte(i * 7 + i / 251);
+	return image;
+}
+
+// Compares every row of a staging copy to the region at (x, y) of the source image, and the padding to fill
+bool MatchesRegion(std::span<const std::byte> staging, TextureRegionFootprint const& footprint,
+				   std::span<const std::byte> image, uint64_t imageRowPitch, uint32_t x, uint32_t y,
+				   uint32_t bytesPerPixel, std::byte fill)
+{
+	for (uint32_t row = 0; row < footprint.Height; row++)
+	{
+		auto stagingRow = staging.subspan(row * footprint.RowPitch, footprint.RowBytes);
+		auto imageRow = image.subspan((y + row) * imageRowPitch + uint64_t(x) * bytesPerPixel, footprint.RowBytes);
+		if (!std::ranges::equal(stagingRow, imageRow))
+			return false;
+		if (row + 1 < footprint.Height)
+		{
+			auto padding = staging.subspan(row * footprint.RowPitch + footprint.RowBytes,
+										   footprint.RowPitch - footprint.RowBytes);
+			if (!std::ranges::all_of(padding, [fill](std::byte value) { return value == fill; }))
+				return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+RAD_TEST(TextureFootprint, PitchIsAligned)
+{
+	struct Case
+	{
+		uint32_t Width, BytesPerPixel;
+		uint64_t RowPitch;
+	};
+	Case cases[] = {{1, 4, 256}, {64, 4, 256}, {65, 4, 512}, {256, 1, 256}, {257, 1, 512}, {3, 16, 256},
+					{1024, 16, 16384}, {1000, 12, 12032}};
+	for (Case const& c : cases)
+	{
+		auto footprint = ComputeRegionFootprint(c.Width, 5, c.BytesPerPixel);
+		RAD_CHECK_EQ(footprint.RowBytes, uint64_t(c.Width) * c.BytesPerPixel);
+		RAD_CHECK_EQ(footprint.RowPitch, c.RowPitch);
+		RAD_CHECK_EQ(footprint.RowPitch % TextureDataPitchAlignment, 0u);
+		// The last row is not padded
+		RAD_CHECK_EQ(footprint.TotalBytes, c.RowPitch * 4 + footprint.RowBytes);
+	}
+}
+
+RAD_TEST(TextureFootprint, EmptyRegion)
+{
+	RAD_CHECK_EQ(ComputeRegionFootprint(0, 16, 4).TotalBytes, 0u);
+	RAD_CHECK_EQ(ComputeRegionFootprint(16, 0, 4).TotalBytes, 0u);
+
+	// Nothing is read or written
+	auto footprint = ComputeRegionFootprint(16, 0, 4);
+	CopyRegionRows(footprint, {}, 64, nullptr);
+}
+
+RAD_TEST(TextureFootprint, CopiesTightRows)
+{
+	uint32_t width = 37, height = 11, bytesPerPixel = 4;
+	auto image = CreateImage(width, height, bytesPerPixel);
+	auto footprint = ComputeRegionFootprint(width, height, bytesPerPixel);
+	std::vector<std::byte> staging(footprint.TotalBytes, std::byte(0xCD));
+	CopyRegionRows(footprint, image, footprint.RowBytes, staging.data());
+	RAD_CHECK(MatchesRegion(staging, footprint, image, footprint.RowBytes, 0, 0, bytesPerPixel, std::byte(0xCD)));
+}
+
+RAD_TEST(TextureFootprint, CopiesAlreadyPitchedRows)
+{
+	// A source laid out like the staging buffer goes in one copy, padding included
+	uint32_t width = 64, height = 9, bytesPerPixel = 4;
+	auto footprint = ComputeRegionFootprint(width, height, bytesPerPixel);
+	auto image = CreateImage(uint32_t(footprint.RowPitch / bytesPerPixel), height, bytesPerPixel);
+	std::vector<std::byte> staging(footprint.TotalBytes);
+	CopyRegionRows(footprint, std::span(image).first(footprint.TotalBytes), footprint.RowPitch, staging.data());
+	RAD_CHECK(std::ranges::equal(staging, std::span(image).first(footprint.TotalBytes)));
+}
+
+RAD_TEST(TextureFootprint, CopiesSubRegion)
+{
+	// The region starts inside a larger image and reads it with the image's pitch
+	uint32_t imageWidth = 300, imageHeight = 40, bytesPerPixel = 2;
+	auto image = CreateImage(imageWidth, imageHeight, bytesPerPixel);
+	uint64_t imagePitch = uint64_t(imageWidth) * bytesPerPixel;
+	struct Region
+	{
+		uint32_t X, Y, Width, Height;
+	};
+	Region regions[] = {{0, 0, 300, 40}, {1, 1, 1, 1}, {17, 5, 129, 30}, {299, 39, 1, 1}, {200, 0, 100, 40}};
+	for (Region const& region : regions)
+	{
+		auto footprint = ComputeRegionFootprint(region.Width, region.Height, bytesPerPixel);
+		auto source = std::span<const std::byte>(image).subspan(region.Y * imagePitch + region.X * bytesPerPixel);
+		std::vector<std::byte> staging(footprint.TotalBytes, std::byte(0xAB));
+		CopyRegionRows(footprint, source, imagePitch, staging.data());
+		RAD_CHECK(MatchesRegion(staging, footprint, image, imagePitch, region.X, region.Y, bytesPerPixel,
+								std::byte(0xAB)));
+	}
+}
+
+RAD_TEST(TextureFootprint, MipChain)
+{
+	// Every level of a 1000x300 RGBA32F chain, down to 1x1
+	uint32_t width = 1000, height = 300, bytesPerPixel = 16;
+	for (uint32_t mip = 0; (width >> mip) || (height >> mip); mip++)
+	{
+		uint32_t mipWidth = std::max(1u, width >> mip), mipHeight = std::max(1u, height >> mip);
+		auto footprint = ComputeRegionFootprint(mipWidth, mipHeight, bytesPerPixel);
+		RAD_CHECK_EQ(footprint.Width, mipWidth);
+		RAD_CHECK_EQ(footprint.Height, mipHeight);
+		RAD_CHECK_EQ(footprint.RowPitch, AlignUp(uint64_t(mipWidth) * bytesPerPixel, TextureDataPitchAlignment));
+
+		auto image = CreateImage(mipWidth, mipHeight, bytesPerPixel);
+		std::vector<std::byte> staging(footprint.TotalBytes, std::byte(0xEF));
+		CopyRegionRows(footprint, image, footprint.RowBytes, staging.data());
+		RAD_CHECK(MatchesRegion(staging, footprint, image, footprint.RowBytes, 0, 0, bytesPerPixel, std::byte(0xEF)));
+	}
+}
+
+RAD_TEST(TextureFootprint, AlignUp)
+{
+	RAD_CHECK_EQ(AlignUp(0, 256), 0u);
+	RAD_CHECK_EQ(AlignUp(1, 256), 256u);
+	RAD_CHECK_EQ(AlignUp(256, 256), 256u);
+	RAD_CHECK_EQ(AlignUp(257, 512), 512u);
+	RAD_CHECK_EQ(AlignUp(1000, 16), 1008u);
+}
@@ -0,0 +1,109 @@
+#include "Test.h"
+
+#include "ProcGen/ThermalErosionReference.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace rad;
+using namespace rad::proc;
+
+namespace
+{
+
+struct ThermalMap
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<float> Heights;
+	std::vector<float> Softness;
+};
+
+// Steep noise so most cells are over the talus angle, with a few flat plateaus where nothing moves
+ThermalMap CreateRandomMap(uint32_t width, uint32_t height, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> heightDistribution(0.0f, 50.0f);
+	std::uniform_real_distribution<float> softnessDistribution(0.0f, 1.0f);
+	size_t cellCount = size_t(width) * height;
+	ThermalMap map{.Width = width, .Height = height, .Heights = std::vector<float>(cellCount),
+				   .Softness = std::vector<float>(cellCount)};
+	for (size_t i = 0; i < map.Heights.size(); i++)
+	{
+		map.Heights[i] = i % 7 == 0 && i > 0 ? map.Heights[i - 1] : heightDistribution(generator);
+		map.Softness[i] = softnessDistribution(generator);
+	}
+	return map;
+}
+
+double Sum(std::span<const float> values)
+{
+	double sum = 0.0;
+	for (float value : values)
+		sum += value;
+	return sum;
+}
+
+} // namespace
+
+RAD_TEST(ThermalErosion, GatherMatchesScatter)
+{
+	hlsl::ThermalErosionResources settings{};
+	uint32_t sizes[][2] = {{1, 1}, {2, 3}, {17, 5}, {64, 64}, {129, 200}};
+	for (uint32_t seed = 0; seed < 4; seed++)
+		for (auto [width, height] : sizes)
+		{
+			ThermalMap map = CreateRandomMap(width, height, seed);
+			settings.PipeLength = 0.5f + seed * 0.5f;
+			std::vector<float> scattered = map.Heights, gathered = map.Heights;
+			std::vector<float> scatterOut(map.Heights.size()), gatherOut(map.Heights.size());
+			// Several steps, so the comparison also covers maps that erosion has already smoothed
+			float maxDifference = 0.0f;
+			for (int step = 0; step < 8; step++)
+			{
+				ThermalErosionScatter(scattered, map.Softness, width, height, settings, scatterOut);
+				ThermalErosionGather(gathered, map.Softness, width, height, settings, gatherOut);
+				std::swap(scattered, scatterOut);
+				std::swap(gathered, gatherOut);
+				for (size_t i = 0; i < scattered.size(); i++)
+					maxDifference = std::max(maxDifference, std::abs(scattered[i] - gathered[i]));
+			}
+			RAD_CHECK_NEAR(maxDifference, 0.0f, 1e-3f);
+		}
+}
+
+RAD_TEST(ThermalErosion, ConservesMaterial)
+{
+	hlsl::ThermalErosionResources settings{};
+	ThermalMap map = CreateRandomMap(96, 80, 7);
+	std::vector<float> out(map.Heights.size());
+	double before = Sum(map.Heights);
+
+	ThermalErosionScatter(map.Heights, map.Softness, map.Width, map.Height, settings, out);
+	RAD_CHECK_NEAR(Sum(out), before, before * 1e-6);
+	ThermalErosionGather(map.Heights, map.Softness, map.Width, map.Height, settings, out);
+	RAD_CHECK_NEAR(Sum(out), before, before * 1e-6);
+}
+
+RAD_TEST(ThermalErosion, FlatMapDoesNotMove)
+{
+	hlsl::ThermalErosionResources settings{};
+	std::vector<float> heights(32 * 32, 3.0f), softness(heights.size(), 1.0f), out(heights.size());
+	ThermalErosionGather(heights, softness, 32, 32, settings, out);
+	RAD_CHECK(out == heights);
+	ThermalErosionScatter(heights, softness, 32, 32, settings, out);
+	RAD_CHECK(out == heights);
+}
+
+RAD_TEST(ThermalErosion, ThreadCountDoesNotChangeResult)
+{
+	hlsl::ThermalErosionResources settings{};
+	ThermalMap map = CreateRandomMap(100, 77, 3);
+	std::vector<float> single(map.Heights.size()), threaded(map.Heights.size());
+	ThermalErosionGather(map.Heights, map.Softness, map.Width, map.Height, settings, single, 1);
+	ThermalErosionGather(map.Heights, map.Softness, map.Width, map.Height, settings, threaded, 4);
+	RAD_CHECK(single == threaded);
+	ThermalErosionScatter(map.Heights, map.Softness, map.Width, map.Height, settings, single, 1);
+	ThermalErosionScatter(map.Heights, map.Softness, map.Width, map.Height, settings, threaded, 4);
+	RAD_CHECK(single == threaded);
+}
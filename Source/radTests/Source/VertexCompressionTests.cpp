@@ -0,0 +1,208 @@
+#include "Test.h"
+
+#include "Graphics/VertexCompression.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+using namespace rad;
+
+namespace
+{
+
+glm::vec3 RandomDirection(std::mt19937& generator)
+{
+	std::normal_distribution<float> normal;
+	glm::vec3 direction;
+	do
+		direction = {normal(generator), normal(generator), normal(generator)};
+	while (glm::dot(direction, direction) < 1e-6f);
+	return glm::normalize(direction);
+}
+
+// Positions over uneven extents, texture coordinates from tiny to tiling
+std::vector<Vertex> CreateRandomVertices(size_t count, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> x(-50.0f, 80.0f), y(-3.0f, 3.0f), z(0.0f, 1000.0f);
+	std::uniform_real_distribution<float> exponent(-20.0f, 3.0f);
+	std::vector<Vertex> vertices(count);
+	for (Vertex& vertex : vertices)
+	{
+		vertex.Position = {x(generator), y(generator), z(generator)};
+		vertex.Normal = RandomDirection(generator);
+		vertex.Tangent = RandomDirection(generator);
+		float u = std::exp2(exponent(generator)), v = std::exp2(exponent(generator));
+		vertex.TexCoord = {generator() % 2 ? u : -u, generator() % 2 ? v : -v};
+	}
+	return vertices;
+}
+
+// atan2 of the cross and dot products keeps precision for the tiny angles this is used on
+double AngleDegrees(glm::vec3 a, glm::vec3 b)
+{
+	glm::vec3 cross = glm::cross(a, b);
+	double sine = std::sqrt(double(cross.x) * cross.x + double(cross.y) * cross.y + double(cross.z) * cross.z);
+	double cosine = double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z;
+	return std::atan2(sine, cosine) * 180.0 / 3.14159265358979;
+}
+
+// Whether half is the half closest to value, ties going to the even one
+bool IsNearestHalf(float value, uint32_t half)
+{
+	float decoded = hlsl::f16tof32(half);
+	if (std::isnan(value))
+		return std::isnan(decoded);
+	if (std::abs(value) >= 65520.0f)
+		return std::isinf(decoded) && std::signbit(decoded) == std::signbit(value);
+	if (std::signbit(decoded) != std::signbit(value) && decoded != 0.0f)
+		return false;
+	double error = std::abs(double(value) - decoded);
+	// Neighbours in the same sign, larger and smaller in magnitude
+	uint32_t magnitude = half & 0x7FFF;
+	for (uint32_t neighbour : {magnitude + 1, magnitude - 1})
+	{
+		if (neighbour >= 0x7C00)
+			continue;
+		double neighbourError = std::abs(std::abs(double(value)) - hlsl::f16tof32(neighbour));
+		if (neighbourError < error || (neighbourError == error && (half & 1)))
+			return false;
+	}
+	return true;
+}
+
+} // namespace
+
+RAD_TEST(VertexCompression, CompactVertexWithinErrorBounds)
+{
+	auto vertices = CreateRandomVertices(200000, 1);
+	CompactVertexBounds bounds = ComputeCompactVertexBounds(vertices);
+	std::vector<hlsl::CompactVertex> encoded(vertices.size());
+	EncodeCompactVertices(vertices, bounds, encoded);
+
+	double worstSteps = 0.0, worstNormal = 0.0, worstTangent = 0.0;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		Vertex const& vertex = vertices[i];
+		hlsl::CompactVertex const& compact = encoded[i];
+
+		glm::vec3 position =
+			hlsl::DecodeCompactPosition(compact.PositionXY, compact.PositionZ, bounds.Min, bounds.Extent);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			double step = bounds.Extent[axis] / 65535.0;
+			// Float rounding of the decode, a few units in the last place of the largest coordinate
+			double largest = std::max(std::abs(bounds.Min[axis]), std::abs(bounds.Min[axis] + bounds.Extent[axis]));
+			double rounding = 4.0 * largest * std::numeric_limits<float>::epsilon();
+			double error = std::abs(double(position[axis]) - vertex.Position[axis]);
+			RAD_CHECK(error <= 0.5 * step + rounding);
+			worstSteps = std::max(worstSteps, error / step);
+		}
+
+		double normalError = AngleDegrees(hlsl::DecodeCompactNormal(compact.Normal), vertex.Normal);
+		glm::vec4 tangent = hlsl::DecodeCompactTangent(compact.Tangent);
+		double tangentError = AngleDegrees(glm::vec3(tangent), vertex.Tangent);
+		RAD_CHECK(normalError <= 0.006);
+		RAD_CHECK(tangentError <= 0.01);
+		RAD_CHECK_EQ(tangent.w, 1.0f);
+		worstNormal = std::max(worstNormal, normalError);
+		worstTangent = std::max(worstTangent, tangentError);
+
+		glm::vec2 texCoord = hlsl::DecodeCompactTexCoord(compact.TexCoord);
+		for (int axis = 0; axis < 2; axis++)
+		{
+			double value = vertex.TexCoord[axis];
+			// Relative for normal halves, absolute below the smallest one
+			double tolerance = std::max(std::abs(value) * std::exp2(-11.0), std::exp2(-25.0));
+			RAD_CHECK(std::abs(texCoord[axis] - value) <= tolerance);
+		}
+	}
+	// Not looser than the rounding allows either
+	RAD_CHECK(worstSteps > 0.45 && worstNormal > 0.002 && worstTangent > 0.003);
+}
+
+RAD_TEST(VertexCompression, FloatLayoutKeepsPositions)
+{
+	auto vertices = CreateRandomVertices(3000, 2);
+	std::vector<hlsl::CompactVertex> compact(vertices.size());
+	std::vector<hlsl::CompactVertexFloat> compactFloat(vertices.size());
+	EncodeCompactVertices(vertices, ComputeCompactVertexBounds(vertices), compact);
+	EncodeCompactVertices(vertices, compactFloat);
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		RAD_CHECK(compactFloat[i].Position == vertices[i].Position);
+		RAD_CHECK(compactFloat[i].Normal == compact[i].Normal && compactFloat[i].Tangent == compact[i].Tangent);
+		RAD_CHECK_EQ(compactFloat[i].TexCoord, compact[i].TexCoord);
+	}
+}
+
+RAD_TEST(VertexCompression, DirectionsOnTheOctahedronFolds)
+{
+	float nan = std::numeric_limits<float>::quiet_NaN();
+	std::vector<Vertex> vertices;
+	// The axes, then directions in the -z half, which is folded over the corners
+	glm::vec3 directions[] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1},
+							  {1, 1, -1}, {-1, 1, -1}, {1, -1, -1}, {-1, -1, -1}, {0.6f, 0.0f, -0.8f},
+							  {0.0f, -0.6f, -0.8f}};
+	for (glm::vec3 direction : directions)
+		vertices.push_back({.Position = {}, .Normal = direction, .TexCoord = {}, .Tangent = direction});
+	// Zero and NaN directions come back as +z
+	vertices.push_back({.Position = {}, .Normal = {}, .TexCoord = {}, .Tangent = {}});
+	vertices.push_back({.Position = {}, .Normal = {nan, 0.0f, 1.0f}, .TexCoord = {}, .Tangent = {nan, nan, nan}});
+
+	std::vector<hlsl::CompactVertexFloat> encoded(vertices.size());
+	EncodeCompactVertices(vertices, encoded);
+	for (size_t i = 0; i < std::size(directions); i++)
+	{
+		RAD_CHECK(AngleDegrees(hlsl::DecodeCompactNormal(encoded[i].Normal), directions[i]) <= 0.006);
+		RAD_CHECK(AngleDegrees(glm::vec3(hlsl::DecodeCompactTangent(encoded[i].Tangent)), directions[i]) <= 0.01);
+	}
+	for (size_t i = std::size(directions); i < vertices.size(); i++)
+	{
+		RAD_CHECK(hlsl::DecodeCompactNormal(encoded[i].Normal) == glm::vec3(0.0f, 0.0f, 1.0f));
+		RAD_CHECK(glm::vec3(hlsl::DecodeCompactTangent(encoded[i].Tangent)) == glm::vec3(0.0f, 0.0f, 1.0f));
+	}
+}
+
+RAD_TEST(VertexCompression, HalvesRoundToNearestEven)
+{
+	// Every float exponent, denormals, infinities and NaNs included, with a spread of mantissas. Halfway cases between
+	// two halves are hit by the mantissas whose low 13 bits are 0x1000.
+	std::vector<Vertex> vertices;
+	for (uint64_t bits = 0; bits <= 0xFFFFFFFFull; bits += 65521)
+		for (uint32_t low : {0u, 0x1000u, 0x0FFFu, 0x1001u})
+		{
+			float value = std::bit_cast<float>(uint32_t(bits & ~0x1FFFull) | low);
+			vertices.push_back({.Position = {}, .Normal = {}, .TexCoord = {value, -value}, .Tangent = {}});
+		}
+	std::vector<hlsl::CompactVertexFloat> encoded(vertices.size());
+	EncodeCompactVertices(vertices, encoded);
+	size_t failures = 0;
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		failures += !IsNearestHalf(vertices[i].TexCoord.x, encoded[i].TexCoord & 0xFFFF);
+		failures += !IsNearestHalf(vertices[i].TexCoord.y, encoded[i].TexCoord >> 16);
+	}
+	RAD_CHECK_EQ(failures, 0u);
+}
+
+RAD_TEST(VertexCompression, FlatAxisAndThreadCount)
+{
+	auto vertices = CreateRandomVertices(5000, 3);
+	for (Vertex& vertex : vertices)
+		vertex.Position.y = 2.5f;
+	CompactVertexBounds bounds = ComputeCompactVertexBounds(vertices);
+	RAD_CHECK_EQ(bounds.Extent.y, 0.0f);
+
+	std::vector<hlsl::CompactVertex> single(vertices.size()), threaded(vertices.size());
+	EncodeCompactVertices(vertices, bounds, single, 1);
+	EncodeCompactVertices(vertices, bounds, threaded, 4);
+	RAD_CHECK(std::memcmp(single.data(), threaded.data(), single.size() * sizeof(hlsl::CompactVertex)) == 0);
+	for (auto const& compact : single)
+		RAD_CHECK_EQ(hlsl::DecodeCompactPosition(compact.PositionXY, compact.PositionZ, bounds.Min, bounds.Extent).y,
+					 2.5f);
+}
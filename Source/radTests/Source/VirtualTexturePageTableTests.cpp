@@ -0,0 +1,160 @@
+#include "Test.h"
+
+#include "Graphics/VirtualTexturePageTable.h"
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <tuple>
+
+using namespace rad;
+
+namespace
+{
+
+using PageTable = VirtualTexturePageTable;
+
+// 4x4 mip 0 pages, mips 0 to 2, the single mip 2 page is pinned
+PageTable::Settings SmallTable(uint32_t physicalPageCount)
+{
+	return {.Width = 512, .Height = 512, .PageSize = 128, .PhysicalPageCount = physicalPageCount,
+			.MaxLoadsPerFrame = 16};
+}
+
+std::vector<PageTable::PageLoad> RunFrame(PageTable& table, std::initializer_list<PageTable::PageId> pages)
+{
+	table.BeginFrame();
+	for (auto page : pages)
+		table.Request(page);
+	return table.Update();
+}
+
+uint32_t EntryAt(PageTable const& table, uint32_t x, uint32_t y)
+{
+	return table.GetIndirection()[x + y * table.GetPagesX()];
+}
+
+} // namespace
+
+RAD_TEST(VirtualTexturePageTable, EvictsLeastRecentlyRequested)
+{
+	PageTable table(SmallTable(4));
+	// The pinned page and three free slots
+	RAD_CHECK_EQ(RunFrame(table, {{0, 0, 0}, {1, 0, 0}, {2, 0, 0}}).size(), 4u);
+	RunFrame(table, {{0, 0, 0}});
+	RunFrame(table, {{2, 0, 0}});
+
+	auto loads = RunFrame(table, {{3, 0, 0}});
+	RAD_CHECK_EQ(loads.size(), 1u);
+	RAD_CHECK_EQ(table.GetStats().Evicted, 1u);
+	RAD_CHECK(!table.IsResident({1, 0, 0}));
+	RAD_CHECK(table.IsResident({0, 0, 0}) && table.IsResident({2, 0, 0}) && table.IsResident({3, 0, 0}));
+	RAD_CHECK(table.IsResident({0, 0, 2}));
+
+	loads = RunFrame(table, {{1, 1, 0}});
+	RAD_CHECK(!table.IsResident({0, 0, 0}));
+	RAD_CHECK_EQ(table.GetStats().TotalEvicted, 2u);
+}
+
+RAD_TEST(VirtualTexturePageTable, KeepsPagesRequestedThisFrame)
+{
+	PageTable table(SmallTable(4));
+	auto loads = RunFrame(table, {{0, 0, 0}, {1, 0, 0}, {2, 0, 0}, {3, 0, 0}, {0, 1, 0}});
+	RAD_CHECK_EQ(loads.size(), 4u);
+	RAD_CHECK_EQ(table.GetStats().Requested, 5u);
+	RAD_CHECK_EQ(table.GetStats().Missing, 2u);
+	RAD_CHECK_EQ(table.GetStats().Evicted, 0u);
+
+	// Next frame the ones not asked for again make room
+	RunFrame(table, {{3, 0, 0}, {0, 1, 0}});
+	RAD_CHECK(table.IsResident({3, 0, 0}) && table.IsResident({0, 1, 0}));
+	RAD_CHECK_EQ(table.GetStats().Evicted, 2u);
+	RAD_CHECK_EQ(table.GetStats().Missing, 0u);
+}
+
+RAD_TEST(VirtualTexturePageTable, IndirectionFallsBackAfterEviction)
+{
+	PageTable table(SmallTable(3));
+	auto loads = RunFrame(table, {{0, 0, 1}, {1, 1, 0}});
+	RAD_CHECK_EQ(loads.size(), 3u);
+	std::map<uint32_t, uint32_t> slotOfMip;
+	for (auto const& load : loads)
+		slotOfMip[load.Page.Mip] = load.Slot;
+	// Coarse first, so the finer page already has its fallback when it lands
+	RAD_CHECK(loads[0].Page.Mip == 2 && loads[1].Page.Mip == 1 && loads[2].Page.Mip == 0);
+
+	RAD_CHECK_EQ(EntryAt(table, 1, 1), PageTable::PackEntry(slotOfMip[0], 0));
+	RAD_CHECK_EQ(EntryAt(table, 0, 1), PageTable::PackEntry(slotOfMip[1], 1));
+	RAD_CHECK_EQ(EntryAt(table, 2, 2), PageTable::PackEntry(slotOfMip[2], 2));
+
+	// Mip 0 page is the older one, it goes first and its entry falls back to the mip 1 page above it
+	RunFrame(table, {{0, 0, 1}});
+	RunFrame(table, {{3, 3, 0}});
+	RAD_CHECK(!table.IsResident({1, 1, 0}));
+	RAD_CHECK_EQ(EntryAt(table, 1, 1), PageTable::PackEntry(slotOfMip[1], 1));
+
+	// Then the mip 1 page, down to the pinned top
+	RunFrame(table, {{3, 2, 0}});
+	RAD_CHECK(!table.IsResident({0, 0, 1}));
+	for (uint32_t y = 0; y < 2; y++)
+		for (uint32_t x = 0; x < 2; x++)
+			RAD_CHECK_EQ(EntryAt(table, x, y), PageTable::PackEntry(slotOfMip[2], 2));
+}
+
+RAD_TEST(VirtualTexturePageTable, IndirectionDirtyRect)
+{
+	PageTable table(SmallTable(8));
+	// The pinned page covers the whole table
+	auto rect = table.TakeIndirectionDirtyRect();
+	RAD_CHECK(rect.X == 0 && rect.Y == 0 && rect.Width == 4 && rect.Height == 4);
+	RAD_CHECK_EQ(table.TakeIndirectionDirtyRect().Width, 0u);
+	RunFrame(table, {});
+	RAD_CHECK_EQ(table.TakeIndirectionDirtyRect().Width, 0u);
+
+	RunFrame(table, {{2, 1, 0}});
+	rect = table.TakeIndirectionDirtyRect();
+	RAD_CHECK(rect.X == 2 && rect.Y == 1 && rect.Width == 1 && rect.Height == 1);
+
+	// Grows to cover every change until taken
+	RunFrame(table, {{1, 1, 1}, {0, 3, 0}});
+	rect = table.TakeIndirectionDirtyRect();
+	RAD_CHECK(rect.X == 0 && rect.Y == 2 && rect.Width == 4 && rect.Height == 2);
+}
+
+RAD_TEST(VirtualTexturePageTable, RandomTrafficMatchesFinestResidentAncestor)
+{
+	// 16x16 mip 0 pages, a viewer wandering about and a few random requests, loads capped per frame
+	PageTable table({.Width = 2048, .Height = 2048, .PageSize = 128, .PhysicalPageCount = 40, .MaxLoadsPerFrame = 6});
+	std::mt19937 generator(4);
+	std::map<std::tuple<uint32_t, uint32_t, uint32_t>, uint32_t> slots;
+	float viewerX = 1024.0f, viewerY = 1024.0f;
+	for (int frame = 0; frame < 2000; frame++)
+	{
+		viewerX = std::clamp(viewerX + float(int(generator() % 201) - 100), 0.0f, 2048.0f);
+		viewerY = std::clamp(viewerY + float(int(generator() % 201) - 100), 0.0f, 2048.0f);
+		table.BeginFrame();
+		table.RequestByDistance(viewerX, viewerY, 50.0f, 200.0f);
+		for (int extra = 0; extra < 3; extra++)
+		{
+			uint32_t mip = generator() % table.GetMipCount();
+			table.Request({uint32_t(generator() % table.GetPagesX(mip)), uint32_t(generator() % table.GetPagesY(mip)),
+						   mip});
+		}
+		for (auto const& load : table.Update())
+			slots[{load.Page.X, load.Page.Y, load.Page.Mip}] = load.Slot;
+		if (frame % 10 == 0)
+			table.InvalidateAll();
+
+		for (uint32_t y = 0; y < table.GetPagesY(); y++)
+			for (uint32_t x = 0; x < table.GetPagesX(); x++)
+			{
+				uint32_t mip = 0;
+				while (!table.IsResident({x >> mip, y >> mip, mip}))
+					mip++;
+				uint32_t expected = PageTable::PackEntry(slots[{x >> mip, y >> mip, mip}], mip);
+				RAD_CHECK_EQ(EntryAt(table, x, y), expected);
+			}
+		RAD_CHECK(table.GetStats().Resident <= 40u);
+	}
+	RAD_CHECK(table.GetStats().TotalEvicted > 0u);
+}
@@ -0,0 +1,171 @@
+#include "Test.h"
+
+#include "ProcGen/WaterBodies.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace rad::proc;
+
+namespace
+{
+
+// Blobs of water with holes and thin bridges, so bodies cross many tile borders
+std::vector<float> CreateRandomWater(uint32_t width, uint32_t height, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::vector<float> water(size_t(width) * height, 0.0f);
+	for (int blob = 0; blob < 24; blob++)
+	{
+		int cx = int(generator() % width), cy = int(generator() % height);
+		int radius = 1 + int(generator() % 12);
+		for (int y = std::max(cy - radius, 0); y <= std::min(cy + radius, int(height) - 1); y++)
+			for (int x = std::max(cx - radius, 0); x <= std::min(cx + radius, int(width) - 1); x++)
+				if ((x - cx) * (x - cx) + (y - cy) * (y - cy) <= radius * radius)
+					water[x + y * width] = 1.0f;
+	}
+	for (float& cell : water)
+		if (generator() % 10 == 0)
+			cell = generator() % 2 ? 0.5f : 0.1f;
+	return water;
+}
+
+// Breadth-first flood fill, bodies numbered in raster order of their first cell
+std::vector<uint32_t> FloodFillLabels(std::span<const float> water, uint32_t width, uint32_t height, float threshold)
+{
+	std::vector<uint32_t> labels(water.size(), 0);
+	std::vector<uint32_t> queue;
+	uint32_t bodyCount = 0;
+	for (uint32_t start = 0; start < labels.size(); start++)
+	{
+		if (labels[start] || water[start] < threshold)
+			continue;
+		labels[start] = ++bodyCount;
+		queue.assign(1, start);
+		while (!queue.empty())
+		{
+			uint32_t cell = queue.back();
+			queue.pop_back();
+			uint32_t x = cell % width, y = cell / width;
+			uint32_t neighbours[] = {x > 0 ? cell - 1 : cell, x + 1 < width ? cell + 1 : cell,
+									 y > 0 ? cell - width : cell, y + 1 < height ? cell + width : cell};
+			for (uint32_t neighbour : neighbours)
+				if (!labels[neighbour] && water[neighbour] >= threshold)
+				{
+					labels[neighbour] = bodyCount;
+					queue.push_back(neighbour);
+				}
+		}
+	}
+	return labels;
+}
+
+// Same partition of the cells, whatever the numbering
+bool SamePartition(std::span<const uint32_t> a, std::span<const uint32_t> b)
+{
+	std::vector<uint32_t> aToB(a.size() + 1, 0), bToA(b.size() + 1, 0);
+	for (size_t i = 0; i < a.size(); i++)
+	{
+		if (!a[i] || !b[i])
+		{
+			if (a[i] || b[i])
+				return false;
+			continue;
+		}
+		if (!aToB[a[i]])
+			aToB[a[i]] = b[i];
+		if (!bToA[b[i]])
+			bToA[b[i]] = a[i];
+		if (aToB[a[i]] != b[i] || bToA[b[i]] != a[i])
+			return false;
+	}
+	return true;
+}
+
+} // namespace
+
+RAD_TEST(WaterBodies, MatchesFloodFill)
+{
+	uint32_t sizes[][2] = {{1, 1}, {7, 3}, {64, 64}, {129, 77}, {200, 311}};
+	uint32_t tileSizes[] = {1, 5, 16, 128};
+	for (uint32_t seed = 0; seed < 3; seed++)
+		for (auto [width, height] : sizes)
+		{
+			auto water = CreateRandomWater(width, height, seed);
+			std::vector<float> heights(water.size());
+			for (size_t i = 0; i < heights.size(); i++)
+				heights[i] = float(i % 13);
+			auto expected = FloodFillLabels(water, width, height, 0.2f);
+			uint32_t expectedBodies = expected.empty() ? 0 : *std::ranges::max_element(expected);
+
+			for (uint32_t tileSize : tileSizes)
+			{
+				WaterLabelSettings settings{
+					.Threshold = 0.2f, .CellArea = 2.0f, .TileSize = tileSize, .ThreadCount = 4};
+				auto labels = LabelWaterBodies(water, heights, width, height, settings);
+				RAD_CHECK_EQ(labels.Bodies.size(), size_t(expectedBodies));
+				RAD_CHECK(SamePartition(labels.Labels, expected));
+
+				// Per body sums against a plain walk over its cells
+				std::vector<WaterBody> bodies(labels.Bodies.size(), {.MinX = width, .MinY = height});
+				std::vector<double> levels(labels.Bodies.size(), 0.0);
+				for (uint32_t y = 0; y < height; y++)
+					for (uint32_t x = 0; x < width; x++)
+					{
+						uint32_t label = labels.Labels[x + y * width];
+						if (!label)
+							continue;
+						auto& body = bodies[label - 1];
+						body.MinX = std::min(body.MinX, x);
+						body.MinY = std::min(body.MinY, y);
+						body.MaxX = std::max(body.MaxX, x);
+						body.MaxY = std::max(body.MaxY, y);
+						body.Area++;
+						body.Volume += 2.0f * water[x + y * width];
+						levels[label - 1] += water[x + y * width] + heights[x + y * width];
+					}
+				for (size_t i = 0; i < bodies.size(); i++)
+				{
+					auto const& body = labels.Bodies[i];
+					RAD_CHECK(body.MinX == bodies[i].MinX && body.MinY == bodies[i].MinY);
+					RAD_CHECK(body.MaxX == bodies[i].MaxX && body.MaxY == bodies[i].MaxY);
+					RAD_CHECK_EQ(body.Area, bodies[i].Area);
+					RAD_CHECK_NEAR(body.Volume, bodies[i].Volume, 1e-3f * bodies[i].Volume);
+					RAD_CHECK_NEAR(body.MeanLevel, levels[i] / bodies[i].Area, 1e-4);
+				}
+			}
+		}
+}
+
+RAD_TEST(WaterBodies, ThreadCountDoesNotChangeLabels)
+{
+	uint32_t width = 300, height = 257;
+	auto water = CreateRandomWater(width, height, 9);
+	std::vector<float> heights(water.size(), 1.0f);
+	auto single = LabelWaterBodies(water, heights, width, height, {.TileSize = 32, .ThreadCount = 1});
+	for (uint32_t threads : {2u, 4u, 8u})
+	{
+		auto threaded = LabelWaterBodies(water, heights, width, height, {.TileSize = 32, .ThreadCount = threads});
+		RAD_CHECK(threaded.Labels == single.Labels);
+		RAD_CHECK_EQ(threaded.Bodies.size(), single.Bodies.size());
+	}
+}
+
+RAD_TEST(WaterBodies, DryAndFullMaps)
+{
+	std::vector<float> heights(40 * 30, 0.0f);
+	auto dry = LabelWaterBodies(std::vector<float>(heights.size(), 0.0f), heights, 40, 30, {.TileSize = 8});
+	RAD_CHECK(dry.Bodies.empty());
+	RAD_CHECK(std::ranges::all_of(dry.Labels, [](uint32_t label) { return label == 0; }));
+
+	// Threshold is inclusive
+	auto full = LabelWaterBodies(std::vector<float>(heights.size(), 0.2f), heights, 40, 30, {.TileSize = 8});
+	RAD_CHECK_EQ(full.Bodies.size(), 1u);
+	RAD_CHECK(std::ranges::all_of(full.Labels, [](uint32_t label) { return label == 1; }));
+	RAD_CHECK(full.Bodies[0].MinX == 0 && full.Bodies[0].MinY == 0);
+	RAD_CHECK(full.Bodies[0].MaxX == 39 && full.Bodies[0].MaxY == 29);
+	RAD_CHECK_EQ(full.Bodies[0].Area, 40u * 30u);
+
+	auto empty = LabelWaterBodies({}, {}, 0, 0);
+	RAD_CHECK(empty.Labels.empty() && empty.Bodies.empty());
+}
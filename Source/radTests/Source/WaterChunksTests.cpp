@@ -0,0 +1,166 @@
+#include "Test.h"
+
+#include "ProcGen/WaterChunks.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+
+using namespace rad::proc;
+
+namespace
+{
+
+using Triangle = std::array<uint32_t, 3>;
+
+std::vector<Triangle> SortedTriangles(std::span<const uint32_t> indices)
+{
+	std::vector<Triangle> triangles;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		triangles.push_back({indices[i], indices[i + 1], indices[i + 2]});
+	std::ranges::sort(triangles);
+	return triangles;
+}
+
+// The row-major plane the chunked one replaces
+std::vector<uint32_t> RowMajorPlaneIndices(uint32_t resX, uint32_t resY)
+{
+	std::vector<uint32_t> indices;
+	for (uint32_t y = 0; y + 1 < resY; y++)
+		for (uint32_t x = 0; x + 1 < resX; x++)
+		{
+			uint32_t vtx1 = x + y * resX;
+			uint32_t vtx3 = vtx1 + resX;
+			indices.insert(indices.end(), {vtx1, vtx3, vtx1 + 1, vtx3, vtx3 + 1, vtx1 + 1});
+		}
+	return indices;
+}
+
+} // namespace
+
+RAD_TEST(WaterChunks, ChunkedPlaneHasRowMajorTriangles)
+{
+	uint32_t planes[][3] = {{2, 2, 16}, {17, 17, 16}, {18, 33, 16}, {100, 37, 8}, {512, 512, 16}, {9, 70, 1}};
+	for (auto [resX, resY, chunkQuads] : planes)
+	{
+		WaterChunkGrid grid{.ResX = resX, .ResY = resY, .ChunkQuads = chunkQuads};
+		std::vector<uint32_t> offsets;
+		auto indices = BuildChunkedPlaneIndices(grid, offsets);
+		RAD_CHECK(SortedTriangles(indices) == SortedTriangles(RowMajorPlaneIndices(resX, resY)));
+
+		RAD_CHECK_EQ(offsets.size(), size_t(grid.ChunkCount()) + 1);
+		RAD_CHECK_EQ(offsets.front(), 0u);
+		RAD_CHECK_EQ(offsets.back(), uint32_t(indices.size()));
+		RAD_CHECK(std::ranges::is_sorted(offsets));
+		// Every chunk's range only holds quads of that chunk
+		for (uint32_t chunk = 0; chunk < grid.ChunkCount(); chunk++)
+		{
+			uint32_t cx = chunk % grid.ChunksX(), cy = chunk / grid.ChunksX();
+			for (uint32_t i = offsets[chunk]; i < offsets[chunk + 1]; i += 6)
+			{
+				uint32_t x = indices[i] % resX, y = indices[i] / resX;
+				RAD_CHECK(x / chunkQuads == cx && y / chunkQuads == cy);
+			}
+		}
+	}
+}
+
+RAD_TEST(WaterChunks, ClassifiesWithDilation)
+{
+	WaterChunkGrid grid{.ResX = 6 * 4 + 1, .ResY = 5 * 4 + 1, .ChunkQuads = 4};
+	RAD_CHECK_EQ(grid.ChunksX(), 6u);
+	RAD_CHECK_EQ(grid.ChunksY(), 5u);
+	std::vector<float> chunkMax(grid.ChunkCount(), 0.1f);
+	// At the threshold counts as wet, a corner chunk checks the clamping at the edges
+	chunkMax[2 + 2 * 6] = 0.2f;
+	chunkMax[5 + 4 * 6] = 3.0f;
+
+	auto wet = ClassifyWetChunks(chunkMax, grid, 0.2f, 0);
+	RAD_CHECK_EQ(std::ranges::count(wet, uint8_t(1)), 2);
+	RAD_CHECK(wet[2 + 2 * 6] && wet[5 + 4 * 6]);
+
+	wet = ClassifyWetChunks(chunkMax, grid, 0.2f, 1);
+	for (int cy = 0; cy < 5; cy++)
+		for (int cx = 0; cx < 6; cx++)
+		{
+			bool nearCenter = std::abs(cx - 2) <= 1 && std::abs(cy - 2) <= 1;
+			bool nearCorner = cx >= 4 && cy >= 3;
+			RAD_CHECK_EQ(bool(wet[cx + cy * 6]), nearCenter || nearCorner);
+		}
+
+	wet = ClassifyWetChunks(chunkMax, grid, 0.2f, 10);
+	RAD_CHECK_EQ(std::ranges::count(wet, uint8_t(1)), 30);
+	wet = ClassifyWetChunks(chunkMax, grid, 5.0f, 10);
+	RAD_CHECK_EQ(std::ranges::count(wet, uint8_t(0)), 30);
+}
+
+RAD_TEST(WaterChunks, DrawRangesCoverWetChunks)
+{
+	WaterChunkGrid grid{.ResX = 130, .ResY = 70, .ChunkQuads = 16};
+	std::vector<uint32_t> offsets;
+	auto indices = BuildChunkedPlaneIndices(grid, offsets);
+	std::mt19937 generator(5);
+	for (int round = 0; round < 50; round++)
+	{
+		std::vector<uint8_t> wet(grid.ChunkCount());
+		for (auto& chunk : wet)
+			chunk = generator() % 3 == 0;
+		auto ranges = BuildWetDrawRanges(wet, offsets);
+
+		std::vector<uint8_t> drawn(indices.size(), 0);
+		for (size_t i = 0; i < ranges.size(); i++)
+		{
+			RAD_CHECK(ranges[i].IndexCount > 0);
+			// Touching ranges would have been merged
+			if (i > 0)
+				RAD_CHECK(ranges[i - 1].StartIndex + ranges[i - 1].IndexCount < ranges[i].StartIndex);
+			std::fill_n(drawn.begin() + ranges[i].StartIndex, ranges[i].IndexCount, uint8_t(1));
+		}
+		for (uint32_t chunk = 0; chunk < grid.ChunkCount(); chunk++)
+			for (uint32_t i = offsets[chunk]; i < offsets[chunk + 1]; i++)
+				RAD_CHECK_EQ(drawn[i], wet[chunk]);
+	}
+
+	std::vector<uint8_t> allWet(grid.ChunkCount(), 1);
+	auto ranges = BuildWetDrawRanges(allWet, offsets);
+	RAD_CHECK_EQ(ranges.size(), 1u);
+	RAD_CHECK_EQ(ranges[0].IndexCount, uint32_t(indices.size()));
+	RAD_CHECK(BuildWetDrawRanges(std::vector<uint8_t>(grid.ChunkCount(), 0), offsets).empty());
+}
+
+RAD_TEST(WaterChunks, ChunkMaxCoversBilinearFootprint)
+{
+	// One wet texel at a time: every quad whose texture coordinates can filter it must land in a wet chunk
+	uint32_t maps[][2] = {{37, 29}, {64, 64}, {20, 50}};
+	for (auto [mapWidth, mapHeight] : maps)
+	{
+		WaterChunkGrid grid{.ResX = 23, .ResY = 19, .ChunkQuads = 4};
+		std::vector<float> water(size_t(mapWidth) * mapHeight, 0.0f);
+		for (uint32_t texelY = 0; texelY < mapHeight; texelY++)
+			for (uint32_t texelX = 0; texelX < mapWidth; texelX++)
+			{
+				water[texelX + texelY * mapWidth] = 1.0f;
+				auto wet = ClassifyWetChunks(ComputeChunkMaxWater(water, mapWidth, mapHeight, grid), grid, 0.5f, 0);
+				water[texelX + texelY * mapWidth] = 0.0f;
+
+				for (uint32_t y = 0; y + 1 < grid.ResY; y++)
+					for (uint32_t x = 0; x + 1 < grid.ResX; x++)
+					{
+						// Bilinear taps of texture coordinates between the quad's vertices, vertex v is at v / Res
+						auto taps = [](uint32_t vertex, uint32_t res, uint32_t size)
+						{
+							int first = int(std::floor(float(vertex) * size / res - 0.5f));
+							int last = int(std::floor(float(vertex + 1) * size / res - 0.5f)) + 1;
+							return std::pair(std::max(first, 0), std::min(last, int(size) - 1));
+						};
+						auto [minX, maxX] = taps(x, grid.ResX, mapWidth);
+						auto [minY, maxY] = taps(y, grid.ResY, mapHeight);
+						bool filtered = int(texelX) >= minX && int(texelX) <= maxX && int(texelY) >= minY &&
+										int(texelY) <= maxY;
+						if (filtered)
+							RAD_CHECK(wet[x / grid.ChunkQuads + y / grid.ChunkQuads * grid.ChunksX()]);
+					}
+			}
+	}
+}